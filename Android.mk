@@ -34,11 +34,15 @@ LOCAL_SRC_FILES := \
     android/service/platform_service_interface.cpp \
     android/service/platform_service.cpp \
     android/service/platform_api_stub.cpp \
+    src/anbox/common/cache_line_aligned.cpp \
+    src/anbox/common/content_hash.cpp \
     src/anbox/common/fd.cpp \
     src/anbox/common/wait_handle.cpp \
     src/anbox/rpc/message_processor.cpp \
     src/anbox/rpc/pending_call_cache.cpp \
     src/anbox/rpc/channel.cpp \
+    src/anbox/rpc/metrics.cpp \
+    src/anbox/stats/registry.cpp \
     src/anbox/protobuf/anbox_rpc.proto \
     src/anbox/protobuf/anbox_bridge.proto
 proto_header_dir := $(call local-generated-sources-dir)/proto/$(LOCAL_PATH)/src/anbox/protobuf
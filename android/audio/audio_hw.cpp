@@ -41,7 +41,7 @@
 #define PCM_CARD 0
 #define PCM_DEVICE 0
 
-#define OUT_PERIOD_MS 25
+#define OUT_PERIOD_MS 10
 #define OUT_PERIOD_COUNT 4
 
 #define IN_PERIOD_MS 10
@@ -286,6 +286,9 @@ struct generic_stream_out {
     uint64_t frames_total_buffered;
     uint64_t frames_written;
     uint64_t frames_rendered;
+    // Frames the host buffers before playing them back
+    uint32_t host_latency_frames;
+    uint64_t underruns;
 
     pthread_t worker_thread;
     pthread_cond_t worker_wake;
@@ -316,8 +319,19 @@ struct generic_stream_in {
     pthread_cond_t worker_wake;       // Protected by this->lock
     bool worker_standby;              // Protected by this->lock
     bool worker_exit;                 // Protected by this->lock
+
+    // Capture statistics
+    uint64_t periods_received;        // Protected by this->lock
+    int64_t total_latency_us;         // Protected by this->lock
+    int64_t max_latency_us;           // Protected by this->lock
+    uint32_t host_overruns;           // Protected by this->lock
+    uint32_t reported_overruns;       // Protected by this->lock
+    uint64_t underruns;               // Protected by this->lock
 };
 
+// Number of received periods after which the capture statistics are logged
+#define IN_STATS_INTERVAL 500
+
 static struct pcm_config pcm_config_out = {
     .channels = 2,
     .rate = 0,
@@ -376,46 +390,45 @@ static int out_set_format(struct audio_stream *stream, audio_format_t format)
     return -ENOSYS;
 }
 
-static int stop_audio_recording(int fd)
+static int start_audio_streaming(int fd)
 {
-    anbox::audio::RecordCommand recordCmd = anbox::audio::RecordCommand::StopRecord;
-    int errorCode = -1;
+    anbox::audio::RecordCommand recordCmd = anbox::audio::RecordCommand::StartStreaming;
     if (::write(fd, &recordCmd, sizeof(recordCmd)) < 0) {
-        ALOGE("stop_audio_recording, write msg failed");
-        close(fd);
-        return -EIO;
-    }
-
-    auto bytes_read = ::read(fd, &errorCode, sizeof(int));
-    if (bytes_read < 0) {
-        ALOGE("stop_audio_recording,anbox responed error");
-        close(fd);
+        ALOGE("start audio streaming failed");
         return -EIO;
     }
-
-    if (errorCode == 0) {
-        ALOGD("stop audio record sucess");
-    } else {
-        ALOGE("stop audio record failed  errorCode is %d", errorCode);
-        close(fd);
-        return -EIO;
-    }
-
     return 0;
 }
 
-static int start_audio_record(int fd)
+// The host doesn't answer StopRecord while streaming, anything it sent
+// in the meantime is dropped with the connection.
+static void stop_audio_streaming(int fd)
 {
-    anbox::audio::RecordCommand recordCmd = anbox::audio::RecordCommand::StartRecord;
+    anbox::audio::RecordCommand recordCmd = anbox::audio::RecordCommand::StopRecord;
     if (::write(fd, &recordCmd, sizeof(recordCmd)) < 0) {
-        ALOGE("start audio record,failed");
-        close(fd);
-        return -EIO;
+        ALOGE("stop audio streaming, write msg failed");
     }
-    return 0;
+    close(fd);
+}
+
+static bool read_fully(int fd, void *data, size_t size)
+{
+    uint8_t *p = (uint8_t*)data;
+    while (size > 0) {
+        ssize_t r = ::read(fd, p, size);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        p += r;
+        size -= r;
+    }
+    return true;
 }
 
-static int connect_audio_server(const anbox::audio::ClientInfo::Type &type)
+static int connect_audio_server(anbox::audio::ClientInfo *client_info)
 {
     int fd = socket(AF_LOCAL, SOCK_STREAM, 0);
     if (fd < 0) {
@@ -435,17 +448,19 @@ static int connect_audio_server(const anbox::audio::ClientInfo::Type &type)
     // We will send out client type information to the server and the
     // server will either deny the request by closing the connection
     // or by sending us the approved client details back.
-    anbox::audio::ClientInfo client_info{type};
-    if (::write(fd, &client_info, sizeof(client_info)) < 0) {
+    const auto type = client_info->type;
+    client_info->type = static_cast<anbox::audio::ClientInfo::Type>(
+        static_cast<uint8_t>(type) | anbox::audio::ClientInfo::extended_info);
+    if (::write(fd, client_info, sizeof(*client_info)) < 0) {
         close(fd);
         return -EIO;
     }
 
-    auto bytes_read = ::read(fd, &client_info, sizeof(client_info));
-    if (bytes_read < 0) {
+    if (!read_fully(fd, client_info, sizeof(*client_info))) {
         close(fd);
         return -EIO;
     }
+    client_info->type = type;
 
     ALOGE("Successfully connected Anbox audio server");
 
@@ -464,13 +479,17 @@ static int out_dump(const struct audio_stream *stream, int fd)
             "\t\tchannel mask: %08x\n"
             "\t\tformat: %d\n"
             "\t\tdevice: %08x\n"
-            "\t\taudio dev: %p\n\n",
+            "\t\taudio dev: %p\n"
+            "\t\thost latency: %u frames\n"
+            "\t\tunderruns: %llu\n\n",
             out_get_sample_rate(stream),
             out_get_buffer_size(stream),
             out_get_channels(stream),
             out_get_format(stream),
             out->device,
-            out->dev);
+            out->dev,
+            out->host_latency_frames,
+            (unsigned long long)out->underruns);
     pthread_mutex_unlock(&out->lock);
     return 0;
 }
@@ -568,7 +587,10 @@ static char *out_get_parameters(const struct audio_stream *stream, const char *k
 static uint32_t out_get_latency(const struct audio_stream_out *stream)
 {
     struct generic_stream_out *out = (struct generic_stream_out *)stream;
-    return (out->pcm_config.period_size  * 1000) / out->pcm_config.rate;
+    pthread_mutex_lock(&out->lock);
+    const uint32_t latency_frames = out->pcm_config.period_size + out->host_latency_frames;
+    pthread_mutex_unlock(&out->lock);
+    return (latency_frames * 1000) / out->pcm_config.rate;
 }
 
 static int out_set_volume(struct audio_stream_out *stream, float left, float right)
@@ -619,13 +641,25 @@ static void *out_write_worker(void * args)
         }
 
         if (fd < 0) {
-            fd = connect_audio_server(anbox::audio::ClientInfo::Type::Playback);
+            // Let the host open its device with our rate and period size
+            // so it neither resamples nor buffers more than needed.
+            anbox::audio::ClientInfo client_info{anbox::audio::ClientInfo::Type::Playback,
+                                                 out->pcm_config.rate,
+                                                 out->pcm_config.period_size, 0};
+            fd = connect_audio_server(&client_info);
             if (fd < 0) {
                 ret = fd;
                 ALOGE("Failed to connect with Anbox audio servers (err %d)", ret);
                 pthread_mutex_unlock(&out->lock);
                 break;
             }
+            if (client_info.sample_rate != out->pcm_config.rate) {
+                ALOGW("Host plays back at %u Hz instead of %u Hz",
+                      client_info.sample_rate, out->pcm_config.rate);
+            }
+            out->host_latency_frames = client_info.latency_frames;
+            ALOGD("Playback at %u Hz with %u frames periods, host latency %u frames",
+                  out->pcm_config.rate, out->pcm_config.period_size, out->host_latency_frames);
 
             buffer_frames = out->pcm_config.period_size;
             // two channel  16BIT format
@@ -685,6 +719,7 @@ static void get_current_output_position(struct generic_stream_out *out,
         ALOGW("Not supplying enough data to HAL, expected position %lu, only wrote %lu",
                 *position, out->frames_written);
         *position = out->frames_written;
+        out->underruns++;
         out->underrun_position = *position;
         out->underrun_time = curtime;
         out->frames_total_buffered = 0;
@@ -981,13 +1016,22 @@ static int in_dump(const struct audio_stream *stream, int fd)
                 "\t\tchannel mask: %08x\n"
                 "\t\tformat: %d\n"
                 "\t\tdevice: %08x\n"
-                "\t\taudio dev: %p\n\n",
+                "\t\taudio dev: %p\n"
+                "\t\tperiods received: %llu\n"
+                "\t\tlatency avg/max: %lld/%lld us\n"
+                "\t\thost overruns: %u\n"
+                "\t\tunderruns: %llu\n\n",
             in_get_sample_rate(stream),
             in_get_buffer_size(stream),
             in_get_channels(stream),
             in_get_format(stream),
             in->device,
-            in->dev);
+            in->dev,
+            (unsigned long long)in->periods_received,
+            (long long)(in->periods_received ? in->total_latency_us / (int64_t)in->periods_received : 0),
+            (long long)in->max_latency_us,
+            in->host_overruns,
+            (unsigned long long)in->underruns);
     pthread_mutex_unlock(&in->lock);
     return 0;
 }
@@ -1139,25 +1183,23 @@ static void *in_read_worker(void * args)
 {
     struct generic_stream_in *in = (struct generic_stream_in *)args;
     uint8_t *buffer = NULL;
-    size_t buffer_frames;
-    int buffer_size;
+    size_t buffer_size = 0;
+    const size_t frame_size = pcm_frames_to_bytes(&in->pcm_config, 1);
 
     bool restart = false;
     bool shutdown = false;
     int ret = 0;
     int fd = -1;
+    // Overruns the host reported on the current connection
+    uint32_t connection_overruns = 0;
     while (true) {
         pthread_mutex_lock(&in->lock);
         while (in->worker_standby || restart) {
             restart = false;
             if (fd >= 0) {
-                if (stop_audio_recording(fd) == 0) {
-                    ALOGD("stop_audio_recording success fd is %d", fd);
-                    close(fd);
-                }
+                stop_audio_streaming(fd);
+                ALOGD("stopped audio streaming on fd %d", fd);
                 fd = -1;
-                free(buffer);
-                buffer = NULL;
             }
             if (in->worker_exit) {
                 break;
@@ -1178,36 +1220,83 @@ static void *in_read_worker(void * args)
             break;
         }
         if (fd < 0) {
-            fd = connect_audio_server(anbox::audio::ClientInfo::Type::Recording);
+            anbox::audio::ClientInfo client_info{anbox::audio::ClientInfo::Type::Recording, 0, 0, 0};
+            fd = connect_audio_server(&client_info);
             if (fd < 0) {
                 ret = fd;
                 ALOGE("Failed to connect with Anbox audio servers (err %d)", ret);
                 pthread_mutex_unlock(&in->lock);
                 break;
             }
-            buffer_frames = in->pcm_config.period_size;
-            buffer_size = pcm_frames_to_bytes(&in->pcm_config, buffer_frames);
-            buffer = (uint8_t*)malloc(buffer_size);
             if (!buffer) {
-                ALOGE("could not allocate worker read buffer");
-                pthread_mutex_unlock(&in->lock);
-                break;
+                buffer_size = pcm_frames_to_bytes(&in->pcm_config, in->pcm_config.period_size);
+                buffer = (uint8_t*)malloc(buffer_size);
+                if (!buffer) {
+                    ALOGE("could not allocate worker read buffer");
+                    pthread_mutex_unlock(&in->lock);
+                    break;
+                }
             }
+            pthread_mutex_unlock(&in->lock);
+
+            // The host pushes every captured period from now on so we
+            // don't pay for a request round trip per period anymore.
+            connection_overruns = 0;
+            if (start_audio_streaming(fd) != 0) {
+                restart = true;
+                continue;
+            }
+        } else {
+            pthread_mutex_unlock(&in->lock);
         }
-        pthread_mutex_unlock(&in->lock);
-        if (start_audio_record(fd) != 0) {
-            ALOGE("audio start record failed");
+
+        anbox::audio::CapturePeriodHeader header;
+        if (!read_fully(fd, &header, sizeof(header)) || header.size == 0) {
+            ALOGE("audio read failed");
             restart = true;
             continue;
         }
-        int read_bytes = read(fd, buffer, pcm_frames_to_bytes(&in->pcm_config, buffer_frames));
-        if (read_bytes <= 10) {
+        if (header.size > buffer_size) {
+            uint8_t *new_buffer = (uint8_t*)realloc(buffer, header.size);
+            if (!new_buffer) {
+                ALOGE("could not grow worker read buffer to %u bytes", header.size);
+                restart = true;
+                continue;
+            }
+            buffer = new_buffer;
+            buffer_size = header.size;
+        }
+        if (!read_fully(fd, buffer, header.size)) {
             ALOGE("audio read failed");
             restart = true;
             continue;
         }
+
+        struct timespec now = { .tv_sec = 0, .tv_nsec = 0 };
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const int64_t latency_us = (now.tv_sec * 1000000000LL + now.tv_nsec -
+                                    header.capture_time_ns) / 1000;
+        const size_t buffer_frames = header.size / frame_size;
+
         pthread_mutex_lock(&in->lock);
         size_t frames_written = audio_vbuffer_write(&in->buffer, buffer, buffer_frames);
+        if (header.overruns > connection_overruns) {
+            in->host_overruns += header.overruns - connection_overruns;
+            connection_overruns = header.overruns;
+        }
+        in->periods_received++;
+        in->total_latency_us += latency_us;
+        if (latency_us > in->max_latency_us) {
+            in->max_latency_us = latency_us;
+        }
+        if (in->periods_received % IN_STATS_INTERVAL == 0) {
+            ALOGD("in_read_worker: %llu periods, latency avg %lld us max %lld us, "
+                  "%u host overruns, %llu underruns",
+                  (unsigned long long)in->periods_received,
+                  (long long)(in->total_latency_us / (int64_t)in->periods_received),
+                  (long long)in->max_latency_us, in->host_overruns,
+                  (unsigned long long)in->underruns);
+        }
         pthread_mutex_unlock(&in->lock);
 
         if (frames_written != buffer_frames) {
@@ -1305,6 +1394,10 @@ static ssize_t in_read(struct audio_stream_in *stream, void* buffer,
         read_frames = audio_vbuffer_read(&in->buffer, buffer, frames);
     }
 
+    if (!mic_mute && (size_t)read_frames < frames) {
+        in->underruns++;
+    }
+
 exit:
     read_bytes = read_frames * audio_stream_in_frame_size(stream);
 
@@ -1324,7 +1417,14 @@ exit:
 
 static uint32_t in_get_input_frames_lost(struct audio_stream_in *stream)
 {
-    return 0;
+    struct generic_stream_in *in = (struct generic_stream_in *)stream;
+    pthread_mutex_lock(&in->lock);
+    // Every overrun on the host side dropped a whole period
+    const uint32_t lost = (in->host_overruns - in->reported_overruns) *
+                          in->pcm_config.period_size;
+    in->reported_overruns = in->host_overruns;
+    pthread_mutex_unlock(&in->lock);
+    return lost;
 }
 
 static int in_get_capture_position(const struct audio_stream_in *stream,
@@ -1418,6 +1518,8 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     out->frames_total_buffered = 0;
     out->frames_written = 0;
     out->frames_rendered = 0;
+    out->host_latency_frames = 0;
+    out->underruns = 0;
 
     ret = audio_vbuffer_init(&out->buffer,
                       out->pcm_config.period_size*out->pcm_config.period_count,
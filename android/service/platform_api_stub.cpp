@@ -16,12 +16,14 @@
  */
 
 #include "android/service/platform_api_stub.h"
+#include "anbox/common/content_hash.h"
 #include "anbox/rpc/channel.h"
 
 #include "anbox_rpc.pb.h"
 #include "anbox_bridge.pb.h"
 
 #include <fstream>
+#include <set>
 
 #include <sys/stat.h>
 
@@ -30,6 +32,78 @@
 
 namespace {
 constexpr const char *first_boot_marker_path{"/data/.anbox_initialized"};
+constexpr const unsigned int max_deltas_between_snapshots{64};
+
+void convert_window(const anbox::PlatformApiStub::WindowStateUpdate::Window &in,
+                    anbox::protobuf::bridge::WindowStateUpdateEvent_WindowState *out) {
+    out->set_display_id(in.display_id);
+    out->set_has_surface(in.has_surface);
+    out->set_package_name(in.package_name);
+    out->set_frame_left(in.frame.left);
+    out->set_frame_top(in.frame.top);
+    out->set_frame_right(in.frame.right);
+    out->set_frame_bottom(in.frame.bottom);
+    out->set_task_id(in.task_id);
+    out->set_stack_id(in.stack_id);
+    out->set_videofullscreen(false);
+    out->set_flags(1); // window has DecorCaption title when flags = 1, otherwise 0
+}
+
+bool same_windows(const std::vector<anbox::PlatformApiStub::WindowStateUpdate::Window> &a,
+                  const std::vector<anbox::PlatformApiStub::WindowStateUpdate::Window> &b) {
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t n = 0; n < a.size(); n++) {
+        if (a[n].display_id != b[n].display_id ||
+            a[n].has_surface != b[n].has_surface ||
+            a[n].package_name != b[n].package_name ||
+            a[n].frame.left != b[n].frame.left ||
+            a[n].frame.top != b[n].frame.top ||
+            a[n].frame.right != b[n].frame.right ||
+            a[n].frame.bottom != b[n].frame.bottom ||
+            a[n].task_id != b[n].task_id ||
+            a[n].stack_id != b[n].stack_id)
+            return false;
+    }
+    return true;
+}
+
+std::uint64_t hash_application(const anbox::PlatformApiStub::ApplicationListUpdate::Application &a,
+                               std::uint64_t icon_hash) {
+    using anbox::common::content_hash;
+    auto hash = content_hash(&icon_hash, sizeof(icon_hash));
+    // Include the terminating null byte to separate the fields
+    for (const auto &field : {a.name, a.package, a.launch_intent.action, a.launch_intent.uri,
+                              a.launch_intent.type, a.launch_intent.package,
+                              a.launch_intent.component})
+        hash = content_hash(field.c_str(), field.size() + 1, hash);
+    for (const auto &category : a.launch_intent.categories)
+        hash = content_hash(category.c_str(), category.size() + 1, hash);
+    return hash;
+}
+
+void convert_application(const anbox::PlatformApiStub::ApplicationListUpdate::Application &a,
+                         std::uint64_t icon_hash, bool with_icon,
+                         anbox::protobuf::bridge::ApplicationListUpdateEvent_Application *app) {
+    app->set_name(a.name);
+    app->set_package(a.package);
+
+    auto launch_intent = app->mutable_launch_intent();
+    launch_intent->set_action(a.launch_intent.action);
+    launch_intent->set_uri(a.launch_intent.uri);
+    launch_intent->set_type(a.launch_intent.type);
+    launch_intent->set_package(a.launch_intent.package);
+    launch_intent->set_component(a.launch_intent.component);
+    for (const auto &category : a.launch_intent.categories) {
+        auto c = launch_intent->add_categories();
+        *c = category;
+    }
+
+    app->set_icon_hash(icon_hash);
+    if (with_icon)
+        app->set_icon(a.icon.data(), a.icon.size());
+}
 }
 
 namespace anbox {
@@ -51,23 +125,30 @@ void PlatformApiStub::boot_finished() {
 }
 
 void PlatformApiStub::update_window_state(const WindowStateUpdate &state) {
+    // Binder threads call us concurrently and the delta has to go out
+    // before the next one is computed against the same base.
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+
+    std::map<int, std::vector<WindowStateUpdate::Window>> tasks;
+    for (const auto &window : state.updated_windows)
+        tasks[window.task_id].push_back(window);
+
+    // Send a full snapshot from time to time so the host can recover from
+    // deltas it couldn't apply.
+    if (window_state_version_ == 0 || deltas_since_snapshot_ >= max_deltas_between_snapshots) {
+        send_window_state_snapshot(state);
+        deltas_since_snapshot_ = 0;
+    } else {
+        send_window_state_delta(tasks);
+    }
+
+    last_task_windows_ = std::move(tasks);
+}
+
+void PlatformApiStub::send_window_state_snapshot(const WindowStateUpdate &state) {
     protobuf::bridge::EventSequence seq;
     auto event = seq.mutable_window_state_update();
 
-    auto convert_window = [](WindowStateUpdate::Window in, anbox::protobuf::bridge::WindowStateUpdateEvent_WindowState *out) {
-        out->set_display_id(in.display_id);
-        out->set_has_surface(in.has_surface);
-        out->set_package_name(in.package_name);
-        out->set_frame_left(in.frame.left);
-        out->set_frame_top(in.frame.top);
-        out->set_frame_right(in.frame.right);
-        out->set_frame_bottom(in.frame.bottom);
-        out->set_task_id(in.task_id);
-        out->set_stack_id(in.stack_id);
-        out->set_videofullscreen(false);
-        out->set_flags(1); // window has DecorCaption title when flags = 1, otherwise 0
-    };
-
     for (const auto &window : state.updated_windows) {
         auto w = event->add_windows();
         convert_window(window, w);
@@ -78,40 +159,123 @@ void PlatformApiStub::update_window_state(const WindowStateUpdate &state) {
         convert_window(window, w);
     }
 
+    event->set_version(++window_state_version_);
+
+    rpc_channel_->send_event(seq);
+}
+
+void PlatformApiStub::send_window_state_delta(const std::map<int, std::vector<WindowStateUpdate::Window>> &tasks) {
+    protobuf::bridge::EventSequence seq;
+    auto event = seq.mutable_window_state_delta();
+
+    bool changed = false;
+    for (const auto &task : tasks) {
+        auto last = last_task_windows_.find(task.first);
+        if (last == last_task_windows_.end()) {
+            for (const auto &window : task.second)
+                convert_window(window, event->add_added_windows());
+            changed = true;
+        } else if (!same_windows(last->second, task.second)) {
+            for (const auto &window : task.second)
+                convert_window(window, event->add_changed_windows());
+            changed = true;
+        }
+    }
+
+    for (const auto &last : last_task_windows_) {
+        if (tasks.find(last.first) != tasks.end())
+            continue;
+        event->add_removed_tasks(last.first);
+        changed = true;
+    }
+
+    if (!changed)
+        return;
+
+    event->set_base_version(window_state_version_);
+    event->set_version(++window_state_version_);
+    deltas_since_snapshot_++;
+
     rpc_channel_->send_event(seq);
 }
 
 void PlatformApiStub::update_application_list(const ApplicationListUpdate &update) {
+    // LauncherService and the package event receiver may both update
+    // the list at the same time.
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+
+    std::set<std::string> removed(update.removed_applications.begin(),
+                                  update.removed_applications.end());
+    if (update.complete) {
+        std::set<std::string> installed;
+        for (const auto &a : update.applications)
+            installed.insert(a.package);
+        for (const auto &sent : sent_applications_) {
+            if (installed.count(sent.first) == 0)
+                removed.insert(sent.first);
+        }
+    }
+
+    // The host keeps the complete list we sent first and from then on only
+    // gets to know about what changed.
+    const auto first_sync = update.complete && application_list_version_ == 0;
+
     protobuf::bridge::EventSequence seq;
     auto event = seq.mutable_application_list_update();
 
     for (const auto &a : update.applications) {
-        auto app = event->add_applications();
-        app->set_name(a.name);
-        app->set_package(a.package);
-
-        auto launch_intent = app->mutable_launch_intent();
-        launch_intent->set_action(a.launch_intent.action);
-        launch_intent->set_uri(a.launch_intent.uri);
-        launch_intent->set_type(a.launch_intent.type);
-        launch_intent->set_package(a.launch_intent.package);
-        launch_intent->set_component(a.launch_intent.component);
-        for (const auto &category : a.launch_intent.categories) {
-            auto c = launch_intent->add_categories();
-            *c = category;
+        if (a.package.empty() || removed.count(a.package) > 0)
+            continue;
+
+        const auto icon_hash = common::content_hash(a.icon.data(), a.icon.size());
+        const auto hash = hash_application(a, icon_hash);
+
+        auto sent = sent_applications_.find(a.package);
+        if (sent != sent_applications_.end() && sent->second.hash == hash)
+            continue;
+
+        const auto send_icon = (sent == sent_applications_.end() ||
+                                sent->second.icon_hash != icon_hash) &&
+                               a.icon.size() > 0;
+
+        // Send updates with icons separately to not overflow protobuf
+        if (send_icon && event->applications_size() > 0) {
+            send_application_list_update(seq);
+            event = seq.mutable_application_list_update();
         }
 
-        if (a.icon.size() > 0)
-          app->set_icon(a.icon.data(), a.icon.size());
+        convert_application(a, icon_hash, send_icon, event->add_applications());
+        sent_applications_[a.package] = SentApplication{hash, icon_hash};
+
+        if (send_icon) {
+            send_application_list_update(seq);
+            event = seq.mutable_application_list_update();
+        }
     }
 
-    for (const auto &package : update.removed_applications) {
+    for (const auto &package : removed) {
       auto app = event->add_removed_applications();
       app->set_name("unknown");
       app->set_package(package);
+      sent_applications_.erase(package);
     }
 
+    if (first_sync) {
+        for (const auto &sent : sent_applications_)
+            event->add_installed_packages(sent.first);
+    } else if (event->applications_size() == 0 && event->removed_applications_size() == 0) {
+        return;
+    }
+
+    send_application_list_update(seq);
+}
+
+void PlatformApiStub::send_application_list_update(protobuf::bridge::EventSequence &seq) {
+    auto event = seq.mutable_application_list_update();
+    event->set_base_version(application_list_version_);
+    event->set_version(++application_list_version_);
     rpc_channel_->send_event(seq);
+    seq.Clear();
 }
 
 void PlatformApiStub::on_clipboard_data_set(Request<protobuf::rpc::Void> *request) {
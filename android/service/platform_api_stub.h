@@ -20,6 +20,8 @@
 
 #include "anbox/common/wait_handle.h"
 
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
@@ -31,6 +33,7 @@ class Void;
 } // namespace rpc
 namespace bridge {
 class ClipboardData;
+class EventSequence;
 } // namespace bridge
 } // namespace protobuf
 namespace rpc {
@@ -80,6 +83,8 @@ public:
         };
         std::vector<Application> applications;
         std::vector<std::string> removed_applications;
+        // Set if applications lists every installed application.
+        bool complete = false;
     };
 
     void update_application_list(const ApplicationListUpdate &update);
@@ -103,9 +108,29 @@ private:
     void on_clipboard_data_set(Request<protobuf::rpc::Void> *request);
     void on_clipboard_data_get(Request<protobuf::bridge::ClipboardData> *request);
 
+    // Have to be called with mutex_ held.
+    void send_window_state_snapshot(const WindowStateUpdate &state);
+    void send_window_state_delta(const std::map<int, std::vector<WindowStateUpdate::Window>> &tasks);
+    void send_application_list_update(protobuf::bridge::EventSequence &seq);
+
     mutable std::mutex mutex_;
     std::shared_ptr<rpc::Channel> rpc_channel_;
 
+    // Last window state sent to the host grouped by task id. Following
+    // updates are only sent as the difference to it.
+    std::map<int, std::vector<WindowStateUpdate::Window>> last_task_windows_;
+    std::uint64_t window_state_version_ = 0;
+    unsigned int deltas_since_snapshot_ = 0;
+
+    // What we last sent to the host for each application so that only
+    // changed ones are sent again.
+    struct SentApplication {
+        std::uint64_t hash;
+        std::uint64_t icon_hash;
+    };
+    std::map<std::string, SentApplication> sent_applications_;
+    std::uint64_t application_list_version_ = 0;
+
     ClipboardData received_clipboard_data_;
 };
 } // namespace anbox
@@ -118,14 +118,7 @@ status_t PlatformService::update_application_list(const Parcel &data) {
 
         data.readByteVector(&p.icon);
 
-        // Send updates with icons separately to not overflow protobuf
-        if (p.icon.size() > 0) {
-          anbox::PlatformApiStub::ApplicationListUpdate with_icon_update;
-          with_icon_update.applications.push_back(p);
-          platform_api_stub_->update_application_list(with_icon_update);
-        } else {
-          update.applications.push_back(p);
-        }
+        update.applications.push_back(std::move(p));
     }
 
     const auto num_removed_packages = data.readInt32();
@@ -134,6 +127,10 @@ status_t PlatformService::update_application_list(const Parcel &data) {
       update.removed_applications.push_back(package_name.string());
     }
 
+    // The app manager either sends all installed applications or the ones
+    // which were removed.
+    update.complete = num_removed_packages == 0;
+
     platform_api_stub_->update_application_list(update);
 
     return OK;
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Compares how fast GL packet sized buffers get from one thread to another
+// through the mutex protected BufferQueue and the LockFreeBufferQueue.
+
+#include "anbox/graphics/buffer_queue.h"
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace po = boost::program_options;
+
+using anbox::graphics::Buffer;
+using anbox::graphics::BufferQueue;
+using anbox::graphics::LockFreeBufferQueue;
+
+namespace {
+// Size of the packets BufferedIOStream sends by default
+constexpr const size_t packet_size{384};
+
+// Moves |count| GL packet sized buffers from one thread to another and
+// returns how long that took.
+template <typename Push, typename Pop>
+std::chrono::nanoseconds measure_handoff(unsigned int count, Push push, Pop pop) {
+  const auto start = std::chrono::steady_clock::now();
+
+  std::thread consumer([&]() {
+    Buffer buffer;
+    for (unsigned int n = 0; n < count; n++) {
+      if (pop(&buffer) != 0)
+        break;
+    }
+  });
+
+  std::uint8_t packet[packet_size];
+  std::memset(packet, 0, sizeof(packet));
+  for (unsigned int n = 0; n < count; n++) {
+    if (push(Buffer{packet, packet + sizeof(packet)}) != 0)
+      break;
+  }
+
+  consumer.join();
+  return std::chrono::steady_clock::now() - start;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  po::options_description desc("Options");
+  desc.add_options()
+      ("help,h", "Show this help")
+      ("buffers,n", po::value<unsigned int>()->default_value(200000), "Number of buffers moved through each queue")
+      ("capacity,c", po::value<unsigned int>()->default_value(16), "Capacity of the queues");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << "Usage: " << argv[0] << " [options]" << std::endl << desc;
+    return EXIT_SUCCESS;
+  }
+
+  const auto count = vm["buffers"].as<unsigned int>();
+  const auto capacity = vm["capacity"].as<unsigned int>();
+
+  std::mutex lock;
+  BufferQueue locked_queue(capacity);
+  const auto locked = measure_handoff(count,
+    [&](Buffer &&buffer) {
+      std::unique_lock<std::mutex> l(lock);
+      return locked_queue.push_locked(std::move(buffer), l);
+    },
+    [&](Buffer *buffer) {
+      std::unique_lock<std::mutex> l(lock);
+      return locked_queue.pop_locked(buffer, l);
+    });
+
+  LockFreeBufferQueue lock_free_queue(capacity);
+  const auto lock_free = measure_handoff(count,
+    [&](Buffer &&buffer) { return lock_free_queue.push(std::move(buffer)); },
+    [&](Buffer *buffer) { return lock_free_queue.pop(buffer); });
+
+  const auto per_buffer = [&](std::chrono::nanoseconds d) {
+    return count > 0 ? static_cast<double>(d.count()) / count : 0.0;
+  };
+  std::cout << "BufferQueue:         " << per_buffer(locked) << " ns per buffer" << std::endl
+            << "LockFreeBufferQueue: " << per_buffer(lock_free) << " ns per buffer" << std::endl;
+
+  return EXIT_SUCCESS;
+}
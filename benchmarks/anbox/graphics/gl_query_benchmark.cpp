@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Measures the round trip of the synchronous queries the guest issues by
+// sending them one at a time to a RenderThread and waiting for the reply,
+// just like the guest side encoder does:
+//
+//   gl_query_benchmark --software-egl --iterations 10000
+//   gl_query_benchmark --software-egl --no-state-shadow
+
+#include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/graphics/emugl/RenderApi.h"
+#include "anbox/graphics/emugl/RenderControl.h"
+#include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/network/socket_messenger.h"
+
+#include "external/android-emugl/shared/OpenglCodecCommon/GLStateShadow.h"
+
+#include "benchmarks/support/latency_histogram.h"
+
+#include "gles2_opcodes.h"
+// Every API defines its own end marker
+#undef OP_last
+#include "renderControl_opcodes.h"
+#include "renderControl_types.h"
+
+#include <GLES2/gl2.h>
+
+#include <boost/program_options.hpp>
+
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+
+using anbox::benchmarks::LatencyHistogram;
+using anbox::graphics::BufferedIOStream;
+
+namespace {
+// Size of the buffer rcGetGLString is asked to fill
+constexpr const std::uint32_t string_buffer_size{256};
+
+// Collects the replies of the decoders so the caller can wait for them.
+class ReplyMessenger : public anbox::network::SocketMessenger {
+ public:
+  anbox::network::Credentials creds() const override { return {0, 0, 0}; }
+  unsigned short local_port() const override { return 0; }
+  int native_handle() const override { return -1; }
+  void async_wait_writable(AnboxWritableHandler const&) override {}
+  void set_no_delay() override {}
+  void close() override {}
+
+  void send(char const*, size_t) override {}
+  ssize_t send_raw(char const *data, size_t length) override {
+    std::lock_guard<std::mutex> l(lock_);
+    reply_.insert(reply_.end(), data, data + length);
+    received_.notify_all();
+    return length;
+  }
+
+  void async_receive_msg(AnboxReadHandler const&, boost::asio::mutable_buffers_1 const&) override {}
+  boost::system::error_code receive_msg(boost::asio::mutable_buffers_1 const&) override {
+    return boost::system::error_code{};
+  }
+  size_t available_bytes() override { return 0; }
+
+  std::vector<std::uint8_t> wait_for_reply(std::size_t size) {
+    std::unique_lock<std::mutex> l(lock_);
+    received_.wait(l, [&]() { return reply_.size() >= size; });
+    std::vector<std::uint8_t> reply(reply_.begin(), reply_.begin() + size);
+    reply_.erase(reply_.begin(), reply_.begin() + size);
+    return reply;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable received_;
+  std::vector<std::uint8_t> reply_;
+};
+
+// Encodes a command the way the guest side encoder does: opcode, total
+// size and the arguments, where out pointers only carry their size.
+std::vector<std::uint8_t> command(std::uint32_t opcode, const std::vector<std::uint32_t> &args) {
+  const std::uint32_t size = static_cast<std::uint32_t>(sizeof(std::uint32_t) * (2 + args.size()));
+  std::vector<std::uint8_t> data(size);
+  std::memcpy(data.data(), &opcode, sizeof(opcode));
+  std::memcpy(data.data() + sizeof(opcode), &size, sizeof(size));
+  if (!args.empty())
+    std::memcpy(data.data() + 2 * sizeof(std::uint32_t), args.data(), args.size() * sizeof(std::uint32_t));
+  return data;
+}
+
+struct Query {
+  std::string name;
+  std::vector<std::uint8_t> data;
+  std::size_t reply_size;
+  LatencyHistogram latency;
+};
+
+class Connection {
+ public:
+  explicit Connection(const std::shared_ptr<Renderer> &renderer)
+      : messenger_(std::make_shared<ReplyMessenger>()),
+        stream_(std::make_shared<BufferedIOStream>(messenger_)),
+        thread_(RenderThread::create(renderer, stream_.get(), nullptr)) {
+    if (!thread_->start())
+      BOOST_THROW_EXCEPTION(std::runtime_error("Failed to start render thread"));
+  }
+
+  ~Connection() {
+    stream_->forceStop();
+    thread_->wait(nullptr);
+  }
+
+  std::vector<std::uint8_t> call(const std::vector<std::uint8_t> &data, std::size_t reply_size) {
+    stream_->post_data(anbox::graphics::Buffer{data.data(), data.data() + data.size()});
+    return messenger_->wait_for_reply(reply_size);
+  }
+
+  std::uint32_t call_uint32(const std::vector<std::uint8_t> &data) {
+    const auto reply = call(data, sizeof(std::uint32_t));
+    std::uint32_t value = 0;
+    std::memcpy(&value, reply.data(), sizeof(value));
+    return value;
+  }
+
+ private:
+  std::shared_ptr<ReplyMessenger> messenger_;
+  std::shared_ptr<BufferedIOStream> stream_;
+  std::unique_ptr<RenderThread> thread_;
+};
+
+void print_result(const Query &query) {
+  const auto &h = query.latency;
+  std::cout << "  " << query.name
+            << " count=" << h.count()
+            << " " << h.mean_ns() / 1000.0
+            << "/" << h.percentile_ns(50) / 1000.0
+            << "/" << h.percentile_ns(99) / 1000.0
+            << "/" << h.max_ns() / 1000.0;
+  h.print_buckets(std::cout);
+  std::cout << std::endl;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  po::options_description desc("Options");
+  desc.add_options()
+      ("help,h", "Show this help")
+      ("iterations,i", po::value<unsigned int>()->default_value(1000), "Number of times each query is sent")
+      ("software-egl", "Force Mesa's software rasterizer on a surfaceless EGL platform")
+      ("no-state-shadow", "Send all queries to the driver");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << "Usage: " << argv[0] << " [options]" << std::endl << desc;
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("software-egl")) {
+    ::setenv("EGL_PLATFORM", "surfaceless", 1);
+    ::setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+  }
+
+  GLStateShadow::setEnabled(vm.count("no-state-shadow") == 0);
+
+  if (!anbox::graphics::emugl::initialize(anbox::graphics::emugl::default_gl_libraries(), nullptr, nullptr)) {
+    std::cerr << "Failed to initialize OpenGL renderer" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto renderer = std::make_shared<::Renderer>();
+  if (!renderer->initialize(0)) {
+    std::cerr << "Failed to initialize renderer" << std::endl;
+    return EXIT_FAILURE;
+  }
+  registerRenderer(renderer);
+
+  const auto iterations = vm["iterations"].as<unsigned int>();
+
+  std::vector<Query> queries = {
+    {"glGetIntegerv(GL_MAX_TEXTURE_SIZE)",
+     command(OP_glGetIntegerv, {GL_MAX_TEXTURE_SIZE, sizeof(GLint)}), sizeof(GLint), {}},
+    {"glGetError", command(OP_glGetError, {}), sizeof(GLenum), {}},
+    {"glIsEnabled(GL_BLEND)", command(OP_glIsEnabled, {GL_BLEND}), sizeof(GLboolean), {}},
+    {"glGetIntegerv(GL_VIEWPORT)",
+     command(OP_glGetIntegerv, {GL_VIEWPORT, 4 * sizeof(GLint)}), 4 * sizeof(GLint), {}},
+    {"rcGetGLString(GL_VENDOR)",
+     command(OP_rcGetGLString, {GL_VENDOR, string_buffer_size, string_buffer_size}),
+     string_buffer_size + sizeof(EGLint), {}},
+    {"rcGetFBParam(FB_FPS)", command(OP_rcGetFBParam, {FB_FPS}), sizeof(EGLint), {}},
+  };
+
+  {
+    Connection connection(renderer);
+
+    const auto context = connection.call_uint32(command(OP_rcCreateContext, {0, 0, 2}));
+    const auto surface = connection.call_uint32(command(OP_rcCreateWindowSurface, {0, 64, 64}));
+    if (!context || !surface ||
+        !connection.call_uint32(command(OP_rcMakeCurrent, {context, surface, surface}))) {
+      std::cerr << "Failed to make a GLESv2 context current" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    for (unsigned int n = 0; n < iterations; n++) {
+      for (auto &query : queries) {
+        const auto start = std::chrono::steady_clock::now();
+        connection.call(query.data, query.reply_size);
+        query.latency.record(std::chrono::steady_clock::now() - start);
+      }
+    }
+
+    connection.call_uint32(command(OP_rcMakeCurrent, {0, 0, 0}));
+    connection.call(command(OP_rcDestroyWindowSurface, {surface}), 0);
+    connection.call(command(OP_rcDestroyContext, {context}), 0);
+  }
+
+  std::cout << "query round trip (mean/p50/p99/max in us, then histogram buckets), state shadow "
+            << (GLStateShadow::enabled() ? "enabled" : "disabled") << ":" << std::endl;
+  for (const auto &query : queries)
+    print_result(query);
+
+  registerRenderer(nullptr);
+  renderer->finalize();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Replays GL streams captured with ANBOX_GL_CAPTURE_DIR through a
+// RenderThread and reports how fast the host decodes and executes them.
+// Works headless with a software EGL implementation like Mesa's llvmpipe:
+//
+//   gl_replay_benchmark --software-egl /path/to/gl-stream-1234-0.capture
+
+#include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/graphics/emugl/RenderApi.h"
+#include "anbox/graphics/emugl/RenderControl.h"
+#include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/graphics/emugl/Renderer.h"
+#include "anbox/graphics/gl_stream_capture.h"
+#include "anbox/network/socket_messenger.h"
+
+#include "benchmarks/support/latency_histogram.h"
+
+#include <boost/program_options.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+
+using anbox::benchmarks::LatencyHistogram;
+using anbox::graphics::BufferedIOStream;
+using anbox::graphics::GLStreamCapture;
+
+namespace {
+// Size of the chunks we feed the captured stream in, matches what a
+// single socket read hands us in the real setup.
+constexpr const std::size_t chunk_size{8192};
+
+// All replies the decoders write are simply dropped.
+class NullMessenger : public anbox::network::SocketMessenger {
+ public:
+  anbox::network::Credentials creds() const override { return {0, 0, 0}; }
+  unsigned short local_port() const override { return 0; }
+  int native_handle() const override { return -1; }
+  void async_wait_writable(AnboxWritableHandler const&) override {}
+  void set_no_delay() override {}
+  void close() override {}
+
+  void send(char const*, size_t) override {}
+  ssize_t send_raw(char const*, size_t length) override { return length; }
+
+  void async_receive_msg(AnboxReadHandler const&, boost::asio::mutable_buffers_1 const&) override {}
+  boost::system::error_code receive_msg(boost::asio::mutable_buffers_1 const&) override {
+    return boost::system::error_code{};
+  }
+  size_t available_bytes() override { return 0; }
+};
+
+struct Capture {
+  std::string path;
+  std::vector<std::uint8_t> data;
+};
+
+bool load_capture(const std::string &path, Capture *capture) {
+  std::ifstream in(path, std::ios::binary);
+  GLStreamCapture::Header header;
+  if (!GLStreamCapture::read_header(in, &header)) {
+    std::cerr << path << " is not a GL stream capture" << std::endl;
+    return false;
+  }
+
+  capture->path = path;
+  capture->data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+std::string opcode_api(std::uint32_t opcode) {
+  if (opcode >= 10000)
+    return "rc";
+  else if (opcode >= 2048)
+    return "gles2";
+  else if (opcode >= 1024)
+    return "gles1";
+  return "unknown";
+}
+
+struct Result {
+  std::uint64_t commands = 0;
+  std::uint64_t bytes = 0;
+  std::chrono::nanoseconds duration{0};
+  std::map<std::uint32_t, LatencyHistogram> opcodes;
+};
+
+void replay(const std::shared_ptr<Renderer> &renderer, const Capture &capture,
+            BufferedIOStream::IngestMode ingest_mode, Result *result) {
+  auto stream = std::make_shared<BufferedIOStream>(
+      std::make_shared<NullMessenger>(), BufferedIOStream::default_buffer_size, ingest_mode);
+
+  std::unique_ptr<RenderThread> thread(RenderThread::create(renderer, stream.get(), nullptr));
+  // Only the render thread updates the result until we joined it
+  thread->setCommandObserver([&](std::uint32_t opcode, std::uint32_t size, std::chrono::nanoseconds duration) {
+    result->commands++;
+    result->bytes += size;
+    result->opcodes[opcode].record(duration);
+  });
+
+  const auto start = std::chrono::steady_clock::now();
+  if (!thread->start())
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to start render thread"));
+
+  std::size_t offset = 0;
+  while (offset < capture.data.size()) {
+    auto size = std::min(chunk_size, capture.data.size() - offset);
+    if (ingest_mode == BufferedIOStream::IngestMode::Streaming) {
+      std::size_t available = 0;
+      auto dst = stream->prepare_data(&available);
+      if (!dst)
+        break;
+      size = std::min(size, available);
+      std::memcpy(dst, capture.data.data() + offset, size);
+      stream->commit_data(size);
+    } else {
+      stream->post_data(anbox::graphics::Buffer{capture.data.data() + offset,
+                                                capture.data.data() + offset + size});
+    }
+    offset += size;
+  }
+
+  // The render thread still decodes everything which was queued before it
+  // notices the stream was closed.
+  stream->forceStop();
+  thread->wait(nullptr);
+  result->duration += std::chrono::steady_clock::now() - start;
+}
+
+void print_result(const std::string &name, const Result &result) {
+  const auto seconds = std::chrono::duration<double>(result.duration).count();
+
+  std::cout << name << std::endl
+            << "  commands:    " << result.commands << std::endl
+            << "  bytes:       " << result.bytes << std::endl
+            << "  duration:    " << seconds * 1000.0 << " ms" << std::endl
+            << "  commands/s:  " << (seconds > 0 ? result.commands / seconds : 0) << std::endl
+            << "  MB/s:        " << (seconds > 0 ? result.bytes / seconds / (1024 * 1024) : 0) << std::endl
+            << "  per-opcode latency (mean/p50/p99/max in us, then histogram buckets):" << std::endl;
+
+  for (const auto &op : result.opcodes) {
+    const auto &h = op.second;
+    std::cout << "    " << opcode_api(op.first) << ":" << op.first
+              << " count=" << h.count()
+              << " " << h.mean_ns() / 1000.0
+              << "/" << h.percentile_ns(50) / 1000.0
+              << "/" << h.percentile_ns(99) / 1000.0
+              << "/" << h.max_ns() / 1000.0;
+    h.print_buckets(std::cout);
+    std::cout << std::endl;
+  }
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  po::options_description desc("Options");
+  desc.add_options()
+      ("help,h", "Show this help")
+      ("iterations,i", po::value<unsigned int>()->default_value(1), "Number of times each capture is replayed")
+      ("streaming", "Feed the captures through the zero-copy streaming ingest path")
+      ("software-egl", "Force Mesa's software rasterizer on a surfaceless EGL platform")
+      ("capture", po::value<std::vector<std::string>>(), "GL stream captures to replay");
+
+  po::positional_options_description positional;
+  positional.add("capture", -1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    po::notify(vm);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help") || !vm.count("capture")) {
+    std::cout << "Usage: " << argv[0] << " [options] <capture>..." << std::endl << desc;
+    return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (vm.count("software-egl")) {
+    ::setenv("EGL_PLATFORM", "surfaceless", 1);
+    ::setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+  }
+
+  std::vector<Capture> captures;
+  for (const auto &path : vm["capture"].as<std::vector<std::string>>()) {
+    Capture capture;
+    if (!load_capture(path, &capture))
+      return EXIT_FAILURE;
+    captures.push_back(std::move(capture));
+  }
+
+  if (!anbox::graphics::emugl::initialize(anbox::graphics::emugl::default_gl_libraries(), nullptr, nullptr)) {
+    std::cerr << "Failed to initialize OpenGL renderer" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto renderer = std::make_shared<::Renderer>();
+  if (!renderer->initialize(0)) {
+    std::cerr << "Failed to initialize renderer" << std::endl;
+    return EXIT_FAILURE;
+  }
+  registerRenderer(renderer);
+
+  const auto ingest_mode = vm.count("streaming") ?
+        BufferedIOStream::IngestMode::Streaming : BufferedIOStream::IngestMode::Queued;
+  const auto iterations = vm["iterations"].as<unsigned int>();
+
+  Result total;
+  for (const auto &capture : captures) {
+    Result result;
+    for (unsigned int n = 0; n < iterations; n++)
+      replay(renderer, capture, ingest_mode, &result);
+    print_result(capture.path, result);
+
+    total.commands += result.commands;
+    total.bytes += result.bytes;
+    total.duration += result.duration;
+  }
+
+  if (captures.size() > 1)
+    std::cout << "total: " << total.commands << " commands, "
+              << std::chrono::duration<double>(total.duration).count() << " s" << std::endl;
+
+  registerRenderer(nullptr);
+  renderer->finalize();
+
+  return EXIT_SUCCESS;
+}
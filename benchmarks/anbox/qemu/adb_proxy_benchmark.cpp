@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Pushes data from a fake adb server through qemu::AdbMessageProcessor
+// to a fake adbd like `adb push` does and reports the throughput:
+//
+//   adb_proxy_benchmark --megabytes 512 --sessions 2
+//
+// The proxy notifies an adb server on the default port about every
+// session, so make sure none is running while benchmarking.
+
+#include "anbox/network/connections.h"
+#include "anbox/network/local_socket_messenger.h"
+#include "anbox/network/socket_connection.h"
+#include "anbox/qemu/adb_message_processor.h"
+#include "anbox/runtime.h"
+
+#include "benchmarks/support/latency_histogram.h"
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ba = boost::asio;
+namespace po = boost::program_options;
+
+using anbox::benchmarks::LatencyHistogram;
+
+namespace {
+struct Session {
+  std::shared_ptr<ba::local::stream_protocol::socket> guest;
+  std::shared_ptr<ba::local::stream_protocol::socket> adbd;
+  std::shared_ptr<anbox::qemu::AdbMessageProcessor> processor;
+  std::shared_ptr<ba::ip::tcp::socket> host;
+
+  std::chrono::nanoseconds duration{0};
+  LatencyHistogram writes;
+};
+
+bool write_all(int fd, const std::uint8_t *data, std::size_t size) {
+  while (size > 0) {
+    const auto n = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool read_all(int fd, std::uint8_t *data, std::size_t size) {
+  while (size > 0) {
+    const auto n = ::read(fd, data, size);
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Runs the accept/ok/start handshake adbd does for every new transport
+bool connect_session(const std::shared_ptr<anbox::Runtime> &rt, Session *session) {
+  const auto adbd = session->adbd->native_handle();
+  if (!write_all(adbd, reinterpret_cast<const std::uint8_t*>("accept"), 6))
+    return false;
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    const auto port = session->processor->listen_port();
+    if (port > 0) {
+      session->host = std::make_shared<ba::ip::tcp::socket>(rt->service());
+      boost::system::error_code err;
+      session->host->connect(ba::ip::tcp::endpoint(ba::ip::address_v4::loopback(), port), err);
+      if (!err)
+        break;
+      session->host.reset();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  if (!session->host)
+    return false;
+
+  std::uint8_t ok[2];
+  if (!read_all(adbd, ok, sizeof(ok)) || std::memcmp(ok, "ok", 2) != 0)
+    return false;
+
+  return write_all(adbd, reinterpret_cast<const std::uint8_t*>("start"), 5);
+}
+
+void push(Session *session, std::size_t total, std::size_t chunk_size) {
+  std::vector<std::uint8_t> chunk(chunk_size, 'x');
+  const auto host = session->host->native_handle();
+  const auto adbd = session->adbd->native_handle();
+
+  std::thread receiver([&]() {
+    std::vector<std::uint8_t> buffer(256 * 1024);
+    std::size_t received = 0;
+    while (received < total) {
+      const auto n = ::read(adbd, buffer.data(), std::min(buffer.size(), total - received));
+      if (n <= 0)
+        break;
+      received += n;
+    }
+  });
+
+  const auto start = std::chrono::steady_clock::now();
+  std::size_t sent = 0;
+  while (sent < total) {
+    const auto size = std::min(chunk_size, total - sent);
+    const auto write_start = std::chrono::steady_clock::now();
+    if (!write_all(host, chunk.data(), size))
+      break;
+    session->writes.record(std::chrono::steady_clock::now() - write_start);
+    sent += size;
+  }
+  receiver.join();
+  session->duration = std::chrono::steady_clock::now() - start;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  po::options_description desc("Options");
+  desc.add_options()
+      ("help,h", "Show this help")
+      ("megabytes,m", po::value<std::size_t>()->default_value(256), "Amount of data pushed per session")
+      ("chunk-size", po::value<std::size_t>()->default_value(64 * 1024), "Size of a single write of the adb server")
+      ("sessions,s", po::value<unsigned int>()->default_value(1), "Number of concurrently proxied sessions")
+      ("port,p", po::value<unsigned short>()->default_value(5575), "Listen port of the first session")
+      ("copy", "Copy proxied data through user space instead of splicing it");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << "Usage: " << argv[0] << " [options]" << std::endl << desc;
+    return EXIT_SUCCESS;
+  }
+
+  const auto total = vm["megabytes"].as<std::size_t>() * 1024 * 1024;
+  const auto chunk_size = std::max<std::size_t>(vm["chunk-size"].as<std::size_t>(), 1);
+  const auto num_sessions = std::max(vm["sessions"].as<unsigned int>(), 1U);
+
+  anbox::qemu::AdbMessageProcessor::Config config{num_sessions, vm.count("copy") == 0,
+                                                  vm["port"].as<unsigned short>()};
+
+  auto rt = anbox::Runtime::create();
+  rt->start();
+
+  auto connections = std::make_shared<anbox::network::Connections<anbox::network::SocketConnection>>();
+  std::vector<Session> sessions(num_sessions);
+  for (unsigned int n = 0; n < num_sessions; n++) {
+    auto &session = sessions[n];
+    session.guest = std::make_shared<ba::local::stream_protocol::socket>(rt->service());
+    session.adbd = std::make_shared<ba::local::stream_protocol::socket>(rt->service());
+    ba::local::connect_pair(*session.guest, *session.adbd);
+
+    auto messenger = std::make_shared<anbox::network::LocalSocketMessenger>(session.guest);
+    session.processor = std::make_shared<anbox::qemu::AdbMessageProcessor>(rt, messenger, config);
+    auto connection = std::make_shared<anbox::network::SocketConnection>(
+        messenger, messenger, n, connections, session.processor);
+    connections->add(connection);
+    connection->read_next_message();
+
+    if (!connect_session(rt, &session)) {
+      std::cerr << "Failed to set up proxied session " << n << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pushers;
+  for (auto &session : sessions)
+    pushers.emplace_back(push, &session, total, chunk_size);
+  for (auto &pusher : pushers)
+    pusher.join();
+  const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "mode:         " << (config.zero_copy ? "splice" : "copy") << std::endl;
+  for (unsigned int n = 0; n < num_sessions; n++) {
+    const auto &session = sessions[n];
+    const auto session_seconds = std::chrono::duration<double>(session.duration).count();
+    std::cout << "session " << n << ":    " << (total / session_seconds / (1024 * 1024)) << " MB/s, "
+              << "per write (mean/p50/p99/max in us): "
+              << session.writes.mean_ns() / 1000.0 << "/"
+              << session.writes.percentile_ns(50) / 1000.0 << "/"
+              << session.writes.percentile_ns(99) / 1000.0 << "/"
+              << session.writes.max_ns() / 1000.0 << std::endl;
+  }
+  std::cout << "total MB/s:   " << (total * num_sessions / seconds / (1024 * 1024)) << std::endl;
+
+  connections->clear();
+  rt->stop();
+
+  return EXIT_SUCCESS;
+}
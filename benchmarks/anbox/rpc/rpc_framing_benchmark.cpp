@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Feeds a stream of framed RPC messages with a configurable mix of small
+// and large payloads through rpc::MessageProcessor and reports how fast
+// they are framed and parsed:
+//
+//   rpc_framing_benchmark --messages 100000 --large-percent 5 --large-size 262144
+
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/message_processor.h"
+
+#include "benchmarks/support/latency_histogram.h"
+
+#include "anbox_rpc.pb.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+
+using anbox::benchmarks::LatencyHistogram;
+
+namespace {
+class CountingMessageProcessor : public anbox::rpc::MessageProcessor {
+ public:
+  CountingMessageProcessor()
+      : anbox::rpc::MessageProcessor(nullptr, std::make_shared<anbox::rpc::PendingCallCache>()) {}
+
+  void dispatch(anbox::rpc::Invocation const &invocation) override {
+    messages++;
+    payload_bytes += invocation.parameters().size();
+  }
+
+  std::uint64_t messages = 0;
+  std::uint64_t payload_bytes = 0;
+};
+
+void append_invocation(std::size_t parameter_size, std::vector<std::uint8_t> *stream) {
+  anbox::protobuf::rpc::Invocation invocation;
+  invocation.set_id(1);
+  invocation.set_method_name("benchmark");
+  invocation.set_parameters(std::string(parameter_size, 'x'));
+  invocation.set_protocol_version(1);
+
+  const auto payload = invocation.SerializeAsString();
+  const auto offset = stream->size();
+  stream->resize(offset + anbox::rpc::header_size + payload.size());
+
+  auto message = stream->data() + offset;
+  message[0] = static_cast<std::uint8_t>((payload.size() >> 16) & 0xff);
+  message[1] = static_cast<std::uint8_t>((payload.size() >> 8) & 0xff);
+  message[2] = static_cast<std::uint8_t>(payload.size() & 0xff);
+  message[3] = anbox::rpc::MessageType::invocation;
+  std::memcpy(message + anbox::rpc::header_size, payload.data(), payload.size());
+}
+
+struct Result {
+  std::uint64_t messages = 0;
+  std::uint64_t bytes = 0;
+  std::chrono::nanoseconds duration{0};
+  LatencyHistogram reads;
+};
+
+void run(const std::vector<std::uint8_t> &stream, std::size_t read_size, bool copy, Result *result) {
+  CountingMessageProcessor processor;
+
+  std::size_t offset = 0;
+  const auto start = std::chrono::steady_clock::now();
+  while (offset < stream.size()) {
+    const auto read_start = std::chrono::steady_clock::now();
+
+    auto size = std::min(read_size, stream.size() - offset);
+    if (copy) {
+      // Like a socket read into an intermediate buffer handed over by value
+      std::vector<std::uint8_t> data(stream.begin() + offset, stream.begin() + offset + size);
+      processor.process_data(data);
+    } else {
+      std::size_t available = 0;
+      auto dst = processor.prepare_data(&available);
+      size = std::min(size, available);
+      std::memcpy(dst, stream.data() + offset, size);
+      processor.commit_data(size);
+    }
+    offset += size;
+
+    result->reads.record(std::chrono::steady_clock::now() - read_start);
+  }
+  result->duration += std::chrono::steady_clock::now() - start;
+  result->messages += processor.messages;
+  result->bytes += stream.size();
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  po::options_description desc("Options");
+  desc.add_options()
+      ("help,h", "Show this help")
+      ("messages,n", po::value<unsigned int>()->default_value(100000), "Number of messages in the stream")
+      ("large-percent", po::value<unsigned int>()->default_value(5), "Share of large messages in percent")
+      ("small-size", po::value<std::size_t>()->default_value(64), "Payload size of small messages")
+      ("large-size", po::value<std::size_t>()->default_value(256 * 1024), "Payload size of large messages")
+      ("read-size", po::value<std::size_t>()->default_value(8192), "Maximum number of bytes a single read hands over")
+      ("iterations,i", po::value<unsigned int>()->default_value(5), "Number of times the stream is processed")
+      ("copy", "Feed the stream through process_data() instead of reading into the processor's buffer");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << "Usage: " << argv[0] << " [options]" << std::endl << desc;
+    return EXIT_SUCCESS;
+  }
+
+  const auto num_messages = vm["messages"].as<unsigned int>();
+  const auto large_percent = std::min(vm["large-percent"].as<unsigned int>(), 100U);
+  const auto small_size = vm["small-size"].as<std::size_t>();
+  const auto large_size = vm["large-size"].as<std::size_t>();
+  const auto read_size = std::max<std::size_t>(vm["read-size"].as<std::size_t>(), 1);
+
+  // Messages are framed with a 24 bit size
+  if (large_size + 64 >= (1 << 24) || small_size + 64 >= (1 << 24)) {
+    std::cerr << "Payloads need to be smaller than 16 MiB" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<unsigned int> percent(0, 99);
+  std::vector<std::uint8_t> stream;
+  for (unsigned int n = 0; n < num_messages; n++)
+    append_invocation(percent(rng) < large_percent ? large_size : small_size, &stream);
+
+  Result result;
+  const auto iterations = vm["iterations"].as<unsigned int>();
+  for (unsigned int n = 0; n < iterations; n++)
+    run(stream, read_size, vm.count("copy") > 0, &result);
+
+  const auto seconds = std::chrono::duration<double>(result.duration).count();
+  std::cout << "messages:     " << result.messages << " (" << large_percent << "% with "
+            << large_size << " bytes, others with " << small_size << " bytes)" << std::endl
+            << "messages/s:   " << static_cast<std::uint64_t>(result.messages / seconds) << std::endl
+            << "MB/s:         " << (result.bytes / seconds / (1024 * 1024)) << std::endl
+            << "per read (mean/p50/p99/max in us): "
+            << result.reads.mean_ns() / 1000.0 << "/"
+            << result.reads.percentile_ns(50) / 1000.0 << "/"
+            << result.reads.percentile_ns(99) / 1000.0 << "/"
+            << result.reads.max_ns() / 1000.0 << std::endl
+            << "   ";
+  result.reads.print_buckets(std::cout);
+  std::cout << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_BENCHMARKS_SUPPORT_LATENCY_HISTOGRAM_H_
+#define ANBOX_BENCHMARKS_SUPPORT_LATENCY_HISTOGRAM_H_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+namespace anbox {
+namespace benchmarks {
+// Latency histogram with power of two nanosecond buckets. Cheap enough to
+// be updated for every single sample.
+class LatencyHistogram {
+ public:
+  static constexpr const std::size_t num_buckets{40};
+
+  void record(std::chrono::nanoseconds duration) {
+    const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+    std::size_t bucket = 0;
+    while (bucket < num_buckets - 1 && (std::uint64_t{1} << (bucket + 1)) <= ns)
+      bucket++;
+    buckets_[bucket]++;
+    count_++;
+    total_ += ns;
+    max_ = std::max(max_, ns);
+  }
+
+  std::uint64_t count() const { return count_; }
+  std::uint64_t total_ns() const { return total_; }
+  std::uint64_t max_ns() const { return max_; }
+  std::uint64_t mean_ns() const { return count_ > 0 ? total_ / count_ : 0; }
+
+  // Upper bound of the bucket the given percentile falls into.
+  std::uint64_t percentile_ns(double percentile) const {
+    const auto wanted = static_cast<std::uint64_t>(count_ * percentile / 100.0);
+    std::uint64_t seen = 0;
+    for (std::size_t n = 0; n < num_buckets; n++) {
+      seen += buckets_[n];
+      if (seen > wanted)
+        return std::min(max_, (std::uint64_t{1} << (n + 1)) - 1);
+    }
+    return max_;
+  }
+
+  // Prints all non-empty buckets as '<upper bound in us>:<count>'.
+  void print_buckets(std::ostream &out) const {
+    for (std::size_t n = 0; n < num_buckets; n++) {
+      if (buckets_[n] == 0)
+        continue;
+      out << " <" << std::setprecision(3) << ((std::uint64_t{1} << (n + 1)) / 1000.0)
+          << "us:" << buckets_[n];
+    }
+  }
+
+ private:
+  std::array<std::uint64_t, num_buckets> buckets_{};
+  std::uint64_t count_ = 0;
+  std::uint64_t total_ = 0;
+  std::uint64_t max_ = 0;
+};
+}  // namespace benchmarks
+}  // namespace anbox
+
+#endif
@@ -15,6 +15,8 @@
 */
 #include "GLESv1Decoder.h"
 
+#include "gles1_opcodes.h"
+
 #include <EGL/egl.h>
 #include <GLES/gl.h>
 #include <GLES/glext.h>
@@ -31,6 +33,7 @@ GLESv1Decoder::GLESv1Decoder()
 {
     m_contextData = NULL;
     m_glesDso = NULL;
+    m_driver = DriverProcs();
 }
 
 GLESv1Decoder::~GLESv1Decoder()
@@ -66,9 +69,216 @@ int GLESv1Decoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
     glDrawElementsData = s_glDrawElementsData;
     glFinishRoundTrip = s_glFinishRoundTrip;
 
+#define SHADOW_PROC(name) \
+    m_driver.name = reinterpret_cast<decltype(m_driver.name)>(getProcFunc(#name, getProcFuncData)); \
+    name = s_##name
+
+    SHADOW_PROC(glGetError);
+    SHADOW_PROC(glGetIntegerv);
+    SHADOW_PROC(glGetBooleanv);
+    SHADOW_PROC(glGetFloatv);
+    SHADOW_PROC(glIsEnabled);
+    SHADOW_PROC(glEnable);
+    SHADOW_PROC(glDisable);
+    SHADOW_PROC(glViewport);
+    SHADOW_PROC(glScissor);
+    SHADOW_PROC(glPixelStorei);
+    SHADOW_PROC(glActiveTexture);
+#undef SHADOW_PROC
+
     return 0;
 }
 
+size_t GLESv1Decoder::decode(void *buf, size_t len, IOStream *stream)
+{
+    GLStateShadow *shadow = stateShadow();
+    if (shadow && shadow->errorsPossible() == false) {
+        // The guest waits for the reply of every query so they come last.
+        // Looking at the commands up to the first one which isn't a query
+        // is enough to know whether this batch can raise errors.
+        unsigned char *ptr = (unsigned char *)buf;
+        size_t pos = 0;
+        while (len - pos >= 8) {
+            uint32_t opcode = *(uint32_t *)(ptr + pos);
+            size_t packetLen = *(uint32_t *)(ptr + pos + 4);
+            if (packetLen < 8 || len - pos < packetLen ||
+                opcode < OP_glAlphaFunc || opcode >= OP_last) {
+                break;
+            }
+            if (opcode != OP_glGetError && opcode != OP_glGetIntegerv &&
+                opcode != OP_glGetBooleanv && opcode != OP_glGetFloatv &&
+                opcode != OP_glIsEnabled) {
+                shadow->markErrorsPossible();
+                break;
+            }
+            pos += packetLen;
+        }
+    }
+    return gles1_decoder_context_t::decode(buf, len, stream);
+}
+
+GLStateShadow *GLESv1Decoder::stateShadow() const
+{
+    if (m_contextData == NULL || !GLStateShadow::enabled()) {
+        return NULL;
+    }
+    return &m_contextData->stateShadow();
+}
+
+bool GLESv1Decoder::isInvariant(GLenum pname)
+{
+    switch (pname) {
+    case GL_ALIASED_LINE_WIDTH_RANGE:
+    case GL_ALIASED_POINT_SIZE_RANGE:
+    case GL_MAX_CLIP_PLANES:
+    case GL_MAX_LIGHTS:
+    case GL_MAX_MODELVIEW_STACK_DEPTH:
+    case GL_MAX_PROJECTION_STACK_DEPTH:
+    case GL_MAX_TEXTURE_SIZE:
+    case GL_MAX_TEXTURE_STACK_DEPTH:
+    case GL_MAX_TEXTURE_UNITS:
+    case GL_MAX_VIEWPORT_DIMS:
+    case GL_NUM_COMPRESSED_TEXTURE_FORMATS:
+    case GL_SMOOTH_LINE_WIDTH_RANGE:
+    case GL_SMOOTH_POINT_SIZE_RANGE:
+    case GL_SUBPIXEL_BITS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+GLenum GLESv1Decoder::s_glGetError(void *self)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->errorsPossible() == false) {
+        return GL_NO_ERROR;
+    }
+
+    GLenum err = ctx->m_driver.glGetError();
+    if (shadow && err == GL_NO_ERROR) {
+        shadow->clearErrorsPossible();
+    }
+    return err;
+}
+
+void GLESv1Decoder::s_glGetIntegerv(void *self, GLenum pname, GLint *params)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->getIntegerv(pname, params)) {
+        return;
+    }
+
+    ctx->m_driver.glGetIntegerv(pname, params);
+    if (shadow) {
+        shadow->storeIntegerv(pname, params, isInvariant(pname));
+    }
+}
+
+void GLESv1Decoder::s_glGetBooleanv(void *self, GLenum pname, GLboolean *params)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->getBooleanv(pname, params)) {
+        return;
+    }
+
+    ctx->m_driver.glGetBooleanv(pname, params);
+    if (shadow) {
+        shadow->storeBooleanv(pname, params, isInvariant(pname));
+    }
+}
+
+void GLESv1Decoder::s_glGetFloatv(void *self, GLenum pname, GLfloat *params)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->getFloatv(pname, params)) {
+        return;
+    }
+
+    ctx->m_driver.glGetFloatv(pname, params);
+    if (shadow) {
+        shadow->storeFloatv(pname, params, isInvariant(pname));
+    }
+}
+
+GLboolean GLESv1Decoder::s_glIsEnabled(void *self, GLenum cap)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    GLboolean enabled = GL_FALSE;
+    if (shadow && shadow->isEnabled(cap, &enabled)) {
+        return enabled;
+    }
+
+    enabled = ctx->m_driver.glIsEnabled(cap);
+    if (shadow) {
+        shadow->storeEnabled(cap, enabled);
+    }
+    return enabled;
+}
+
+void GLESv1Decoder::s_glEnable(void *self, GLenum cap)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    ctx->m_driver.glEnable(cap);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setEnabled(cap, true);
+    }
+}
+
+void GLESv1Decoder::s_glDisable(void *self, GLenum cap)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    ctx->m_driver.glDisable(cap);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setEnabled(cap, false);
+    }
+}
+
+void GLESv1Decoder::s_glViewport(void *self, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    ctx->m_driver.glViewport(x, y, width, height);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        GLint maxDims[2];
+        s_glGetIntegerv(self, GL_MAX_VIEWPORT_DIMS, maxDims);
+        shadow->setViewport(x, y, width, height, maxDims);
+    }
+}
+
+void GLESv1Decoder::s_glScissor(void *self, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    ctx->m_driver.glScissor(x, y, width, height);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setScissor(x, y, width, height);
+    }
+}
+
+void GLESv1Decoder::s_glPixelStorei(void *self, GLenum pname, GLint param)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    ctx->m_driver.glPixelStorei(pname, param);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setPixelStore(pname, param);
+    }
+}
+
+void GLESv1Decoder::s_glActiveTexture(void *self, GLenum texture)
+{
+    GLESv1Decoder *ctx = (GLESv1Decoder *)self;
+    ctx->m_driver.glActiveTexture(texture);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        GLint maxUnits = 0;
+        s_glGetIntegerv(self, GL_MAX_TEXTURE_UNITS, &maxUnits);
+        shadow->setActiveTexture(texture, maxUnits);
+    }
+}
+
 int GLESv1Decoder::s_glFinishRoundTrip(void *self)
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *)self;
@@ -207,7 +417,7 @@ void GLESv1Decoder::s_glDrawElementsData(void *self, GLenum mode, GLsizei count,
 void GLESv1Decoder::s_glGetCompressedTextureFormats(void *self, GLint count, GLint *data)
 {
     GLESv1Decoder *ctx = (GLESv1Decoder *) self;
-    ctx->glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, data);
+    ctx->m_driver.glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, data);
 }
 
 void *GLESv1Decoder::s_getProc(const char *name, void *userData)
@@ -30,6 +30,9 @@ public:
     ~GLESv1Decoder();
     int initGL(get_proc_func_t getProcFunc, void *getProcFuncData);
     void setContextData(GLDecoderContextData *contextData) { m_contextData = contextData; }
+    // Lets the state shadow of the current context know when commands
+    // which may raise GL errors go to the driver before decoding them.
+    size_t decode(void *buf, size_t bufsize, IOStream *stream);
 
 private:
     static void gles1_APIENTRY s_glGetCompressedTextureFormats(void * self, GLint cont, GLint *data);
@@ -59,10 +62,40 @@ private:
 
     static int gles1_APIENTRY s_glFinishRoundTrip(void *self);
 
+    static GLenum gles1_APIENTRY s_glGetError(void *self);
+    static void gles1_APIENTRY s_glGetIntegerv(void *self, GLenum pname, GLint *params);
+    static void gles1_APIENTRY s_glGetBooleanv(void *self, GLenum pname, GLboolean *params);
+    static void gles1_APIENTRY s_glGetFloatv(void *self, GLenum pname, GLfloat *params);
+    static GLboolean gles1_APIENTRY s_glIsEnabled(void *self, GLenum cap);
+    static void gles1_APIENTRY s_glEnable(void *self, GLenum cap);
+    static void gles1_APIENTRY s_glDisable(void *self, GLenum cap);
+    static void gles1_APIENTRY s_glViewport(void *self, GLint x, GLint y, GLsizei width, GLsizei height);
+    static void gles1_APIENTRY s_glScissor(void *self, GLint x, GLint y, GLsizei width, GLsizei height);
+    static void gles1_APIENTRY s_glPixelStorei(void *self, GLenum pname, GLint param);
+    static void gles1_APIENTRY s_glActiveTexture(void *self, GLenum texture);
+
     static void * s_getProc(const char *name, void *userData);
 
     GLDecoderContextData *m_contextData;
     emugl::SharedLibrary* m_glesDso;
+
+    // Driver entry points of the calls the state shadow sits in front of
+    struct DriverProcs {
+        GLenum (gles1_APIENTRY *glGetError)();
+        void (gles1_APIENTRY *glGetIntegerv)(GLenum pname, GLint *params);
+        void (gles1_APIENTRY *glGetBooleanv)(GLenum pname, GLboolean *params);
+        void (gles1_APIENTRY *glGetFloatv)(GLenum pname, GLfloat *params);
+        GLboolean (gles1_APIENTRY *glIsEnabled)(GLenum cap);
+        void (gles1_APIENTRY *glEnable)(GLenum cap);
+        void (gles1_APIENTRY *glDisable)(GLenum cap);
+        void (gles1_APIENTRY *glViewport)(GLint x, GLint y, GLsizei width, GLsizei height);
+        void (gles1_APIENTRY *glScissor)(GLint x, GLint y, GLsizei width, GLsizei height);
+        void (gles1_APIENTRY *glPixelStorei)(GLenum pname, GLint param);
+        void (gles1_APIENTRY *glActiveTexture)(GLenum texture);
+    } m_driver;
+
+    GLStateShadow *stateShadow() const;
+    static bool isInvariant(GLenum pname);
 };
 
 #endif
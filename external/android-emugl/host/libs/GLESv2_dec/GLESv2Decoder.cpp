@@ -15,6 +15,7 @@
 */
 
 #include "GLESv2Decoder.h"
+#include "gles2_opcodes.h"
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
@@ -28,6 +29,7 @@ GLESv2Decoder::GLESv2Decoder()
 {
     m_contextData = NULL;
     m_GL2library = NULL;
+    m_driver = DriverProcs();
 }
 
 GLESv2Decoder::~GLESv2Decoder()
@@ -65,10 +67,254 @@ int GLESv2Decoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
     glDrawElementsData = s_glDrawElementsData;
     glShaderString = s_glShaderString;
     glFinishRoundTrip = s_glFinishRoundTrip;
+
+#define SHADOW_PROC(name) \
+    m_driver.name = reinterpret_cast<decltype(m_driver.name)>(getProcFunc(#name, getProcFuncData)); \
+    name = s_##name
+
+    SHADOW_PROC(glGetError);
+    SHADOW_PROC(glGetIntegerv);
+    SHADOW_PROC(glGetBooleanv);
+    SHADOW_PROC(glGetFloatv);
+    SHADOW_PROC(glIsEnabled);
+    SHADOW_PROC(glEnable);
+    SHADOW_PROC(glDisable);
+    SHADOW_PROC(glViewport);
+    SHADOW_PROC(glScissor);
+    SHADOW_PROC(glPixelStorei);
+    SHADOW_PROC(glActiveTexture);
+#undef SHADOW_PROC
     return 0;
 
 }
 
+size_t GLESv2Decoder::decode(void *buf, size_t len, IOStream *stream)
+{
+    GLStateShadow *shadow = stateShadow();
+    if (shadow && shadow->errorsPossible() == false) {
+        // The guest waits for the reply of every query so they come last.
+        // Looking at the commands up to the first one which isn't a query
+        // is enough to know whether this batch can raise errors.
+        unsigned char *ptr = (unsigned char *)buf;
+        size_t pos = 0;
+        while (len - pos >= 8) {
+            uint32_t opcode = *(uint32_t *)(ptr + pos);
+            size_t packetLen = *(uint32_t *)(ptr + pos + 4);
+            if (packetLen < 8 || len - pos < packetLen ||
+                opcode < OP_glActiveTexture || opcode >= OP_last) {
+                break;
+            }
+            if (opcode != OP_glGetError && opcode != OP_glGetIntegerv &&
+                opcode != OP_glGetBooleanv && opcode != OP_glGetFloatv &&
+                opcode != OP_glIsEnabled) {
+                shadow->markErrorsPossible();
+                break;
+            }
+            pos += packetLen;
+        }
+    }
+    return gles2_decoder_context_t::decode(buf, len, stream);
+}
+
+GLStateShadow *GLESv2Decoder::stateShadow() const
+{
+    if (m_contextData == NULL || !GLStateShadow::enabled()) {
+        return NULL;
+    }
+    return &m_contextData->stateShadow();
+}
+
+bool GLESv2Decoder::bindCachedBuffer(GLenum target, const void *data, GLuint datalen, VertexDataCache::Digest *digest)
+{
+    if (datalen < VertexDataCache::kMinDataSize || VertexDataCache::capacity() == 0) {
+        return false;
+    }
+
+    VertexDataCache &cache = m_contextData->vertexDataCache();
+    *digest = VertexDataCache::digest(data, datalen);
+    GLuint buffer = cache.lookup(*digest, datalen);
+    if (buffer != 0) {
+        this->glBindBuffer(target, buffer);
+        return true;
+    }
+
+    if (!cache.seenRecently(*digest, datalen)) {
+        return false;
+    }
+
+    std::vector<GLuint> evicted;
+    const bool fits = cache.reserve(datalen, &evicted);
+    if (!evicted.empty()) {
+        this->glDeleteBuffers(static_cast<GLsizei>(evicted.size()), evicted.data());
+    }
+    if (!fits) {
+        return false;
+    }
+
+    this->glGenBuffers(1, &buffer);
+    this->glBindBuffer(target, buffer);
+    this->glBufferData(target, datalen, data, GL_STATIC_DRAW);
+    cache.insert(*digest, datalen, buffer);
+    return true;
+}
+
+bool GLESv2Decoder::isInvariant(GLenum pname)
+{
+    switch (pname) {
+    case GL_ALIASED_LINE_WIDTH_RANGE:
+    case GL_ALIASED_POINT_SIZE_RANGE:
+    case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+    case GL_MAX_CUBE_MAP_TEXTURE_SIZE:
+    case GL_MAX_FRAGMENT_UNIFORM_VECTORS:
+    case GL_MAX_RENDERBUFFER_SIZE:
+    case GL_MAX_TEXTURE_IMAGE_UNITS:
+    case GL_MAX_TEXTURE_SIZE:
+    case GL_MAX_VARYING_VECTORS:
+    case GL_MAX_VERTEX_ATTRIBS:
+    case GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS:
+    case GL_MAX_VERTEX_UNIFORM_VECTORS:
+    case GL_MAX_VIEWPORT_DIMS:
+    case GL_NUM_COMPRESSED_TEXTURE_FORMATS:
+    case GL_NUM_SHADER_BINARY_FORMATS:
+    case GL_SHADER_COMPILER:
+    case GL_SUBPIXEL_BITS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+GLenum GLESv2Decoder::s_glGetError(void *self)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->errorsPossible() == false) {
+        return GL_NO_ERROR;
+    }
+
+    GLenum err = ctx->m_driver.glGetError();
+    if (shadow && err == GL_NO_ERROR) {
+        shadow->clearErrorsPossible();
+    }
+    return err;
+}
+
+void GLESv2Decoder::s_glGetIntegerv(void *self, GLenum pname, GLint *params)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->getIntegerv(pname, params)) {
+        return;
+    }
+
+    ctx->m_driver.glGetIntegerv(pname, params);
+    if (shadow) {
+        shadow->storeIntegerv(pname, params, isInvariant(pname));
+    }
+}
+
+void GLESv2Decoder::s_glGetBooleanv(void *self, GLenum pname, GLboolean *params)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->getBooleanv(pname, params)) {
+        return;
+    }
+
+    ctx->m_driver.glGetBooleanv(pname, params);
+    if (shadow) {
+        shadow->storeBooleanv(pname, params, isInvariant(pname));
+    }
+}
+
+void GLESv2Decoder::s_glGetFloatv(void *self, GLenum pname, GLfloat *params)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    if (shadow && shadow->getFloatv(pname, params)) {
+        return;
+    }
+
+    ctx->m_driver.glGetFloatv(pname, params);
+    if (shadow) {
+        shadow->storeFloatv(pname, params, isInvariant(pname));
+    }
+}
+
+GLboolean GLESv2Decoder::s_glIsEnabled(void *self, GLenum cap)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    GLStateShadow *shadow = ctx->stateShadow();
+    GLboolean enabled = GL_FALSE;
+    if (shadow && shadow->isEnabled(cap, &enabled)) {
+        return enabled;
+    }
+
+    enabled = ctx->m_driver.glIsEnabled(cap);
+    if (shadow) {
+        shadow->storeEnabled(cap, enabled);
+    }
+    return enabled;
+}
+
+void GLESv2Decoder::s_glEnable(void *self, GLenum cap)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->m_driver.glEnable(cap);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setEnabled(cap, true);
+    }
+}
+
+void GLESv2Decoder::s_glDisable(void *self, GLenum cap)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->m_driver.glDisable(cap);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setEnabled(cap, false);
+    }
+}
+
+void GLESv2Decoder::s_glViewport(void *self, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->m_driver.glViewport(x, y, width, height);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        GLint maxDims[2];
+        s_glGetIntegerv(self, GL_MAX_VIEWPORT_DIMS, maxDims);
+        shadow->setViewport(x, y, width, height, maxDims);
+    }
+}
+
+void GLESv2Decoder::s_glScissor(void *self, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->m_driver.glScissor(x, y, width, height);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setScissor(x, y, width, height);
+    }
+}
+
+void GLESv2Decoder::s_glPixelStorei(void *self, GLenum pname, GLint param)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->m_driver.glPixelStorei(pname, param);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        shadow->setPixelStore(pname, param);
+    }
+}
+
+void GLESv2Decoder::s_glActiveTexture(void *self, GLenum texture)
+{
+    GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    ctx->m_driver.glActiveTexture(texture);
+    if (GLStateShadow *shadow = ctx->stateShadow()) {
+        GLint maxUnits = 0;
+        s_glGetIntegerv(self, GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxUnits);
+        shadow->setActiveTexture(texture, maxUnits);
+    }
+}
+
 int GLESv2Decoder::s_glFinishRoundTrip(void *self)
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *)self;
@@ -81,11 +327,11 @@ void GLESv2Decoder::s_glGetCompressedTextureFormats(void *self, int count, GLint
     GLESv2Decoder *ctx = (GLESv2Decoder *) self;
 
     int nFormats;
-    ctx->glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &nFormats);
+    ctx->m_driver.glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &nFormats);
     if (nFormats > count) {
         fprintf(stderr, "%s: GetCompressedTextureFormats: The requested number of formats does not match the number that is reported by OpenGL\n", __FUNCTION__);
     } else {
-        ctx->glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats);
+        ctx->m_driver.glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats);
     }
 }
 
@@ -94,9 +340,19 @@ void GLESv2Decoder::s_glVertexAttribPointerData(void *self, GLuint indx, GLint s
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *) self;
     if (ctx->m_contextData != NULL) {
-        ctx->m_contextData->storePointerData(indx, data, datalen);
+        VertexDataCache &cache = ctx->m_contextData->vertexDataCache();
+        VertexDataCache::Digest digest;
         // note - the stride of the data is always zero when it comes out of the codec.
         // See gl2.attrib for the packing function call.
+        if (ctx->bindCachedBuffer(GL_ARRAY_BUFFER, data, datalen, &digest)) {
+            ctx->glVertexAttribPointer(indx, size, type, normalized, 0, NULL);
+            // The guest unbinds its array buffer before sending client arrays
+            ctx->glBindBuffer(GL_ARRAY_BUFFER, 0);
+            cache.attachAttrib(indx, digest, datalen);
+            return;
+        }
+        cache.detachAttrib(indx);
+        ctx->m_contextData->storePointerData(indx, data, datalen);
         ctx->glVertexAttribPointer(indx, size, type, normalized, 0, ctx->m_contextData->pointerData(indx));
     }
 }
@@ -105,6 +361,9 @@ void GLESv2Decoder::s_glVertexAttribPointerOffset(void *self, GLuint indx, GLint
                                                GLboolean normalized, GLsizei stride,  GLuint data)
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *) self;
+    if (ctx->m_contextData != NULL) {
+        ctx->m_contextData->vertexDataCache().detachAttrib(indx);
+    }
     ctx->glVertexAttribPointer(indx, size, type, normalized, stride, SafePointerFromUInt(data));
 }
 
@@ -112,6 +371,14 @@ void GLESv2Decoder::s_glVertexAttribPointerOffset(void *self, GLuint indx, GLint
 void GLESv2Decoder::s_glDrawElementsData(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen)
 {
     GLESv2Decoder *ctx = (GLESv2Decoder *)self;
+    VertexDataCache::Digest digest;
+    if (ctx->m_contextData != NULL &&
+        ctx->bindCachedBuffer(GL_ELEMENT_ARRAY_BUFFER, data, datalen, &digest)) {
+        ctx->glDrawElements(mode, count, type, NULL);
+        // The guest unbinds its element array buffer before sending index data
+        ctx->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        return;
+    }
     ctx->glDrawElements(mode, count, type, data);
 }
 
@@ -29,10 +29,32 @@ public:
     ~GLESv2Decoder();
     int initGL(get_proc_func_t getProcFunc, void *getProcFuncData);
     void setContextData(GLDecoderContextData *contextData) { m_contextData = contextData; }
+    // Lets the state shadow of the current context know when commands
+    // which may raise GL errors go to the driver before decoding them.
+    size_t decode(void *buf, size_t bufsize, IOStream *stream);
 private:
     GLDecoderContextData *m_contextData;
     emugl::SharedLibrary* m_GL2library;
 
+    // Driver entry points of the calls the state shadow sits in front of
+    struct DriverProcs {
+        GLenum (gles2_APIENTRY *glGetError)();
+        void (gles2_APIENTRY *glGetIntegerv)(GLenum pname, GLint *params);
+        void (gles2_APIENTRY *glGetBooleanv)(GLenum pname, GLboolean *params);
+        void (gles2_APIENTRY *glGetFloatv)(GLenum pname, GLfloat *params);
+        GLboolean (gles2_APIENTRY *glIsEnabled)(GLenum cap);
+        void (gles2_APIENTRY *glEnable)(GLenum cap);
+        void (gles2_APIENTRY *glDisable)(GLenum cap);
+        void (gles2_APIENTRY *glViewport)(GLint x, GLint y, GLsizei width, GLsizei height);
+        void (gles2_APIENTRY *glScissor)(GLint x, GLint y, GLsizei width, GLsizei height);
+        void (gles2_APIENTRY *glPixelStorei)(GLenum pname, GLint param);
+        void (gles2_APIENTRY *glActiveTexture)(GLenum texture);
+    } m_driver;
+
+    GLStateShadow *stateShadow() const;
+    static bool isInvariant(GLenum pname);
+    bool bindCachedBuffer(GLenum target, const void *data, GLuint datalen, VertexDataCache::Digest *digest);
+
     static void *s_getProc(const char *name, void *userData);
     static void gles2_APIENTRY s_glGetCompressedTextureFormats(void *self, int count, GLint *formats);
     static void gles2_APIENTRY s_glVertexAttribPointerData(void *self, GLuint indx, GLint size, GLenum type,
@@ -44,5 +66,17 @@ private:
     static void gles2_APIENTRY s_glDrawElementsData(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen);
     static void gles2_APIENTRY s_glShaderString(void *self, GLuint shader, const GLchar* string, GLsizei len);
     static int  gles2_APIENTRY s_glFinishRoundTrip(void *self);
+
+    static GLenum gles2_APIENTRY s_glGetError(void *self);
+    static void gles2_APIENTRY s_glGetIntegerv(void *self, GLenum pname, GLint *params);
+    static void gles2_APIENTRY s_glGetBooleanv(void *self, GLenum pname, GLboolean *params);
+    static void gles2_APIENTRY s_glGetFloatv(void *self, GLenum pname, GLfloat *params);
+    static GLboolean gles2_APIENTRY s_glIsEnabled(void *self, GLenum cap);
+    static void gles2_APIENTRY s_glEnable(void *self, GLenum cap);
+    static void gles2_APIENTRY s_glDisable(void *self, GLenum cap);
+    static void gles2_APIENTRY s_glViewport(void *self, GLint x, GLint y, GLsizei width, GLsizei height);
+    static void gles2_APIENTRY s_glScissor(void *self, GLint x, GLint y, GLsizei width, GLsizei height);
+    static void gles2_APIENTRY s_glPixelStorei(void *self, GLenum pname, GLint param);
+    static void gles2_APIENTRY s_glActiveTexture(void *self, GLenum texture);
 };
 #endif
@@ -758,6 +758,9 @@ int ApiGen::genDecoderHeader(const std::string &filename)
         fprintf(fp, "\n#include <mutex>\n");
     }
     fprintf(fp, "\n#include \"emugl/common/logging.h\"\n");
+    if (m_profiling) {
+        fprintf(fp, "#include \"DecoderProfile.h\"\n");
+    }
 
     for (size_t i = 0; i < m_decoderHeaders.size(); i++) {
         fprintf(fp, "#include %s\n", m_decoderHeaders[i].c_str());
@@ -767,6 +770,11 @@ int ApiGen::genDecoderHeader(const std::string &filename)
     fprintf(fp, "struct %s : public %s_%s_context_t {\n\n",
             classname.c_str(), m_basename.c_str(), sideString(SERVER_SIDE));
     fprintf(fp, "\tsize_t decode(void *buf, size_t bufsize, IOStream *stream);\n");
+    if (m_profiling) {
+        fprintf(fp, "\tstatic const char *opcodeName(uint32_t opcode);\n");
+        fprintf(fp, "\temugl::DecoderProfile m_profile{%u, %u, &%s::opcodeName};\n",
+                (unsigned int)m_baseOpcode, (unsigned int)size(), classname.c_str());
+    }
     if (strcmp(classname.c_str(), "gles2_decoder_context_t") == 0){ 
 	fprintf(fp, 
 			"\tvoid freeShader(); \n\
@@ -884,6 +892,18 @@ int ApiGen::genDecoderImpl(const std::string &filename)
 }\n\n");
     }
 
+    if (m_profiling) {
+        fprintf(fp, "const char *%s::opcodeName(uint32_t opcode)\n{\n", classname.c_str());
+        fprintf(fp, "\tswitch(opcode) {\n");
+        for (size_t f = 0; f < n; f++) {
+            fprintf(fp, "\tcase OP_%s: return \"%s\";\n",
+                    at(f).name().c_str(), at(f).name().c_str());
+        }
+        fprintf(fp, "\tdefault: return NULL;\n");
+        fprintf(fp, "\t}\n");
+        fprintf(fp, "}\n\n");
+    }
+
     // decoder switch;
     fprintf(fp, "size_t %s::decode(void *buf, size_t len, IOStream *stream)\n{\n", classname.c_str());
     fprintf(fp,
@@ -894,7 +914,12 @@ int ApiGen::genDecoderImpl(const std::string &filename)
 \tbool unknownOpcode = false;  \n\
 #ifdef CHECK_GL_ERROR \n\
 \tchar lastCall[256] = {0}; \n\
-#endif \n\
+#endif \n");
+    if (m_profiling) {
+        fprintf(fp, "\tconst bool profiling = emugl::DecoderProfile::enabled();\n");
+    }
+    fprintf(fp,
+            "\
 \twhile ((len - pos >= 8) && !unknownOpcode) {   \n\
 \t\tuint32_t opcode = *(uint32_t *)ptr;   \n\
 \t\tsize_t packetLen = *(uint32_t *)(ptr + 4);\n\
@@ -903,8 +928,14 @@ int ApiGen::genDecoderImpl(const std::string &filename)
 \t\tsize_t checksumSize = 0;\n\
 \t\tif (useChecksum) {\n\
 \t\t\tchecksumSize = ChecksumCalculatorThreadInfo::checksumByteSize();\n\
-\t\t}\n\
-\t\tswitch(opcode) {\n");
+\t\t}\n");
+    if (m_profiling) {
+        fprintf(fp,
+                "\t\tconst bool timed = profiling && m_profile.begin(opcode, packetLen);\n"
+                "\t\tstd::chrono::steady_clock::time_point start;\n"
+                "\t\tif (timed) start = std::chrono::steady_clock::now();\n");
+    }
+    fprintf(fp, "\t\tswitch(opcode) {\n");
 
     for (size_t f = 0; f < n; f++) {
         enum Pass_t {
@@ -1276,9 +1307,14 @@ int ApiGen::genDecoderImpl(const std::string &filename)
     fprintf(fp, "\t\t\tdefault:\n");
     fprintf(fp, "\t\t\t\tunknownOpcode = true;\n");
     fprintf(fp, "\t\t} //switch\n");
+    if (m_profiling) {
+        fprintf(fp, "\t\tif (timed) m_profile.end(opcode, std::chrono::steady_clock::now() - start);\n");
+    }
     if (strstr(m_basename.c_str(), "gl")) {
         fprintf(fp, "#ifdef CHECK_GL_ERROR\n");
-        fprintf(fp, "\tint err = lastCall[0] ? this->glGetError() : GL_NO_ERROR;\n");
+        EntryPoint *getError = findEntryByName("glGetError");
+        fprintf(fp, "\tint err = lastCall[0] ? this->glGetError(%s) : GL_NO_ERROR;\n",
+                getError && getError->customDecoder() ? "this" : "");
         fprintf(fp, "\tif (err) fprintf(stderr, \"%s Error: 0x%%X in %%s\\n\", err, lastCall);\n", m_basename.c_str());
         fprintf(fp, "#endif\n");
     }
@@ -30,7 +30,8 @@ public:
     ApiGen(const std::string & basename) :
         m_basename(basename),
         m_maxEntryPointsParams(0),
-        m_baseOpcode(0)
+        m_baseOpcode(0),
+        m_profiling(false)
     { }
     virtual ~ApiGen() {}
     int readSpec(const std::string & filename);
@@ -41,6 +42,8 @@ public:
     }
     int baseOpcode() { return m_baseOpcode; }
     void setBaseOpcode(int base) { m_baseOpcode = base; }
+    // Make the decoder count and time the commands it executes per opcode
+    void setProfiling(bool profiling) { m_profiling = profiling; }
 
     const char *sideString(SideType side) {
         const char *retval;
@@ -91,6 +94,7 @@ protected:
     StringVec m_decoderHeaders;
     size_t m_maxEntryPointsParams; // record the maximum number of parameters in the entry points;
     int m_baseOpcode;
+    bool m_profiling;
     int setGlobalAttribute(const std::string & line, size_t lc);
 };
 
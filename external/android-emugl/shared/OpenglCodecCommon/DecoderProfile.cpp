@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DecoderProfile.h"
+
+#include <algorithm>
+
+namespace emugl {
+
+const uint64_t DecoderProfile::kSampleInterval;
+
+std::atomic<bool> DecoderProfile::s_enabled{false};
+
+DecoderProfile::DecoderProfile(uint32_t firstOpcode, uint32_t count,
+                               OpcodeNameFunc opcodeName)
+    : m_firstOpcode(firstOpcode), m_opcodeName(opcodeName), m_stats(count) {}
+
+void DecoderProfile::setEnabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::vector<DecoderProfile::Entry> DecoderProfile::top(size_t count) const {
+    std::vector<Entry> entries;
+    for (size_t n = 0; n < m_stats.size(); n++) {
+        const Stats& s = m_stats[n];
+        if (s.calls == 0)
+            continue;
+
+        const uint32_t opcode = m_firstOpcode + n;
+        // Integer maths would overflow for long running threads
+        const uint64_t estimatedNs = s.timedCalls == 0 ? 0 :
+                static_cast<uint64_t>(static_cast<double>(s.timedNs) / s.timedCalls * s.calls);
+        entries.push_back({opcode, m_opcodeName ? m_opcodeName(opcode) : nullptr,
+                           s.calls, s.bytes, estimatedNs});
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.estimatedNs != b.estimatedNs)
+            return a.estimatedNs > b.estimatedNs;
+        return a.bytes > b.bytes;
+    });
+
+    if (entries.size() > count)
+        entries.resize(count);
+    return entries;
+}
+
+void DecoderProfile::reset() {
+    std::fill(m_stats.begin(), m_stats.end(), Stats());
+}
+
+}  // namespace emugl
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef EMUGL_DECODER_PROFILE_H
+#define EMUGL_DECODER_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace emugl {
+
+// Per opcode statistics of the commands a decoder generated by emugen with
+// the -P option executed. Every decoder context owns one and only ever
+// touches it from the thread it decodes on, so recording a command is a
+// couple of plain increments. Profiling is switched on and off for all
+// decoders at once and costs a single relaxed load per decode() call while
+// it is off.
+class DecoderProfile {
+public:
+    typedef const char* (*OpcodeNameFunc)(uint32_t opcode);
+
+    struct Entry {
+        uint32_t opcode;
+        const char* name;
+        uint64_t calls;
+        uint64_t bytes;
+        // Time spent executing all calls, extrapolated from the timed ones
+        uint64_t estimatedNs;
+    };
+
+    // Only every n-th call of an opcode is timed as reading the clock costs
+    // more than executing many of the small commands. Has to be a power of two.
+    static const uint64_t kSampleInterval = 32;
+
+    DecoderProfile(uint32_t firstOpcode, uint32_t count, OpcodeNameFunc opcodeName);
+
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // Records a command of |bytes| size with |opcode| and returns true when
+    // its execution should be timed and reported through end().
+    bool begin(uint32_t opcode, size_t bytes) {
+        const uint32_t index = opcode - m_firstOpcode;
+        if (opcode < m_firstOpcode || index >= m_stats.size())
+            return false;
+        Stats& s = m_stats[index];
+        s.bytes += bytes;
+        return (s.calls++ & (kSampleInterval - 1)) == 0;
+    }
+
+    void end(uint32_t opcode, std::chrono::steady_clock::duration elapsed) {
+        Stats& s = m_stats[opcode - m_firstOpcode];
+        s.timedCalls++;
+        s.timedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    // Returns the |count| opcodes with most execution time, most expensive first.
+    std::vector<Entry> top(size_t count) const;
+
+    void reset();
+
+private:
+    struct Stats {
+        uint64_t calls = 0;
+        uint64_t bytes = 0;
+        uint64_t timedCalls = 0;
+        uint64_t timedNs = 0;
+    };
+
+    static std::atomic<bool> s_enabled;
+
+    uint32_t m_firstOpcode;
+    OpcodeNameFunc m_opcodeName;
+    std::vector<Stats> m_stats;
+};
+
+}  // namespace emugl
+
+#endif  // EMUGL_DECODER_PROFILE_H
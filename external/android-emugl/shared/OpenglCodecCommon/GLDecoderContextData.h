@@ -15,6 +15,9 @@
 */
 #pragma once
 
+#include "GLStateShadow.h"
+#include "VertexDataCache.h"
+
 #include <vector>
 #include <string>
 
@@ -23,7 +26,8 @@
 
 // Convenient class used to hold the common context data shared
 // by both the GLESv1 and GLESv2 decoders. This corresponds to
-// vertex attribute buffers.
+// vertex attribute buffers, the buffer objects client side vertex
+// data is cached in and the shadow of the context's GL state.
 class  GLDecoderContextData {
 public:
     // List of supported vertex attribute indices, as they appear in
@@ -74,9 +78,14 @@ public:
         }
     }
 
+    GLStateShadow& stateShadow() { return mStateShadow; }
+    VertexDataCache& vertexDataCache() { return mVertexDataCache; }
+
 private:
     static const int kMaxVertexAttributes = 64;
 
     std::vector<std::string> mPointerData;
     unsigned mNumLocations = 0;
+    GLStateShadow mStateShadow;
+    VertexDataCache mVertexDataCache;
 };
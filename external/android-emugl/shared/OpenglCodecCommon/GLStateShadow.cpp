@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GLStateShadow.h"
+
+#include <algorithm>
+
+std::atomic<bool> GLStateShadow::s_enabled{true};
+
+void GLStateShadow::setEnabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+// Capabilities which are valid for GLESv1 as well as for GLESv2
+bool GLStateShadow::isTrackedCap(GLenum cap) {
+    switch (cap) {
+    case GL_BLEND:
+    case GL_CULL_FACE:
+    case GL_DEPTH_TEST:
+    case GL_DITHER:
+    case GL_POLYGON_OFFSET_FILL:
+    case GL_SAMPLE_ALPHA_TO_COVERAGE:
+    case GL_SAMPLE_COVERAGE:
+    case GL_SCISSOR_TEST:
+    case GL_STENCIL_TEST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool GLStateShadow::isTrackedState(GLenum pname) {
+    switch (pname) {
+    case GL_VIEWPORT:
+    case GL_SCISSOR_BOX:
+    case GL_PACK_ALIGNMENT:
+    case GL_UNPACK_ALIGNMENT:
+    case GL_ACTIVE_TEXTURE:
+        return true;
+    default:
+        return isTrackedCap(pname);
+    }
+}
+
+bool GLStateShadow::isKnownString(GLenum name) {
+    switch (name) {
+    case GL_VENDOR:
+    case GL_RENDERER:
+    case GL_VERSION:
+    case GL_EXTENSIONS:
+    case GL_SHADING_LANGUAGE_VERSION:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool GLStateShadow::getIntegerv(GLenum pname, GLint* params) const {
+    auto state = m_state.find(pname);
+    if (state != m_state.end()) {
+        std::copy(state->second.begin(), state->second.end(), params);
+        return true;
+    }
+    auto value = m_integers.find(pname);
+    if (value == m_integers.end())
+        return false;
+    std::copy(value->second.begin(), value->second.end(), params);
+    return true;
+}
+
+bool GLStateShadow::getBooleanv(GLenum pname, GLboolean* params) const {
+    auto state = m_state.find(pname);
+    if (state != m_state.end()) {
+        for (size_t n = 0; n < state->second.size(); n++)
+            params[n] = state->second[n] != 0 ? GL_TRUE : GL_FALSE;
+        return true;
+    }
+    auto value = m_booleans.find(pname);
+    if (value == m_booleans.end())
+        return false;
+    std::copy(value->second.begin(), value->second.end(), params);
+    return true;
+}
+
+bool GLStateShadow::getFloatv(GLenum pname, GLfloat* params) const {
+    auto state = m_state.find(pname);
+    if (state != m_state.end()) {
+        for (size_t n = 0; n < state->second.size(); n++)
+            params[n] = static_cast<GLfloat>(state->second[n]);
+        return true;
+    }
+    auto value = m_floats.find(pname);
+    if (value == m_floats.end())
+        return false;
+    std::copy(value->second.begin(), value->second.end(), params);
+    return true;
+}
+
+bool GLStateShadow::isEnabled(GLenum cap, GLboolean* enabled) const {
+    if (!isTrackedCap(cap))
+        return false;
+    auto state = m_state.find(cap);
+    if (state == m_state.end())
+        return false;
+    *enabled = state->second[0] != 0 ? GL_TRUE : GL_FALSE;
+    return true;
+}
+
+bool GLStateShadow::getString(GLenum name, std::string* value) const {
+    auto str = m_strings.find(name);
+    if (str == m_strings.end())
+        return false;
+    *value = str->second;
+    return true;
+}
+
+void GLStateShadow::storeIntegerv(GLenum pname, const GLint* params, bool invariant) {
+    const size_t count = glUtilsParamSize(pname);
+    if (invariant)
+        m_integers[pname].assign(params, params + count);
+    else if (isTrackedState(pname))
+        m_state[pname].assign(params, params + count);
+    else
+        // The driver may have rejected |pname|
+        markErrorsPossible();
+}
+
+void GLStateShadow::storeBooleanv(GLenum pname, const GLboolean* params, bool invariant) {
+    if (invariant)
+        m_booleans[pname].assign(params, params + glUtilsParamSize(pname));
+    else if (isTrackedCap(pname))
+        m_state[pname].assign(1, params[0]);
+    else if (!isTrackedState(pname))
+        markErrorsPossible();
+}
+
+void GLStateShadow::storeFloatv(GLenum pname, const GLfloat* params, bool invariant) {
+    if (invariant)
+        m_floats[pname].assign(params, params + glUtilsParamSize(pname));
+    else if (!isTrackedState(pname))
+        markErrorsPossible();
+}
+
+void GLStateShadow::storeEnabled(GLenum cap, GLboolean enabled) {
+    if (isTrackedCap(cap))
+        m_state[cap].assign(1, enabled);
+    else
+        markErrorsPossible();
+}
+
+void GLStateShadow::storeString(GLenum name, const std::string& value) {
+    if (isKnownString(name))
+        m_strings[name] = value;
+    else
+        markErrorsPossible();
+}
+
+void GLStateShadow::setEnabled(GLenum cap, bool enabled) {
+    if (isTrackedCap(cap))
+        m_state[cap].assign(1, enabled ? 1 : 0);
+}
+
+void GLStateShadow::setViewport(GLint x, GLint y, GLsizei width, GLsizei height,
+                                const GLint* maxViewportDims) {
+    if (width < 0 || height < 0)
+        return;
+    // The driver silently clamps the size to what it supports
+    m_state[GL_VIEWPORT] = {x, y, std::min(width, maxViewportDims[0]),
+                            std::min(height, maxViewportDims[1])};
+}
+
+void GLStateShadow::setScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (width < 0 || height < 0)
+        return;
+    m_state[GL_SCISSOR_BOX] = {x, y, width, height};
+}
+
+void GLStateShadow::setPixelStore(GLenum pname, GLint param) {
+    if (pname != GL_PACK_ALIGNMENT && pname != GL_UNPACK_ALIGNMENT)
+        return;
+    if (param != 1 && param != 2 && param != 4 && param != 8)
+        return;
+    m_state[pname].assign(1, param);
+}
+
+void GLStateShadow::setActiveTexture(GLenum texture, GLint maxTextureUnits) {
+    if (texture < GL_TEXTURE0 || texture >= GL_TEXTURE0 + static_cast<GLenum>(maxTextureUnits))
+        return;
+    m_state[GL_ACTIVE_TEXTURE].assign(1, static_cast<GLint>(texture));
+}
+
+void GLStateShadow::invalidate() {
+    m_state.clear();
+    markErrorsPossible();
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef EMUGL_GL_STATE_SHADOW_H
+#define EMUGL_GL_STATE_SHADOW_H
+
+#include "glUtils.h"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+// Copy of the GL state of a single context which lets the decoders answer
+// the synchronous queries of the guest without going to the driver.
+//
+// It holds two kinds of state. Implementation limits never change for a
+// context, so the first answer of the driver is kept for good. A small set
+// of state the guest can only change through the decoder (capabilities,
+// viewport, scissor box, pixel store alignment and the active texture unit)
+// is followed as the guest sets it. Nothing is known about a context
+// up front: what isn't stored yet still goes to the driver.
+//
+// On top of that it knows whether anything which could have raised a GL
+// error ran since the driver last reported GL_NO_ERROR, so that glGetError
+// doesn't need the driver either while the guest only queries state.
+class GLStateShadow {
+public:
+    GLStateShadow() = default;
+
+    // Allows to switch the shadow off for all contexts. Has to be called
+    // before any context is used.
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // Answer a query from the shadow. Returns false when it has to go to
+    // the driver instead.
+    bool getIntegerv(GLenum pname, GLint* params) const;
+    bool getBooleanv(GLenum pname, GLboolean* params) const;
+    bool getFloatv(GLenum pname, GLfloat* params) const;
+    bool isEnabled(GLenum cap, GLboolean* enabled) const;
+    bool getString(GLenum name, std::string* value) const;
+
+    // Take note of what the driver answered for a query. |invariant| tells
+    // whether |pname| is a limit of the context which is valid for its API.
+    void storeIntegerv(GLenum pname, const GLint* params, bool invariant);
+    void storeBooleanv(GLenum pname, const GLboolean* params, bool invariant);
+    void storeFloatv(GLenum pname, const GLfloat* params, bool invariant);
+    void storeEnabled(GLenum cap, GLboolean enabled);
+    void storeString(GLenum name, const std::string& value);
+
+    // Follow the state changes of the guest. Calls with arguments the
+    // driver rejects don't change any state, just like the driver.
+    void setEnabled(GLenum cap, bool enabled);
+    void setViewport(GLint x, GLint y, GLsizei width, GLsizei height,
+                     const GLint* maxViewportDims);
+    void setScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+    void setPixelStore(GLenum pname, GLint param);
+    void setActiveTexture(GLenum texture, GLint maxTextureUnits);
+
+    // Something which may have raised a GL error went to the driver.
+    void markErrorsPossible() { m_errorsPossible = true; }
+    // The driver just reported GL_NO_ERROR.
+    void clearErrorsPossible() { m_errorsPossible = false; }
+    // Returns false when glGetError can only return GL_NO_ERROR.
+    bool errorsPossible() const { return m_errorsPossible; }
+
+    // Forget everything the guest may have changed, e.g. because the host
+    // worked with the context itself.
+    void invalidate();
+
+private:
+    static bool isTrackedCap(GLenum cap);
+    static bool isTrackedState(GLenum pname);
+    static bool isKnownString(GLenum name);
+
+    static std::atomic<bool> s_enabled;
+
+    std::map<GLenum, std::vector<GLint>> m_state;
+    std::map<GLenum, std::vector<GLint>> m_integers;
+    std::map<GLenum, std::vector<GLboolean>> m_booleans;
+    std::map<GLenum, std::vector<GLfloat>> m_floats;
+    std::map<GLenum, std::string> m_strings;
+    bool m_errorsPossible = true;
+};
+
+#endif  // EMUGL_GL_STATE_SHADOW_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "VertexDataCache.h"
+
+#include <string.h>
+
+const size_t VertexDataCache::kMinDataSize;
+const size_t VertexDataCache::kDefaultCapacity;
+const size_t VertexDataCache::kRecentDigests;
+
+std::atomic<size_t> VertexDataCache::s_capacity{kDefaultCapacity};
+
+void VertexDataCache::setCapacity(size_t capacity) {
+    s_capacity.store(capacity, std::memory_order_relaxed);
+}
+
+// FNV-1a over 64 bit words rather than single bytes as it has to keep up
+// with copying the data. Folding the upper half back after every step
+// keeps differences in the high bits of a word, like the sign of a float,
+// from getting lost.
+//
+// The check is computed in the same pass but mixes the words with another
+// multiplier and a rotation and depends on their position, so data
+// colliding in one of them is very unlikely to collide in the other.
+VertexDataCache::Digest VertexDataCache::digest(const void* data, size_t size) {
+    static const uint64_t kPrime = 0x100000001b3ULL;
+    static const uint64_t kCheckMultiplier = 0x9e3779b97f4a7c15ULL;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    Digest digest = {0xcbf29ce484222325ULL, size};
+    size_t n = 0;
+    for (; n + sizeof(uint64_t) <= size; n += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + n, sizeof(word));
+        digest.hash ^= word;
+        digest.hash *= kPrime;
+        digest.hash ^= digest.hash >> 32;
+        digest.check += (word ^ n) * kCheckMultiplier;
+        digest.check = (digest.check << 27) | (digest.check >> 37);
+    }
+    for (; n < size; n++) {
+        digest.hash ^= bytes[n];
+        digest.hash *= kPrime;
+        digest.check += (bytes[n] ^ n) * kCheckMultiplier;
+        digest.check = (digest.check << 27) | (digest.check >> 37);
+    }
+    return digest;
+}
+
+GLuint VertexDataCache::lookup(const Digest& digest, size_t size) {
+    auto entry = m_index.find(Key(digest, size));
+    if (entry == m_index.end())
+        return 0;
+    m_entries.splice(m_entries.begin(), m_entries, entry->second);
+    return entry->second->buffer;
+}
+
+bool VertexDataCache::seenRecently(const Digest& digest, size_t size) {
+    const Key key(digest, size);
+    for (const auto& recent : m_recent) {
+        if (recent == key)
+            return true;
+    }
+
+    if (m_recent.size() < kRecentDigests) {
+        m_recent.push_back(key);
+    } else {
+        m_recent[m_nextRecent] = key;
+        m_nextRecent = (m_nextRecent + 1) % kRecentDigests;
+    }
+    return false;
+}
+
+bool VertexDataCache::reserve(size_t size, std::vector<GLuint>* evicted) {
+    const size_t limit = capacity();
+    if (size > limit)
+        return false;
+
+    auto entry = m_entries.end();
+    while (m_size + size > limit && entry != m_entries.begin()) {
+        --entry;
+        if (entry->users > 0)
+            continue;
+        evicted->push_back(entry->buffer);
+        m_size -= entry->size;
+        m_index.erase(Key(entry->digest, entry->size));
+        entry = m_entries.erase(entry);
+    }
+    return m_size + size <= limit;
+}
+
+void VertexDataCache::insert(const Digest& digest, size_t size, GLuint buffer) {
+    m_entries.push_front({digest, size, buffer, 0});
+    m_index[Key(digest, size)] = m_entries.begin();
+    m_size += size;
+}
+
+void VertexDataCache::attachAttrib(unsigned int location, const Digest& digest, size_t size) {
+    auto entry = m_index.find(Key(digest, size));
+    if (entry == m_index.end())
+        return;
+    detachAttrib(location);
+    entry->second->users++;
+    m_attribs[location] = entry->second;
+}
+
+void VertexDataCache::detachAttrib(unsigned int location) {
+    auto attrib = m_attribs.find(location);
+    if (attrib == m_attribs.end())
+        return;
+    attrib->second->users--;
+    m_attribs.erase(attrib);
+}
+
+void VertexDataCache::clear(std::vector<GLuint>* buffers) {
+    for (const auto& entry : m_entries)
+        buffers->push_back(entry.buffer);
+    m_entries.clear();
+    m_index.clear();
+    m_attribs.clear();
+    m_recent.clear();
+    m_nextRecent = 0;
+    m_size = 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef EMUGL_VERTEX_DATA_CACHE_H
+#define EMUGL_VERTEX_DATA_CACHE_H
+
+#include <GLES2/gl2.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Bookkeeping for the buffer objects the GLESv2 decoder keeps the client
+// side vertex arrays and index data of a context in. The guest sends the
+// whole array with every draw call, but mostly the same one frame after
+// frame, so by looking the data up by its content it only has to be
+// uploaded once.
+//
+// The cache doesn't talk to GL itself: the decoder creates and deletes the
+// buffers and reports them here. Buffers are evicted least recently used
+// first once the cache would grow beyond its capacity, except for those
+// vertex attributes still point to as deleting them would leave the
+// attributes without any data.
+//
+// Data is only moved into a buffer once it shows up a second time while
+// its digest is still among the last kRecentDigests seen. Dynamic data
+// which changes with every draw call keeps being copied as before instead
+// of filling the cache with buffers which are never used again.
+//
+// The data itself isn't compared as that would mean keeping a copy of
+// every buffer. Instead two independent 64 bit hashes and the size have
+// to match, so a stale buffer is only used if both hashes collide.
+class VertexDataCache {
+public:
+    // Data smaller than this isn't worth it: hashing it and binding the
+    // buffer costs about as much as copying it again.
+    static const size_t kMinDataSize = 128;
+    static const size_t kDefaultCapacity = 8 * 1024 * 1024;
+    static const size_t kRecentDigests = 64;
+
+    VertexDataCache() = default;
+
+    // Maximum number of bytes the buffers of a single context may hold. A
+    // capacity of 0 disables the cache for all contexts.
+    static size_t capacity() { return s_capacity.load(std::memory_order_relaxed); }
+    static void setCapacity(size_t capacity);
+
+    struct Digest {
+        uint64_t hash;
+        uint64_t check;
+
+        bool operator==(const Digest& other) const {
+            return hash == other.hash && check == other.check;
+        }
+        bool operator<(const Digest& other) const {
+            return hash < other.hash || (hash == other.hash && check < other.check);
+        }
+    };
+
+    static Digest digest(const void* data, size_t size);
+
+    // Returns the buffer holding |size| bytes with |digest| or 0 if there
+    // is none yet. A hit makes the buffer the most recently used one.
+    GLuint lookup(const Digest& digest, size_t size);
+
+    // Returns true if data with |digest| and |size| was seen before and
+    // is worth a buffer. Remembers it otherwise.
+    bool seenRecently(const Digest& digest, size_t size);
+
+    // Makes room for |size| more bytes and appends the buffers which have
+    // to be deleted for that to |evicted|. Returns false when the data
+    // can't be cached at all.
+    bool reserve(size_t size, std::vector<GLuint>* evicted);
+
+    // Adds |buffer| holding |size| bytes with |digest| after reserve()
+    // made room for it.
+    void insert(const Digest& digest, size_t size, GLuint buffer);
+
+    // Vertex attribute |location| now points to the cached buffer holding
+    // |size| bytes with |digest|, which won't be evicted until no attribute
+    // points to it anymore.
+    void attachAttrib(unsigned int location, const Digest& digest, size_t size);
+    // Vertex attribute |location| now points elsewhere.
+    void detachAttrib(unsigned int location);
+
+    // Forgets all buffers and appends them to |buffers| for the caller to
+    // delete, which has to happen while the owning context is current.
+    void clear(std::vector<GLuint>* buffers);
+
+    // Number of bytes held by all buffers.
+    size_t size() const { return m_size; }
+
+private:
+    struct Entry {
+        Digest digest;
+        size_t size;
+        GLuint buffer;
+        // Number of vertex attributes pointing to the buffer
+        unsigned int users;
+    };
+    typedef std::list<Entry> EntryList;
+    typedef std::pair<Digest, size_t> Key;
+
+    static std::atomic<size_t> s_capacity;
+
+    // Most recently used first
+    EntryList m_entries;
+    std::map<Key, EntryList::iterator> m_index;
+    std::map<unsigned int, EntryList::iterator> m_attribs;
+    size_t m_size = 0;
+    // Digests of data not cached yet, the oldest one is overwritten first
+    std::vector<Key> m_recent;
+    size_t m_nextRecent = 0;
+};
+
+#endif  // EMUGL_VERTEX_DATA_CACHE_H
@@ -20,26 +20,46 @@
 #include "anbox/system_configuration.h"
 #include "anbox/logger.h"
 
+#include <tuple>
+
 namespace anbox {
 namespace application {
 const Database::Item Database::Unknown{};
 
+bool Database::Item::operator==(const Item &other) const {
+  const auto &a = launch_intent;
+  const auto &b = other.launch_intent;
+  return std::tie(name, package, icon_hash, a.action, a.uri, a.type, a.package,
+                  a.component, a.categories) ==
+         std::tie(other.name, other.package, other.icon_hash, b.action, b.uri,
+                  b.type, b.package, b.component, b.categories);
+}
+
 Database::Database() :
-  storage_(std::make_shared<LauncherStorage>(SystemConfiguration::instance().application_item_dir())) {}
+  Database(std::make_shared<LauncherStorage>(SystemConfiguration::instance().application_item_dir())) {}
+
+Database::Database(const std::shared_ptr<LauncherStorage> &storage) :
+  storage_(storage) {}
 
 Database::~Database() {}
 
-void Database::store_or_update(const Item &item) {
-  if (!done_reset) {
-    storage_->reset();
-    done_reset = true;
-  }
-  storage_->add_or_update(item);
+void Database::store_or_update(const Item &item, const std::string &icon) {
+  auto iter = items_.find(item.package);
+  if (iter != items_.end() && iter->second == item)
+    return;
+
+  storage_->add_or_update(item, icon);
   items_[item.package] = item;
+}
 
-  // We don't need to store the icon data anymore at this point as the
-  // launcher is already stored it on the disk.
-  items_[item.package].icon.clear();
+void Database::retain(const std::set<std::string> &packages) {
+  for (auto iter = items_.begin(); iter != items_.end();) {
+    if (packages.count(iter->first) == 0)
+      iter = items_.erase(iter);
+    else
+      ++iter;
+  }
+  storage_->retain(packages);
 }
 
 void Database::remove(const Item &item) {
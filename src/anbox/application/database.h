@@ -20,9 +20,11 @@
 
 #include "anbox/android/intent.h"
 
+#include <cstdint>
 #include <string>
 #include <map>
 #include <memory>
+#include <set>
 
 namespace anbox {
 namespace application {
@@ -33,25 +35,33 @@ class Database {
     std::string name;
     std::string package;
     android::Intent launch_intent;
-    std::vector<char> icon;
+    // Content hash of the icon, the icon data itself is only kept on disk.
+    std::uint64_t icon_hash = 0;
 
     bool valid() const { return package.length() > 0; }
+    bool operator==(const Item &other) const;
   };
 
   static const Item Unknown;
 
   Database();
+  explicit Database(const std::shared_ptr<LauncherStorage> &storage);
   ~Database();
 
-  void store_or_update(const Item &item);
+  // Stores the item unless an identical one is stored already. The icon
+  // data can be left empty if an icon with the item's hash was stored
+  // before.
+  void store_or_update(const Item &item, const std::string &icon);
   void remove(const Item &item);
+  // Drops everything stored before, also by previous sessions, which is
+  // not listed in packages.
+  void retain(const std::set<std::string> &packages);
 
   const Item& find_by_package(const std::string &package) const;
 
  private:
   std::shared_ptr<LauncherStorage> storage_;
   std::map<std::string,Item> items_;
-  bool done_reset = false;
 };
 }  // namespace application
 }  // namespace anbox
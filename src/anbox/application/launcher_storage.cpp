@@ -16,12 +16,15 @@
  */
 
 #include "anbox/application/launcher_storage.h"
+#include "anbox/common/content_hash.h"
 #include "anbox/utils.h"
 #include "anbox/logger.h"
 
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 
 namespace fs = boost::filesystem;
 
@@ -29,12 +32,21 @@ namespace {
 // This will always point us to the right executable when we're running within
 // a snap environment.
 constexpr const char *snap_exe_path{"/snap/bin/anbox"};
+
+bool file_has_content(const fs::path &path, const std::string &content) {
+  std::ifstream in(path.string(), std::ios::binary);
+  if (!in)
+    return false;
+  const std::string current{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  return current == content;
+}
 }
 
 namespace anbox {
 namespace application {
 LauncherStorage::LauncherStorage(const fs::path &path) :
-  path_(path) {
+  path_(path),
+  icon_path_(path / "anbox-icons") {
     invisible_pkg_.insert("com-android-contacts"); 
     invisible_pkg_.insert("com-android-calendar");
     invisible_pkg_.insert("com-android-deskclock");
@@ -47,18 +59,6 @@ LauncherStorage::~LauncherStorage() {
    invisible_pkg_.clear();
 }
 
-void LauncherStorage::reset() {
-  if (fs::exists(path_)) {
-    for(auto & p : boost::filesystem::directory_iterator(path_)) {
-        if (fs::is_regular_file(p)){
-          auto str = p.path().filename().string();
-          if (boost::starts_with(str, "anbox-"))
-            fs::remove(p);
-        }
-     }
-   }
-}
-
 std::string LauncherStorage::clean_package_name(const std::string &package_name) {
   auto cleaned_package_name = package_name;
   std::replace(cleaned_package_name.begin(), cleaned_package_name.end(), '.', '-');
@@ -69,15 +69,29 @@ fs::path LauncherStorage::path_for_item(const std::string &package_name) {
   return path_ / utils::string_format("anbox-%s.desktop", package_name);
 }
 
-fs::path LauncherStorage::path_for_item_icon(const std::string &package_name) {
-  return path_ / utils::string_format("anbox-%s.png", package_name);
+fs::path LauncherStorage::path_for_icon(std::uint64_t icon_hash) {
+  return icon_path_ / utils::string_format("%s.png", common::content_hash_to_string(icon_hash));
 }
 
-void LauncherStorage::add_or_update(const Database::Item &item) {
-  if (!fs::exists(path_)) fs::create_directories(path_);
+void LauncherStorage::write_file(const fs::path &path, const char *data, std::size_t size) {
+  // Write to a temporary file first so that nobody watching the directory
+  // ever sees a partially written file.
+  const auto tmp_path = path.string() + ".tmp";
+  if (auto out = std::ofstream(tmp_path, std::ios::binary | std::ios::trunc)) {
+    out.write(data, size);
+    if (!out)
+      BOOST_THROW_EXCEPTION(std::runtime_error("Failed to write " + path.string()));
+  } else {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create " + path.string()));
+  }
+  fs::rename(tmp_path, path);
+  files_written_++;
+}
 
-  auto package_name = item.package;
-  std::replace(package_name.begin(), package_name.end(), '.', '-');
+void LauncherStorage::add_or_update(const Database::Item &item, const std::string &icon) {
+  if (!fs::exists(icon_path_)) fs::create_directories(icon_path_);
+
+  const auto package_name = clean_package_name(item.package);
        
   if(invisible_pkg_.count(package_name)) {
     DEBUG("package_name:%s   skip!!!\n", package_name);
@@ -105,22 +119,28 @@ void LauncherStorage::add_or_update(const Database::Item &item) {
   if (!item.launch_intent.component.empty())
     exec += utils::string_format("--component=%s ", item.launch_intent.component);
 
-  const auto item_icon_path = path_for_item_icon(package_name);
-  if (auto desktop_item = std::ofstream(path_for_item(package_name).string())) {
-    desktop_item << "[Desktop Entry]" << std::endl
-                 << "Name=" << item.name << std::endl
-                 << "Exec=" << exec << std::endl
-                 << "Terminal=false" << std::endl
-                 << "Type=Application" << std::endl
-                 << "Icon=" << item_icon_path.string() << std::endl;
-  } else {
-    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create desktop item"));
+  // Icons are named by their content so an existing one never needs to
+  // be written again.
+  const auto item_icon_path = path_for_icon(item.icon_hash);
+  if (!fs::exists(item_icon_path)) {
+    if (!icon.empty())
+      write_file(item_icon_path, icon.data(), icon.size());
+    else
+      WARNING("Missing icon for %s", item.package);
   }
 
-  if (auto icon = std::ofstream(item_icon_path.string()))
-    icon.write(item.icon.data(), item.icon.size());
-  else
-    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to write icon"));
+  std::stringstream desktop_item;
+  desktop_item << "[Desktop Entry]" << std::endl
+               << "Name=" << item.name << std::endl
+               << "Exec=" << exec << std::endl
+               << "Terminal=false" << std::endl
+               << "Type=Application" << std::endl
+               << "Icon=" << item_icon_path.string() << std::endl;
+
+  const auto item_path = path_for_item(package_name);
+  const auto content = desktop_item.str();
+  if (!file_has_content(item_path, content))
+    write_file(item_path, content.data(), content.size());
 }
 
 void LauncherStorage::remove(const Database::Item &item) {
@@ -130,9 +150,49 @@ void LauncherStorage::remove(const Database::Item &item) {
   if (fs::exists(item_path))
     fs::remove(item_path);
 
-  const auto item_icon_path = path_for_item_icon(package_name);
-  if (fs::exists(item_icon_path))
-    fs::remove(item_icon_path);
+  // The icon may be shared with other items and is dropped with the
+  // next retain() if it isn't.
+}
+
+void LauncherStorage::retain(const std::set<std::string> &packages) {
+  if (!fs::exists(path_))
+    return;
+
+  std::set<std::string> retained_items;
+  for (const auto &package : packages)
+    retained_items.insert(path_for_item(clean_package_name(package)).filename().string());
+
+  // Besides items of packages which are gone this also drops icons of
+  // older versions which were stored next to the items.
+  std::set<std::string> used_icons;
+  for (const auto &p : fs::directory_iterator(path_)) {
+    if (!fs::is_regular_file(p))
+      continue;
+
+    const auto name = p.path().filename().string();
+    if (!boost::starts_with(name, "anbox-"))
+      continue;
+
+    if (retained_items.count(name) == 0) {
+      fs::remove(p);
+      continue;
+    }
+
+    std::ifstream in(p.path().string());
+    std::string line;
+    while (std::getline(in, line)) {
+      if (boost::starts_with(line, "Icon="))
+        used_icons.insert(line.substr(5));
+    }
+  }
+
+  if (!fs::exists(icon_path_))
+    return;
+
+  for (const auto &p : fs::directory_iterator(icon_path_)) {
+    if (used_icons.count(p.path().string()) == 0)
+      fs::remove(p);
+  }
 }
 
 }  // namespace application
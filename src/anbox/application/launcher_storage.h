@@ -35,17 +35,26 @@ class LauncherStorage {
   LauncherStorage(const boost::filesystem::path &path);
   ~LauncherStorage();
 
-  void reset();
-  void add_or_update(const Database::Item &item);
+  // Icons are stored once per content hash and shared between items.
+  // Nothing is written if the files on disk are up to date already.
+  void add_or_update(const Database::Item &item, const std::string &icon);
   void remove(const Database::Item &item);
+  // Removes items of all packages not listed and icons no item uses.
+  void retain(const std::set<std::string> &packages);
+
+  // Number of desktop items and icons written so far
+  std::uint64_t files_written() const { return files_written_; }
 
  private:
   std::string clean_package_name(const std::string &package_name);
   boost::filesystem::path path_for_item(const std::string &package_name);
-  boost::filesystem::path path_for_item_icon(const std::string &package_name);
+  boost::filesystem::path path_for_icon(std::uint64_t icon_hash);
+  void write_file(const boost::filesystem::path &path, const char *data, std::size_t size);
 
   boost::filesystem::path path_;
+  boost::filesystem::path icon_path_;
   std::set<std::string> invisible_pkg_;
+  std::uint64_t files_written_ = 0;
 };
 }  // namespace application
 }  // namespace anbox
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/async_log_writer.h"
+#include "anbox/common/cache_line_aligned.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace anbox {
+// A bounded queue of log records with many producers and a single consumer.
+// Producers never wait for each other or for the consumer, a record which
+// doesn't fit anymore is rejected instead. Based on Dmitry Vyukov's bounded
+// MPMC queue.
+class AsyncLogWriter::Queue : public common::CacheLineAligned {
+ public:
+  explicit Queue(std::size_t capacity)
+      : cells_(new Cell[capacity]), mask_(capacity - 1) {
+    for (std::size_t n = 0; n < capacity; n++)
+      cells_[n].sequence.store(n, std::memory_order_relaxed);
+  }
+
+  bool try_push(Record &&record) {
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const auto seq = cell->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->record = std::move(record);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only
+  bool try_pop(Record *record) {
+    if (empty())
+      return false;
+
+    const auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    auto &cell = cells_[pos & mask_];
+    *record = std::move(cell.record);
+    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+    dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Consumer only
+  bool empty() const {
+    const auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    Record record;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_;
+  // Producers and the consumer don't share a cache line
+  alignas(common::cache_line_size) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(common::cache_line_size) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+AsyncLogWriter::AsyncLogWriter(std::size_t capacity, const WriteHandler &write)
+    : write_{write}, queue_{new Queue(capacity)}, thread_{&AsyncLogWriter::main, this} {}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  stop();
+}
+
+bool AsyncLogWriter::post(Record &&record) {
+  if (stopped_.load(std::memory_order_acquire))
+    return false;
+
+  if (!queue_->try_push(std::move(record))) {
+    dropped_++;
+    return true;
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> l(lock_);
+    wakeup_.notify_one();
+  }
+  return true;
+}
+
+void AsyncLogWriter::stop() {
+  stopped_.store(true, std::memory_order_release);
+  if (!thread_.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    running_ = false;
+  }
+  wakeup_.notify_one();
+  thread_.join();
+}
+
+void AsyncLogWriter::main() {
+  Record record;
+  while (true) {
+    while (queue_->try_pop(&record))
+      write_(record);
+
+    if (const auto dropped = dropped_.exchange(0)) {
+      write_(Record{Logger::Severity::kWarning, boost::posix_time::microsec_clock::universal_time(),
+                    utils::string_format("Dropped %d log messages as the log queue was full", dropped),
+                    boost::none});
+    }
+
+    std::unique_lock<std::mutex> l(lock_);
+    if (!running_ && queue_->empty())
+      break;
+
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wakeup_.wait(l, [&]() { return !running_ || !queue_->empty(); });
+    sleeping_.store(false, std::memory_order_relaxed);
+  }
+}
+}  // namespace anbox
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_ASYNC_LOG_WRITER_H_
+#define ANBOX_ASYNC_LOG_WRITER_H_
+
+#include "anbox/do_not_copy_or_move.h"
+#include "anbox/logger.h"
+
+#include <boost/date_time/posix_time/ptime.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace anbox {
+// Hands log records over to a thread of its own which writes them out, so
+// that threads logging never wait for the console or syslog. Producers
+// don't wait for each other or for the writer either. A record which
+// doesn't fit into the queue anymore is dropped and counted and the writer
+// reports how many were lost.
+class AsyncLogWriter : public DoNotCopyOrMove {
+ public:
+  struct Record {
+    Logger::Severity severity;
+    boost::posix_time::ptime timestamp;
+    std::string message;
+    boost::optional<Logger::Location> location;
+  };
+
+  typedef std::function<void(const Record&)> WriteHandler;
+
+  // |capacity| must be a power of two. |write| is only ever called from
+  // the writer thread.
+  AsyncLogWriter(std::size_t capacity, const WriteHandler &write);
+  ~AsyncLogWriter();
+
+  // Returns false once the writer was stopped and the caller has to write
+  // |record| itself.
+  bool post(Record &&record);
+
+  // Writes out everything queued and stops the writer thread.
+  void stop();
+
+ private:
+  class Queue;
+
+  void main();
+
+  const WriteHandler write_;
+  std::unique_ptr<Queue> queue_;
+  std::atomic<bool> stopped_{false};
+  std::atomic<std::uint64_t> dropped_{0};
+  std::mutex lock_;
+  std::condition_variable wakeup_;
+  std::atomic<bool> sleeping_{false};
+  bool running_ = true;
+  std::thread thread_;
+};
+}  // namespace anbox
+
+#endif
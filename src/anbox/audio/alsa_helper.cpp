@@ -152,6 +152,7 @@ size_t AlsaHelper::pcm_read(char *readBuf, size_t length)
             DEBUG("pcm read data no complete, has read size= %d", r);
             snd_pcm_wait(mhandle, wait_times);
         } else if (r == -EPIPE) {
+            xrun_count++;
             if ((error = xrun()) < 0) {
                 return 0;
             }
@@ -26,6 +26,7 @@
 #include<malloc.h>
 #include<vector>
 #include<array>
+#include<atomic>
 #include <endian.h>
 #include <assert.h>
 #include"anbox/logger.h"
@@ -96,6 +97,8 @@ public:
     snd_pcm_uframes_t get_period_frames_bytes() const;
     std::string get_usb_audio_device_name() const;
     bool get_device_config (hwparams& device_config) const;
+    // Number of times the device overran so far
+    unsigned int get_xrun_count() const { return xrun_count; }
 private:
     const char* pcm_name;
     snd_pcm_stream_t  stream_type;
@@ -110,6 +113,7 @@ private:
     hwparams  mhwparams;
     int mmap_flag {0};
     size_t chunk_bytes;  // chunk_bytes formula is period_frames * bits_per_frame / 8
+    std::atomic<unsigned int> xrun_count {0};
 
     int set_params();
     int xrun(void);
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/capture_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace anbox {
+namespace audio {
+CaptureRing::CaptureRing(std::size_t period_size, std::size_t period_count)
+    : period_size_(period_size),
+      storage_(period_size * std::max<std::size_t>(period_count, 1)),
+      periods_(std::max<std::size_t>(period_count, 1)) {}
+
+std::uint8_t *CaptureRing::prepare() {
+  std::lock_guard<std::mutex> l(lock_);
+  // The period we are about to capture into is still the oldest unread
+  // one. Dropping it now keeps the capture going at device pace.
+  if (count_ == periods_.size()) {
+    read_pos_ = (read_pos_ + 1) % periods_.size();
+    count_--;
+    overruns_++;
+  }
+
+  const auto write_pos = (read_pos_ + count_) % periods_.size();
+  return storage_.data() + write_pos * period_size_;
+}
+
+void CaptureRing::commit(std::size_t size, std::int64_t capture_time_ns) {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    auto &period = periods_[(read_pos_ + count_) % periods_.size()];
+    period.size = std::min(size, period_size_);
+    period.capture_time_ns = capture_time_ns;
+    count_++;
+  }
+  can_pop_.notify_one();
+}
+
+bool CaptureRing::pop(std::uint8_t *data, std::size_t *size, std::int64_t *capture_time_ns) {
+  std::unique_lock<std::mutex> l(lock_);
+  can_pop_.wait(l, [&]() { return closed_ || count_ > 0; });
+  if (closed_)
+    return false;
+
+  const auto &period = periods_[read_pos_];
+  std::memcpy(data, storage_.data() + read_pos_ * period_size_, period.size);
+  *size = period.size;
+  *capture_time_ns = period.capture_time_ns;
+
+  read_pos_ = (read_pos_ + 1) % periods_.size();
+  count_--;
+  return true;
+}
+
+void CaptureRing::close() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    closed_ = true;
+  }
+  can_pop_.notify_all();
+}
+
+std::uint64_t CaptureRing::overruns() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return overruns_;
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_CAPTURE_RING_H_
+#define ANBOX_AUDIO_CAPTURE_RING_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace anbox {
+namespace audio {
+// Fixed number of preallocated capture periods between the thread reading
+// from the audio device and the one sending the periods on. The device is
+// read straight into the ring and it never waits for the reader: if the
+// reader falls behind the oldest period is dropped and counted as overrun.
+class CaptureRing {
+ public:
+  CaptureRing(std::size_t period_size, std::size_t period_count);
+
+  // Writer side: returns the period to capture into next. It only becomes
+  // visible to the reader with commit().
+  std::uint8_t *prepare();
+  void commit(std::size_t size, std::int64_t capture_time_ns);
+
+  // Reader side: waits for the oldest captured period and copies it into
+  // |data| which needs to hold period_size() bytes. Returns false once the
+  // ring is closed.
+  bool pop(std::uint8_t *data, std::size_t *size, std::int64_t *capture_time_ns);
+
+  void close();
+
+  std::size_t period_size() const { return period_size_; }
+  // Number of periods dropped as the reader didn't keep up
+  std::uint64_t overruns() const;
+
+ private:
+  struct Period {
+    std::size_t size = 0;
+    std::int64_t capture_time_ns = 0;
+  };
+
+  const std::size_t period_size_;
+  std::vector<std::uint8_t> storage_;
+  std::vector<Period> periods_;
+
+  mutable std::mutex lock_;
+  std::condition_variable can_pop_;
+  std::size_t read_pos_ = 0;
+  std::size_t count_ = 0;
+  std::uint64_t overruns_ = 0;
+  bool closed_ = false;
+};
+}  // namespace audio
+}  // namespace anbox
+
+#endif
@@ -28,11 +28,38 @@ struct ClientInfo {
     Recording = 1,
     Max = 2,
   };
+  // Older clients only send |type| and get it back. Clients setting this
+  // bit in |type| send the complete struct and get it back instead.
+  static constexpr const std::uint8_t extended_info{0x80};
+
   Type type;
+  // Playback clients announce the rate and period size they render with
+  // so the host can open the device to match and answers with what it
+  // ended up using. Zero keeps the host defaults.
+  std::uint32_t sample_rate;
+  std::uint32_t period_frames;
+  // Set by the host to the number of frames it buffers before they are
+  // played back by the device.
+  std::uint32_t latency_frames;
 };
 enum class RecordCommand : std::uint8_t {
+  // Capture a single period and send it back
   StartRecord = 1,
   StopRecord,
+  // Keep capturing and push every period as soon as it was captured, each
+  // preceded by a CapturePeriodHeader, until StopRecord is sent or the
+  // connection is closed. Nothing is sent back for StopRecord then.
+  StartStreaming,
+};
+
+struct CapturePeriodHeader {
+  // Number of bytes of PCM data following the header
+  std::uint32_t size;
+  // Number of periods the host dropped so far as they couldn't be sent
+  // fast enough or the audio device overran.
+  std::uint32_t overruns;
+  // CLOCK_MONOTONIC time the first frame of the period was captured at
+  std::int64_t capture_time_ns;
 };
 
 } // namespace audio
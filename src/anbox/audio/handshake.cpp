@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/handshake.h"
+#include "anbox/logger.h"
+
+namespace anbox {
+namespace audio {
+bool receive_client_info(network::SocketMessenger &messenger, ClientInfo *client_info,
+                         bool *extended) {
+  *client_info = ClientInfo{};
+  auto err = messenger.receive_msg(
+      boost::asio::buffer(&client_info->type, sizeof(client_info->type)));
+  if (err) {
+    ERROR("Failed to read client info: %s", err.message());
+    return false;
+  }
+
+  const auto type = static_cast<std::uint8_t>(client_info->type);
+  *extended = (type & ClientInfo::extended_info) != 0;
+  client_info->type = static_cast<ClientInfo::Type>(type & ~ClientInfo::extended_info);
+  if (!*extended)
+    return true;
+
+  // The rest of the struct follows right after the type
+  err = messenger.receive_msg(
+      boost::asio::buffer(reinterpret_cast<char*>(client_info) + sizeof(client_info->type),
+                          sizeof(ClientInfo) - sizeof(client_info->type)));
+  if (err) {
+    ERROR("Failed to read client info: %s", err.message());
+    return false;
+  }
+  return true;
+}
+
+void send_client_info(network::SocketMessenger &messenger, const ClientInfo &client_info,
+                      bool extended) {
+  // Older clients only expect their type
+  if (!extended) {
+    messenger.send(reinterpret_cast<const char*>(&client_info.type), sizeof(client_info.type));
+    return;
+  }
+
+  auto reply = client_info;
+  reply.type = static_cast<ClientInfo::Type>(static_cast<std::uint8_t>(client_info.type) |
+                                             ClientInfo::extended_info);
+  messenger.send(reinterpret_cast<const char*>(&reply), sizeof(reply));
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_AUDIO_HANDSHAKE_H_
+#define ANBOX_AUDIO_HANDSHAKE_H_
+
+#include "anbox/audio/client_info.h"
+#include "anbox/network/socket_messenger.h"
+
+namespace anbox {
+namespace audio {
+// Reads the client info a guest starts its connection with. Older clients
+// only send the type. Clients setting ClientInfo::extended_info in it send
+// the complete struct the way it is laid out in memory, padding after the
+// type included. |extended| tells which of both the client did.
+bool receive_client_info(network::SocketMessenger &messenger, ClientInfo *client_info,
+                         bool *extended);
+
+// Approves the client by sending |client_info| back in the form the client
+// sent its own.
+void send_client_info(network::SocketMessenger &messenger, const ClientInfo &client_info,
+                      bool extended);
+}  // namespace audio
+}  // namespace anbox
+
+#endif
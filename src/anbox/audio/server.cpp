@@ -15,6 +15,7 @@
  *
  */
 
+#include "anbox/audio/handshake.h"
 #include "anbox/audio/server.h"
 #include "anbox/audio/sink.h"
 #include "anbox/audio/source.h"
@@ -103,21 +104,22 @@ void Server::create_connection_for(std::shared_ptr<boost::asio::basic_stream_soc
   // We have to read the client flags first before we can continue
   // processing the actual commands
   ClientInfo client_info;
-  auto err = messenger->receive_msg(
-      boost::asio::buffer(&client_info, sizeof(ClientInfo)));
-  if (err) {
-    ERROR("Failed to read client info: %s", err.message());
+  bool extended = false;
+  if (!receive_client_info(*messenger, &client_info, &extended))
     return;
-  }
 
   std::shared_ptr<network::MessageProcessor> processor;
   std::shared_ptr<anbox::audio::Source>  mAudioSource;
 
   switch (client_info.type) {
-  case ClientInfo::Type::Playback:
-    processor = std::make_shared<AudioForwarder>(platform_->create_audio_sink());
+  case ClientInfo::Type::Playback: {
+    auto sink = platform_->create_audio_sink();
+    if (sink)
+      sink->configure(client_info);
+    processor = std::make_shared<AudioForwarder>(sink);
     DEBUG("create_connection for is called, audio type Playback");
     break;
+  }
   case ClientInfo::Type::Recording:
     DEBUG("create_connection for is called, audio type Recording");
     mAudioSource = platform_->create_audio_source();
@@ -128,10 +130,9 @@ void Server::create_connection_for(std::shared_ptr<boost::asio::basic_stream_soc
     return;
   }
 
-  // Everything ok, so approve the client by sending the requesting client
-  // info back. Once we have more things to negotiate we will send a modified
-  // client info struct back.
-  messenger->send(reinterpret_cast<char*>(&client_info), sizeof(client_info));
+  // Everything ok, so approve the client by sending the client info back
+  // with the playback format the sink settled on.
+  send_client_info(*messenger, client_info, extended);
 
   auto connection = std::make_shared<network::SocketConnection>(
         messenger, messenger, next_id(), connections_, processor);
@@ -18,6 +18,8 @@
 #ifndef ANBOX_AUDIO_SINK_H_
 #define ANBOX_AUDIO_SINK_H_
 
+#include "anbox/audio/client_info.h"
+
 #include <cstdint>
 
 #include <vector>
@@ -27,6 +29,9 @@ namespace audio {
 class Sink {
  public:
   virtual ~Sink() {}
+  // Called before any data is written with the format the client
+  // announced. Sinks update |client_info| with the one they play back.
+  virtual void configure(ClientInfo &client_info) { (void) client_info; }
   virtual void write_data(const std::vector<std::uint8_t> &data) = 0;
 };
 } // namespace audio
@@ -17,6 +17,7 @@
 
 #include "anbox/bridge/platform_api_skeleton.h"
 #include "anbox/application/database.h"
+#include "anbox/common/content_hash.h"
 #include "anbox/platform/base_platform.h"
 #include "anbox/wm/manager.h"
 #include "anbox/wm/window_state.h"
@@ -32,6 +33,19 @@
 #include <google/protobuf/stubs/callback.h>
 #endif
 
+namespace {
+anbox::wm::WindowState convert_window_state(
+    const anbox::protobuf::bridge::WindowStateUpdateEvent_WindowState &window) {
+  return anbox::wm::WindowState(
+      anbox::wm::Display::Id(window.display_id()), window.has_surface(),
+      anbox::graphics::Rect(window.frame_left(), window.frame_top(),
+                            window.frame_right(), window.frame_bottom()),
+      window.package_name(), anbox::wm::Task::Id(window.task_id()),
+      anbox::wm::Stack::Id(window.stack_id()),
+      window.videofullscreen(), window.flags());
+}
+}  // namespace
+
 namespace anbox {
 namespace bridge {
 PlatformApiSkeleton::PlatformApiSkeleton(
@@ -76,34 +90,68 @@ void PlatformApiSkeleton::handle_boot_finished_event(const anbox::protobuf::brid
 }
 
 void PlatformApiSkeleton::handle_window_state_update_event(const anbox::protobuf::bridge::WindowStateUpdateEvent &event) {
-  auto convert_window_state = [](
-      const ::anbox::protobuf::bridge::WindowStateUpdateEvent_WindowState
-          &window) {
-    return wm::WindowState(
-        wm::Display::Id(window.display_id()), window.has_surface(),
-        graphics::Rect(window.frame_left(), window.frame_top(),
-                       window.frame_right(), window.frame_bottom()),
-        window.package_name(), wm::Task::Id(window.task_id()),
-        wm::Stack::Id(window.stack_id()),
-        window.videofullscreen(), window.flags());
-  };
-
   wm::WindowState::List updated;
-  for (int n = 0; n < event.windows_size(); n++) {
-    const auto window = event.windows(n);
-    updated.push_back(convert_window_state(window));
-  }
+  updated.reserve(event.windows_size());
+  for (int n = 0; n < event.windows_size(); n++)
+    updated.push_back(convert_window_state(event.windows(n)));
 
   wm::WindowState::List removed;
-  for (int n = 0; n < event.removed_windows_size(); n++) {
-    const auto window = event.removed_windows(n);
-    removed.push_back(convert_window_state(window));
-  }
+  removed.reserve(event.removed_windows_size());
+  for (int n = 0; n < event.removed_windows_size(); n++)
+    removed.push_back(convert_window_state(event.removed_windows(n)));
+
+  // A full snapshot is always applied and becomes the base for all
+  // following deltas.
+  if (event.has_version())
+    window_state_version_ = event.version();
 
   window_manager_->apply_window_state_update(updated, removed);
 }
 
+void PlatformApiSkeleton::handle_window_state_delta_event(const anbox::protobuf::bridge::WindowStateDeltaEvent &event) {
+  if (event.version() <= window_state_version_) {
+    DEBUG("Ignoring outdated window state delta %d (current version %d)",
+          event.version(), window_state_version_);
+    return;
+  }
+
+  // Added and changed tasks always carry their complete state so applying
+  // a delta with a gap only misses removals until the next full snapshot.
+  if (event.base_version() != window_state_version_)
+    WARNING("Window state delta %d is based on version %d but we're at %d",
+            event.version(), event.base_version(), window_state_version_);
+
+  window_state_version_ = event.version();
+
+  wm::WindowStateDelta delta;
+  delta.added.reserve(event.added_windows_size());
+  for (int n = 0; n < event.added_windows_size(); n++)
+    delta.added.push_back(convert_window_state(event.added_windows(n)));
+
+  delta.changed.reserve(event.changed_windows_size());
+  for (int n = 0; n < event.changed_windows_size(); n++)
+    delta.changed.push_back(convert_window_state(event.changed_windows(n)));
+
+  delta.removed.reserve(event.removed_tasks_size());
+  for (int n = 0; n < event.removed_tasks_size(); n++)
+    delta.removed.push_back(wm::Task::Id(event.removed_tasks(n)));
+
+  window_manager_->apply_window_state_delta(delta);
+}
+
 void PlatformApiSkeleton::handle_application_list_update_event(const anbox::protobuf::bridge::ApplicationListUpdateEvent &event) {
+  if (event.has_version()) {
+    if (event.base_version() != application_list_version_)
+      WARNING("Application list update %d is based on version %d but we're at %d",
+              event.version(), event.base_version(), application_list_version_);
+    application_list_version_ = event.version();
+  } else if (!application_list_reset_ && event.applications_size() > 0) {
+    // Older guests send the complete list without telling us so. Start from
+    // scratch with it.
+    app_db_->retain({});
+    application_list_reset_ = true;
+  }
+
   for (int n = 0; n < event.removed_applications_size(); n++) {
     application::Database::Item item;
 
@@ -133,12 +181,23 @@ void PlatformApiSkeleton::handle_application_list_update_event(const anbox::prot
     for (int m = 0; m < li.categories_size(); m++)
       item.launch_intent.categories.push_back(li.categories(m));
 
-    item.icon = std::vector<char>(app.icon().begin(), app.icon().end());
+    // We don't trust the hash of icons we get and only use it to refer to
+    // ones we stored before.
+    if (app.icon().size() > 0)
+      item.icon_hash = common::content_hash(app.icon());
+    else
+      item.icon_hash = app.icon_hash();
 
     if (item.package.empty())
       continue;
 
-    app_db_->store_or_update(item);
+    app_db_->store_or_update(item, app.icon());
+  }
+
+  if (event.installed_packages_size() > 0) {
+    std::set<std::string> packages(event.installed_packages().begin(),
+                                   event.installed_packages().end());
+    app_db_->retain(packages);
   }
 }
 
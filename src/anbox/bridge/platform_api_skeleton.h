@@ -18,6 +18,7 @@
 #ifndef ANBOX_BRIDGE_PLATFORM_SERVER_H_
 #define ANBOX_BRIDGE_PLATFORM_SERVER_H_
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 
@@ -36,6 +37,7 @@ namespace bridge {
 class ClipboardData;
 class BootFinishedEvent;
 class WindowStateUpdateEvent;
+class WindowStateDeltaEvent;
 class ApplicationListUpdateEvent;
 }  // namespace bridge
 }  // namespace protobuf
@@ -72,6 +74,8 @@ class PlatformApiSkeleton {
       const anbox::protobuf::bridge::BootFinishedEvent &event);
   void handle_window_state_update_event(
       const anbox::protobuf::bridge::WindowStateUpdateEvent &event);
+  void handle_window_state_delta_event(
+      const anbox::protobuf::bridge::WindowStateDeltaEvent &event);
   void handle_application_list_update_event(
       const anbox::protobuf::bridge::ApplicationListUpdateEvent &event);
 
@@ -83,6 +87,9 @@ class PlatformApiSkeleton {
   std::shared_ptr<wm::Manager> window_manager_;
   std::shared_ptr<application::Database> app_db_;
   std::function<void()> boot_finished_handler_;
+  std::uint64_t window_state_version_ = 0;
+  std::uint64_t application_list_version_ = 0;
+  bool application_list_reset_ = false;
 };
 }  // namespace bridge
 }  // namespace anbox
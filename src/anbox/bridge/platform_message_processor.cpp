@@ -53,6 +53,9 @@ void PlatformMessageProcessor::process_event_sequence(
   if (seq.has_window_state_update())
     server_->handle_window_state_update_event(seq.window_state_update());
 
+  if (seq.has_window_state_delta())
+    server_->handle_window_state_delta_event(seq.window_state_delta());
+
   if (seq.has_application_list_update())
     server_->handle_application_list_update_event(
         seq.application_list_update());
@@ -42,12 +42,16 @@
 #include "anbox/rpc/channel.h"
 #include "anbox/rpc/connection_creator.h"
 #include "anbox/runtime.h"
+#include "anbox/stats/connection_creator.h"
+#include "anbox/stats/registry.h"
 #include "anbox/platform/base_platform.h"
 #include "anbox/wm/multi_window_manager.h"
 #include "anbox/wm/single_window_manager.h"
 
 #include "external/xdg/xdg.h"
 
+#include <cstdlib>
+
 #include <sys/prctl.h>
 
 #pragma GCC diagnostic pop
@@ -139,18 +143,29 @@ anbox::cmds::SessionManager::SessionManager()
         SystemConfiguration::instance().input_device_dir(),
     });
 
-    auto rt = Runtime::create();
+    Runtime::Config runtime_config;
+    try {
+      runtime_config = Runtime::parse_config(utils::get_env_value("ANBOX_RUNTIME_EXECUTORS", ""));
+    } catch (const std::exception &err) {
+      ERROR("%s", err.what());
+      return EXIT_FAILURE;
+    }
+
+    // By default everything runs on a single executor. Latency sensitive
+    // subsystems like input and audio can be isolated from bulk transfers
+    // like adb by giving them executors of their own.
+    auto rt = Runtime::create(runtime_config);
     auto dispatcher = anbox::common::create_dispatcher_for_runtime(rt);
 
     if (!standalone_) {
-      container_ = std::make_shared<container::Client>(rt);
+      container_ = std::make_shared<container::Client>(rt->executor(Runtime::Subsystem::Container));
       container_->register_terminate_handler([&]() {
         WARNING("Lost connection to container manager, terminating.");
         trap->stop();
       });
     }
 
-    auto input_manager = std::make_shared<input::Manager>(rt);
+    auto input_manager = std::make_shared<input::Manager>(rt->executor(Runtime::Subsystem::Input));
     auto android_api_stub = std::make_shared<bridge::AndroidApiStub>();
 
     auto display_frame = graphics::Rect::Invalid;
@@ -188,9 +203,24 @@ anbox::cmds::SessionManager::SessionManager()
     if (should_force_software_rendering == "true" || use_software_rendering_)
      gl_driver = graphics::GLRendererServer::Config::Driver::Software;
 
+    const auto should_compose_async = utils::get_env_value("ANBOX_ASYNC_COMPOSITION", "false");
+    const auto should_track_damage = utils::get_env_value("ANBOX_DAMAGE_TRACKING", "true");
+    const auto should_present_non_blocking = utils::get_env_value("ANBOX_NON_BLOCKING_PRESENT", "false");
+    const auto decode_shrink_threshold_mb = utils::get_env_value("ANBOX_GL_DECODE_SHRINK_THRESHOLD_MB", "0");
+    const auto profiled_gl_commands = utils::get_env_value("ANBOX_GL_PROFILE_TOP_COMMANDS", "0");
+    const auto should_shadow_gl_state = utils::get_env_value("ANBOX_GL_STATE_SHADOW", "true");
+    const auto vertex_cache_size_mb = utils::get_env_value("ANBOX_GL_VERTEX_CACHE_MB", "8");
+
     graphics::GLRendererServer::Config renderer_config {
       gl_driver,
-      single_window_
+      single_window_,
+      should_compose_async == "true",
+      should_track_damage == "true",
+      should_present_non_blocking == "true",
+      static_cast<std::size_t>(std::max(0, std::atoi(decode_shrink_threshold_mb.c_str()))) * 1024 * 1024,
+      static_cast<std::size_t>(std::max(0, std::atoi(profiled_gl_commands.c_str()))),
+      should_shadow_gl_state == "true",
+      static_cast<std::size_t>(std::max(0, std::atoi(vertex_cache_size_mb.c_str()))) * 1024 * 1024
     };
     auto gl_server = std::make_shared<graphics::GLRendererServer>(renderer_config, window_manager);
 
@@ -209,23 +239,36 @@ anbox::cmds::SessionManager::SessionManager()
             android_api_stub, wm::Stack::Id::Freeform);
     }
 
-    auto audio_server = std::make_shared<audio::Server>(rt, platform);
+    auto audio_server = std::make_shared<audio::Server>(rt->executor(Runtime::Subsystem::Audio), platform);
 
     const auto socket_path = SystemConfiguration::instance().socket_dir();
 
+    const auto adb_sessions = utils::get_env_value("ANBOX_ADB_SESSIONS", "1");
+    const auto should_splice_adb = utils::get_env_value("ANBOX_ADB_ZERO_COPY", "true");
+
+    auto adb_config = qemu::AdbMessageProcessor::default_config;
+    adb_config.max_sessions = std::max(1, std::atoi(adb_sessions.c_str()));
+    adb_config.zero_copy = should_splice_adb == "true";
+
     // The qemu pipe is used as a very fast communication channel between guest
     // and host for things like the GLES emulation/translation, the RIL or ADB.
     auto qemu_pipe_connector =
         std::make_shared<network::PublishedSocketConnector>(
-            utils::string_format("%s/qemu_pipe", socket_path), rt,
-            std::make_shared<qemu::PipeConnectionCreator>(gl_server->renderer(), rt));
+            utils::string_format("%s/qemu_pipe", socket_path), rt->executor(Runtime::Subsystem::Qemu),
+            std::make_shared<qemu::PipeConnectionCreator>(gl_server->renderer(), rt, adb_config));
+
+    // Statistics of all host side pipelines are available in the
+    // Prometheus text format from this socket.
+    auto stats_connector = std::make_shared<network::PublishedSocketConnector>(
+        utils::string_format("%s/anbox_stats", socket_path), rt,
+        std::make_shared<stats::ConnectionCreator>(stats::Registry::instance()));
 
     boost::asio::deadline_timer appmgr_start_timer(rt->service());
 
     auto bridge_connector = std::make_shared<network::PublishedSocketConnector>(
-        utils::string_format("%s/anbox_bridge", socket_path), rt,
+        utils::string_format("%s/anbox_bridge", socket_path), rt->executor(Runtime::Subsystem::Bridge),
         std::make_shared<rpc::ConnectionCreator>(
-            rt, [&](const std::shared_ptr<network::MessageSender> &sender) {
+            rt->executor(Runtime::Subsystem::Bridge), [&](const std::shared_ptr<network::MessageSender> &sender) {
               auto pending_calls = std::make_shared<rpc::PendingCallCache>();
               auto rpc_channel =
                   std::make_shared<rpc::Channel>(pending_calls, sender);
@@ -299,6 +342,13 @@ anbox::cmds::SessionManager::SessionManager()
 
     rt->stop();
 
+    for (const auto &stats : rt->stats()) {
+      DEBUG("Executor %s (%d threads): %d handlers, max queued %d, avg latency %d us, max latency %d us",
+            stats.name, stats.threads, stats.handlers, stats.max_queued,
+            stats.handlers > 0 ? stats.total_latency_us / stats.handlers : 0,
+            stats.max_latency_us);
+    }
+
     return EXIT_SUCCESS;
   });
 }
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/cache_line_aligned.h"
+
+#include <new>
+
+#include <stdlib.h>
+
+namespace anbox {
+namespace common {
+void *CacheLineAligned::operator new(std::size_t size) {
+  void *ptr = nullptr;
+  if (::posix_memalign(&ptr, cache_line_size, size) != 0)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void CacheLineAligned::operator delete(void *ptr) {
+  ::free(ptr);
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_CACHE_LINE_ALIGNED_H_
+#define ANBOX_COMMON_CACHE_LINE_ALIGNED_H_
+
+#include <cstddef>
+
+namespace anbox {
+namespace common {
+constexpr const std::size_t cache_line_size{64};
+
+// Plain operator new only honors the alignment of over-aligned types
+// starting with C++17. Types declared alignas(cache_line_size) derive
+// from this to get their own which does, as long as they are allocated
+// with new. Containers and std::make_shared still don't honor it.
+class CacheLineAligned {
+ public:
+  static void *operator new(std::size_t size);
+  static void operator delete(void *ptr);
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/content_hash.h"
+
+#include <cstdio>
+
+namespace {
+constexpr const std::uint64_t fnv_prime{0x100000001b3ULL};
+}
+
+namespace anbox {
+namespace common {
+std::uint64_t content_hash(const void *data, std::size_t size, std::uint64_t seed) {
+  auto hash = seed;
+  const auto bytes = static_cast<const std::uint8_t*>(data);
+  for (std::size_t n = 0; n < size; n++) {
+    hash ^= bytes[n];
+    hash *= fnv_prime;
+  }
+  return hash;
+}
+
+std::uint64_t content_hash(const std::string &data, std::uint64_t seed) {
+  return content_hash(data.data(), data.size(), seed);
+}
+
+std::string content_hash_to_string(std::uint64_t hash) {
+  char str[17];
+  std::snprintf(str, sizeof(str), "%016llx", static_cast<unsigned long long>(hash));
+  return str;
+}
+}  // namespace common
+}  // namespace anbox
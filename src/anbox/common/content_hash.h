@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_CONTENT_HASH_H_
+#define ANBOX_COMMON_CONTENT_HASH_H_
+
+#include <cstdint>
+#include <string>
+
+namespace anbox {
+namespace common {
+// 64 bit FNV-1a hash. Not suitable against malicious input but cheap
+// enough to key caches by content. Pass the result of a previous call as
+// |seed| to hash data spread over several buffers.
+constexpr const std::uint64_t content_hash_seed{0xcbf29ce484222325ULL};
+
+std::uint64_t content_hash(const void *data, std::size_t size,
+                           std::uint64_t seed = content_hash_seed);
+std::uint64_t content_hash(const std::string &data,
+                           std::uint64_t seed = content_hash_seed);
+
+// Fixed width lower case hex representation suitable for file names.
+std::string content_hash_to_string(std::uint64_t hash);
+}  // namespace common
+}  // namespace anbox
+
+#endif
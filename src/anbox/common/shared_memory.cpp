@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/shared_memory.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+namespace anbox {
+namespace common {
+Fd SharedMemory::create_fd(const std::string &name, std::size_t size) {
+#ifdef SYS_memfd_create
+  const int raw_fd = ::syscall(SYS_memfd_create, name.c_str(), MFD_CLOEXEC);
+#else
+  (void)name;
+  errno = ENOSYS;
+  const int raw_fd = -1;
+#endif
+  if (raw_fd < 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error(
+        std::string("Failed to create shared memory: ") + std::strerror(errno)));
+
+  Fd fd{raw_fd};
+  if (::ftruncate(fd, size) < 0)
+    BOOST_THROW_EXCEPTION(std::runtime_error(
+        std::string("Failed to size shared memory: ") + std::strerror(errno)));
+
+  return fd;
+}
+
+SharedMemory::SharedMemory(const std::string &name, std::size_t size)
+    : fd_(create_fd(name, size)), data_(nullptr), size_(size) {
+  auto addr = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED)
+    BOOST_THROW_EXCEPTION(std::runtime_error(
+        std::string("Failed to map shared memory: ") + std::strerror(errno)));
+  data_ = static_cast<std::uint8_t*>(addr);
+}
+
+SharedMemory::~SharedMemory() {
+  if (data_)
+    ::munmap(data_, size_);
+}
+
+bool SharedMemory::contains(std::size_t offset, std::size_t length) const {
+  return offset <= size_ && length <= size_ - offset;
+}
+}  // namespace common
+}  // namespace anbox
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_COMMON_SHARED_MEMORY_H_
+#define ANBOX_COMMON_SHARED_MEMORY_H_
+
+#include "anbox/common/fd.h"
+
+#include <cstdint>
+#include <string>
+
+namespace anbox {
+namespace common {
+// Anonymous memory mapped into our address space which can be shared with
+// another process by passing its file descriptor along.
+class SharedMemory {
+ public:
+  // Creates an anonymous memory file of |size| bytes. Throws when the
+  // kernel doesn't support it or we're out of memory.
+  static Fd create_fd(const std::string &name, std::size_t size);
+
+  SharedMemory(const std::string &name, std::size_t size);
+  ~SharedMemory();
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  Fd fd() const { return fd_; }
+  std::uint8_t *data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+  // Returns whether |length| bytes starting at |offset| lie completely
+  // within the memory.
+  bool contains(std::size_t offset, std::size_t length) const;
+
+ private:
+  Fd fd_;
+  std::uint8_t *data_;
+  std::size_t size_;
+};
+}  // namespace common
+}  // namespace anbox
+
+#endif
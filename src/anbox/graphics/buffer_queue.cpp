@@ -14,6 +14,40 @@
 
 #include "anbox/graphics/buffer_queue.h"
 
+#include <algorithm>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+// Number of times a side checks again before it goes to sleep. Most of the
+// time the other side is just about to push or pop something. With a single
+// CPU the other side can't make progress while we spin.
+int spin_count() {
+  static const int count = std::thread::hardware_concurrency() > 1 ? 128 : 0;
+  return count;
+}
+
+size_t round_up_to_power_of_two(size_t value) {
+  size_t result = 1;
+  while (result < value)
+    result <<= 1;
+  return result;
+}
+
+void futex_wait(std::atomic<int> *addr, int value) {
+  ::syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAIT_PRIVATE, value,
+            nullptr, nullptr, 0);
+}
+
+void futex_wake(std::atomic<int> *addr) {
+  ::syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAKE_PRIVATE, 1,
+            nullptr, nullptr, 0);
+}
+}  // namespace
+
 namespace anbox {
 namespace graphics {
 BufferQueue::BufferQueue(size_t capacity)
@@ -100,5 +134,130 @@ void BufferQueue::close_locked() {
     can_pop_.notify_all();
   }
 }
+
+LockFreeBufferQueue::LockFreeBufferQueue(size_t capacity)
+    : capacity_(round_up_to_power_of_two(std::max<size_t>(capacity, 1))),
+      mask_(capacity_ - 1),
+      buffers_(new Buffer[capacity_]),
+      consumer_(new Consumer),
+      producer_(new Producer) {}
+
+LockFreeBufferQueue::~LockFreeBufferQueue() {}
+
+template <typename Predicate>
+void LockFreeBufferQueue::wait(std::atomic<int> &waiter, Predicate ready) {
+  for (int n = 0; n < spin_count(); n++) {
+    if (ready())
+      return;
+  }
+
+  // The other side publishes its progress before it checks for waiters and
+  // we announce ourselves before checking its progress. The full fences on
+  // both sides make sure at least one of us sees the other.
+  while (true) {
+    waiter.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ready())
+      break;
+    futex_wait(&waiter, 1);
+  }
+  waiter.store(0, std::memory_order_relaxed);
+}
+
+void LockFreeBufferQueue::wake(std::atomic<int> &waiter) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiter.load(std::memory_order_relaxed) != 0 && waiter.exchange(0) != 0)
+    futex_wake(&waiter);
+}
+
+int LockFreeBufferQueue::try_push(Buffer &&buffer) {
+  if (closed_.load(std::memory_order_acquire))
+    return -EIO;
+
+  const auto tail = producer_->tail.load(std::memory_order_relaxed);
+  if (tail - producer_->cached_head >= capacity_) {
+    producer_->cached_head = consumer_->head.load(std::memory_order_acquire);
+    if (tail - producer_->cached_head >= capacity_)
+      return -EAGAIN;
+  }
+
+  buffers_[tail & mask_] = std::move(buffer);
+  producer_->tail.store(tail + 1, std::memory_order_release);
+  wake(consumer_->waiter);
+
+  return 0;
+}
+
+int LockFreeBufferQueue::push(Buffer &&buffer) {
+  while (true) {
+    const auto result = try_push(std::move(buffer));
+    if (result != -EAGAIN)
+      return result;
+
+    const auto tail = producer_->tail.load(std::memory_order_relaxed);
+    wait(producer_->waiter, [&]() {
+      return closed_.load(std::memory_order_acquire) ||
+             tail - consumer_->head.load(std::memory_order_acquire) < capacity_;
+    });
+  }
+}
+
+int LockFreeBufferQueue::try_pop_batch(Buffer *buffers, size_t max) {
+  const auto head = consumer_->head.load(std::memory_order_relaxed);
+  if (consumer_->cached_tail == head) {
+    consumer_->cached_tail = producer_->tail.load(std::memory_order_acquire);
+    if (consumer_->cached_tail == head) {
+      if (!closed_.load(std::memory_order_acquire))
+        return -EAGAIN;
+      // Something might have been pushed right before the queue was closed
+      consumer_->cached_tail = producer_->tail.load(std::memory_order_acquire);
+      if (consumer_->cached_tail == head)
+        return -EIO;
+    }
+  }
+
+  const auto count = std::min(consumer_->cached_tail - head, max);
+  for (size_t n = 0; n < count; n++)
+    buffers[n] = std::move(buffers_[(head + n) & mask_]);
+
+  consumer_->head.store(head + count, std::memory_order_release);
+  wake(producer_->waiter);
+
+  return static_cast<int>(count);
+}
+
+int LockFreeBufferQueue::pop_batch(Buffer *buffers, size_t max) {
+  while (true) {
+    const auto result = try_pop_batch(buffers, max);
+    if (result != -EAGAIN)
+      return result;
+
+    const auto head = consumer_->head.load(std::memory_order_relaxed);
+    wait(consumer_->waiter, [&]() {
+      return closed_.load(std::memory_order_acquire) ||
+             producer_->tail.load(std::memory_order_acquire) != head;
+    });
+  }
+}
+
+int LockFreeBufferQueue::try_pop(Buffer *buffer) {
+  const auto result = try_pop_batch(buffer, 1);
+  return result < 0 ? result : 0;
+}
+
+int LockFreeBufferQueue::pop(Buffer *buffer) {
+  const auto result = pop_batch(buffer, 1);
+  return result < 0 ? result : 0;
+}
+
+bool LockFreeBufferQueue::empty() const {
+  return consumer_->head.load(std::memory_order_acquire) == producer_->tail.load(std::memory_order_acquire);
+}
+
+void LockFreeBufferQueue::close() {
+  closed_.store(true, std::memory_order_release);
+  wake(consumer_->waiter);
+  wake(producer_->waiter);
+}
 }  // namespace graphics
 }  // namespace anbox
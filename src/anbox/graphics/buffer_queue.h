@@ -15,8 +15,10 @@
 #ifndef ANBOX_GRAPHICS_BUFFER_QUEUE_H_
 #define ANBOX_GRAPHICS_BUFFER_QUEUE_H_
 
+#include "anbox/common/cache_line_aligned.h"
 #include "anbox/common/small_vector.h"
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -53,6 +55,68 @@ class BufferQueue {
   std::condition_variable can_pop_;
 };
 
+// A variant of BufferQueue for exactly one producer and one consumer
+// thread which doesn't need any lock. Both sides only synchronize through
+// the read and write positions and a side that has to wait for the other
+// one sleeps on a futex which the other side only wakes when somebody is
+// actually waiting. The return values follow BufferQueue: 0 on success,
+// -EAGAIN if the operation would block and -EIO once the queue is closed
+// (and empty, for popping).
+class LockFreeBufferQueue {
+ public:
+  // |capacity| is rounded up to the next power of two.
+  explicit LockFreeBufferQueue(size_t capacity);
+  ~LockFreeBufferQueue();
+
+  // Producer side
+  int try_push(Buffer &&buffer);
+  int push(Buffer &&buffer);
+
+  // Consumer side
+  int try_pop(Buffer *buffer);
+  int pop(Buffer *buffer);
+  // Pop up to |max| buffers at once. Returns the number of buffers popped
+  // or a negative error. pop_batch() waits until at least one buffer is
+  // available.
+  int try_pop_batch(Buffer *buffers, size_t max);
+  int pop_batch(Buffer *buffers, size_t max);
+
+  // Can be called from any thread. Both only give a snapshot which might
+  // be outdated when the other side is active.
+  bool empty() const;
+  bool is_closed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Can be called from any thread. Wakes up both sides.
+  void close();
+
+ private:
+  template <typename Predicate>
+  void wait(std::atomic<int> &waiter, Predicate ready);
+  void wake(std::atomic<int> &waiter);
+
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<Buffer[]> buffers_;
+  std::atomic<bool> closed_{false};
+
+  // Keep what each side writes on its own cache line so that they don't
+  // keep stealing them from each other. They are allocated separately as
+  // the queue itself is embedded in objects created with std::make_shared
+  // which doesn't honor their alignment.
+  struct alignas(common::cache_line_size) Consumer : public common::CacheLineAligned {
+    std::atomic<size_t> head{0};
+    size_t cached_tail = 0;
+    std::atomic<int> waiter{0};
+  };
+  struct alignas(common::cache_line_size) Producer : public common::CacheLineAligned {
+    std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+    std::atomic<int> waiter{0};
+  };
+  const std::unique_ptr<Consumer> consumer_;
+  const std::unique_ptr<Producer> producer_;
+};
+
 }  // namespace graphics
 }  // namespace anbox
 
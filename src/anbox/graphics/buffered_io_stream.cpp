@@ -16,17 +16,44 @@
  */
 
 #include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/stats/registry.h"
 #include "anbox/logger.h"
 
+#include <algorithm>
+#include <cstring>
+
+namespace {
+struct StreamMetrics {
+  anbox::stats::Counter &received_bytes;
+  anbox::stats::Counter &sent_bytes;
+  anbox::stats::Histogram &write_batch_buffers;
+};
+
+StreamMetrics &metrics() {
+  auto &registry = anbox::stats::Registry::instance();
+  static StreamMetrics m{
+      registry.counter("anbox_gl_stream_received_bytes_total",
+                       "Bytes received from GL clients"),
+      registry.counter("anbox_gl_stream_sent_bytes_total",
+                       "Bytes sent to GL clients"),
+      registry.histogram("anbox_gl_stream_write_batch_buffers",
+                         "Buffers written out together with a single write",
+                         anbox::stats::Histogram::exponential_bounds(1, 5)),
+  };
+  return m;
+}
+}  // namespace
+
 namespace anbox {
 namespace graphics {
 BufferedIOStream::BufferedIOStream(
     const std::shared_ptr<anbox::network::SocketMessenger> &messenger,
-    size_t buffer_size)
+    size_t buffer_size, IngestMode ingest_mode)
     : IOStream(buffer_size),
       messenger_(messenger),
       in_queue_(1024U),
       out_queue_(16U),
+      ring_(ingest_mode == IngestMode::Streaming ? new StreamRingBuffer : nullptr),
       worker_thread_(&BufferedIOStream::thread_main, this) {
   write_buffer_.resize_noinit(buffer_size);
 }
@@ -37,26 +64,23 @@ BufferedIOStream::~BufferedIOStream() {
 }
 
 void *BufferedIOStream::allocBuffer(size_t min_size) {
-  std::unique_lock<std::mutex> l(out_lock_);
   if (write_buffer_.size() < min_size) write_buffer_.resize_noinit(min_size);
   return write_buffer_.data();
 }
 
 size_t BufferedIOStream::commitBuffer(size_t size) {
-  std::unique_lock<std::mutex> l(out_lock_);
   assert(size <= write_buffer_.size());
   if (write_buffer_.isAllocated()) {
     write_buffer_.resize(size);
-    out_queue_.push_locked(std::move(write_buffer_), l);
+    out_queue_.push(std::move(write_buffer_));
   } else {
-    out_queue_.push_locked(
-        Buffer{write_buffer_.data(), write_buffer_.data() + size}, l);
+    out_queue_.push(
+        Buffer{write_buffer_.data(), write_buffer_.data() + size});
   }
   return size;
 }
 
 const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
-  std::unique_lock<std::mutex> l(lock_);
   size_t count = 0U;
 
   if ((buf == nullptr) || (inout_len == nullptr)) {
@@ -65,6 +89,20 @@ const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
   }
   size_t wanted = *inout_len;
   auto dst = static_cast<uint8_t *>(buf);
+
+  if (ring_) {
+    // Readers which can't parse in place still get a copy.
+    size_t avail = 0;
+    const auto data = ring_->wait_for_data(0, &avail);
+    if (!data)
+      return nullptr;
+    count = std::min(wanted, avail);
+    memcpy(dst, data, count);
+    ring_->consume(count);
+    *inout_len = count;
+    return static_cast<const unsigned char *>(buf);
+  }
+
   while (count < wanted) {
     if (read_buffer_left_ > 0) {
       size_t avail = std::min<size_t>(wanted - count, read_buffer_left_);
@@ -79,9 +117,9 @@ const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
     bool blocking = (count == 0);
     auto result = -EIO;
     if (blocking)
-      result = in_queue_.pop_locked(&read_buffer_, l);
+      result = in_queue_.pop(&read_buffer_);
     else
-      result = in_queue_.try_pop_locked(&read_buffer_);
+      result = in_queue_.try_pop(&read_buffer_);
 
     if (result == 0) {
       read_buffer_left_ = read_buffer_.size();
@@ -100,42 +138,113 @@ const unsigned char *BufferedIOStream::read(void *buf, size_t *inout_len) {
 }
 
 void BufferedIOStream::forceStop() {
-  std::lock_guard<std::mutex> l(lock_);
-  in_queue_.close_locked();
-  out_queue_.close_locked();
+  in_queue_.close();
+  out_queue_.close();
+  if (ring_)
+    ring_->close();
 }
 
-void BufferedIOStream::post_data(Buffer &&data) {
-  std::unique_lock<std::mutex> l(lock_);
-  in_queue_.push_locked(std::move(data), l);
+bool BufferedIOStream::post_data(Buffer &&data) {
+  if (ring_) {
+    // With streaming ingest the reader only looks at the ring so data
+    // handed over as a whole, like what a client sent along with its
+    // handshake, has to end up there too.
+    size_t offset = 0;
+    while (offset < data.size()) {
+      size_t available = 0;
+      auto dst = ring_->prepare(&available);
+      if (!dst) {
+        // The reader is gone, nothing will ever consume the data.
+        ERROR("Stream was closed, dropping %d bytes", data.size() - offset);
+        forceStop();
+        return false;
+      }
+      const auto size = std::min(available, data.size() - offset);
+      std::memcpy(dst, data.data() + offset, size);
+      commit_data(size);
+      offset += size;
+    }
+    return true;
+  }
+
+  const auto size = data.size();
+  if (in_queue_.push(std::move(data)) != 0) {
+    ERROR("Stream was closed, dropping %d bytes", size);
+    return false;
+  }
+  metrics().received_bytes.add(size);
+  return true;
+}
+
+std::uint8_t *BufferedIOStream::prepare_data(size_t *size) {
+  if (!ring_)
+    return nullptr;
+  return ring_->prepare(size);
+}
+
+bool BufferedIOStream::commit_data(size_t size) {
+  if (!ring_)
+    return false;
+  metrics().received_bytes.add(size);
+  ring_->commit(size);
+  return true;
 }
 
 bool BufferedIOStream::needs_data() {
-  std::unique_lock<std::mutex> l(lock_);
-  return !in_queue_.can_pop_locked();
+  if (ring_)
+    return ring_->readable() == 0;
+
+  return in_queue_.empty();
 }
 
 void BufferedIOStream::thread_main() {
-  while (true) {
-    std::unique_lock<std::mutex> l(out_lock_);
+  static constexpr const size_t max_batch_size{16};
+  Buffer buffers[max_batch_size];
+  struct iovec iov[max_batch_size];
 
-    Buffer buffer;
-    const auto result = out_queue_.pop_locked(&buffer, l);
-    if (result != 0 && result != -EAGAIN) break;
+  while (true) {
+    const auto result = out_queue_.pop_batch(buffers, max_batch_size);
+    if (result < 0) break;
+
+    // Everything the render thread committed in the meantime goes out with
+    // a single gathering write rather than one write per buffer.
+    const auto count = static_cast<size_t>(result);
+    size_t size = 0;
+    for (size_t n = 0; n < count; n++) {
+      iov[n].iov_base = buffers[n].data();
+      iov[n].iov_len = buffers[n].size();
+      size += buffers[n].size();
+    }
 
-    auto bytes_left = buffer.size();
+    size_t first = 0;
+    auto bytes_left = size;
     while (bytes_left > 0) {
-      const auto written = messenger_->send_raw(
-          reinterpret_cast<const char*>(buffer.data() + (buffer.size() - bytes_left)), bytes_left);
+      const auto written = messenger_->send_raw_gathered(iov + first, count - first);
       if (written < 0) {
         if (errno != EINTR && errno != EAGAIN) {
           ERROR("Failed to write data: %s", std::strerror(errno));
           break;
         }
         // Socket is busy, lets try again
-      } else
-        bytes_left -= written;
+        continue;
+      }
+
+      bytes_left -= written;
+      // Skip what went out already, the write might have stopped in the
+      // middle of a buffer.
+      auto skip = static_cast<size_t>(written);
+      while (first < count && skip >= iov[first].iov_len) {
+        skip -= iov[first].iov_len;
+        first++;
+      }
+      if (first < count) {
+        iov[first].iov_base = static_cast<std::uint8_t*>(iov[first].iov_base) + skip;
+        iov[first].iov_len -= skip;
+      }
     }
+
+    metrics().sent_bytes.add(size - bytes_left);
+    metrics().write_batch_buffers.observe(count);
   }
 }
 }  // namespace graphics
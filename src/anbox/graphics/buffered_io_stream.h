@@ -21,9 +21,11 @@
 #include "external/android-emugl/host/include/libOpenglRender/IOStream.h"
 
 #include "anbox/graphics/buffer_queue.h"
+#include "anbox/graphics/stream_ring_buffer.h"
 #include "anbox/network/socket_messenger.h"
 
 #include <memory>
+#include <mutex>
 #include <thread>
 
 namespace anbox {
@@ -32,9 +34,18 @@ class BufferedIOStream : public IOStream {
  public:
   static const size_t default_buffer_size{384};
 
+  enum class IngestMode {
+    // Incoming data is posted as separate buffers and copied out by read().
+    Queued,
+    // Incoming data is received straight into a ring buffer the decoders
+    // parse in place, see prepare_data() and ring().
+    Streaming,
+  };
+
   explicit BufferedIOStream(
       const std::shared_ptr<anbox::network::SocketMessenger> &messenger,
-      size_t buffer_size = default_buffer_size);
+      size_t buffer_size = default_buffer_size,
+      IngestMode ingest_mode = IngestMode::Queued);
 
   virtual ~BufferedIOStream();
 
@@ -42,7 +53,16 @@ class BufferedIOStream : public IOStream {
   size_t commitBuffer(size_t size) override;
   const unsigned char *read(void *buf, size_t *inout_len) override;
   void forceStop() override;
-  void post_data(Buffer &&data);
+  // Returns false if the stream was stopped and the data got dropped.
+  bool post_data(Buffer &&data);
+
+  // Streaming mode only: returns the range the next socket read should
+  // land in and makes |size| bytes of it available to the reader.
+  std::uint8_t *prepare_data(size_t *size);
+  bool commit_data(size_t size);
+  // Streaming mode only: the ring the incoming data can be parsed from in
+  // place. Returns nullptr in queued mode.
+  StreamRingBuffer *ring() const { return ring_.get(); }
 
   bool needs_data();
 
@@ -50,13 +70,16 @@ class BufferedIOStream : public IOStream {
   void thread_main();
 
   std::shared_ptr<anbox::network::SocketMessenger> messenger_;
-  std::mutex lock_;
-  std::mutex out_lock_;
   Buffer write_buffer_;
   Buffer read_buffer_;
   size_t read_buffer_left_ = 0;
-  BufferQueue in_queue_;
-  BufferQueue out_queue_;
+  // Both queues have a single producer and a single consumer: incoming
+  // data is posted by the socket reader and read by the render thread,
+  // outgoing data is committed by the render thread and written out by
+  // our worker thread.
+  LockFreeBufferQueue in_queue_;
+  LockFreeBufferQueue out_queue_;
+  std::unique_ptr<StreamRingBuffer> ring_;
   std::thread worker_thread_;
 };
 }  // namespace graphics
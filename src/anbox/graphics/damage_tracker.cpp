@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/damage_tracker.h"
+#include "anbox/wm/window.h"
+
+#include <algorithm>
+
+namespace {
+bool is_empty(const anbox::graphics::Rect &rect) {
+  return rect.width() <= 0 || rect.height() <= 0;
+}
+
+anbox::graphics::Rect clip(const anbox::graphics::Rect &rect, const anbox::graphics::Rect &bounds) {
+  return anbox::graphics::Rect{std::max(rect.left(), bounds.left()),
+                               std::max(rect.top(), bounds.top()),
+                               std::min(rect.right(), bounds.right()),
+                               std::min(rect.bottom(), bounds.bottom())};
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+DamageTracker::WindowDamageList DamageTracker::update(const LayerComposer::Strategy::WindowRenderableList &win_layers) {
+  WindowDamageList damage;
+  std::map<std::shared_ptr<wm::Window>, WindowState> windows;
+
+  for (const auto &w : win_layers) {
+    WindowState current{
+        w.first->native_handle(),
+        Rect{0, 0, w.first->frame().width(), w.first->frame().height()},
+        w.first->checkResizeable(),
+        w.second};
+
+    const auto invalidated = w.first->take_invalidation();
+    auto last = windows_.find(w.first);
+    if (last == windows_.end() || invalidated)
+      damage.insert({w.first, current.frame});
+    else
+      damage.insert({w.first, damage_for(last->second, current)});
+
+    windows.insert({w.first, std::move(current)});
+  }
+
+  windows_.swap(windows);
+  return damage;
+}
+
+Rect DamageTracker::damage_for(const WindowState &last, const WindowState &current) const {
+  if (last.native_handle != current.native_handle ||
+      last.frame != current.frame ||
+      last.resizing || current.resizing ||
+      last.renderables.size() != current.renderables.size())
+    return current.frame;
+
+  Rect damage = Rect::Empty;
+  for (std::size_t n = 0; n < current.renderables.size(); n++) {
+    const auto &before = last.renderables[n];
+    const auto &after = current.renderables[n];
+    if (before == after)
+      continue;
+
+    // Layers are drawn with a transformation around their center which we
+    // don't map into window coordinates here so damage the whole window.
+    const auto identity = glm::mat4(1.0f);
+    if (before.transformation() != identity || after.transformation() != identity)
+      return current.frame;
+
+    for (const auto &rect : {before.screen_position(), after.screen_position()}) {
+      const auto visible = clip(rect, current.frame);
+      if (is_empty(visible))
+        continue;
+      if (is_empty(damage))
+        damage = visible;
+      else
+        damage.merge(visible);
+    }
+  }
+
+  return damage;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_DAMAGE_TRACKER_H_
+#define ANBOX_GRAPHICS_DAMAGE_TRACKER_H_
+
+#include "anbox/graphics/layer_composer.h"
+
+#include <map>
+#include <memory>
+
+namespace anbox {
+namespace graphics {
+// Keeps the layers each window was last drawn with and computes which part
+// of a window changed with a new frame.
+//
+// Layers are compared by buffer, position, crop, transformation and alpha.
+// A layer showing new content always comes with a different buffer as the
+// guest can't queue the buffer again which is still presented.
+class DamageTracker {
+ public:
+  typedef std::map<std::shared_ptr<wm::Window>, Rect> WindowDamageList;
+
+  // Returns the damaged region of every window in window coordinates. The
+  // region is empty when nothing changed since the window was last drawn.
+  // Windows not part of |win_layers| are forgotten and fully damaged the
+  // next time they show up. Windows the host invalidated, resizes or just
+  // finished resizing are fully damaged as well as the host changed their
+  // surface without the layers changing.
+  WindowDamageList update(const LayerComposer::Strategy::WindowRenderableList &win_layers);
+
+ private:
+  struct WindowState {
+    EGLNativeWindowType native_handle;
+    Rect frame;
+    bool resizing;
+    RenderableList renderables;
+  };
+
+  Rect damage_for(const WindowState &last, const WindowState &current) const;
+
+  std::map<std::shared_ptr<wm::Window>, WindowState> windows_;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -18,7 +18,6 @@
 #include "anbox/graphics/emugl/DispatchTables.h"
 #include "anbox/graphics/emugl/RenderThreadInfo.h"
 #include "anbox/graphics/emugl/TextureDraw.h"
-#include "anbox/graphics/emugl/TextureResize.h"
 #include "anbox/logger.h"
 
 #include "external/android-emugl/host/include/OpenGLESDispatch/EGLDispatch.h"
@@ -156,19 +155,6 @@ ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
     s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    //
-    // create another texture for that colorbuffer for blit
-    //
-    s_gles2.glGenTextures(1, &cb->m_blitTex);
-    s_gles2.glBindTexture(GL_TEXTURE_2D, cb->m_blitTex);
-    s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, texInternalFormat, p_width, p_height,
-                         0, texInternalFormat, GL_UNSIGNED_BYTE, NULL);
-
-    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
     cb->m_width = p_width;
     cb->m_height = p_height;
     cb->m_internalFormat = texInternalFormat;
@@ -177,21 +163,28 @@ ColorBuffer* ColorBuffer::create(EGLDisplay p_display, int p_width,
         cb->m_eglImage = s_egl.eglCreateImageKHR(
             p_display, s_egl.eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
             reinterpret_cast<EGLClientBuffer>(SafePointerFromUInt(cb->m_tex)), NULL);
-
-        cb->m_blitEGLImage = s_egl.eglCreateImageKHR(
-            p_display, s_egl.eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
-            reinterpret_cast<EGLClientBuffer>(SafePointerFromUInt(cb->m_blitTex)), NULL);
-    }
-
-    cb->m_resizer = new(std::nothrow) TextureResize(p_width, p_height);
-    if (!(cb->m_resizer)) {
-        delete cb;
-        return NULL;
     }
 
     return cb;
 }
 
+bool ColorBuffer::createBlitImage() {
+    s_gles2.glGenTextures(1, &m_blitTex);
+    s_gles2.glBindTexture(GL_TEXTURE_2D, m_blitTex);
+    s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, m_internalFormat, m_width, m_height,
+                         0, m_internalFormat, GL_UNSIGNED_BYTE, NULL);
+
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    m_blitEGLImage = s_egl.eglCreateImageKHR(
+        m_display, s_egl.eglGetCurrentContext(), EGL_GL_TEXTURE_2D_KHR,
+        reinterpret_cast<EGLClientBuffer>(SafePointerFromUInt(m_blitTex)), NULL);
+    return m_blitEGLImage != NULL;
+}
+
 ColorBuffer::ColorBuffer(EGLDisplay display, Helper* helper, HandleType hndl)
     : m_tex(0),
       m_blitTex(0),
@@ -203,7 +196,6 @@ ColorBuffer::ColorBuffer(EGLDisplay display, Helper* helper, HandleType hndl)
       m_internalFormat(0),
       m_display(display),
       m_helper(helper),
-      m_resizer(NULL),
       mHndl(hndl) {}
 
 ColorBuffer::~ColorBuffer() {
@@ -222,9 +214,6 @@ ColorBuffer::~ColorBuffer() {
 
     GLuint tex[2] = {m_tex, m_blitTex};
     s_gles2.glDeleteTextures(2, tex);
-
-    delete m_resizer;
-
 }
 
 HandleType ColorBuffer::getHndl() const {
@@ -267,6 +256,18 @@ bool ColorBuffer::blitFromCurrentReadBuffer() {
         return false;
     }
 
+    // Without EGLImage support there is nothing to blit through
+    if (!m_eglImage) {
+        return false;
+    }
+
+    if (!m_blitEGLImage) {
+        ScopedHelperContext context(m_helper);
+        if (!context.isOk() || !createBlitImage()) {
+            return false;
+        }
+    }
+
     // Copy the content of the current read surface into m_blitEGLImage.
     // This is done by creating a temporary texture, bind it to the EGLImage
     // then call glCopyTexSubImage2D().
@@ -338,6 +339,8 @@ bool ColorBuffer::bindToTexture() {
     } else {
         s_gles1.glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, m_eglImage);
     }
+    // The guest's glGetError has to see what this raised
+    tInfo->currContext->decoderContextData().stateShadow().markErrorsPossible();
     return true;
 }
 
@@ -357,6 +360,7 @@ bool ColorBuffer::bindToRenderbuffer() {
     } else {
         s_gles1.glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER_OES, m_eglImage);
     }
+    tInfo->currContext->decoderContextData().stateShadow().markErrorsPossible();
     return true;
 }
 
@@ -371,7 +375,10 @@ void ColorBuffer::readback(unsigned char* img) {
     }
 }
 
-void ColorBuffer::bind() {
-    const auto id = m_resizer->update(m_tex);
+void ColorBuffer::bind(const TextureResize::Viewport& viewport) {
+    auto id = m_tex;
+    if (auto resizer = m_helper->getTextureResize()) {
+        id = resizer->update(m_tex, m_width, m_height, viewport);
+    }
     s_gles2.glBindTexture(GL_TEXTURE_2D, id);
 }
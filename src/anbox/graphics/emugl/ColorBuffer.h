@@ -20,12 +20,13 @@
 #include <EGL/eglext.h>
 #include <GLES/gl.h>
 
+#include "anbox/graphics/emugl/TextureResize.h"
+
 #include <memory>
 
 typedef uint32_t HandleType;
 
 class TextureDraw;
-class TextureResize;
 
 // A class used to model a guest color buffer, and used to implement several
 // related things:
@@ -66,6 +67,7 @@ class ColorBuffer {
     virtual bool setupContext() = 0;
     virtual void teardownContext() = 0;
     virtual TextureDraw* getTextureDraw() const = 0;
+    virtual TextureResize* getTextureResize() const = 0;
   };
 
   // Create a new ColorBuffer instance.
@@ -115,7 +117,10 @@ class ColorBuffer {
   // |img| must be a buffer large enough (i.e. width * height * 4).
   void readback(unsigned char* img);
 
-  void bind();
+  // Bind the texture to draw this ColorBuffer into |viewport| to the current
+  // context's GL_TEXTURE_2D. Buffers a lot larger than the viewport are
+  // scaled down first.
+  void bind(const TextureResize::Viewport& viewport);
 
   HandleType getHndl() const;
 
@@ -124,6 +129,10 @@ class ColorBuffer {
 
   explicit ColorBuffer(EGLDisplay display, Helper* helper, HandleType hndl);
 
+  // Only buffers used for window surfaces are ever blitted to so the
+  // blit texture is created on first use.
+  bool createBlitImage();
+
  private:
   GLuint m_tex;
   GLuint m_blitTex;
@@ -135,7 +144,6 @@ class ColorBuffer {
   GLenum m_internalFormat;
   EGLDisplay m_display;
   Helper* m_helper;
-  TextureResize* m_resizer;
   HandleType mHndl;
 };
 
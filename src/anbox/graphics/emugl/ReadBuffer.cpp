@@ -15,62 +15,199 @@
 */
 
 #include "anbox/graphics/emugl/ReadBuffer.h"
+#include "anbox/graphics/stream_ring_buffer.h"
+#include "anbox/stats/registry.h"
 #include "anbox/logger.h"
 
+#include <algorithm>
+#include <atomic>
+
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
 #include <string.h>
 
+namespace {
+// Every command starts with its opcode followed by its total size
+const size_t kCommandHeaderSize = 2 * sizeof(uint32_t);
+// Leftover data is only moved to the front when less room than this is
+// left behind it.
+const size_t kMinReadSize = 16 * 1024;
+const size_t kPageSize = 4096;
+
+std::atomic<size_t> s_allocated{0};
+std::atomic<size_t> s_shrink_threshold{ReadBuffer::kDefaultShrinkThreshold};
+
+struct ReadBufferMetrics {
+  anbox::stats::Gauge &allocated;
+  anbox::stats::Counter &grows;
+  anbox::stats::Counter &shrinks;
+};
+
+ReadBufferMetrics &metrics() {
+  auto &registry = anbox::stats::Registry::instance();
+  static ReadBufferMetrics m{
+      registry.gauge("anbox_gl_read_buffer_bytes", "Memory held by all GL decode buffers"),
+      registry.counter("anbox_gl_read_buffer_grows_total", "Times a GL decode buffer had to grow"),
+      registry.counter("anbox_gl_read_buffer_shrinks_total", "Times a GL decode buffer shrank back"),
+  };
+  return m;
+}
+}  // namespace
+
+const size_t ReadBuffer::kInitialSize;
+const size_t ReadBuffer::kDefaultShrinkThreshold;
+const std::chrono::milliseconds ReadBuffer::kShrinkDelay{1000};
+
 ReadBuffer::ReadBuffer(size_t bufsize)
-  : m_size(bufsize),
+  : m_readPtr(NULL),
     m_buf(NULL),
+    m_size(0),
     m_validData(0),
-    m_readPtr(NULL) {
-  if (m_size == 0) {
+    m_ring(NULL),
+    m_highWaterMark(0),
+    m_highWaterMarkGauge(NULL) {
+  if (bufsize == 0) {
     ERROR("bufsize invailed !");
     return;
   }
-  m_buf = static_cast<unsigned char*>(malloc(m_size * sizeof(unsigned char)));
-  if (!m_buf) {
-    ERROR("Failed to alloc %zu bytes for ReadBuffer", (m_size * sizeof(unsigned char)));
-    return;
-  }
-  m_readPtr = m_buf;
+  resize(bufsize);
 }
 
-ReadBuffer::~ReadBuffer() { 
+ReadBuffer::ReadBuffer(anbox::graphics::StreamRingBuffer *ring)
+  : m_readPtr(NULL),
+    m_buf(NULL),
+    m_size(0),
+    m_validData(0),
+    m_ring(ring),
+    m_highWaterMark(0),
+    m_highWaterMarkGauge(NULL) {}
+
+ReadBuffer::~ReadBuffer() {
   if (m_buf) {
     free(m_buf);
+    s_allocated -= m_size;
+    metrics().allocated.sub(m_size);
   }
 }
 
+void ReadBuffer::setShrinkThreshold(size_t threshold) {
+  s_shrink_threshold = threshold;
+}
+
+size_t ReadBuffer::allocatedBytes() {
+  return s_allocated;
+}
+
+void ReadBuffer::setHighWaterMarkGauge(anbox::stats::Gauge *gauge) {
+  m_highWaterMarkGauge = gauge;
+  if (m_highWaterMarkGauge)
+    m_highWaterMarkGauge->set(m_highWaterMark);
+}
+
+bool ReadBuffer::resize(size_t size) {
+  size = (size + kPageSize - 1) / kPageSize * kPageSize;
+
+  // Only the data not consumed yet is carried over rather than the whole
+  // buffer as realloc() would do.
+  auto buf = static_cast<unsigned char*>(malloc(size));
+  if (!buf) {
+    ERROR("Failed to alloc %zu bytes for ReadBuffer", size);
+    return false;
+  }
+  if (m_validData > 0)
+    memcpy(buf, m_readPtr, m_validData);
+
+  if (m_buf)
+    free(m_buf);
+
+  s_allocated += size;
+  s_allocated -= m_size;
+  auto &m = metrics();
+  m.allocated.add(static_cast<int64_t>(size) - static_cast<int64_t>(m_size));
+
+  m_buf = buf;
+  m_readPtr = buf;
+  m_size = size;
+
+  if (m_size > m_highWaterMark) {
+    m_highWaterMark = m_size;
+    if (m_highWaterMarkGauge)
+      m_highWaterMarkGauge->set(m_highWaterMark);
+  }
+  return true;
+}
+
+void ReadBuffer::maybeShrink() {
+  if (m_size <= kInitialSize)
+    return;
+
+  if (s_allocated <= s_shrink_threshold &&
+      std::chrono::steady_clock::now() - m_lastLargeUse < kShrinkDelay)
+    return;
+
+  if (resize(kInitialSize))
+    metrics().shrinks.add();
+}
+
 int ReadBuffer::getData(IOStream* stream) {
-  if (stream == NULL) return -1;
-  if ((m_validData > 0) && (m_readPtr > m_buf)) {
+  if (m_ring) {
+    // Data already lands in the ring so all we have to do is waiting for
+    // more than we've already seen. The ring grows by itself when a single
+    // command doesn't fit into it.
+    size_t avail = 0;
+    const unsigned char *data = m_ring->wait_for_data(m_validData, &avail);
+    if (!data) return -1;
+    size_t len = avail - m_validData;
+    m_readPtr = const_cast<unsigned char*>(data);
+    m_validData = avail;
+    return len;
+  }
+
+  if (stream == NULL || m_buf == NULL) return -1;
+
+  if (m_validData == 0) {
+    m_readPtr = m_buf;
+    maybeShrink();
+  }
+
+  // Only move the start of a partial command to the front once there is
+  // not enough room behind it anymore.
+  size_t offset = m_readPtr - m_buf;
+  if (offset > 0 && m_size - offset - m_validData < kMinReadSize) {
     memmove(m_buf, m_readPtr, m_validData);
+    m_readPtr = m_buf;
+    offset = 0;
   }
+
   // get fresh data into the buffer;
-  size_t len = m_size - m_validData;
+  size_t len = m_size - offset - m_validData;
   if (len == 0) {
-    // we need to inc our buffer
+    // All complete commands are decoded already so what we hold is the
+    // start of a single command which doesn't fit. Grow to what it needs
+    // rather than doubling.
     size_t new_size = m_size * 2;
-    unsigned char* new_buf;
-    if (new_size < m_size) {  // overflow check
+    if (m_validData >= kCommandHeaderSize) {
+      uint32_t cmd_size = 0;
+      memcpy(&cmd_size, m_readPtr + sizeof(uint32_t), sizeof(uint32_t));
+      if (cmd_size > m_size)
+        new_size = cmd_size;
+    }
+    if (new_size < m_size || new_size > static_cast<size_t>(INT_MAX)) {  // overflow check
       new_size = INT_MAX;
     }
 
-    new_buf = static_cast<unsigned char*>(realloc(m_buf, new_size));
-    if (!new_buf) {
-      ERROR("Failed to alloc %zu bytes for ReadBuffer", new_size);
+    if (!resize(new_size)) {
       return -1;
     }
-    m_size = new_size;
-    m_buf = new_buf;
+    metrics().grows.add();
     len = m_size - m_validData;
   }
-  m_readPtr = m_buf;
-  if (NULL != stream->read(m_buf + m_validData, &len)) {
+
+  if (NULL != stream->read(m_readPtr + m_validData, &len)) {
     m_validData += len;
+    if (m_validData > kInitialSize)
+      m_lastLargeUse = std::chrono::steady_clock::now();
     return len;
   }
   return -1;
@@ -80,4 +217,5 @@ void ReadBuffer::consume(size_t amount) {
   assert(amount <= m_validData);
   m_validData -= amount;
   m_readPtr += amount;
+  if (m_ring) m_ring->consume(amount);
 }
@@ -18,9 +18,34 @@
 
 #include "external/android-emugl/host/include/libOpenglRender/IOStream.h"
 
+#include <chrono>
+
+namespace anbox {
+namespace graphics {
+class StreamRingBuffer;
+}  // namespace graphics
+namespace stats {
+class Gauge;
+}  // namespace stats
+}  // namespace anbox
+
+// Holds the data a render thread decodes. The buffer starts out small and
+// only grows as far as the largest pending command needs. A grown buffer
+// shrinks back once it wasn't needed at its size for kShrinkDelay. While
+// all buffers together hold more than the shrink threshold every buffer
+// shrinks back as soon as it is drained. The threshold doesn't limit how
+// far a buffer grows, a command always gets the memory it needs.
 class ReadBuffer {
  public:
-  explicit ReadBuffer(size_t bufSize);
+  // Buffers start out with and shrink back to this size
+  static const size_t kInitialSize = 64 * 1024;
+  static const size_t kDefaultShrinkThreshold = 64 * 1024 * 1024;
+  static const std::chrono::milliseconds kShrinkDelay;
+
+  explicit ReadBuffer(size_t bufSize = kInitialSize);
+  // Parses in place from |ring| instead of reading from the stream passed
+  // to getData().
+  explicit ReadBuffer(anbox::graphics::StreamRingBuffer *ring);
   ~ReadBuffer();
   unsigned char *m_readPtr;
   int getData(IOStream *stream);              // get fresh data from the stream
@@ -29,10 +54,29 @@ class ReadBuffer {
     return m_validData;
   }                             // return the amount of valid data in readptr
   void consume(size_t amount);  // notify that 'amount' data has been consumed;
+
+  // Current and largest size the buffer had
+  size_t size() const { return m_size; }
+  size_t highWaterMark() const { return m_highWaterMark; }
+  // Reports the high-water mark to |gauge| whenever it changes
+  void setHighWaterMarkGauge(anbox::stats::Gauge *gauge);
+
+  static void setShrinkThreshold(size_t threshold);
+  // Memory currently held by all buffers
+  static size_t allocatedBytes();
+
  private:
+  bool resize(size_t size);
+  void maybeShrink();
+
   unsigned char *m_buf;
   size_t m_size;
   size_t m_validData;
+  anbox::graphics::StreamRingBuffer *m_ring;
+  size_t m_highWaterMark;
+  anbox::stats::Gauge *m_highWaterMarkGauge;
+  // Last time more than kInitialSize bytes were buffered
+  std::chrono::steady_clock::time_point m_lastLargeUse;
 };
 
 #endif
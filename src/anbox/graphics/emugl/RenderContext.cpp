@@ -15,9 +15,13 @@
 */
 
 #include "anbox/graphics/emugl/RenderContext.h"
+#include "anbox/graphics/emugl/DispatchTables.h"
+#include "anbox/logger.h"
 
 #include "OpenGLESDispatch/EGLDispatch.h"
 
+#include <vector>
+
 RenderContext* RenderContext::create(EGLDisplay display, EGLConfig config,
                                      EGLContext sharedContext, bool isGl2) {
   const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, isGl2 ? 2 : 1,
@@ -36,6 +40,35 @@ RenderContext::RenderContext(EGLDisplay display, EGLContext context, bool isGl2)
 
 RenderContext::~RenderContext() {
   if (mContext != EGL_NO_CONTEXT) {
+    releaseCachedBuffers();
     s_egl.eglDestroyContext(mDisplay, mContext);
   }
 }
+
+// Buffer objects belong to the share group rather than the context, so
+// the ones the decoder cached vertex data in would live on as long as any
+// context sharing with this one does.
+void RenderContext::releaseCachedBuffers() {
+  std::vector<GLuint> buffers;
+  mContextData.vertexDataCache().clear(&buffers);
+  if (buffers.empty()) {
+    return;
+  }
+
+  const EGLContext prevContext = s_egl.eglGetCurrentContext();
+  const EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
+  const EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+  const bool rebind = prevContext != mContext;
+
+  if (rebind && !s_egl.eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, mContext)) {
+    WARNING("Failed to bind context to delete %d cached buffers: 0x%04x",
+            buffers.size(), s_egl.eglGetError());
+    return;
+  }
+
+  s_gles2.glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+
+  if (rebind) {
+    s_egl.eglMakeCurrent(mDisplay, prevDrawSurf, prevReadSurf, prevContext);
+  }
+}
@@ -55,6 +55,9 @@ class RenderContext {
 
   RenderContext(EGLDisplay display, EGLContext context, bool isGl2);
 
+  // Deletes the buffer objects client side vertex data was cached in.
+  void releaseCachedBuffers();
+
  private:
   EGLDisplay mDisplay;
   EGLContext mContext;
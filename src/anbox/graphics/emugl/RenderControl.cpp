@@ -97,10 +97,27 @@ static EGLint rcQueryEGLString(EGLenum name, void* buffer, EGLint bufferSize) {
   return len;
 }
 
+static EGLint copyGLString(const std::string& str, void* buffer, EGLint bufferSize) {
+  int nextBufferSize = str.size() + 1;
+
+  if (!buffer || nextBufferSize > bufferSize)
+    return -nextBufferSize;
+
+  snprintf(static_cast<char*>(buffer), nextBufferSize, "%s", str.c_str());
+  return nextBufferSize;
+}
+
 static EGLint rcGetGLString(EGLenum name, void* buffer, EGLint bufferSize) {
   RenderThreadInfo* tInfo = RenderThreadInfo::get();
   std::string result;
 
+  // The guest asks twice for every string, first for its size
+  GLStateShadow* shadow = nullptr;
+  if (tInfo && tInfo->currContext && GLStateShadow::enabled())
+    shadow = &tInfo->currContext->decoderContextData().stateShadow();
+  if (shadow && shadow->getString(name, &result))
+    return copyGLString(result, buffer, bufferSize);
+
   if (tInfo && tInfo->currContext) {
     const char* str = nullptr;
     if (tInfo->currContext->isGL2())
@@ -150,13 +167,10 @@ static EGLint rcGetGLString(EGLenum name, void* buffer, EGLint bufferSize) {
     result = filter_extensions(result, whitelisted_extensions);
   }
 
-  int nextBufferSize = result.size() + 1;
-
-  if (!buffer || nextBufferSize > bufferSize)
-    return -nextBufferSize;
+  if (shadow)
+    shadow->storeString(name, result);
 
-  snprintf(static_cast<char*>(buffer), nextBufferSize, "%s", result.c_str());
-  return nextBufferSize;
+  return copyGLString(result, buffer, bufferSize);
 }
 
 static EGLint rcGetNumConfigs(uint32_t *p_numAttribs) {
@@ -405,7 +419,9 @@ int rcGetDisplayVsyncPeriod(uint32_t display_id) {
   return 1;
 }
 
-static std::vector<Renderable> frame_layers;
+// Layers are collected per render thread so that concurrently decoding
+// threads can't interleave their frames.
+static thread_local std::vector<Renderable> frame_layers;
 
 bool is_layer_blacklisted(const std::string &name) {
   static std::vector<std::string> blacklist = {
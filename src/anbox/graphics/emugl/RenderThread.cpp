@@ -20,32 +20,141 @@
 #include "anbox/graphics/emugl/RenderThreadInfo.h"
 #include "anbox/graphics/emugl/Renderer.h"
 #include "anbox/graphics/emugl/TimeUtils.h"
+#include "anbox/graphics/buffered_io_stream.h"
+#include "anbox/stats/registry.h"
 #include "anbox/logger.h"
 
 #include "external/android-emugl/shared/OpenglCodecCommon/ChecksumCalculatorThreadInfo.h"
+#include "external/android-emugl/shared/OpenglCodecCommon/DecoderProfile.h"
 #include "external/android-emugl/host/include/OpenGLESDispatch/EGLDispatch.h"
 #include "external/android-emugl/host/include/OpenGLESDispatch/GLESv1Dispatch.h"
 #include "external/android-emugl/host/include/OpenGLESDispatch/GLESv2Dispatch.h"
 
+#include <algorithm>
+#include <atomic>
+
 #include <stdio.h>
+#include <string.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 
-#define STREAM_BUFFER_SIZE 4 * 1024 * 1024
+namespace {
+const char *kReadBufferHighWaterMark = "anbox_render_thread_read_buffer_high_water_bytes";
+// How often a render thread logs where its time went while profiling
+constexpr const std::chrono::seconds kDecoderProfileInterval{10};
+
+std::atomic<std::size_t> profiled_opcodes{0};
+
+struct RenderThreadMetrics {
+  anbox::stats::Gauge &threads;
+  anbox::stats::Counter &decoded_bytes;
+  anbox::stats::Histogram &decode_us;
+  anbox::stats::Histogram &read_buffer_high_water;
+};
+
+RenderThreadMetrics &metrics() {
+  auto &registry = anbox::stats::Registry::instance();
+  static RenderThreadMetrics m{
+      registry.gauge("anbox_render_threads", "Running render threads"),
+      registry.counter("anbox_render_thread_decoded_bytes_total",
+                       "Bytes of GL commands decoded by all render threads"),
+      registry.histogram("anbox_render_thread_decode_duration_us",
+                         "Time spent decoding the data available after each read",
+                         anbox::stats::Histogram::exponential_bounds(16, 14)),
+      registry.histogram("anbox_render_thread_exited_read_buffer_high_water_bytes",
+                         "Largest decode buffer of render threads which exited",
+                         anbox::stats::Histogram::exponential_bounds(64 * 1024, 10)),
+  };
+  return m;
+}
+}  // namespace
 
-RenderThread::RenderThread(const std::shared_ptr<Renderer> &renderer, IOStream *stream, std::mutex &m)
+RenderThread::RenderThread(const std::shared_ptr<Renderer> &renderer,
+                           anbox::graphics::BufferedIOStream *stream, std::mutex *m)
     : emugl::Thread(), renderer_(renderer), m_lock(m), m_stream(stream) {}
 
 RenderThread::~RenderThread() {
   forceStop();
 }
 
-RenderThread *RenderThread::create(const std::shared_ptr<Renderer> &renderer, IOStream *stream, std::mutex &m) {
+RenderThread *RenderThread::create(const std::shared_ptr<Renderer> &renderer,
+                                   anbox::graphics::BufferedIOStream *stream, std::mutex *m) {
   return new RenderThread(renderer, stream, m);
 }
 
 void RenderThread::forceStop() { m_stream->forceStop(); }
 
+void RenderThread::setCommandObserver(const CommandObserver &observer) {
+  m_commandObserver = observer;
+}
+
+void RenderThread::setDecoderProfiling(std::size_t count) {
+  profiled_opcodes = count;
+  emugl::DecoderProfile::setEnabled(count > 0);
+}
+
+void RenderThread::dumpDecoderProfile(RenderThreadInfo &threadInfo) {
+  const auto count = profiled_opcodes.load();
+  if (count == 0)
+    return;
+
+  std::vector<emugl::DecoderProfile::Entry> entries;
+  for (auto profile : {&threadInfo.m_glDec.m_profile, &threadInfo.m_gl2Dec.m_profile,
+                       &threadInfo.m_rcDec.m_profile}) {
+    const auto top = profile->top(count);
+    entries.insert(entries.end(), top.begin(), top.end());
+    profile->reset();
+  }
+  if (entries.empty())
+    return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const emugl::DecoderProfile::Entry &a, const emugl::DecoderProfile::Entry &b) {
+              return a.estimatedNs > b.estimatedNs;
+            });
+  if (entries.size() > count)
+    entries.resize(count);
+
+  INFO("Render thread %d top %d GL commands:", threadInfo.m_tid, entries.size());
+  for (const auto &entry : entries)
+    INFO("  %s: %d calls, %d bytes, ~%d us", entry.name ? entry.name : "unknown",
+         entry.calls, entry.bytes, entry.estimatedNs / 1000);
+}
+
+void RenderThread::decodeObserved(RenderThreadInfo &threadInfo, ReadBuffer &readBuf) {
+  // Every command starts with its opcode and its total size including
+  // this header which is the same for all decoders.
+  static const size_t headerSize = 2 * sizeof(uint32_t);
+
+  while (readBuf.validData() >= headerSize) {
+    uint32_t opcode = 0, size = 0;
+    memcpy(&opcode, readBuf.buf(), sizeof(uint32_t));
+    memcpy(&size, readBuf.buf() + sizeof(uint32_t), sizeof(uint32_t));
+    if (size < headerSize || readBuf.validData() < size)
+      break;
+
+    std::unique_lock<std::mutex> l;
+    if (m_lock)
+      l = std::unique_lock<std::mutex>(*m_lock);
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t last = threadInfo.m_glDec.decode(readBuf.buf(), size, m_stream);
+    if (last == 0)
+      last = threadInfo.m_gl2Dec.decode(readBuf.buf(), size, m_stream);
+    if (last == 0)
+      last = threadInfo.m_rcDec.decode(readBuf.buf(), size, m_stream);
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    // None of the decoders knows this command
+    if (last == 0)
+      break;
+
+    readBuf.consume(last);
+    metrics().decoded_bytes.add(last);
+    m_commandObserver(opcode, size, std::chrono::duration_cast<std::chrono::nanoseconds>(duration));
+  }
+}
+
 intptr_t RenderThread::main() {
   RenderThreadInfo threadInfo;
   threadInfo.m_tid = syscall(SYS_gettid);
@@ -55,24 +164,50 @@ intptr_t RenderThread::main() {
   threadInfo.m_gl2Dec.initGL(gles2_dispatch_get_proc_func, NULL);
   initRenderControlContext(&threadInfo.m_rcDec);
 
-  ReadBuffer readBuf(STREAM_BUFFER_SIZE);
+  std::unique_ptr<ReadBuffer> readBufPtr;
+  if (m_stream->ring())
+    readBufPtr.reset(new ReadBuffer(m_stream->ring()));
+  else
+    readBufPtr.reset(new ReadBuffer());
+  ReadBuffer &readBuf = *readBufPtr;
+
+  auto &m = metrics();
+  m.threads.add();
+
+  auto &registry = anbox::stats::Registry::instance();
+  const anbox::stats::Labels threadLabels{{"thread", std::to_string(threadInfo.m_tid)}};
+  readBuf.setHighWaterMarkGauge(&registry.gauge(
+      kReadBufferHighWaterMark, "Largest size the decode buffer of a render thread had",
+      threadLabels));
+
+  auto last_profile_dump = std::chrono::steady_clock::now();
 
   while (true) {
     int stat = readBuf.getData(m_stream);
     if (stat <= 0)
       break;
 
+    if (m_commandObserver) {
+      decodeObserved(threadInfo, readBuf);
+      continue;
+    }
+
+    const auto decode_start = std::chrono::steady_clock::now();
+    size_t decoded = 0;
     bool progress = false;
     do {
       progress = false;
 
-      std::unique_lock<std::mutex> l(m_lock);
+      std::unique_lock<std::mutex> l;
+      if (m_lock)
+        l = std::unique_lock<std::mutex>(*m_lock);
 
       size_t last =
           threadInfo.m_glDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
       if (last > 0) {
         progress = true;
         readBuf.consume(last);
+        decoded += last;
       }
 
       last =
@@ -80,18 +215,33 @@ intptr_t RenderThread::main() {
       if (last > 0) {
         progress = true;
         readBuf.consume(last);
+        decoded += last;
       }
 
       last = threadInfo.m_rcDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
       if (last > 0) {
         readBuf.consume(last);
+        decoded += last;
         progress = true;
       }
 
     } while (progress);
 
+    const auto decode_end = std::chrono::steady_clock::now();
+    m.decoded_bytes.add(decoded);
+    m.decode_us.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+        decode_end - decode_start).count());
+
+    // Each dump covers what the thread did since the last one so that it
+    // shows the hotspots of what the app is doing right now.
+    if (decode_end - last_profile_dump >= kDecoderProfileInterval) {
+      dumpDecoderProfile(threadInfo);
+      last_profile_dump = decode_end;
+    }
   }
 
+  dumpDecoderProfile(threadInfo);
+
   threadInfo.m_gl2Dec.freeShader();
   threadInfo.m_gl2Dec.freeProgram();
 
@@ -104,5 +254,15 @@ intptr_t RenderThread::main() {
   renderer_->drainRenderContext();
 
   renderer_->cleanupProcGLObjects(threadInfo.m_tid);
+
+  readBuf.setHighWaterMarkGauge(nullptr);
+  registry.remove(kReadBufferHighWaterMark, threadLabels);
+  if (readBuf.highWaterMark() > 0) {
+    m.read_buffer_high_water.observe(readBuf.highWaterMark());
+    DEBUG("Render thread %d exiting, decode buffer high-water mark %d bytes",
+          threadInfo.m_tid, readBuf.highWaterMark());
+  }
+
+  m.threads.sub();
   return 0;
 }
@@ -21,10 +21,22 @@
 
 #include "emugl/common/thread.h"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 
+class ReadBuffer;
 class Renderer;
+struct RenderThreadInfo;
+
+namespace anbox {
+namespace graphics {
+class BufferedIOStream;
+}  // namespace graphics
+}  // namespace anbox
 
 // A class used to model a thread of the RenderServer. Each one of them
 // handles a single guest client / protocol byte stream.
@@ -34,10 +46,13 @@ class RenderThread : public emugl::Thread {
   // |stream| is an input stream that will be read from the thread,
   // and deleted by it when it exits.
   // |mutex| is a pointer to a shared mutex used to serialize
-  // decoding operations between all threads.
-  // TODO(digit): Why is this needed here? Shouldn't this be handled
-  //              by the decoders themselves or at a lower-level?
-  static RenderThread* create(const std::shared_ptr<Renderer>& renderer, IOStream* stream, std::mutex &m);
+  // decoding operations between all threads. When it is NULL the thread
+  // decodes concurrently with all others and only synchronizes on the
+  // Renderer state it actually touches.
+  // When |stream| receives its data into a ring buffer the commands are
+  // decoded in place from it instead of being read into a separate buffer.
+  static RenderThread* create(const std::shared_ptr<Renderer>& renderer,
+                              anbox::graphics::BufferedIOStream* stream, std::mutex *m);
 
   // Destructor.
   virtual ~RenderThread();
@@ -49,16 +64,36 @@ class RenderThread : public emugl::Thread {
   // Force a thread to stop.
   void forceStop();
 
+  // Called for every decoded command with its opcode, its size in bytes and
+  // how long it took to decode and execute it.
+  typedef std::function<void(uint32_t opcode, uint32_t size, std::chrono::nanoseconds duration)>
+      CommandObserver;
+
+  // Set an observer which gets called for every single command. This makes
+  // the thread hand the decoders one command at a time and is meant for
+  // profiling only. Has to be called before the thread is started.
+  void setCommandObserver(const CommandObserver &observer);
+
+  // Count and time the commands of all render threads per opcode and let
+  // every thread periodically log the |count| opcodes it spent most time
+  // executing. Zero switches profiling off again.
+  static void setDecoderProfiling(std::size_t count);
+
  private:
   RenderThread();  // No default constructor
 
-  RenderThread(const std::shared_ptr<Renderer>& renderer, IOStream* stream, std::mutex &m);
+  RenderThread(const std::shared_ptr<Renderer>& renderer,
+               anbox::graphics::BufferedIOStream* stream, std::mutex *m);
 
   virtual intptr_t main();
 
+  void decodeObserved(RenderThreadInfo &threadInfo, ReadBuffer &readBuf);
+  void dumpDecoderProfile(RenderThreadInfo &threadInfo);
+
   std::shared_ptr<Renderer> renderer_;
-  std::mutex &m_lock;
-  IOStream* m_stream;
+  std::mutex *m_lock;
+  anbox::graphics::BufferedIOStream* m_stream;
+  CommandObserver m_commandObserver;
 };
 
 #endif
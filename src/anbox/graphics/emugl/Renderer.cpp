@@ -17,6 +17,7 @@
 #include <map>
 #include "anbox/graphics/emugl/Renderer.h"
 #include "anbox/graphics/emugl/DispatchTables.h"
+#include "anbox/graphics/emugl/RendererWindowStats.h"
 #include "anbox/graphics/emugl/RenderThreadInfo.h"
 #include "anbox/graphics/emugl/TimeUtils.h"
 #include "anbox/graphics/gl_extensions.h"
@@ -29,7 +30,9 @@
 
 #include <stdio.h>
 #include <cstdint>
+#include <algorithm>
 #include <chrono>
+#include <deque>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wold-style-cast"
@@ -90,6 +93,8 @@ class ColorBufferHelper : public ColorBuffer::Helper {
 
   virtual TextureDraw *getTextureDraw() const { return mFb->getTextureDraw(); }
 
+  virtual TextureResize *getTextureResize() const { return mFb->getTextureResize(); }
+
   ~ColorBufferHelper() {}
  private:
   Renderer *mFb;
@@ -147,22 +152,40 @@ bool Renderer::initialize(EGLNativeDisplayType nativeDisplay) {
   if (!surfaceless_supported)
     DEBUG("EGL doesn't support surfaceless context");
 
+  m_caps.has_buffer_age = egl_extensions.support("EGL_EXT_buffer_age") ||
+                          egl_extensions.support("EGL_KHR_partial_update");
+  m_caps.has_partial_update = egl_extensions.support("EGL_KHR_partial_update") &&
+                              s_egl.eglSetDamageRegionKHR;
+  if (egl_extensions.support("EGL_KHR_swap_buffers_with_damage") && s_egl.eglSwapBuffersWithDamageKHR)
+    m_swapBuffersWithDamage = s_egl.eglSwapBuffersWithDamageKHR;
+  else if (egl_extensions.support("EGL_EXT_swap_buffers_with_damage") && s_egl.eglSwapBuffersWithDamageEXT)
+    m_swapBuffersWithDamage = s_egl.eglSwapBuffersWithDamageEXT;
+  m_caps.has_swap_buffers_with_damage = m_swapBuffersWithDamage != nullptr;
+
   s_egl.eglBindAPI(EGL_OPENGL_ES_API);
 
   // Create EGL context for framebuffer post rendering.
   GLint surfaceType = EGL_WINDOW_BIT | EGL_PBUFFER_BIT;
-  const GLint configAttribs[] = {EGL_RED_SIZE, 8,
-                                 EGL_GREEN_SIZE, 8,
-                                 EGL_BLUE_SIZE, 8,
-                                 EGL_SURFACE_TYPE, surfaceType,
-                                 EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
-                                 EGL_NONE};
+  GLint configAttribs[] = {EGL_RED_SIZE, 8,
+                           EGL_GREEN_SIZE, 8,
+                           EGL_BLUE_SIZE, 8,
+                           EGL_SURFACE_TYPE, surfaceType,
+                           EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+                           EGL_NONE};
 
   int n;
   if ((s_egl.eglChooseConfig(m_eglDisplay, configAttribs, &m_eglConfig,
                              1, &n) == EGL_FALSE) || n == 0) {
-    ERROR("Failed to select EGL configuration");
-    return false;
+    // Headless platforms (e.g. Mesa's surfaceless one used when replaying
+    // GL streams) don't have any window capable configuration. We can still
+    // render into pbuffers there, just not present anything.
+    configAttribs[7] = EGL_PBUFFER_BIT;
+    if ((s_egl.eglChooseConfig(m_eglDisplay, configAttribs, &m_eglConfig,
+                               1, &n) == EGL_FALSE) || n == 0) {
+      ERROR("Failed to select EGL configuration");
+      return false;
+    }
+    WARNING("No window capable EGL configuration available, rendering offscreen only");
   }
 
   static const GLint glContextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2,
@@ -276,6 +299,10 @@ bool Renderer::initialize(EGLNativeDisplayType nativeDisplay) {
     return false;
   }
 
+  // GL objects are only created once the first buffer needs resizing
+  // which happens from the composition context.
+  m_textureResize = new TextureResize;
+
   m_defaultProgram = m_family.add_program(vshader, defaultFShader);
   m_alphaProgram = m_family.add_program(vshader, alphaFShader);
 
@@ -310,7 +337,10 @@ Renderer::Renderer()
       m_prevReadSurf(EGL_NO_SURFACE),
       m_prevDrawSurf(EGL_NO_SURFACE),
       m_textureDraw(NULL),
+      m_textureResize(NULL),
       m_lastPostedColorBuffer(0),
+      m_swapBuffersWithDamage(nullptr),
+      m_swapInterval(-1),
       m_statsNumFrames(0),
       m_statsStartTime(0LL),
       m_glVendor(NULL),
@@ -321,6 +351,7 @@ Renderer::Renderer()
 
 Renderer::~Renderer() {
   delete m_textureDraw;
+  delete m_textureResize;
   delete m_configs;
   delete m_colorBufferHelper;
 }
@@ -331,11 +362,16 @@ struct RendererWindow {
   anbox::graphics::Rect viewport;
   glm::mat4 screen_to_gl_coords;
   glm::mat4 display_transform;
+  // Damage of the most recent frames, newest first. Used together with the
+  // age of the back buffer to find out what needs to be repainted.
+  std::deque<anbox::graphics::Rect> damage_history;
+  RendererWindowStats stats;
+  std::chrono::steady_clock::time_point last_stats_report;
 };
 
 RendererWindow *Renderer::createNativeWindow(
     EGLNativeWindowType native_window) {
-  m_lock.lock();
+  std::lock_guard<std::recursive_mutex> l(m_contextLock);
 
   auto window = new RendererWindow;
   window->native_window = native_window;
@@ -343,36 +379,35 @@ RendererWindow *Renderer::createNativeWindow(
       m_eglDisplay, m_eglConfig, window->native_window, nullptr);
   if (window->surface == EGL_NO_SURFACE) {
     delete window;
-    m_lock.unlock();
     return nullptr;
   }
 
   if (!bindWindow_locked(window)) {
     s_egl.eglDestroySurface(m_eglDisplay, window->surface);
     delete window;
-    m_lock.unlock();
     return nullptr;
   }
 
+  applySwapInterval_locked(window);
+
   s_gles2.glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
                   GL_STENCIL_BUFFER_BIT);
   s_egl.eglSwapBuffers(m_eglDisplay, window->surface);
 
   unbind_locked();
 
+  window->last_stats_report = std::chrono::steady_clock::now();
   m_nativeWindows.insert({native_window, window});
 
-  m_lock.unlock();
-
   return window;
 }
 
 void Renderer::destroyNativeWindow(EGLNativeWindowType native_window) {
+  std::lock_guard<std::recursive_mutex> l(m_contextLock);
+
   auto w = m_nativeWindows.find(native_window);
   if (w == m_nativeWindows.end()) return;
 
-  m_lock.lock();
-
   s_egl.eglMakeCurrent(m_eglDisplay, nullptr, nullptr, nullptr);
 
   if (w->second->surface != EGL_NO_SURFACE)
@@ -380,8 +415,45 @@ void Renderer::destroyNativeWindow(EGLNativeWindowType native_window) {
 
   delete w->second;
   m_nativeWindows.erase(w);
+}
+
+void Renderer::setSwapInterval(int interval) {
+  std::lock_guard<std::recursive_mutex> l(m_contextLock);
+
+  m_swapInterval = interval;
+  for (auto &w : m_nativeWindows) {
+    if (!bindWindow_locked(w.second))
+      continue;
+    applySwapInterval_locked(w.second);
+    unbind_locked();
+  }
+}
+
+void Renderer::applySwapInterval_locked(RendererWindow *window) {
+  if (m_swapInterval < 0)
+    return;
 
-  m_lock.unlock();
+  // The swap interval applies to the surface currently bound
+  if (!s_egl.eglSwapInterval(m_eglDisplay, m_swapInterval))
+    WARNING("Failed to set swap interval %d for window %p", m_swapInterval,
+            reinterpret_cast<void*>(window->native_window));
+}
+
+void Renderer::updateWindowStats_locked(RendererWindow *window, int64_t present_us) {
+  auto &stats = window->stats;
+  const auto now = std::chrono::steady_clock::now();
+  stats.record(present_us, now);
+
+  if (!m_fpsStats)
+    return;
+
+  if (now - window->last_stats_report < std::chrono::seconds(1))
+    return;
+
+  INFO("Window %p: %d frames presented, present latency last %d us avg %d us max %d us",
+       reinterpret_cast<void*>(window->native_window), stats.frames(),
+       stats.last_present_us(), stats.average_present_us(), stats.max_present_us());
+  window->last_stats_report = now;
 }
 
 HandleType Renderer::genHandle() {
@@ -397,7 +469,7 @@ HandleType Renderer::genHandle() {
 
 HandleType Renderer::createColorBuffer(int p_width, int p_height,
                                        GLenum p_internalFormat) {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   HandleType ret = 0;
   ret = genHandle();
@@ -424,7 +496,7 @@ HandleType Renderer::createColorBuffer(int p_width, int p_height,
 
 HandleType Renderer::createRenderContext(int p_config, HandleType p_share,
                                          bool p_isGL2) {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   HandleType ret = 0;
 
@@ -468,7 +540,7 @@ HandleType Renderer::createRenderContext(int p_config, HandleType p_share,
 
 HandleType Renderer::createWindowSurface(int p_config, int p_width,
                                          int p_height) {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   HandleType ret = 0;
 
@@ -494,7 +566,7 @@ HandleType Renderer::createWindowSurface(int p_config, int p_width,
 }
 
 void Renderer::drainRenderContext() {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   RenderThreadInfo *tinfo = RenderThreadInfo::get();
   if (!tinfo || tinfo->m_contextSet.empty()) {
@@ -509,7 +581,7 @@ void Renderer::drainRenderContext() {
 }
 
 void Renderer::drainWindowSurface() {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   RenderThreadInfo *tinfo = RenderThreadInfo::get();
   if (tinfo->m_windowSet.empty()) return;
@@ -528,7 +600,7 @@ void Renderer::drainWindowSurface() {
 }
 
 void Renderer::DestroyRenderContext(HandleType p_context) {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   m_contexts.erase(p_context);
   RenderThreadInfo *tinfo = RenderThreadInfo::get();
@@ -551,7 +623,7 @@ void Renderer::DestroyRenderContext(HandleType p_context) {
 }
 
 void Renderer::DestroyWindowSurface(HandleType p_surface) {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   const auto w = m_windows.find(p_surface);
   if (w != m_windows.end()) {
@@ -562,9 +634,27 @@ void Renderer::DestroyWindowSurface(HandleType p_surface) {
   }
 }
 
+ColorBufferMap::iterator Renderer::findColorBuffer_locked(
+    HandleType p_colorbuffer, ReadLock &l) {
+  auto c = m_colorbuffers.find(p_colorbuffer);
+  if (c == m_colorbuffers.end() || c->second.closedTs == 0)
+    return c;
+
+  l.unlock();
+  {
+    WriteLock wl(m_lock);
+    c = m_colorbuffers.find(p_colorbuffer);
+    if (c != m_colorbuffers.end())
+      resumeColorBuffer(&c->second);
+  }
+  l.lock();
+
+  return m_colorbuffers.find(p_colorbuffer);
+}
+
 int Renderer::openColorBuffer(HandleType p_colorbuffer) {
   RenderThreadInfo *tInfo = RenderThreadInfo::get();
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
   if (c == m_colorbuffers.end()) {
@@ -649,7 +739,7 @@ void Renderer::closeColorBufferLocked(HandleType p_colorbuffer, bool wannaClean)
 
 void Renderer::closeColorBuffer(HandleType p_colorbuffer)
 {
-    std::unique_lock<std::mutex> l(m_lock);
+    WriteLock l(m_lock);
     closeColorBufferLocked(p_colorbuffer);
     RenderThreadInfo *tInfo = RenderThreadInfo::get();
     if (!tInfo) {
@@ -665,7 +755,7 @@ void Renderer::closeColorBuffer(HandleType p_colorbuffer)
 }
 
 void Renderer::cleanupProcGLObjects(int tid) {
-    std::unique_lock<std::mutex> l(m_lock);
+    WriteLock l(m_lock);
     // Clean up color buffers.
     // A color buffer needs to be closed as many times as it is opened by
     // the guest process, to give the correct reference count.
@@ -707,7 +797,7 @@ void Renderer::cleanupProcGLObjects(int tid) {
 }
 
 bool Renderer::flushWindowSurfaceColorBuffer(HandleType p_surface) {
-  std::unique_lock<std::mutex> l(m_lock);
+  ReadLock l(m_lock);
 
   WindowSurfaceMap::iterator w(m_windows.find(p_surface));
   if (w == m_windows.end()) {
@@ -728,7 +818,7 @@ bool Renderer::flushWindowSurfaceColorBuffer(HandleType p_surface) {
 
 bool Renderer::setWindowSurfaceColorBuffer(HandleType p_surface,
                                            HandleType p_colorbuffer) {
-  std::unique_lock<std::mutex> l(m_lock);
+  WriteLock l(m_lock);
 
   WindowSurfaceMap::iterator w(m_windows.find(p_surface));
   if (w == m_windows.end()) {
@@ -756,64 +846,60 @@ bool Renderer::setWindowSurfaceColorBuffer(HandleType p_surface,
 void Renderer::readColorBuffer(HandleType p_colorbuffer, int x, int y,
                                int width, int height, GLenum format,
                                GLenum type, void *pixels) {
-  std::unique_lock<std::mutex> l(m_lock);
+  ReadLock l(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
+  ColorBufferMap::iterator c(findColorBuffer_locked(p_colorbuffer, l));
   if (c == m_colorbuffers.end()) {
     // bad colorbuffer handle
     ERROR("%s: ColorBuffer handle %u not found", __FUNCTION__, p_colorbuffer);
     return;
   }
-  resumeColorBuffer(&((*c).second));
   (*c).second.cb->readPixels(x, y, width, height, format, type, pixels);
 }
 
 bool Renderer::updateColorBuffer(HandleType p_colorbuffer, int x, int y,
                                  int width, int height, GLenum format,
                                  GLenum type, void *pixels) {
-  std::unique_lock<std::mutex> l(m_lock);
+  ReadLock l(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
+  ColorBufferMap::iterator c(findColorBuffer_locked(p_colorbuffer, l));
   if (c == m_colorbuffers.end()) {
     // bad colorbuffer handle
     ERROR("%s: ColorBuffer handle %u not found", __FUNCTION__, p_colorbuffer);
     return false;
   }
-  resumeColorBuffer(&((*c).second));
   (*c).second.cb->subUpdate(x, y, width, height, format, type, pixels);
 
   return true;
 }
 
 bool Renderer::bindColorBufferToTexture(HandleType p_colorbuffer) {
-  std::unique_lock<std::mutex> l(m_lock);
+  ReadLock l(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
+  ColorBufferMap::iterator c(findColorBuffer_locked(p_colorbuffer, l));
   if (c == m_colorbuffers.end()) {
     // bad colorbuffer handle
     ERROR("%s: ColorBuffer handle %u not found", __FUNCTION__, p_colorbuffer);
     return false;
   }
-  resumeColorBuffer(&((*c).second));
   return (*c).second.cb->bindToTexture();
 }
 
 bool Renderer::bindColorBufferToRenderbuffer(HandleType p_colorbuffer) {
-  std::unique_lock<std::mutex> l(m_lock);
+  ReadLock l(m_lock);
 
-  ColorBufferMap::iterator c(m_colorbuffers.find(p_colorbuffer));
+  ColorBufferMap::iterator c(findColorBuffer_locked(p_colorbuffer, l));
   if (c == m_colorbuffers.end()) {
     // bad colorbuffer handle
     ERROR("%s: ColorBuffer handle %u not found", __FUNCTION__, p_colorbuffer);
     return false;
   }
-  resumeColorBuffer(&((*c).second));
   return (*c).second.cb->bindToRenderbuffer();
 }
 
 bool Renderer::bindContext(HandleType p_context, HandleType p_drawSurface,
                            HandleType p_readSurface) {
-  std::unique_lock<std::mutex> l(m_lock);
+  ReadLock l(m_lock);
 
   WindowSurfacePtr draw(NULL), read(NULL);
   RenderContextPtr ctx(NULL);
@@ -885,15 +971,11 @@ bool Renderer::bindContext(HandleType p_context, HandleType p_drawSurface,
   tinfo->currContext = ctx;
   tinfo->currDrawSurf = draw;
   tinfo->currReadSurf = read;
-  if (ctx) {
-    if (ctx->isGL2())
-      tinfo->m_gl2Dec.setContextData(&ctx->decoderContextData());
-    else
-      tinfo->m_glDec.setContextData(&ctx->decoderContextData());
-  } else {
-    tinfo->m_glDec.setContextData(NULL);
-    tinfo->m_gl2Dec.setContextData(NULL);
-  }
+  // The decoder not matching the context must not keep the data of a
+  // previous context which might be destroyed by now.
+  GLDecoderContextData *contextData = ctx ? &ctx->decoderContextData() : NULL;
+  tinfo->m_glDec.setContextData(ctx && !ctx->isGL2() ? contextData : NULL);
+  tinfo->m_gl2Dec.setContextData(ctx && ctx->isGL2() ? contextData : NULL);
   return true;
 }
 
@@ -907,7 +989,7 @@ HandleType Renderer::createClientImage(HandleType context, EGLenum target,
   RenderContextPtr ctx(NULL);
 
   if (context) {
-    std::unique_lock<std::mutex> l(m_lock);
+    ReadLock l(m_lock);
     RenderContextMap::iterator r(m_contexts.find(context));
     if (r == m_contexts.end()) {
       // bad context handle
@@ -921,6 +1003,8 @@ HandleType Renderer::createClientImage(HandleType context, EGLenum target,
   EGLImageKHR image =
       s_egl.eglCreateImageKHR(m_eglDisplay, eglContext, target,
                               reinterpret_cast<EGLClientBuffer>(buffer), NULL);
+
+  WriteLock l(m_lock);
   HandleType imgHnd = 0;
   do {
     imgHnd = getEGLImageIndex();
@@ -933,13 +1017,13 @@ HandleType Renderer::createClientImage(HandleType context, EGLenum target,
     }
     int tid = tInfo->m_tid;
     if (tid > 0) {
-        std::unique_lock<std::mutex> l(m_lock);
         m_procOwnedEGLImages[tid].insert(imgHnd);
     }
     return imgHnd;
 }
 
 EGLBoolean Renderer::destroyClientImage(HandleType image) {
+    WriteLock l(m_lock);
     if (gEGLImageMap.count(image) == 0) return false;
     EGLBoolean ret = s_egl.eglDestroyImageKHR(m_eglDisplay,
         gEGLImageMap[image]);
@@ -951,7 +1035,6 @@ EGLBoolean Renderer::destroyClientImage(HandleType image) {
     }
     int tid = tInfo->m_tid;
     if (tid > 0) {
-        std::unique_lock<std::mutex> l(m_lock);
         m_procOwnedEGLImages[tid].erase(image);
         // We don't explicitly call m_procOwnedEGLImages.erase(puid) when the size
         // reaches 0, since it could go between zero and one many times in the
@@ -963,9 +1046,11 @@ EGLBoolean Renderer::destroyClientImage(HandleType image) {
 }
 
 //
-// The framebuffer lock should be held when calling this function !
+// Takes m_contextLock which is held until the matching unbind_locked() call.
 //
 bool Renderer::bind_locked() {
+  m_contextLock.lock();
+
   EGLContext prevContext = s_egl.eglGetCurrentContext();
   EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
   EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
@@ -973,6 +1058,7 @@ bool Renderer::bind_locked() {
   if (!s_egl.eglMakeCurrent(m_eglDisplay, m_pbufSurface, m_pbufSurface,
                             m_pbufContext)) {
     ERROR("eglMakeCurrent failed: 0x%04x", s_egl.eglGetError());
+    m_contextLock.unlock();
     return false;
   }
 
@@ -983,6 +1069,8 @@ bool Renderer::bind_locked() {
 }
 
 bool Renderer::bindWindow_locked(RendererWindow *window) {
+  m_contextLock.lock();
+
   EGLContext prevContext = s_egl.eglGetCurrentContext();
   EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
   EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
@@ -990,6 +1078,7 @@ bool Renderer::bindWindow_locked(RendererWindow *window) {
   if (!s_egl.eglMakeCurrent(m_eglDisplay, window->surface, window->surface,
                             m_eglContext)) {
     ERROR("eglMakeCurrent failed");
+    m_contextLock.unlock();
     return false;
   }
 
@@ -1000,15 +1089,16 @@ bool Renderer::bindWindow_locked(RendererWindow *window) {
 }
 
 bool Renderer::unbind_locked() {
-  if (!s_egl.eglMakeCurrent(m_eglDisplay, m_prevDrawSurf, m_prevReadSurf,
-                            m_prevContext)) {
-    return false;
+  const auto ret = s_egl.eglMakeCurrent(m_eglDisplay, m_prevDrawSurf,
+                                        m_prevReadSurf, m_prevContext);
+  if (ret) {
+    m_prevContext = EGL_NO_CONTEXT;
+    m_prevReadSurf = EGL_NO_SURFACE;
+    m_prevDrawSurf = EGL_NO_SURFACE;
   }
 
-  m_prevContext = EGL_NO_CONTEXT;
-  m_prevReadSurf = EGL_NO_SURFACE;
-  m_prevDrawSurf = EGL_NO_SURFACE;
-  return true;
+  m_contextLock.unlock();
+  return ret;
 }
 
 const GLchar *const Renderer::vshader = {
@@ -1152,8 +1242,13 @@ void Renderer::draw(RendererWindow *window, const Renderable &renderable,
              static_cast<int32_t>(cb->getWidth()),
              static_cast<int32_t>(cb->getHeight())}, renderable);
 
+  // The viewport always covers the whole window during composition, see
+  // draw_with_damage(), so we don't need to ask GL for it.
+  const TextureResize::Viewport viewport{0, 0, window->viewport.width(),
+                                         window->viewport.height()};
+
   for (auto const &p : m_primitives) {
-    cb->bind();
+    cb->bind(viewport);
 
     s_gles2.glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT, GL_FALSE,
                                   sizeof(anbox::graphics::Vertex),
@@ -1176,17 +1271,44 @@ void Renderer::draw(RendererWindow *window, const Renderable &renderable,
 bool Renderer::draw(EGLNativeWindowType native_window,
                     const anbox::graphics::Rect &window_frame,
                     const RenderableList &renderables) {
+  return draw_with_damage(native_window, window_frame, renderables,
+                          {0, 0, window_frame.width(), window_frame.height()});
+}
 
-  std::unique_lock<std::mutex> l(m_lock);
+bool Renderer::draw_with_damage(EGLNativeWindowType native_window,
+                                const anbox::graphics::Rect &window_frame,
+                                const RenderableList &renderables,
+                                const anbox::graphics::Rect &damage) {
+
+  ReadLock l(m_lock);
+  std::lock_guard<std::recursive_mutex> cl(m_contextLock);
 
   auto w = m_nativeWindows.find(native_window);
   if (w == m_nativeWindows.end()) return false;
 
+  const auto present_start = std::chrono::steady_clock::now();
+
   if (!bindWindow_locked(w->second))
     return false;
 
+  // Damage of frames with a different size doesn't tell us anything
+  if (w->second->viewport != window_frame)
+    w->second->damage_history.clear();
+
   setupViewport(w->second, window_frame);
   s_gles2.glViewport(0, 0, window_frame.width(), window_frame.height());
+
+  // Everything outside of the repaint region is still valid in the back
+  // buffer so we only touch what changed since it was last presented.
+  const auto region = repaintRegion_locked(w->second, window_frame, damage);
+  const auto partial = region.width() < window_frame.width() ||
+                       region.height() < window_frame.height();
+  if (partial) {
+    s_gles2.glEnable(GL_SCISSOR_TEST);
+    s_gles2.glScissor(region.left(), window_frame.height() - region.bottom(),
+                      region.width(), region.height());
+  }
+
   s_gles2.glClearColor(0.0, 0.0, 0.0, 1.0);
   s_gles2.glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
   s_gles2.glClear(GL_COLOR_BUFFER_BIT);
@@ -1194,9 +1316,66 @@ bool Renderer::draw(EGLNativeWindowType native_window,
   for (const auto &r : renderables)
     draw(w->second, r, r.alpha() < 1.0f ? m_alphaProgram : m_defaultProgram);
 
-  s_egl.eglSwapBuffers(m_eglDisplay, w->second->surface);
+  if (partial)
+    s_gles2.glDisable(GL_SCISSOR_TEST);
+
+  swapBuffers_locked(w->second, window_frame, damage);
 
   unbind_locked();
 
+  updateWindowStats_locked(w->second, std::chrono::duration_cast<std::chrono::microseconds>(
+                                          std::chrono::steady_clock::now() - present_start).count());
+
   return false;
 }
+
+anbox::graphics::Rect Renderer::repaintRegion_locked(RendererWindow *window,
+                                                     const anbox::graphics::Rect &window_frame,
+                                                     const anbox::graphics::Rect &damage) {
+  static const std::size_t max_buffer_age{4};
+
+  const anbox::graphics::Rect full{0, 0, window_frame.width(), window_frame.height()};
+
+  EGLint age = 0;
+  if (m_caps.has_buffer_age &&
+      !s_egl.eglQuerySurface(m_eglDisplay, window->surface, EGL_BUFFER_AGE_EXT, &age))
+    age = 0;
+
+  // An age of 0 means the content of the back buffer is undefined. Otherwise
+  // it was presented |age| frames ago and misses the damage of all frames
+  // since then.
+  auto region = damage;
+  if (age <= 0 || static_cast<std::size_t>(age) > window->damage_history.size() + 1) {
+    region = full;
+  } else {
+    for (EGLint n = 0; n < age - 1; n++)
+      region.merge(window->damage_history[n]);
+  }
+
+  window->damage_history.push_front(damage);
+  if (window->damage_history.size() > max_buffer_age)
+    window->damage_history.pop_back();
+
+  if (m_caps.has_partial_update && region != full) {
+    EGLint rect[4] = {region.left(), window_frame.height() - region.bottom(),
+                      region.width(), region.height()};
+    s_egl.eglSetDamageRegionKHR(m_eglDisplay, window->surface, rect, 1);
+  }
+
+  return region;
+}
+
+void Renderer::swapBuffers_locked(RendererWindow *window,
+                                  const anbox::graphics::Rect &window_frame,
+                                  const anbox::graphics::Rect &damage) {
+  if (!m_swapBuffersWithDamage ||
+      (damage.width() >= window_frame.width() && damage.height() >= window_frame.height())) {
+    s_egl.eglSwapBuffers(m_eglDisplay, window->surface);
+    return;
+  }
+
+  // EGL expects the damage with its origin in the bottom left corner
+  EGLint rect[4] = {damage.left(), window_frame.height() - damage.bottom(),
+                    damage.width(), damage.height()};
+  m_swapBuffersWithDamage(m_eglDisplay, window->surface, rect, 1);
+}
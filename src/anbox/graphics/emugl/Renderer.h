@@ -20,6 +20,7 @@
 #include "anbox/graphics/emugl/RenderContext.h"
 #include "anbox/graphics/emugl/RendererConfig.h"
 #include "anbox/graphics/emugl/TextureDraw.h"
+#include "anbox/graphics/emugl/TextureResize.h"
 #include "anbox/graphics/emugl/WindowSurface.h"
 #include "anbox/graphics/emugl/Renderable.h"
 
@@ -31,6 +32,7 @@
 
 #include <map>
 #include <mutex>
+#include <shared_mutex>
 
 #include <unordered_map>
 #include <unordered_set>
@@ -65,11 +67,19 @@ typedef std::unordered_map<int, EGLImageSet> ProcOwnedEGLImages;
 // extension is supported.
 // |has_eglimage_renderbuffer| is true iff the EGL_KHR_gl_renderbuffer_image
 // extension is supported.
+// |has_buffer_age| is true iff the EGL_EXT_buffer_age extension is supported.
+// |has_partial_update| is true iff the EGL_KHR_partial_update extension is
+// supported.
+// |has_swap_buffers_with_damage| is true iff either the KHR or EXT variant of
+// the swap_buffers_with_damage extension is supported.
 // |eglMajor| and |eglMinor| are the major and minor version numbers of
 // the underlying EGL implementation.
 struct RendererCaps {
   bool has_eglimage_texture_2d;
   bool has_eglimage_renderbuffer;
+  bool has_buffer_age;
+  bool has_partial_update;
+  bool has_swap_buffers_with_damage;
   EGLint eglMajor;
   EGLint eglMinor;
 };
@@ -245,6 +255,17 @@ class Renderer : public anbox::graphics::Renderer {
   bool draw(EGLNativeWindowType native_window,
             const anbox::graphics::Rect& window_frame,
             const RenderableList& renderables) override;
+  bool draw_with_damage(EGLNativeWindowType native_window,
+                        const anbox::graphics::Rect& window_frame,
+                        const RenderableList& renderables,
+                        const anbox::graphics::Rect& damage) override;
+
+  // Set the swap interval of all current and future native windows. An
+  // interval of 0 makes presenting a window no longer wait for the next
+  // vertical refresh so that frames of several windows go out within the
+  // same refresh period instead of one after another. A negative interval
+  // keeps the default of the EGL implementation.
+  void setSwapInterval(int interval);
 
   // Return the host EGLDisplay used by this instance.
   EGLDisplay getDisplay() const { return m_eglDisplay; }
@@ -253,6 +274,10 @@ class Renderer : public anbox::graphics::Renderer {
   // and windows created by this instance.
   TextureDraw* getTextureDraw() const { return m_textureDraw; }
 
+  // Return the TextureResize instance shared by all color buffers to scale
+  // them down for composition.
+  TextureResize* getTextureResize() const { return m_textureResize; }
+
   HandleType createClientImage(HandleType context, EGLenum target,
                                GLuint buffer);
   EGLBoolean destroyClientImage(HandleType image);
@@ -262,12 +287,29 @@ class Renderer : public anbox::graphics::Renderer {
   bool unbind_locked();
 
  private:
+  typedef std::shared_lock<std::shared_timed_mutex> ReadLock;
+  typedef std::unique_lock<std::shared_timed_mutex> WriteLock;
+
   HandleType getEGLImageIndex();
   HandleType genHandle();
 
+  // Look up a color buffer with |l| held for reading. Buffers which are
+  // pending a delayed close are revived first, which requires briefly
+  // dropping |l| and taking m_lock for writing.
+  ColorBufferMap::iterator findColorBuffer_locked(HandleType p_colorbuffer,
+                                                  ReadLock& l);
+
   bool bindWindow_locked(RendererWindow* window);
 
   void setupViewport(RendererWindow* window, const anbox::graphics::Rect& rect);
+  anbox::graphics::Rect repaintRegion_locked(RendererWindow* window,
+                                             const anbox::graphics::Rect& window_frame,
+                                             const anbox::graphics::Rect& damage);
+  void swapBuffers_locked(RendererWindow* window,
+                          const anbox::graphics::Rect& window_frame,
+                          const anbox::graphics::Rect& damage);
+  void applySwapInterval_locked(RendererWindow* window);
+  void updateWindowStats_locked(RendererWindow* window, int64_t present_us);
   struct Program;
   void draw(RendererWindow* window, const Renderable& renderable,
             const Program& prog);
@@ -279,7 +321,15 @@ class Renderer : public anbox::graphics::Renderer {
   HandleType eglImageIndex{0};
   static Renderer* s_renderer;
   static HandleType s_nextHandle;
-  std::mutex m_lock;
+  // Protects the handle tables (contexts, window surfaces, color buffers,
+  // EGL images and their per-process ownership). Lookups only take it for
+  // reading so render threads decoding in parallel don't serialize here.
+  std::shared_timed_mutex m_lock;
+  // Serializes use of our own EGL contexts (m_pbufContext and m_eglContext)
+  // which can only be current on one thread at a time. It is acquired by
+  // bind_locked() / bindWindow_locked() and released by unbind_locked() and
+  // also protects m_nativeWindows. Must be taken after m_lock.
+  std::recursive_mutex m_contextLock;
   RendererConfigList* m_configs;
   RendererCaps m_caps;
   EGLDisplay m_eglDisplay;
@@ -296,8 +346,11 @@ class Renderer : public anbox::graphics::Renderer {
   EGLSurface m_prevReadSurf;
   EGLSurface m_prevDrawSurf;
   TextureDraw* m_textureDraw;
+  TextureResize* m_textureResize;
   EGLConfig m_eglConfig;
   HandleType m_lastPostedColorBuffer;
+  EGLBoolean (*m_swapBuffersWithDamage)(EGLDisplay, EGLSurface, const EGLint*, EGLint);
+  int m_swapInterval;
 
   int m_statsNumFrames;
   long long m_statsStartTime;
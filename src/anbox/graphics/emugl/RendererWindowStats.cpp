@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/RendererWindowStats.h"
+
+#include <algorithm>
+
+RendererWindowStats::RendererWindowStats(anbox::stats::Registry &registry)
+    : frames_total_{registry.counter("anbox_renderer_frames_total",
+                                     "Frames presented to host windows")},
+      present_us_{registry.histogram("anbox_renderer_present_duration_us",
+                                     "Time to compose and present a frame",
+                                     anbox::stats::Histogram::exponential_bounds(250, 9))},
+      frame_interval_us_{registry.histogram("anbox_renderer_frame_interval_us",
+                                            "Time between two frames presented to the same window",
+                                            anbox::stats::Histogram::exponential_bounds(1000, 10))} {}
+
+void RendererWindowStats::record(std::int64_t present_us,
+                                 std::chrono::steady_clock::time_point now) {
+  frames_++;
+  last_present_us_ = present_us;
+  max_present_us_ = std::max(max_present_us_, present_us);
+  total_present_us_ += present_us;
+
+  frames_total_.add();
+  present_us_.observe(present_us);
+  // The first frame has nothing to measure the interval against
+  if (frames_ > 1)
+    frame_interval_us_.observe(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - last_present_).count());
+  last_present_ = now;
+}
+
+std::int64_t RendererWindowStats::average_present_us() const {
+  if (frames_ == 0)
+    return 0;
+  return total_present_us_ / static_cast<std::int64_t>(frames_);
+}
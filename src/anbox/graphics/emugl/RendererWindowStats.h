@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_EMUGL_RENDERER_WINDOW_STATS_H_
+#define ANBOX_GRAPHICS_EMUGL_RENDERER_WINDOW_STATS_H_
+
+#include "anbox/stats/registry.h"
+
+#include <chrono>
+#include <cstdint>
+
+// Statistics about how long presenting frames of a single window takes,
+// measured from binding the window until its buffers were swapped. Every
+// frame is also published to the stats registry, summed up over all
+// windows.
+class RendererWindowStats {
+ public:
+  explicit RendererWindowStats(
+      anbox::stats::Registry &registry = anbox::stats::Registry::instance());
+
+  void record(std::int64_t present_us, std::chrono::steady_clock::time_point now);
+
+  std::uint64_t frames() const { return frames_; }
+  std::int64_t last_present_us() const { return last_present_us_; }
+  std::int64_t max_present_us() const { return max_present_us_; }
+  std::int64_t average_present_us() const;
+
+ private:
+  anbox::stats::Counter &frames_total_;
+  anbox::stats::Histogram &present_us_;
+  anbox::stats::Histogram &frame_interval_us_;
+
+  std::uint64_t frames_ = 0;
+  std::int64_t last_present_us_ = 0;
+  std::int64_t max_present_us_ = 0;
+  std::int64_t total_present_us_ = 0;
+  std::chrono::steady_clock::time_point last_present_;
+};
+
+#endif
@@ -19,11 +19,14 @@
 #include "anbox/logger.h"
 
 #include <stdio.h>
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <utility>
 
 #define MAX_FACTOR_POWER 4
+// Intermediate targets kept around for source sizes seen recently
+#define MAX_POOLED_TARGETS 8
 
 static const char kCommonShaderSource[] =
     "precision mediump float;\n"
@@ -40,53 +43,54 @@ static const char kCommonShaderSource[] =
 
 static const char kVertexShaderSource[] =
     "attribute vec2 aPosition;\n"
+    "uniform vec2 uDimension;\n"
 
     "void main() {\n"
     "  gl_Position = vec4(aPosition, 0, 1);\n"
-    "  vec2 uv = ((aPosition + 1.0) / 2.0) + 0.5 / kDimension;\n"
+    "  vec2 uv = ((aPosition + 1.0) / 2.0) + 0.5 / uDimension;\n"
     "  vUV00 = uv;\n"
     "  #ifdef HORIZONTAL\n"
-    "  vUV01 = uv + vec2( 1.0 / kDimension.x, 0);\n"
+    "  vUV01 = uv + vec2( 1.0 / uDimension.x, 0);\n"
     "  #if FACTOR > 2\n"
-    "  vUV02 = uv + vec2( 2.0 / kDimension.x, 0);\n"
-    "  vUV03 = uv + vec2( 3.0 / kDimension.x, 0);\n"
+    "  vUV02 = uv + vec2( 2.0 / uDimension.x, 0);\n"
+    "  vUV03 = uv + vec2( 3.0 / uDimension.x, 0);\n"
     "  #if FACTOR > 4\n"
-    "  vUV04 = uv + vec2( 4.0 / kDimension.x, 0);\n"
-    "  vUV05 = uv + vec2( 5.0 / kDimension.x, 0);\n"
-    "  vUV06 = uv + vec2( 6.0 / kDimension.x, 0);\n"
-    "  vUV07 = uv + vec2( 7.0 / kDimension.x, 0);\n"
+    "  vUV04 = uv + vec2( 4.0 / uDimension.x, 0);\n"
+    "  vUV05 = uv + vec2( 5.0 / uDimension.x, 0);\n"
+    "  vUV06 = uv + vec2( 6.0 / uDimension.x, 0);\n"
+    "  vUV07 = uv + vec2( 7.0 / uDimension.x, 0);\n"
     "  #if FACTOR > 8\n"
-    "  vUV08 = uv + vec2( 8.0 / kDimension.x, 0);\n"
-    "  vUV09 = uv + vec2( 9.0 / kDimension.x, 0);\n"
-    "  vUV10 = uv + vec2(10.0 / kDimension.x, 0);\n"
-    "  vUV11 = uv + vec2(11.0 / kDimension.x, 0);\n"
-    "  vUV12 = uv + vec2(12.0 / kDimension.x, 0);\n"
-    "  vUV13 = uv + vec2(13.0 / kDimension.x, 0);\n"
-    "  vUV14 = uv + vec2(14.0 / kDimension.x, 0);\n"
-    "  vUV15 = uv + vec2(15.0 / kDimension.x, 0);\n"
+    "  vUV08 = uv + vec2( 8.0 / uDimension.x, 0);\n"
+    "  vUV09 = uv + vec2( 9.0 / uDimension.x, 0);\n"
+    "  vUV10 = uv + vec2(10.0 / uDimension.x, 0);\n"
+    "  vUV11 = uv + vec2(11.0 / uDimension.x, 0);\n"
+    "  vUV12 = uv + vec2(12.0 / uDimension.x, 0);\n"
+    "  vUV13 = uv + vec2(13.0 / uDimension.x, 0);\n"
+    "  vUV14 = uv + vec2(14.0 / uDimension.x, 0);\n"
+    "  vUV15 = uv + vec2(15.0 / uDimension.x, 0);\n"
     "  #endif\n"  // FACTOR > 8
     "  #endif\n"  // FACTOR > 4
     "  #endif\n"  // FACTOR > 2
 
     "  #else\n"
-    "  vUV01 = uv + vec2(0,  1.0 / kDimension.y);\n"
+    "  vUV01 = uv + vec2(0,  1.0 / uDimension.y);\n"
     "  #if FACTOR > 2\n"
-    "  vUV02 = uv + vec2(0,  2.0 / kDimension.y);\n"
-    "  vUV03 = uv + vec2(0,  3.0 / kDimension.y);\n"
+    "  vUV02 = uv + vec2(0,  2.0 / uDimension.y);\n"
+    "  vUV03 = uv + vec2(0,  3.0 / uDimension.y);\n"
     "  #if FACTOR > 4\n"
-    "  vUV04 = uv + vec2(0,  4.0 / kDimension.y);\n"
-    "  vUV05 = uv + vec2(0,  5.0 / kDimension.y);\n"
-    "  vUV06 = uv + vec2(0,  6.0 / kDimension.y);\n"
-    "  vUV07 = uv + vec2(0,  7.0 / kDimension.y);\n"
+    "  vUV04 = uv + vec2(0,  4.0 / uDimension.y);\n"
+    "  vUV05 = uv + vec2(0,  5.0 / uDimension.y);\n"
+    "  vUV06 = uv + vec2(0,  6.0 / uDimension.y);\n"
+    "  vUV07 = uv + vec2(0,  7.0 / uDimension.y);\n"
     "  #if FACTOR > 8\n"
-    "  vUV08 = uv + vec2(0,  8.0 / kDimension.y);\n"
-    "  vUV09 = uv + vec2(0,  9.0 / kDimension.y);\n"
-    "  vUV10 = uv + vec2(0, 10.0 / kDimension.y);\n"
-    "  vUV11 = uv + vec2(0, 11.0 / kDimension.y);\n"
-    "  vUV12 = uv + vec2(0, 12.0 / kDimension.y);\n"
-    "  vUV13 = uv + vec2(0, 13.0 / kDimension.y);\n"
-    "  vUV14 = uv + vec2(0, 14.0 / kDimension.y);\n"
-    "  vUV15 = uv + vec2(0, 15.0 / kDimension.y);\n"
+    "  vUV08 = uv + vec2(0,  8.0 / uDimension.y);\n"
+    "  vUV09 = uv + vec2(0,  9.0 / uDimension.y);\n"
+    "  vUV10 = uv + vec2(0, 10.0 / uDimension.y);\n"
+    "  vUV11 = uv + vec2(0, 11.0 / uDimension.y);\n"
+    "  vUV12 = uv + vec2(0, 12.0 / uDimension.y);\n"
+    "  vUV13 = uv + vec2(0, 13.0 / uDimension.y);\n"
+    "  vUV14 = uv + vec2(0, 14.0 / uDimension.y);\n"
+    "  vUV15 = uv + vec2(0, 15.0 / uDimension.y);\n"
     "  #endif\n"  // FACTOR > 8
     "  #endif\n"  // FACTOR > 4
     "  #endif\n"  // FACTOR > 2
@@ -125,18 +129,6 @@ const char kFragmentShaderSource[] =
 
 static const float kVertexData[] = {-1, -1, 3, -1, -1, 3};
 
-static void detachShaders(GLuint program) {
-  GLuint shaders[2] = {};
-  GLsizei count = 0;
-  s_gles2.glGetAttachedShaders(program, 2, &count, shaders);
-  if (s_gles2.glGetError() == GL_NO_ERROR) {
-    for (GLsizei i = 0; i < count; i++) {
-      s_gles2.glDetachShader(program, shaders[i]);
-      s_gles2.glDeleteShader(shaders[i]);
-    }
-  }
-}
-
 static GLuint createShader(GLenum type,
                            const std::initializer_list<const char*>& source) {
   GLint success, infoLength;
@@ -158,96 +150,89 @@ static GLuint createShader(GLenum type,
   return shader;
 }
 
-static void attachShaders(TextureResize::Framebuffer* fb,
-                          const char* factorDefine, const char* dimensionDefine,
-                          GLuint width, GLuint height) {
-  std::ostringstream dimensionConst;
-  dimensionConst << "const vec2 kDimension = vec2(" << width << ", " << height
-                 << ");\n";
-
+static void createProgram(TextureResize::Program* prog,
+                          const char* factorDefine, const char* dimensionDefine) {
   GLuint vShader = createShader(
       GL_VERTEX_SHADER, {factorDefine, dimensionDefine, kCommonShaderSource,
-                         dimensionConst.str().c_str(), kVertexShaderSource});
+                         kVertexShaderSource});
   GLuint fShader = createShader(
       GL_FRAGMENT_SHADER, {factorDefine, dimensionDefine, kCommonShaderSource,
                            kFragmentShaderSource});
 
   if (!vShader || !fShader) {
+    s_gles2.glDeleteShader(vShader);
+    s_gles2.glDeleteShader(fShader);
     return;
   }
 
-  s_gles2.glAttachShader(fb->program, vShader);
-  s_gles2.glAttachShader(fb->program, fShader);
-  s_gles2.glLinkProgram(fb->program);
+  prog->program = s_gles2.glCreateProgram();
+  s_gles2.glAttachShader(prog->program, vShader);
+  s_gles2.glAttachShader(prog->program, fShader);
+  s_gles2.glLinkProgram(prog->program);
+
+  // The program keeps the shaders alive as long as it needs them
+  s_gles2.glDeleteShader(vShader);
+  s_gles2.glDeleteShader(fShader);
 
-  s_gles2.glUseProgram(fb->program);
-  fb->aPosition = s_gles2.glGetAttribLocation(fb->program, "aPosition");
-  fb->uTexture = s_gles2.glGetUniformLocation(fb->program, "uTexture");
+  prog->aPosition = s_gles2.glGetAttribLocation(prog->program, "aPosition");
+  prog->uTexture = s_gles2.glGetUniformLocation(prog->program, "uTexture");
+  prog->uDimension = s_gles2.glGetUniformLocation(prog->program, "uDimension");
 }
 
-TextureResize::TextureResize(GLuint width, GLuint height)
-    : mWidth(width),
-      mHeight(height),
-      mFactor(1) {
-  s_gles2.glGenTextures(1, &mFBWidth.texture);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBWidth.texture);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+static void createFramebuffer(TextureResize::Framebuffer* fb, GLenum filter,
+                              GLuint width, GLuint height, GLenum type) {
+  s_gles2.glGenTextures(1, &fb->texture);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, fb->texture);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                       type, nullptr);
 
-  s_gles2.glGenTextures(1, &mFBHeight.texture);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBHeight.texture);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-  s_gles2.glGenFramebuffers(1, &mFBWidth.framebuffer);
-  s_gles2.glGenFramebuffers(1, &mFBHeight.framebuffer);
-
-  mFBWidth.program = s_gles2.glCreateProgram();
-  mFBHeight.program = s_gles2.glCreateProgram();
-
-  s_gles2.glGenBuffers(1, &mVertexBuffer);
-  s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
-  s_gles2.glBufferData(GL_ARRAY_BUFFER, sizeof(kVertexData), kVertexData,
-                       GL_STATIC_DRAW);
+  s_gles2.glGenFramebuffers(1, &fb->framebuffer);
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, fb->framebuffer);
+  s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                 GL_TEXTURE_2D, fb->texture, 0);
 }
 
-TextureResize::~TextureResize() {
-  GLuint fb[2] = {mFBWidth.framebuffer, mFBHeight.framebuffer};
-  s_gles2.glDeleteFramebuffers(2, fb);
+TextureResize::TextureResize() : mUseCount(0), mVertexBuffer(0) {}
 
-  GLuint tex[2] = {mFBWidth.texture, mFBHeight.texture};
-  s_gles2.glDeleteTextures(2, tex);
+TextureResize::~TextureResize() {
+  for (auto& target : mTargets) {
+    releaseTarget(target);
+  }
 
-  s_gles2.glDeleteProgram(mFBWidth.program);
-  s_gles2.glDeleteProgram(mFBHeight.program);
+  for (const auto& entry : mPrograms) {
+    s_gles2.glDeleteProgram(entry.second.program);
+  }
 
-  s_gles2.glDeleteBuffers(1, &mVertexBuffer);
+  if (mVertexBuffer) {
+    s_gles2.glDeleteBuffers(1, &mVertexBuffer);
+  }
 }
 
-GLuint TextureResize::update(GLuint texture) {
-  // Store the viewport. The viewport is clobbered due to the framebuffers.
-  GLint vport[4] = {
-      0,
-  };
-  s_gles2.glGetIntegerv(GL_VIEWPORT, vport);
-
+unsigned int TextureResize::computeFactor(GLuint width, GLuint height,
+                                          const Viewport& viewport) {
   // Correctly deal with rotated screens.
-  GLint tWidth = vport[2], tHeight = vport[3];
-  if ((mWidth < mHeight) != (tWidth < tHeight)) {
+  GLint tWidth = viewport.width, tHeight = viewport.height;
+  if ((width < height) != (tWidth < tHeight)) {
     std::swap(tWidth, tHeight);
   }
 
   // Compute the scaling factor needed to get an image just larger than the
   // target viewport.
   unsigned int factor = 1;
-  for (int i = 0, w = mWidth / 2, h = mHeight / 2;
+  for (int i = 0, w = width / 2, h = height / 2;
        i < MAX_FACTOR_POWER && w >= tWidth && h >= tHeight;
        i++, w /= 2, h /= 2, factor *= 2) {
   }
+  return factor;
+}
+
+GLuint TextureResize::update(GLuint texture, GLuint width, GLuint height,
+                             const Viewport& viewport) {
+  const auto factor = computeFactor(width, height, viewport);
 
   // No resizing needed.
   if (factor == 1) {
@@ -255,10 +240,18 @@ GLuint TextureResize::update(GLuint texture) {
   }
 
   s_gles2.glGetError();  // Clear any GL errors.
-  setupFramebuffers(factor);
-  resize(texture);
-  s_gles2.glViewport(vport[0], vport[1], vport[2],
-                     vport[3]);  // Restore the viewport.
+
+  if (!mVertexBuffer) {
+    s_gles2.glGenBuffers(1, &mVertexBuffer);
+    s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+    s_gles2.glBufferData(GL_ARRAY_BUFFER, sizeof(kVertexData), kVertexData,
+                         GL_STATIC_DRAW);
+  }
+
+  const auto& t = target(width, height, factor);
+  resize(texture, t);
+  s_gles2.glViewport(viewport.x, viewport.y, viewport.width,
+                     viewport.height);  // Restore the viewport.
 
   // If there was an error while resizing, just use the unscaled texture.
   GLenum error = s_gles2.glGetError();
@@ -267,84 +260,106 @@ GLuint TextureResize::update(GLuint texture) {
     return texture;
   }
 
-  return mFBHeight.texture;
+  return t.vertical.texture;
 }
 
-void TextureResize::setupFramebuffers(unsigned int factor) {
-  if (factor == mFactor) {
-    // The factor hasn't changed, no need to update the framebuffers.
-    return;
+const TextureResize::Program& TextureResize::program(unsigned int factor,
+                                                     bool horizontal) {
+  auto& prog = mPrograms[std::make_pair(factor, horizontal)];
+  if (!prog.program) {
+    std::ostringstream factorDefine;
+    factorDefine << "#define FACTOR " << factor << "\n";
+    createProgram(&prog, factorDefine.str().c_str(),
+                  horizontal ? "#define HORIZONTAL\n" : "#define VERTICAL\n");
   }
+  return prog;
+}
 
-  // Update the framebuffer sizes to match the new factor.
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBWidth.texture);
-  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth / factor, mHeight, 0,
-                       GL_RGBA, GL_FLOAT, nullptr);
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBWidth.framebuffer);
-  s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                 GL_TEXTURE_2D, mFBWidth.texture, 0);
+TextureResize::Target& TextureResize::target(GLuint width, GLuint height,
+                                             unsigned int factor) {
+  mUseCount++;
 
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBHeight.texture);
-  s_gles2.glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth / factor,
-                       mHeight / factor, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBHeight.framebuffer);
-  s_gles2.glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                 GL_TEXTURE_2D, mFBHeight.texture, 0);
+  // Color buffers of the same size share the targets. Every resize is
+  // drawn right away so nothing holds on to a target's output.
+  for (auto& t : mTargets) {
+    if (t.width == width && t.height == height && t.factor == factor) {
+      t.lastUsed = mUseCount;
+      return t;
+    }
+  }
 
-  // Update the shaders to the new factor. First detach the old shaders...
-  detachShaders(mFBWidth.program);
-  detachShaders(mFBHeight.program);
+  if (mTargets.size() >= MAX_POOLED_TARGETS) {
+    auto oldest = std::min_element(mTargets.begin(), mTargets.end(),
+                                   [](const Target& a, const Target& b) {
+                                     return a.lastUsed < b.lastUsed;
+                                   });
+    releaseTarget(*oldest);
+    mTargets.erase(oldest);
+  }
 
-  // ... then attach the new ones.
-  std::ostringstream factorDefine;
-  factorDefine << "#define FACTOR " << factor << "\n";
-  attachShaders(&mFBWidth, factorDefine.str().c_str(), "#define HORIZONTAL\n",
-                mWidth, mHeight);
-  attachShaders(&mFBHeight, factorDefine.str().c_str(), "#define VERTICAL\n",
-                mWidth, mHeight);
+  Target t;
+  t.width = width;
+  t.height = height;
+  t.factor = factor;
+  t.lastUsed = mUseCount;
+  createFramebuffer(&t.horizontal, GL_NEAREST, width / factor, height, GL_FLOAT);
+  createFramebuffer(&t.vertical, GL_LINEAR, width / factor, height / factor,
+                    GL_UNSIGNED_BYTE);
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-  mFactor = factor;
+  mTargets.push_back(t);
+  return mTargets.back();
 }
 
-void TextureResize::resize(GLuint texture) {
+void TextureResize::releaseTarget(Target& target) {
+  GLuint fb[2] = {target.horizontal.framebuffer, target.vertical.framebuffer};
+  s_gles2.glDeleteFramebuffers(2, fb);
+
+  GLuint tex[2] = {target.horizontal.texture, target.vertical.texture};
+  s_gles2.glDeleteTextures(2, tex);
+}
+
+void TextureResize::resize(GLuint texture, const Target& target) {
+  const auto& horizontal = program(target.factor, true);
+  const auto& vertical = program(target.factor, false);
+
   s_gles2.glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
   s_gles2.glActiveTexture(GL_TEXTURE0);
 
   // First scale the horizontal dimension by rendering the input texture to a
   // scaled framebuffer.
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBWidth.framebuffer);
-  s_gles2.glViewport(0, 0, mWidth / mFactor, mHeight);
-  s_gles2.glUseProgram(mFBWidth.program);
-  s_gles2.glEnableVertexAttribArray(mFBWidth.aPosition);
-  s_gles2.glVertexAttribPointer(mFBWidth.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, target.horizontal.framebuffer);
+  s_gles2.glViewport(0, 0, target.width / target.factor, target.height);
+  s_gles2.glUseProgram(horizontal.program);
+  s_gles2.glUniform2f(horizontal.uDimension, target.width, target.height);
+  s_gles2.glEnableVertexAttribArray(horizontal.aPosition);
+  s_gles2.glVertexAttribPointer(horizontal.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
                                 0);
   s_gles2.glBindTexture(GL_TEXTURE_2D, texture);
 
-  // Store the current texture filters and set to nearest for scaling.
-  GLint mag_filter, min_filter;
-  s_gles2.glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
-                              &mag_filter);
-  s_gles2.glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                              &min_filter);
+  // Color buffer textures are always created with linear filtering so we
+  // switch to nearest for scaling without asking GL what is set.
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  s_gles2.glUniform1i(mFBWidth.uTexture, 0);
+  s_gles2.glUniform1i(horizontal.uTexture, 0);
   s_gles2.glDrawArrays(GL_TRIANGLES, 0,
                        sizeof(kVertexData) / (2 * sizeof(float)));
 
-  // Restore the previous texture filters.
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
-  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+  // Restore the texture filters.
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  s_gles2.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
   // Secondly, scale the vertical dimension using the second framebuffer.
-  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, mFBHeight.framebuffer);
-  s_gles2.glViewport(0, 0, mWidth / mFactor, mHeight / mFactor);
-  s_gles2.glUseProgram(mFBHeight.program);
-  s_gles2.glEnableVertexAttribArray(mFBHeight.aPosition);
-  s_gles2.glVertexAttribPointer(mFBHeight.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
+  s_gles2.glBindFramebuffer(GL_FRAMEBUFFER, target.vertical.framebuffer);
+  s_gles2.glViewport(0, 0, target.width / target.factor,
+                     target.height / target.factor);
+  s_gles2.glUseProgram(vertical.program);
+  s_gles2.glUniform2f(vertical.uDimension, target.width, target.height);
+  s_gles2.glEnableVertexAttribArray(vertical.aPosition);
+  s_gles2.glVertexAttribPointer(vertical.aPosition, 2, GL_FLOAT, GL_FALSE, 0,
                                 0);
-  s_gles2.glBindTexture(GL_TEXTURE_2D, mFBWidth.texture);
-  s_gles2.glUniform1i(mFBHeight.uTexture, 0);
+  s_gles2.glBindTexture(GL_TEXTURE_2D, target.horizontal.texture);
+  s_gles2.glUniform1i(vertical.uTexture, 0);
   s_gles2.glDrawArrays(GL_TRIANGLES, 0,
                        sizeof(kVertexData) / (2 * sizeof(float)));
 
@@ -19,33 +19,72 @@
 
 #include <GLES2/gl2.h>
 
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Downscales textures which are a lot larger than the viewport they are
+// drawn into. A single instance is shared by all color buffers of a
+// Renderer and may only be used from its composition context. The shader
+// programs are compiled once per factor and the intermediate targets are
+// pooled by source size and factor.
 class TextureResize {
  public:
-  TextureResize(GLuint width, GLuint height);
+  struct Viewport {
+    GLint x;
+    GLint y;
+    GLsizei width;
+    GLsizei height;
+  };
+
+  TextureResize();
   ~TextureResize();
 
-  // Scales the given texture for the current viewport and returns the scaled
-  // texture. May return the input if no scaling is required.
-  GLuint update(GLuint texture);
+  // Scales |texture| of |width| x |height| pixels for |viewport| and returns
+  // the scaled texture. May return the input if no scaling is required.
+  // |viewport| has to be the one currently set, it is restored afterwards
+  // without querying it from GL.
+  GLuint update(GLuint texture, GLuint width, GLuint height,
+                const Viewport& viewport);
+
+  // Returns the factor a texture of |width| x |height| pixels is scaled
+  // down by to be just larger than |viewport|.
+  static unsigned int computeFactor(GLuint width, GLuint height,
+                                    const Viewport& viewport);
 
   struct Framebuffer {
     GLuint texture = 0;
     GLuint framebuffer = 0;
+  };
+
+  struct Program {
     GLuint program = 0;
-    GLuint aPosition = 0;
-    GLuint uTexture = 0;
+    GLint aPosition = -1;
+    GLint uTexture = -1;
+    GLint uDimension = -1;
   };
 
  private:
-  void setupFramebuffers(unsigned int factor);
-  void resize(GLuint texture);
+  struct Target {
+    GLuint width;
+    GLuint height;
+    unsigned int factor;
+    Framebuffer horizontal;
+    Framebuffer vertical;
+    std::uint64_t lastUsed;
+  };
+
+  const Program& program(unsigned int factor, bool horizontal);
+  Target& target(GLuint width, GLuint height, unsigned int factor);
+  void releaseTarget(Target& target);
+  void resize(GLuint texture, const Target& target);
 
  private:
-  GLuint mWidth;
-  GLuint mHeight;
-  unsigned int mFactor;
-  Framebuffer mFBWidth;
-  Framebuffer mFBHeight;
+  // Keyed by factor and whether it is the horizontal pass
+  std::map<std::pair<unsigned int, bool>, Program> mPrograms;
+  std::vector<Target> mTargets;
+  std::uint64_t mUseCount;
   GLuint mVertexBuffer;
 };
 
@@ -116,6 +116,8 @@ bool WindowSurface::flushColorBuffer() {
   }
 
   mAttachedColorBuffer->blitFromCurrentReadBuffer();
+  // The blit ran on the guest's context behind the back of its decoder
+  mDrawContext->decoderContextData().stateShadow().markErrorsPossible();
 
   // restore current context/surface
   s_egl.eglMakeCurrent(mDisplay, prevDrawSurf, prevReadSurf, prevContext);
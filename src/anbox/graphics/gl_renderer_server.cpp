@@ -16,8 +16,10 @@
  */
 
 #include "anbox/graphics/gl_renderer_server.h"
+#include "anbox/graphics/emugl/ReadBuffer.h"
 #include "anbox/graphics/emugl/RenderApi.h"
 #include "anbox/graphics/emugl/RenderControl.h"
+#include "anbox/graphics/emugl/RenderThread.h"
 #include "anbox/graphics/emugl/Renderer.h"
 #include "anbox/graphics/layer_composer.h"
 #include "anbox/graphics/multi_window_composer_strategy.h"
@@ -25,6 +27,9 @@
 #include "anbox/logger.h"
 #include "anbox/wm/manager.h"
 
+#include "external/android-emugl/shared/OpenglCodecCommon/GLStateShadow.h"
+#include "external/android-emugl/shared/OpenglCodecCommon/VertexDataCache.h"
+
 #include <boost/throw_exception.hpp>
 #include <boost/filesystem.hpp>
 #include <cstdarg>
@@ -74,7 +79,11 @@ GLRendererServer::GLRendererServer(const Config &config, const std::shared_ptr<w
   else
     composer_strategy = std::make_shared<MultiWindowComposerStrategy>(wm);
 
-  composer_ = std::make_shared<LayerComposer>(renderer_, composer_strategy);
+  const auto composer_mode = config.async_composition ?
+        LayerComposer::Mode::Asynchronous : LayerComposer::Mode::Synchronous;
+  composer_ = std::make_shared<LayerComposer>(renderer_, composer_strategy, composer_mode,
+                                              LayerComposer::default_refresh_rate,
+                                              config.damage_tracking);
 
   auto gl_libs = emugl::default_gl_libraries();
   if (config.driver == Config::Driver::Software) {
@@ -101,10 +110,29 @@ GLRendererServer::GLRendererServer(const Config &config, const std::shared_ptr<w
 
   renderer_->initialize(0);
 
+  // Without waiting for vsync on every swap the asynchronous compositor or
+  // the guest is what paces presentation to the refresh rate.
+  if (config.non_blocking_present)
+    renderer_->setSwapInterval(0);
+
+  if (config.decode_shrink_threshold > 0)
+    ReadBuffer::setShrinkThreshold(config.decode_shrink_threshold);
+
+  RenderThread::setDecoderProfiling(config.profiled_commands);
+  GLStateShadow::setEnabled(config.state_shadow);
+  VertexDataCache::setCapacity(config.vertex_cache_size);
+
   registerRenderer(renderer_);
   registerLayerComposer(composer_);
 }
 
-GLRendererServer::~GLRendererServer() { renderer_->finalize(); }
+GLRendererServer::~GLRendererServer() {
+  // Make sure the composer (and its thread when composing asynchronously)
+  // is gone before we tear down the renderer it draws with.
+  registerLayerComposer(nullptr);
+  composer_.reset();
+
+  renderer_->finalize();
+}
 }  // namespace graphics
 }  // namespace anbox
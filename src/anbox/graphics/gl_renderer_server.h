@@ -18,6 +18,7 @@
 #ifndef ANBOX_GRAPHICS_GL_RENDERER_SERVER_H_
 #define ANBOX_GRAPHICS_GL_RENDERER_SERVER_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -45,6 +46,26 @@ class GLRendererServer {
     };
     Driver driver;
     bool single_window;
+    // Compose and present frames on a dedicated thread instead of the
+    // guest's SurfaceFlinger render thread.
+    bool async_composition;
+    // Only redraw windows and regions of them whose layers changed.
+    bool damage_tracking;
+    // Don't let presenting a window wait for the next vertical refresh so
+    // that all windows get their frame out within one refresh period.
+    bool non_blocking_present;
+    // Memory all render threads may hold for buffering commands before
+    // they release it as soon as possible. Zero keeps the default.
+    std::size_t decode_shrink_threshold = 0;
+    // Number of GL commands each render thread periodically reports it
+    // spent most time executing. Zero disables profiling the decoders.
+    std::size_t profiled_commands = 0;
+    // Answer GL queries of the guest which don't need the driver from a
+    // copy of the state of each context.
+    bool state_shadow = true;
+    // Memory each context may keep client side vertex arrays and index
+    // data of the guest in as buffer objects. Zero disables the cache.
+    std::size_t vertex_cache_size = 8 * 1024 * 1024;
   };
 
   GLRendererServer(const Config &config, const std::shared_ptr<wm::Manager> &wm);
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/gl_stream_capture.h"
+#include "anbox/logger.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+constexpr const char capture_magic[8] = {'A', 'N', 'B', 'O', 'X', 'G', 'L', '\0'};
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+constexpr const std::uint32_t GLStreamCapture::version;
+
+bool GLStreamCapture::read_header(std::istream &in, Header *header) {
+  if (!in.read(reinterpret_cast<char*>(header), sizeof(Header)))
+    return false;
+
+  return std::memcmp(header->magic, capture_magic, sizeof(capture_magic)) == 0 &&
+         header->version == version;
+}
+
+std::string GLStreamCapture::make_path(const std::string &directory) {
+  static std::atomic<unsigned int> next_id{0};
+  const auto name = "gl-stream-" + std::to_string(::getpid()) + "-" +
+                    std::to_string(next_id.fetch_add(1)) + ".capture";
+  return (fs::path(directory) / name).string();
+}
+
+GLStreamCapture::GLStreamCapture(const std::string &path, std::uint32_t client_flags)
+    : out_(path, std::ios::binary | std::ios::trunc) {
+  if (!out_.good())
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to open " + path + " for writing"));
+
+  Header header;
+  std::memcpy(header.magic, capture_magic, sizeof(capture_magic));
+  header.version = version;
+  header.client_flags = client_flags;
+  out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  INFO("Capturing GL stream to %s", path);
+}
+
+GLStreamCapture::~GLStreamCapture() {
+  DEBUG("Captured %d bytes of GL stream", bytes_recorded_);
+}
+
+void GLStreamCapture::record(const std::uint8_t *data, std::size_t size) {
+  out_.write(reinterpret_cast<const char*>(data), size);
+  bytes_recorded_ += size;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_GL_STREAM_CAPTURE_H_
+#define ANBOX_GRAPHICS_GL_STREAM_CAPTURE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <string>
+
+namespace anbox {
+namespace graphics {
+// Records a guest GL stream to disk so that it can be replayed later
+// without a running Android container. A capture file starts with a
+// Header followed by the raw bytes exactly as the guest sent them after
+// its client flags.
+class GLStreamCapture {
+ public:
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t client_flags;
+  };
+
+  static constexpr const std::uint32_t version{1};
+
+  // Reads and validates the header of a capture file. Returns false when
+  // |in| doesn't contain a capture we understand.
+  static bool read_header(std::istream &in, Header *header);
+
+  // Creates a new capture file in |directory| with a unique name.
+  static std::string make_path(const std::string &directory);
+
+  // Throws when |path| can't be opened for writing.
+  GLStreamCapture(const std::string &path, std::uint32_t client_flags);
+  ~GLStreamCapture();
+
+  void record(const std::uint8_t *data, std::size_t size);
+
+  std::uint64_t bytes_recorded() const { return bytes_recorded_; }
+
+ private:
+  std::ofstream out_;
+  std::uint64_t bytes_recorded_ = 0;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -16,24 +16,115 @@
  */
 
 #include "anbox/graphics/layer_composer.h"
+#include "anbox/graphics/damage_tracker.h"
 #include "anbox/graphics/emugl/Renderer.h"
 #include "anbox/logger.h"
 #include "anbox/wm/manager.h"
 
+#include <algorithm>
+
 namespace anbox {
 namespace graphics {
-LayerComposer::LayerComposer(const std::shared_ptr<Renderer> renderer, const std::shared_ptr<Strategy> &strategy)
-    : renderer_(renderer), strategy_(strategy) {}
+LayerComposer::LayerComposer(const std::shared_ptr<Renderer> renderer, const std::shared_ptr<Strategy> &strategy,
+                             Mode mode, unsigned int refresh_rate, bool damage_tracking)
+    : renderer_(renderer), strategy_(strategy), mode_(mode),
+      frame_interval_(std::chrono::microseconds(1000000 / std::max(refresh_rate, 1U))) {
+  if (damage_tracking)
+    damage_tracker_.reset(new DamageTracker);
+
+  if (mode_ == Mode::Asynchronous) {
+    running_ = true;
+    compositor_thread_ = std::thread(&LayerComposer::compositor_main, this);
+  }
+}
 
-LayerComposer::~LayerComposer() {}
+LayerComposer::~LayerComposer() {
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    running_ = false;
+  }
+  frame_available_.notify_all();
+
+  if (compositor_thread_.joinable())
+    compositor_thread_.join();
+}
 
 void LayerComposer::submit_layers(const RenderableList &renderables) {
+  if (mode_ == Mode::Synchronous) {
+    compose(renderables);
+    return;
+  }
+
+  // The compositor thread only ever gets an immutable snapshot of the frame
+  // so that the guest can go on with the next one right away.
+  auto frame = std::make_shared<const RenderableList>(renderables);
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    if (pending_frame_)
+      dropped_frames_++;
+    pending_frame_ = frame;
+  }
+  frame_available_.notify_one();
+}
+
+std::size_t LayerComposer::queue_depth() const {
+  std::unique_lock<std::mutex> l(lock_);
+  return pending_frame_ ? 1 : 0;
+}
+
+void LayerComposer::compositor_main() {
+  auto next_frame_time = std::chrono::steady_clock::now();
+
+  while (true) {
+    std::shared_ptr<const RenderableList> frame;
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      frame_available_.wait(l, [&]() { return !running_ || pending_frame_; });
+      if (!running_)
+        break;
+
+      // Don't present faster than the host display refreshes. If the
+      // renderer already blocks on vsync this won't wait at all. Any frame
+      // arriving in the meantime replaces the pending one.
+      frame_available_.wait_until(l, next_frame_time, [&]() { return !running_; });
+      if (!running_)
+        break;
+
+      frame.swap(pending_frame_);
+    }
+
+    compose(*frame);
+
+    next_frame_time = std::max(next_frame_time + frame_interval_,
+                               std::chrono::steady_clock::now());
+  }
+}
+
+void LayerComposer::compose(const RenderableList &renderables) {
   auto win_layers = strategy_->process_layers(renderables);
+  if (!damage_tracker_) {
+    for (auto &w : win_layers) {
+      renderer_->draw(w.first->native_handle(),
+                      Rect{0, 0, w.first->frame().width(), w.first->frame().height()},
+                      w.second);
+    }
+    composed_frames_++;
+    return;
+  }
+
+  const auto damage = damage_tracker_->update(win_layers);
   for (auto &w : win_layers) {
-    renderer_->draw(w.first->native_handle(),
-                    Rect{0, 0, w.first->frame().width(), w.first->frame().height()},
-                    w.second);
+    const auto &window_damage = damage.at(w.first);
+    if (window_damage.width() <= 0 || window_damage.height() <= 0) {
+      skipped_windows_++;
+      continue;
+    }
+
+    renderer_->draw_with_damage(w.first->native_handle(),
+                                Rect{0, 0, w.first->frame().width(), w.first->frame().height()},
+                                w.second, window_damage);
   }
+  composed_frames_++;
 }
 }  // namespace graphics
 }  // namespace anbox
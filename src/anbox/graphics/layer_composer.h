@@ -20,8 +20,13 @@
 
 #include "anbox/graphics/renderer.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <thread>
 
 namespace anbox {
 namespace wm {
@@ -29,6 +34,7 @@ class Manager;
 class Window;
 }  // namespace wm
 namespace graphics {
+class DamageTracker;
 class LayerComposer {
  public:
   class Strategy {
@@ -39,15 +45,57 @@ class LayerComposer {
     virtual WindowRenderableList process_layers(const RenderableList &renderables) = 0;
   };
 
+  enum class Mode {
+    // Layers are composed and presented on the thread submitting them.
+    Synchronous,
+    // Layers are handed over to a dedicated compositor thread which always
+    // composes the newest submitted frame and drops any older one it didn't
+    // get to yet.
+    Asynchronous,
+  };
+
+  // Refresh rate the asynchronous compositor paces itself to. Matches what
+  // we report to the guest through rcGetFBParam(FB_FPS).
+  static constexpr const unsigned int default_refresh_rate{60};
+
   LayerComposer(const std::shared_ptr<Renderer> renderer,
-                const std::shared_ptr<Strategy> &strategy);
+                const std::shared_ptr<Strategy> &strategy,
+                Mode mode = Mode::Synchronous,
+                unsigned int refresh_rate = default_refresh_rate,
+                bool damage_tracking = true);
   ~LayerComposer();
 
   void submit_layers(const RenderableList &renderables);
 
+  // Number of frames submitted but not yet picked up by the compositor
+  // thread. Always 0 in synchronous mode.
+  std::size_t queue_depth() const;
+  // Number of frames which were replaced by a newer one before the
+  // compositor thread got to them.
+  std::uint64_t dropped_frames() const { return dropped_frames_; }
+  // Number of frames which were composed and presented.
+  std::uint64_t composed_frames() const { return composed_frames_; }
+  // Number of times a window wasn't redrawn as none of its layers changed.
+  std::uint64_t skipped_windows() const { return skipped_windows_; }
+
  private:
+  void compose(const RenderableList &renderables);
+  void compositor_main();
+
   std::shared_ptr<Renderer> renderer_;
   std::shared_ptr<Strategy> strategy_;
+  Mode mode_;
+  std::chrono::microseconds frame_interval_;
+  std::unique_ptr<DamageTracker> damage_tracker_;
+
+  mutable std::mutex lock_;
+  std::condition_variable frame_available_;
+  std::shared_ptr<const RenderableList> pending_frame_;
+  bool running_ = false;
+  std::atomic<std::uint64_t> dropped_frames_{0};
+  std::atomic<std::uint64_t> composed_frames_{0};
+  std::atomic<std::uint64_t> skipped_windows_{0};
+  std::thread compositor_thread_;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -19,31 +19,77 @@
 #include "anbox/common/small_vector.h"
 #include "anbox/graphics/buffered_io_stream.h"
 #include "anbox/graphics/emugl/RenderThread.h"
+#include "anbox/graphics/gl_stream_capture.h"
 #include "anbox/logger.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/delegate_message_processor.h"
+#include "anbox/utils.h"
 
 #include <condition_variable>
 #include <functional>
 #include <queue>
 
+namespace {
+// When enabled every RenderThread decodes its GL stream without taking the
+// global lock and only synchronizes on the Renderer state it touches.
+bool concurrent_decode_enabled() {
+  static const bool enabled =
+      anbox::utils::get_env_value("ANBOX_GL_CONCURRENT_DECODE", "false") == "true";
+  return enabled;
+}
+
+// When enabled socket reads land directly in a ring buffer the decoders
+// parse in place instead of being copied through the buffer queue.
+bool streaming_ingest_enabled() {
+  static const bool enabled =
+      anbox::utils::get_env_value("ANBOX_GL_STREAMING_INGEST", "false") == "true";
+  return enabled;
+}
+
+// When set every guest GL stream is recorded into a file in this directory
+// so that it can be replayed later on.
+std::string capture_directory() {
+  static const auto directory = anbox::utils::get_env_value("ANBOX_GL_CAPTURE_DIR", "");
+  return directory;
+}
+
+std::shared_ptr<anbox::graphics::BufferedIOStream> create_stream(
+    const std::shared_ptr<anbox::network::SocketMessenger> &messenger) {
+  using anbox::graphics::BufferedIOStream;
+  if (streaming_ingest_enabled()) {
+    try {
+      return std::make_shared<BufferedIOStream>(
+          messenger, BufferedIOStream::default_buffer_size,
+          BufferedIOStream::IngestMode::Streaming);
+    } catch (const std::exception &err) {
+      WARNING("Falling back to queued GL stream ingest: %s", err.what());
+    }
+  }
+  return std::make_shared<BufferedIOStream>(messenger);
+}
+}  // namespace
+
 namespace anbox {
 namespace graphics {
 std::mutex OpenGlesMessageProcessor::global_lock{};
 
 OpenGlesMessageProcessor::OpenGlesMessageProcessor(
     const std::shared_ptr<Renderer> &renderer,
-    const std::shared_ptr<network::SocketMessenger> &messenger)
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    unsigned int client_flags)
     : messenger_(messenger),
-      stream_(std::make_shared<BufferedIOStream>(messenger_)) {
-  // We have to read the client flags first before we can continue
-  // processing the actual commands
-  unsigned int client_flags = 0;
-  auto err = messenger_->receive_msg(
-      boost::asio::buffer(&client_flags, sizeof(unsigned int)));
-  if (err) ERROR("%s", err.message());
+      stream_(create_stream(messenger_)) {
+  const auto directory = capture_directory();
+  if (!directory.empty()) {
+    try {
+      capture_.reset(new GLStreamCapture(GLStreamCapture::make_path(directory), client_flags));
+    } catch (const std::exception &err) {
+      WARNING("Not capturing GL stream: %s", err.what());
+    }
+  }
 
-  render_thread_.reset(RenderThread::create(renderer, stream_.get(), std::ref(global_lock)));
+  std::mutex *decode_lock = concurrent_decode_enabled() ? nullptr : &global_lock;
+  render_thread_.reset(RenderThread::create(renderer, stream_.get(), decode_lock));
   if (!render_thread_->start())
     BOOST_THROW_EXCEPTION(
         std::runtime_error("Failed to start renderer thread"));
@@ -56,10 +102,25 @@ OpenGlesMessageProcessor::~OpenGlesMessageProcessor() {
 
 bool OpenGlesMessageProcessor::process_data(
     const std::vector<std::uint8_t> &data) {
-  auto stream = std::static_pointer_cast<BufferedIOStream>(stream_);
+  if (capture_)
+    capture_->record(data.data(), data.size());
+
   Buffer buffer{data.data(), data.data() + data.size()};
-  stream->post_data(std::move(buffer));
-  return true;
+  return stream_->post_data(std::move(buffer));
+}
+
+std::uint8_t *OpenGlesMessageProcessor::prepare_data(std::size_t *size) {
+  prepared_data_ = stream_->prepare_data(size);
+  return prepared_data_;
+}
+
+bool OpenGlesMessageProcessor::commit_data(std::size_t size) {
+  // Once committed the render thread may consume the data at any time so
+  // we have to record it before.
+  if (capture_ && prepared_data_)
+    capture_->record(prepared_data_, size);
+
+  return stream_->commit_data(size);
 }
 }  // namespace graphics
 }  // namespace anbox
@@ -28,27 +28,33 @@
 #include <memory>
 #include <mutex>
 
-class IOStream;
 class RenderThread;
 class Renderer;
 
 namespace anbox {
 namespace graphics {
+class BufferedIOStream;
+class GLStreamCapture;
 class OpenGlesMessageProcessor : public network::MessageProcessor {
  public:
   OpenGlesMessageProcessor(
       const std::shared_ptr<Renderer> &renderer,
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      unsigned int client_flags);
   ~OpenGlesMessageProcessor();
 
   bool process_data(const std::vector<std::uint8_t> &data) override;
+  std::uint8_t *prepare_data(std::size_t *size) override;
+  bool commit_data(std::size_t size) override;
 
  private:
   static std::mutex global_lock;
 
   std::shared_ptr<network::SocketMessenger> messenger_;
-  std::shared_ptr<IOStream> stream_;
+  std::shared_ptr<BufferedIOStream> stream_;
   std::shared_ptr<RenderThread> render_thread_;
+  std::unique_ptr<GLStreamCapture> capture_;
+  std::uint8_t *prepared_data_ = nullptr;
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -31,6 +31,17 @@ class Renderer {
   virtual bool draw(EGLNativeWindowType native_window,
                     const anbox::graphics::Rect& window_frame,
                     const RenderableList& renderables) = 0;
+
+  // Like draw() but only |damage| (in window coordinates) changed since
+  // the window was last drawn. Renderers which can't redraw parts of a
+  // window draw all of it.
+  virtual bool draw_with_damage(EGLNativeWindowType native_window,
+                                const anbox::graphics::Rect& window_frame,
+                                const RenderableList& renderables,
+                                const anbox::graphics::Rect& damage) {
+    (void)damage;
+    return draw(native_window, window_frame, renderables);
+  }
 };
 }  // namespace graphics
 }  // namespace anbox
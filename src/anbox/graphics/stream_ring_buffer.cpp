@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/stream_ring_buffer.h"
+#include "anbox/common/shared_memory.h"
+#include "anbox/logger.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+std::size_t round_to_page_size(std::size_t size) {
+  const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  if (size == 0)
+    return page_size;
+  return ((size + page_size - 1) / page_size) * page_size;
+}
+}  // namespace
+
+namespace anbox {
+namespace graphics {
+StreamRingBuffer::StreamRingBuffer(std::size_t capacity)
+    : capacity_(round_to_page_size(capacity)) {
+  base_ = map(capacity_);
+}
+
+StreamRingBuffer::~StreamRingBuffer() {
+  unmap(base_, capacity_);
+}
+
+std::uint8_t *StreamRingBuffer::map(std::size_t capacity) {
+  const auto fd = common::SharedMemory::create_fd("anbox-gl-stream", capacity);
+
+  // Reserve twice the address space and map the same memory into both
+  // halves so that a range starting near the end continues at the start.
+  auto addr = ::mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED)
+    BOOST_THROW_EXCEPTION(std::runtime_error(
+        std::string("Failed to reserve ring buffer address space: ") + std::strerror(errno)));
+
+  auto base = static_cast<std::uint8_t*>(addr);
+  for (const auto offset : {std::size_t{0}, capacity}) {
+    if (::mmap(base + offset, capacity, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      const auto err = errno;
+      ::munmap(addr, 2 * capacity);
+      BOOST_THROW_EXCEPTION(std::runtime_error(
+          std::string("Failed to map ring buffer memory: ") + std::strerror(err)));
+    }
+  }
+
+  // The mappings keep the memory alive once the fd is closed
+  return base;
+}
+
+void StreamRingBuffer::unmap(std::uint8_t *base, std::size_t capacity) {
+  if (base)
+    ::munmap(base, 2 * capacity);
+}
+
+void StreamRingBuffer::grow_locked() {
+  const auto new_capacity = capacity_ * 2;
+  auto new_base = map(new_capacity);
+
+  // The readable range is contiguous thanks to the mirrored mapping
+  std::memcpy(new_base, base_ + read_pos_, count_);
+  unmap(base_, capacity_);
+
+  DEBUG("Grew GL stream ring buffer from %d to %d bytes", capacity_, new_capacity);
+
+  base_ = new_base;
+  capacity_ = new_capacity;
+  read_pos_ = 0;
+  grow_requested_ = false;
+}
+
+std::uint8_t *StreamRingBuffer::prepare(std::size_t *size) {
+  std::unique_lock<std::mutex> l(lock_);
+  while (!closed_ && count_ == capacity_) {
+    // The consumer only requests to grow when it is waiting for more data
+    // and doesn't hold on to any range of the ring.
+    if (grow_requested_) {
+      grow_locked();
+      break;
+    }
+    can_write_.wait(l);
+  }
+
+  if (closed_)
+    return nullptr;
+
+  auto write_pos = read_pos_ + count_;
+  if (write_pos >= capacity_)
+    write_pos -= capacity_;
+
+  *size = capacity_ - count_;
+  return base_ + write_pos;
+}
+
+void StreamRingBuffer::commit(std::size_t size) {
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    count_ += size;
+  }
+  can_read_.notify_one();
+}
+
+const std::uint8_t *StreamRingBuffer::wait_for_data(std::size_t have, std::size_t *size) {
+  std::unique_lock<std::mutex> l(lock_);
+  if (have >= capacity_) {
+    grow_requested_ = true;
+    can_write_.notify_one();
+  }
+
+  can_read_.wait(l, [&]() { return closed_ || count_ > have; });
+  if (count_ <= have)
+    return nullptr;
+
+  *size = count_;
+  return base_ + read_pos_;
+}
+
+void StreamRingBuffer::consume(std::size_t size) {
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    read_pos_ += size;
+    if (read_pos_ >= capacity_)
+      read_pos_ -= capacity_;
+    count_ -= size;
+  }
+  can_write_.notify_one();
+}
+
+void StreamRingBuffer::close() {
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    closed_ = true;
+  }
+  can_read_.notify_all();
+  can_write_.notify_all();
+}
+
+std::size_t StreamRingBuffer::capacity() const {
+  std::unique_lock<std::mutex> l(lock_);
+  return capacity_;
+}
+
+std::size_t StreamRingBuffer::readable() const {
+  std::unique_lock<std::mutex> l(lock_);
+  return count_;
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_GRAPHICS_STREAM_RING_BUFFER_H_
+#define ANBOX_GRAPHICS_STREAM_RING_BUFFER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace anbox {
+namespace graphics {
+// Single producer / single consumer byte ring the socket reader receives
+// into and the decoders parse in place.
+//
+// The backing memory is mapped twice back to back so that every readable
+// or writable range is contiguous in memory even when it wraps around the
+// end of the ring. When a single command doesn't fit into the ring the
+// consumer asks the producer to grow it the next time it runs out of space.
+class StreamRingBuffer {
+ public:
+  static const std::size_t default_capacity{4 * 1024 * 1024};
+
+  explicit StreamRingBuffer(std::size_t capacity = default_capacity);
+  ~StreamRingBuffer();
+
+  StreamRingBuffer(const StreamRingBuffer&) = delete;
+  StreamRingBuffer& operator=(const StreamRingBuffer&) = delete;
+
+  // Producer side. Blocks until there is free space and returns the
+  // writable range. Returns nullptr once the ring is closed. The range
+  // stays valid until commit() is called.
+  std::uint8_t *prepare(std::size_t *size);
+  // Makes |size| bytes written to the range returned by prepare() visible
+  // to the consumer.
+  void commit(std::size_t size);
+
+  // Consumer side. Blocks until more than |have| bytes are readable and
+  // returns the readable range. Returns nullptr when the ring was closed
+  // and no more data will arrive. Passing the full capacity as |have|
+  // makes the ring grow.
+  const std::uint8_t *wait_for_data(std::size_t have, std::size_t *size);
+  // Releases |size| bytes at the start of the readable range.
+  void consume(std::size_t size);
+
+  void close();
+
+  std::size_t capacity() const;
+  std::size_t readable() const;
+
+ private:
+  std::uint8_t *map(std::size_t capacity);
+  void unmap(std::uint8_t *base, std::size_t capacity);
+  void grow_locked();
+
+  mutable std::mutex lock_;
+  std::condition_variable can_read_;
+  std::condition_variable can_write_;
+  std::uint8_t *base_ = nullptr;
+  std::size_t capacity_ = 0;
+  std::size_t read_pos_ = 0;
+  std::size_t count_ = 0;
+  bool grow_requested_ = false;
+  bool closed_ = false;
+};
+}  // namespace graphics
+}  // namespace anbox
+
+#endif
@@ -21,9 +21,37 @@
 #include "anbox/network/delegate_message_processor.h"
 #include "anbox/network/local_socket_messenger.h"
 #include "anbox/qemu/null_message_processor.h"
+#include "anbox/stats/registry.h"
+
+#include <algorithm>
 
 #include <time.h>
 
+namespace {
+// Enough for a few hundred packets which is more than any device produces
+// between two flushes.
+constexpr const std::size_t max_pending_events{1024};
+
+struct InputMetrics {
+  anbox::stats::Counter &events;
+  anbox::stats::Counter &sent_events;
+  anbox::stats::Histogram &batch_latency_us;
+};
+
+InputMetrics &metrics() {
+  auto &registry = anbox::stats::Registry::instance();
+  static InputMetrics m{
+      registry.counter("anbox_input_events_total", "Input events queued for all devices"),
+      registry.counter("anbox_input_sent_events_total",
+                       "Input events sent to Android after coalescing"),
+      registry.histogram("anbox_input_batch_latency_us",
+                         "Time between queuing the oldest event of a batch and sending it",
+                         anbox::stats::Histogram::exponential_bounds(100, 10)),
+  };
+  return m;
+}
+}
+
 namespace anbox {
 namespace input {
 std::shared_ptr<Device> Device::create(
@@ -48,43 +76,76 @@ std::shared_ptr<Device> Device::create(
 Device::Device()
     : next_connection_id_(0),
       connections_(
-          std::make_shared<network::Connections<network::SocketConnection>>()) {
+          std::make_shared<network::Connections<network::SocketConnection>>()),
+      pending_(max_pending_events) {
   ::memset(&info_, 0, sizeof(info_));
 }
 
 Device::~Device() {}
 
 void Device::send_events(const std::vector<Event> &events) {
-  struct CompatEvent {
-    // NOTE: A bit dirty but as we're running currently a 64 bit container
-    // struct input_event has a different size. We rebuild the struct here
-    // to reach the correct size.
-    std::uint64_t sec;
-    std::uint64_t usec;
-    std::uint16_t type;
-    std::uint16_t code;
-    std::uint32_t value;
-  };
+  std::lock_guard<std::mutex> l(lock_);
+  queue_events_locked(events);
+  flush_locked();
+}
+
+void Device::queue_events(const std::vector<Event> &events) {
+  std::lock_guard<std::mutex> l(lock_);
+  queue_events_locked(events);
+}
 
+void Device::queue_events_locked(const std::vector<Event> &events) {
   struct timespec spec;
   clock_gettime(CLOCK_MONOTONIC, &spec);
 
-  auto data = new CompatEvent[events.size()];
-  int n = 0;
-  for (const auto &event : events) {
-    data[n].sec = spec.tv_sec;
-    data[n].usec = spec.tv_nsec / 1000;
-    data[n].type = event.type;
-    data[n].code = event.code;
-    data[n].value = event.value;
-    n++;
-  }
+  if (pending_.empty())
+    oldest_pending_ = std::chrono::steady_clock::now();
 
-  for (unsigned n = 0; n < connections_->size(); n++) {
-    connections_->at(n)->send(reinterpret_cast<const char *>(data),
-                              events.size() * sizeof(struct CompatEvent));
+  if (!pending_.push(events, spec)) {
+    flush_locked();
+    oldest_pending_ = std::chrono::steady_clock::now();
+    pending_.push(events, spec);
   }
-  delete[] data;
+
+  stats_.events += events.size();
+  metrics().events.add(events.size());
+}
+
+void Device::flush() {
+  std::lock_guard<std::mutex> l(lock_);
+  flush_locked();
+}
+
+void Device::flush_locked() {
+  if (pending_.empty())
+    return;
+
+  // Each batch goes out with a single write per connection straight from
+  // the preallocated buffer.
+  const auto data = reinterpret_cast<const char *>(pending_.data());
+  const auto size = pending_.size() * sizeof(CompatEvent);
+  for (unsigned n = 0; n < connections_->size(); n++)
+    connections_->at(n)->send(data, size);
+
+  const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - oldest_pending_).count();
+  stats_.batches++;
+  stats_.total_latency_us += latency;
+  stats_.max_latency_us = std::max<std::uint64_t>(stats_.max_latency_us, latency);
+  stats_.coalesced = pending_.coalesced();
+
+  auto &m = metrics();
+  m.sent_events.add(pending_.size());
+  m.batch_latency_us.observe(latency);
+
+  pending_.clear();
+}
+
+Device::Stats Device::stats() const {
+  std::lock_guard<std::mutex> l(lock_);
+  auto stats = stats_;
+  stats.coalesced = pending_.coalesced();
+  return stats;
 }
 
 void Device::set_name(const std::string &name) {
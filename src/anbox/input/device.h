@@ -18,11 +18,14 @@
 #ifndef ANBOX_INPUT_DEVICE_H_
 #define ANBOX_INPUT_DEVICE_H_
 
+#include "anbox/input/event_coalescer.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/published_socket_connector.h"
 #include "anbox/network/socket_connection.h"
 #include "anbox/runtime.h"
 
+#include <chrono>
+#include <mutex>
 #include <vector>
 
 #include <linux/input.h>
@@ -43,7 +46,13 @@ class Device : public std::enable_shared_from_this<Device> {
   Device();
   ~Device();
 
+  // Queues events and sends them right away together with anything
+  // queued before.
   void send_events(const std::vector<Event> &events);
+  // Queues events to be sent with the next flush(). Motion is coalesced
+  // with the previous packet if nothing else happened in between.
+  void queue_events(const std::vector<Event> &events);
+  void flush();
   void send_event(const std::uint16_t &code, const std::uint16_t &event,
                   const std::int32_t &value);
 
@@ -65,7 +74,20 @@ class Device : public std::enable_shared_from_this<Device> {
 
   std::string socket_path() const;
 
+  struct Stats {
+    std::uint64_t events;
+    std::uint64_t coalesced;
+    std::uint64_t batches;
+    // Time between queuing the oldest event of a batch and sending it
+    std::uint64_t total_latency_us;
+    std::uint64_t max_latency_us;
+  };
+  Stats stats() const;
+
  private:
+  void queue_events_locked(const std::vector<Event> &events);
+  void flush_locked();
+
   int next_id();
   void new_client(std::shared_ptr<
                   boost::asio::local::stream_protocol::socket> const &socket);
@@ -96,6 +118,11 @@ class Device : public std::enable_shared_from_this<Device> {
   std::atomic<int> next_connection_id_;
   std::shared_ptr<network::Connections<network::SocketConnection>> connections_;
   Info info_;
+
+  mutable std::mutex lock_;
+  EventCoalescer pending_;
+  std::chrono::steady_clock::time_point oldest_pending_;
+  Stats stats_{0, 0, 0, 0, 0};
 };
 }  // namespace input
 }  // namespace anbox
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/input/event_coalescer.h"
+#include "anbox/input/device.h"
+
+#include <linux/input.h>
+
+namespace {
+bool is_motion_event(const anbox::input::Event &event) {
+  if (event.type == EV_ABS) {
+    switch (event.code) {
+      case ABS_X:
+      case ABS_Y:
+      case ABS_MT_SLOT:
+      case ABS_MT_POSITION_X:
+      case ABS_MT_POSITION_Y:
+        return true;
+      default:
+        return false;
+    }
+  }
+  return event.type == EV_REL && (event.code == REL_X || event.code == REL_Y);
+}
+
+bool is_syn_report(const anbox::input::Event &event) {
+  return event.type == EV_SYN && event.code == SYN_REPORT;
+}
+}  // namespace
+
+namespace anbox {
+namespace input {
+EventCoalescer::EventCoalescer(std::size_t capacity)
+    : capacity_(capacity), motion_packet_start_(0) {
+  events_.reserve(capacity_);
+}
+
+bool EventCoalescer::push(const std::vector<Event> &events, const struct timespec &time) {
+  // A single push larger than our capacity can't be queued at all, let
+  // the caller deal with it once we're empty.
+  if (events_.size() + events.size() > capacity_ && !events_.empty())
+    return false;
+
+  std::size_t start = 0;
+  while (start < events.size()) {
+    auto end = start;
+    while (end < events.size() && !is_syn_report(events[end]))
+      end++;
+
+    const auto complete = end < events.size();
+    if (complete)
+      end++;
+
+    const auto size = end - start;
+    if (complete && try_merge(&events[start], size, time)) {
+      start = end;
+      continue;
+    }
+
+    bool motion = complete;
+    const auto packet_start = events_.size();
+    for (auto n = start; n < end; n++) {
+      const auto &event = events[n];
+      motion = motion && (is_motion_event(event) || is_syn_report(event));
+      if (event.type == EV_ABS && event.code == ABS_MT_SLOT)
+        current_slot_ = event.value;
+      events_.push_back({static_cast<std::uint64_t>(time.tv_sec),
+                         static_cast<std::uint64_t>(time.tv_nsec / 1000),
+                         event.type, event.code,
+                         static_cast<std::uint32_t>(event.value)});
+    }
+
+    motion_packet_ = motion;
+    motion_packet_start_ = packet_start;
+    start = end;
+  }
+
+  return true;
+}
+
+bool EventCoalescer::try_merge(const Event *packet, std::size_t size, const struct timespec &time) {
+  if (!motion_packet_)
+    return false;
+
+  // Selecting the slot which is already current doesn't change the shape
+  // of the packet.
+  std::size_t first = 0;
+  if (size > 0 && packet[0].type == EV_ABS && packet[0].code == ABS_MT_SLOT) {
+    if (packet[0].value != current_slot_)
+      return false;
+    first = 1;
+  }
+
+  auto last = motion_packet_start_;
+  if (events_[last].type == EV_ABS && events_[last].code == ABS_MT_SLOT)
+    last++;
+
+  if (events_.size() - last != size - first)
+    return false;
+
+  for (std::size_t n = first; n < size; n++) {
+    const auto &queued = events_[last + n - first];
+    if (!is_motion_event(packet[n]) && !is_syn_report(packet[n]))
+      return false;
+    if (queued.type != packet[n].type || queued.code != packet[n].code)
+      return false;
+  }
+
+  // Absolute positions are replaced by the newer ones while relative
+  // movements add up.
+  for (std::size_t n = first; n < size; n++) {
+    auto &queued = events_[last + n - first];
+    if (packet[n].type == EV_REL)
+      queued.value = static_cast<std::uint32_t>(static_cast<std::int32_t>(queued.value) + packet[n].value);
+    else
+      queued.value = static_cast<std::uint32_t>(packet[n].value);
+  }
+
+  for (auto n = motion_packet_start_; n < events_.size(); n++) {
+    events_[n].sec = static_cast<std::uint64_t>(time.tv_sec);
+    events_[n].usec = static_cast<std::uint64_t>(time.tv_nsec / 1000);
+  }
+
+  coalesced_ += size;
+  return true;
+}
+
+void EventCoalescer::clear() {
+  // What was sent can't be merged into anymore but the slot stays
+  // selected on the receiving side.
+  events_.clear();
+  motion_packet_ = false;
+  motion_packet_start_ = 0;
+}
+}  // namespace input
+}  // namespace anbox
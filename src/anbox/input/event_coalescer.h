@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_INPUT_EVENT_COALESCER_H_
+#define ANBOX_INPUT_EVENT_COALESCER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <time.h>
+
+namespace anbox {
+namespace input {
+struct Event;
+
+// NOTE: A bit dirty but as we're running currently a 64 bit container
+// struct input_event has a different size. We rebuild the struct here
+// to reach the correct size.
+struct CompatEvent {
+  std::uint64_t sec;
+  std::uint64_t usec;
+  std::uint16_t type;
+  std::uint16_t code;
+  std::uint32_t value;
+};
+
+// Collects events for a device in their wire format until they are sent.
+// A packet (the events up to and including a SYN_REPORT) which only moves
+// the pointer or a touch point replaces a directly preceding packet of
+// the same shape instead of being appended. Everything else, like button,
+// key or tracking id changes, is kept as is so the guest sees every state
+// change with its SYN_REPORT boundaries intact.
+class EventCoalescer {
+ public:
+  explicit EventCoalescer(std::size_t capacity);
+
+  // Returns false if the events don't fit into the remaining capacity.
+  bool push(const std::vector<Event> &events, const struct timespec &time);
+  void clear();
+
+  bool empty() const { return events_.empty(); }
+  std::size_t size() const { return events_.size(); }
+  const CompatEvent *data() const { return events_.data(); }
+
+  // Number of events dropped by merging them into a previous packet
+  std::uint64_t coalesced() const { return coalesced_; }
+
+ private:
+  bool try_merge(const Event *packet, std::size_t size, const struct timespec &time);
+
+  const std::size_t capacity_;
+  std::vector<CompatEvent> events_;
+  // Start of the last complete packet if it only contains motion
+  std::size_t motion_packet_start_;
+  bool motion_packet_ = false;
+  // Slot selected by the last ABS_MT_SLOT event we queued or sent
+  std::int32_t current_slot_ = -1;
+  std::uint64_t coalesced_ = 0;
+};
+}  // namespace input
+}  // namespace anbox
+
+#endif
@@ -15,6 +15,8 @@
  *
  */
 
+#include <atomic>
+#include <cstdlib>
 #include <thread>
 
 #ifndef BOOST_LOG_DYN_LINK
@@ -30,6 +32,7 @@
 #define BOOST_LOG_USE_NATIVE_SYSLOG
 #include <boost/log/sinks/syslog_backend.hpp>
 
+#include "anbox/async_log_writer.h"
 #include "anbox/logger.h"
 
 namespace {
@@ -40,8 +43,15 @@ BOOST_LOG_ATTRIBUTE_KEYWORD(Timestamp, "Timestamp", boost::posix_time::ptime)
 }
 
 struct BoostLogLogger : public anbox::Logger {
+  // Must be a power of two
+  static constexpr const std::size_t async_queue_size{4096};
+
   BoostLogLogger() : initialized_(false) {}
 
+  ~BoostLogLogger() {
+    StopWriter();
+  }
+
   void Init(const anbox::Logger::Severity& severity = anbox::Logger::Severity::kWarning) override {
     if (initialized_)
       return;
@@ -74,16 +84,15 @@ struct BoostLogLogger : public anbox::Logger {
                                           boost::log::sinks::syslog_backend>>(backend));
     }
 
-    severity_ = severity;
-    initialized_ = true;
-  }
+    SetSeverity(severity);
 
-  void SetSeverity(const Severity& severity) override {
-    severity_ = severity;
-  }
+    // Writing to the console or syslog can block for a long time which
+    // the render, audio and input threads can't afford. With asynchronous
+    // logging they only hand the message over to a dedicated writer thread.
+    if (anbox::utils::get_env_value("ANBOX_ASYNC_LOGGING", "false") == "true")
+      StartWriter();
 
-  Severity GetSeverity() override {
-    return severity_;
+    initialized_ = true;
   }
 
   void Log(Severity severity, const std::string& message, const boost::optional<Location>& loc) override {
@@ -93,13 +102,29 @@ struct BoostLogLogger : public anbox::Logger {
     // we set a filter based on the severity attribute open_record will
     // not return a new record. Because of that we do a poor man filtering
     // here until we have a proper way to do this via boost.
-    if (severity < severity_)
+    if (!IsEnabled(severity))
       return;
 
+    const auto timestamp = boost::posix_time::microsec_clock::universal_time();
+
+    // Fatal messages are usually the last thing we get to write so they
+    // don't wait for the writer thread. Once the writer is stopped we are
+    // back to writing everything right away.
+    auto writer = writer_.load(std::memory_order_acquire);
+    if (!writer || severity >= Severity::kFatal ||
+        !writer->post(anbox::AsyncLogWriter::Record{severity, timestamp, message, loc}))
+      Write(severity, timestamp, message, loc);
+  }
+
+ private:
+  static void StopWriterAtExit();
+
+  void Write(Severity severity, const boost::posix_time::ptime& timestamp,
+             const std::string& message, const boost::optional<Location>& loc) {
     if (auto rec = boost::log::trivial::logger::get().open_record()) {
       boost::log::record_ostream out{rec};
       out << boost::log::add_value(attrs::Severity, severity)
-          << boost::log::add_value(attrs::Timestamp, boost::posix_time::microsec_clock::universal_time())
+          << boost::log::add_value(attrs::Timestamp, timestamp)
           << message;
 
       if (loc) {
@@ -113,11 +138,47 @@ struct BoostLogLogger : public anbox::Logger {
     }
   }
 
- private:
-  Severity severity_;
+  void StartWriter() {
+    async_writer_.reset(new anbox::AsyncLogWriter(async_queue_size, [this](const anbox::AsyncLogWriter::Record &record) {
+      Write(record.severity, record.timestamp, record.message, record.location);
+    }));
+    writer_.store(async_writer_.get(), std::memory_order_release);
+
+    // The writer has to be stopped before boost::log tears down its global
+    // state on exit. Opening a record first sets up everything boost::log
+    // creates lazily so that it is torn down only after our handler ran.
+    { auto rec = boost::log::trivial::logger::get().open_record(); }
+    writer_instance_ = this;
+    std::atexit(&BoostLogLogger::StopWriterAtExit);
+  }
+
+  void StopWriter() {
+    if (!async_writer_)
+      return;
+
+    // Threads still logging write synchronously from now on. The writer
+    // itself stays around as some of them might still be posting to it.
+    writer_.store(nullptr, std::memory_order_release);
+    async_writer_->stop();
+
+    if (writer_instance_ == this)
+      writer_instance_ = nullptr;
+  }
+
   bool initialized_;
+
+  static BoostLogLogger *writer_instance_;
+  std::unique_ptr<anbox::AsyncLogWriter> async_writer_;
+  std::atomic<anbox::AsyncLogWriter*> writer_{nullptr};
 };
 
+BoostLogLogger *BoostLogLogger::writer_instance_ = nullptr;
+
+void BoostLogLogger::StopWriterAtExit() {
+  if (writer_instance_)
+    writer_instance_->StopWriter();
+}
+
 std::shared_ptr<anbox::Logger>& MutableInstance() {
   static std::shared_ptr<anbox::Logger> instance{new BoostLogLogger()};
   return instance;
@@ -20,6 +20,7 @@
 
 #include <boost/optional.hpp>
 
+#include <atomic>
 #include <memory.h>
 #include <string>
 
@@ -50,8 +51,19 @@ class Logger : public DoNotCopyOrMove {
   virtual void Init(const Severity& severity = Severity::kWarning) = 0;
 
   bool SetSeverityFromString(const std::string &severity);
-  virtual void SetSeverity(const Severity& severity) = 0;
-  virtual Severity GetSeverity() = 0;
+  virtual void SetSeverity(const Severity& severity) {
+    severity_.store(severity, std::memory_order_relaxed);
+  }
+  virtual Severity GetSeverity() {
+    return severity_.load(std::memory_order_relaxed);
+  }
+
+  // Whether messages with |severity| pass the configured severity. The
+  // logging macros check this before formatting anything so that filtered
+  // messages cost no more than a load and a compare.
+  bool IsEnabled(Severity severity) const {
+    return severity >= severity_.load(std::memory_order_relaxed);
+  }
 
   virtual void Log(Severity severity, const std::string& message,
                    const boost::optional<Location>& location) = 0;
@@ -113,6 +125,9 @@ class Logger : public DoNotCopyOrMove {
 
  protected:
   Logger() = default;
+
+ private:
+  std::atomic<Severity> severity_{Severity::kWarning};
 };
 
 // operator<< inserts severity into out.
@@ -128,23 +143,32 @@ Logger& Log();
 void SetLogger(const std::shared_ptr<Logger>& logger);
 }
 
-#define TRACE(...)     \
-  anbox::Log().Tracef( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define DEBUG(...)     \
-  anbox::Log().Debugf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define INFO(...)     \
-  anbox::Log().Infof( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define WARNING(...)     \
-  anbox::Log().Warningf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define ERROR(...)     \
-  anbox::Log().Errorf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
-#define FATAL(...)     \
-  anbox::Log().Fatalf( \
-      anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__}, __VA_ARGS__)
+// Messages with a severity below ANBOX_LOG_MIN_SEVERITY (the numeric
+// value of a Logger::Severity) are compiled out completely.
+#ifndef ANBOX_LOG_MIN_SEVERITY
+#define ANBOX_LOG_MIN_SEVERITY 0
+#endif
+
+#define ANBOX_LOG(severity, method, ...)                                      \
+  do {                                                                        \
+    if (static_cast<int>(severity) >= ANBOX_LOG_MIN_SEVERITY &&               \
+        anbox::Log().IsEnabled(severity))                                     \
+      anbox::Log().method(                                                    \
+          anbox::Logger::Location{__FILE__, __FUNCTION__, __LINE__},          \
+          __VA_ARGS__);                                                       \
+  } while (false)
+
+#define TRACE(...) \
+  ANBOX_LOG(anbox::Logger::Severity::kTrace, Tracef, __VA_ARGS__)
+#define DEBUG(...) \
+  ANBOX_LOG(anbox::Logger::Severity::kDebug, Debugf, __VA_ARGS__)
+#define INFO(...) \
+  ANBOX_LOG(anbox::Logger::Severity::kInfo, Infof, __VA_ARGS__)
+#define WARNING(...) \
+  ANBOX_LOG(anbox::Logger::Severity::kWarning, Warningf, __VA_ARGS__)
+#define ERROR(...) \
+  ANBOX_LOG(anbox::Logger::Severity::kError, Errorf, __VA_ARGS__)
+#define FATAL(...) \
+  ANBOX_LOG(anbox::Logger::Severity::kFatal, Fatalf, __VA_ARGS__)
 
 #endif
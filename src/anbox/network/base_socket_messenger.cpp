@@ -17,7 +17,6 @@
  */
 
 #include "anbox/network/base_socket_messenger.h"
-#include "anbox/common/variable_length_array.h"
 #include "anbox/logger.h"
 
 #include <boost/throw_exception.hpp>
@@ -31,8 +30,45 @@ namespace bs = boost::system;
 namespace ba = boost::asio;
 
 namespace {
-/// Buffers need to be big enough to support messages
-unsigned int const serialization_buffer_size = 2048;
+template <typename Socket>
+void flush_when_writable(std::shared_ptr<Socket> const& socket,
+                         std::shared_ptr<anbox::network::SendQueue> const& queue) {
+  socket->async_write_some(ba::null_buffers(), [socket, queue](bs::error_code const& err, size_t) {
+    if (err) {
+      queue->discard();
+      return;
+    }
+    try {
+      if (queue->flush())
+        flush_when_writable(socket, queue);
+    } catch (std::exception const& e) {
+      DEBUG("Failed to send queued data: %s", e.what());
+    }
+  });
+}
+
+template <typename Socket>
+void wait_until_writable(std::shared_ptr<Socket> const& socket,
+                         std::shared_ptr<anbox::network::SendQueue> const& queue,
+                         anbox::network::SocketMessenger::AnboxWritableHandler const& handler) {
+  socket->async_write_some(ba::null_buffers(), [socket, queue, handler](bs::error_code const& err, size_t) {
+    if (err) {
+      handler(err);
+      return;
+    }
+    try {
+      // Whatever was queued has to go out before the caller gets to write
+      if (queue->flush()) {
+        wait_until_writable(socket, queue, handler);
+        return;
+      }
+    } catch (bs::system_error const& e) {
+      handler(e.code());
+      return;
+    }
+    handler(err);
+  });
+}
 }
 
 namespace anbox {
@@ -54,6 +90,7 @@ void BaseSocketMessenger<stream_protocol>::setup(
     std::shared_ptr<ba::basic_stream_socket<stream_protocol>> const& s) {
   socket = s;
   socket_fd = anbox::Fd{IntOwnedFd{socket->native_handle()}};
+  send_queue = std::make_shared<SendQueue>(socket_fd);
   socket->non_blocking(true);
   boost::asio::socket_base::send_buffer_size option(64 * 1024);
   socket->set_option(option);
@@ -76,27 +113,32 @@ Credentials BaseSocketMessenger<stream_protocol>::creds() const {
 template <typename stream_protocol>
 ssize_t BaseSocketMessenger<stream_protocol>::send_raw(char const* data,
                                                        size_t length) {
-  std::unique_lock<std::mutex> lg(message_lock);
-  return ::send(socket_fd, data, length, MSG_NOSIGNAL);
+  return send_queue->send_raw(data, length);
+}
+
+template <typename stream_protocol>
+ssize_t BaseSocketMessenger<stream_protocol>::send_raw_gathered(struct iovec const* iov,
+                                                                size_t count) {
+  return send_queue->send_raw(iov, count);
+}
+
+template <typename stream_protocol>
+void BaseSocketMessenger<stream_protocol>::async_wait_writable(AnboxWritableHandler const& handler) {
+  wait_until_writable(socket, send_queue, handler);
 }
 
 template <typename stream_protocol>
 void BaseSocketMessenger<stream_protocol>::send(char const* data,
                                                 size_t length) {
-  VariableLengthArray<serialization_buffer_size> whole_message{length};
-  std::copy(data, data + length, whole_message.data());
+  struct iovec iov = {const_cast<char*>(data), length};
+  send_gathered(&iov, 1);
+}
 
-  for (;;) {
-    try {
-      std::unique_lock<std::mutex> lg(message_lock);
-      ba::write(*socket, ba::buffer(whole_message.data(), whole_message.size()),
-                boost::asio::transfer_all());
-    } catch (const boost::system::system_error& err) {
-      if (err.code() == boost::asio::error::try_again) continue;
-      throw;
-    }
-    break;
-  }
+template <typename stream_protocol>
+void BaseSocketMessenger<stream_protocol>::send_gathered(struct iovec const* iov,
+                                                         size_t count) {
+  if (send_queue->send(iov, count))
+    flush_when_writable(socket, send_queue);
 }
 
 template <typename stream_protocol>
@@ -133,6 +175,11 @@ unsigned short BaseSocketMessenger<stream_protocol>::local_port() const {
   return 0;
 }
 
+template <typename stream_protocol>
+int BaseSocketMessenger<stream_protocol>::native_handle() const {
+  return socket_fd;
+}
+
 template <typename stream_protocol>
 void BaseSocketMessenger<stream_protocol>::set_no_delay() {
   const auto fd = socket->native_handle();
@@ -146,6 +193,17 @@ void BaseSocketMessenger<stream_protocol>::set_no_delay() {
 template <typename stream_protocol>
 void BaseSocketMessenger<stream_protocol>::close() {
   socket->close();
+  send_queue->discard();
+}
+
+template <typename stream_protocol>
+size_t BaseSocketMessenger<stream_protocol>::queued_bytes() const {
+  return send_queue->queued_bytes();
+}
+
+template <typename stream_protocol>
+std::uint64_t BaseSocketMessenger<stream_protocol>::total_queued_bytes() const {
+  return send_queue->total_queued_bytes();
 }
 
 template class BaseSocketMessenger<boost::asio::local::stream_protocol>;
@@ -20,10 +20,11 @@
 #define ANBOX_NETWORK_BASE_SOCKET_MESSENGER_H_
 
 #include "anbox/common/fd_sets.h"
+#include "anbox/network/send_queue.h"
 #include "anbox/network/socket_messenger.h"
 
 #include <boost/asio.hpp>
-#include <mutex>
+#include <memory>
 
 namespace anbox {
 namespace network {
@@ -37,9 +38,15 @@ class BaseSocketMessenger : public SocketMessenger {
 
   Credentials creds() const override;
   unsigned short local_port() const override;
+  int native_handle() const override;
 
+  // Sending never blocks unless the other side doesn't keep up with more
+  // than SendQueue::default_limit bytes queued.
   void send(char const* data, size_t length) override;
+  void send_gathered(struct iovec const* iov, size_t count) override;
   ssize_t send_raw(char const* data, size_t length) override;
+  ssize_t send_raw_gathered(struct iovec const* iov, size_t count) override;
+  void async_wait_writable(AnboxWritableHandler const& handler) override;
   void async_receive_msg(AnboxReadHandler const& handle,
                          boost::asio::mutable_buffers_1 const& buffer) override;
   boost::system::error_code receive_msg(
@@ -49,6 +56,11 @@ class BaseSocketMessenger : public SocketMessenger {
   void set_no_delay() override;
   void close() override;
 
+  // Bytes waiting for the socket to become writable and the total number
+  // of bytes which ever had to wait.
+  size_t queued_bytes() const;
+  std::uint64_t total_queued_bytes() const;
+
  protected:
   BaseSocketMessenger();
   void setup(std::shared_ptr<
@@ -57,7 +69,7 @@ class BaseSocketMessenger : public SocketMessenger {
  private:
   std::shared_ptr<boost::asio::basic_stream_socket<stream_protocol>> socket;
   anbox::Fd socket_fd;
-  std::mutex message_lock;
+  std::shared_ptr<SendQueue> send_queue;
 };
 }  // namespace network
 }  // namespace anbox
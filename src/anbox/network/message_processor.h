@@ -18,7 +18,9 @@
 #ifndef ANBOX_NETWORK_MESSAGE_PROCESSOR_H
 #define ANBOX_NETWORK_MESSAGE_PROCESSOR_H
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 namespace anbox {
@@ -27,6 +29,26 @@ class MessageProcessor {
  public:
   virtual ~MessageProcessor() {}
   virtual bool process_data(const std::vector<std::uint8_t> &data) = 0;
+
+  // Processors which can take incoming data straight into their own
+  // storage return the range the next read should land in here. Once it
+  // was filled commit_data() is called instead of process_data().
+  virtual std::uint8_t *prepare_data(std::size_t *size) {
+    (void)size;
+    return nullptr;
+  }
+  virtual bool commit_data(std::size_t size) {
+    (void)size;
+    return false;
+  }
+
+  // Processors which couldn't hand on everything they got so far return
+  // true here and call |resume| once they can take more. Nothing is read
+  // from the connection until then.
+  virtual bool defer_read(const std::function<void()> &resume) {
+    (void)resume;
+    return false;
+  }
 };
 }  // namespace network
 }  // namespace anbox
@@ -20,14 +20,36 @@
 #define ANBOX_NETWORK_MESSAGE_SENDER_H_
 
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <cstddef>
+#include <vector>
 
 namespace anbox {
 namespace network {
 class MessageSender {
  public:
   virtual void send(char const* data, size_t length) = 0;
+  // Sends the buffers as a single message, e.g. a header followed by the
+  // payload, without requiring the caller to copy them together first.
+  virtual void send_gathered(struct iovec const* iov, size_t count) {
+    std::vector<char> data;
+    for (size_t n = 0; n < count; n++) {
+      auto const begin = static_cast<char const*>(iov[n].iov_base);
+      data.insert(data.end(), begin, begin + iov[n].iov_len);
+    }
+    send(data.data(), data.size());
+  }
   virtual ssize_t send_raw(char const* data, size_t length) = 0;
+  // Like send_raw() but writes the buffers with a single gathering write.
+  // Returns the number of bytes written over all buffers, which might stop
+  // in the middle of one of them.
+  virtual ssize_t send_raw_gathered(struct iovec const* iov, size_t count) {
+    for (size_t n = 0; n < count; n++) {
+      if (iov[n].iov_len > 0)
+        return send_raw(static_cast<char const*>(iov[n].iov_base), iov[n].iov_len);
+    }
+    return 0;
+  }
 
  protected:
   MessageSender() = default;
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/send_queue.h"
+#include "anbox/stats/registry.h"
+
+#include <boost/system/system_error.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace {
+constexpr const std::size_t max_iovecs{64};
+
+anbox::stats::Gauge &queued_bytes_metric() {
+  static auto &gauge = anbox::stats::Registry::instance().gauge(
+      "anbox_socket_send_queue_bytes", "Bytes queued for sockets which were busy");
+  return gauge;
+}
+}
+
+namespace anbox {
+namespace network {
+SendQueue::SendQueue(Fd const& fd, std::size_t limit) : fd_(fd), limit_(limit) {}
+
+SendQueue::~SendQueue() {
+  queued_bytes_metric().sub(queued_bytes_);
+}
+
+std::size_t SendQueue::write(const struct iovec *iov, std::size_t count) {
+  struct msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = const_cast<struct iovec*>(iov);
+  msg.msg_iovlen = count;
+
+  for (;;) {
+    const auto written = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+    if (written >= 0)
+      return static_cast<std::size_t>(written);
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      return 0;
+    BOOST_THROW_EXCEPTION(boost::system::system_error(
+        errno, boost::system::system_category(), "Failed to send message"));
+  }
+}
+
+bool SendQueue::send(const struct iovec *iov, std::size_t count) {
+  std::lock_guard<std::mutex> l(lock_);
+
+  std::size_t total = 0;
+  for (std::size_t n = 0; n < count; n++)
+    total += iov[n].iov_len;
+
+  // Anything queued has to go out first to keep the order.
+  std::size_t written = 0;
+  if (buffers_.empty())
+    written = write(iov, std::min(count, static_cast<std::size_t>(IOV_MAX)));
+
+  if (written == total)
+    return false;
+
+  std::vector<char> remaining;
+  remaining.reserve(total - written);
+  for (std::size_t n = 0; n < count; n++) {
+    const auto data = static_cast<const char*>(iov[n].iov_base);
+    const auto skip = std::min(written, iov[n].iov_len);
+    remaining.insert(remaining.end(), data + skip, data + iov[n].iov_len);
+    written -= skip;
+  }
+
+  queued_bytes_ += remaining.size();
+  total_queued_bytes_ += remaining.size();
+  queued_bytes_metric().add(remaining.size());
+  buffers_.push_back(std::move(remaining));
+
+  // Apply backpressure on senders which are faster than the receiver
+  if (queued_bytes_ > limit_)
+    drain_locked(limit_);
+
+  if (buffers_.empty() || waiting_)
+    return false;
+
+  waiting_ = true;
+  return true;
+}
+
+bool SendQueue::flush() {
+  std::lock_guard<std::mutex> l(lock_);
+  try {
+    if (flush_locked())
+      return true;
+  } catch (...) {
+    queued_bytes_metric().sub(queued_bytes_);
+    buffers_.clear();
+    offset_ = 0;
+    queued_bytes_ = 0;
+    waiting_ = false;
+    throw;
+  }
+  waiting_ = false;
+  return false;
+}
+
+bool SendQueue::flush_locked() {
+  while (!buffers_.empty()) {
+    struct iovec iov[max_iovecs];
+    std::size_t count = 0;
+    for (auto it = buffers_.begin(); it != buffers_.end() && count < max_iovecs; ++it, ++count) {
+      const auto skip = count == 0 ? offset_ : 0;
+      iov[count].iov_base = it->data() + skip;
+      iov[count].iov_len = it->size() - skip;
+    }
+
+    auto written = write(iov, count);
+    if (written == 0)
+      return true;
+
+    queued_bytes_ -= written;
+    queued_bytes_metric().sub(written);
+    while (written > 0) {
+      const auto left = buffers_.front().size() - offset_;
+      if (written < left) {
+        offset_ += written;
+        break;
+      }
+      written -= left;
+      offset_ = 0;
+      buffers_.pop_front();
+    }
+  }
+  return false;
+}
+
+void SendQueue::drain() {
+  std::lock_guard<std::mutex> l(lock_);
+  drain_locked(0);
+}
+
+void SendQueue::drain_locked(std::size_t limit) {
+  while (queued_bytes_ > limit) {
+    if (!flush_locked())
+      break;
+
+    struct pollfd fd = {fd_, POLLOUT, 0};
+    if (::poll(&fd, 1, -1) < 0 && errno != EINTR)
+      BOOST_THROW_EXCEPTION(boost::system::system_error(
+          errno, boost::system::system_category(), "Failed to wait for socket"));
+  }
+}
+
+void SendQueue::discard() {
+  std::lock_guard<std::mutex> l(lock_);
+  queued_bytes_metric().sub(queued_bytes_);
+  buffers_.clear();
+  offset_ = 0;
+  queued_bytes_ = 0;
+  waiting_ = false;
+}
+
+ssize_t SendQueue::send_raw(char const* data, std::size_t length) {
+  std::lock_guard<std::mutex> l(lock_);
+  drain_locked(0);
+  return ::send(fd_, data, length, MSG_NOSIGNAL);
+}
+
+ssize_t SendQueue::send_raw(const struct iovec *iov, std::size_t count) {
+  std::lock_guard<std::mutex> l(lock_);
+  drain_locked(0);
+
+  struct msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = const_cast<struct iovec*>(iov);
+  msg.msg_iovlen = std::min(count, static_cast<std::size_t>(IOV_MAX));
+  return ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+}
+
+std::size_t SendQueue::queued_bytes() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return queued_bytes_;
+}
+
+std::uint64_t SendQueue::total_queued_bytes() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return total_queued_bytes_;
+}
+}  // namespace network
+}  // namespace anbox
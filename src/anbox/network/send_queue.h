@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_NETWORK_SEND_QUEUE_H_
+#define ANBOX_NETWORK_SEND_QUEUE_H_
+
+#include "anbox/common/fd.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace anbox {
+namespace network {
+// Outgoing data of a non-blocking socket. Messages are written straight
+// away with a single gathering write if nothing is queued. Only what the
+// socket doesn't take immediately is copied and queued until the socket
+// becomes writable again. If more than the limit is queued the sender
+// blocks until the other side catches up.
+class SendQueue {
+ public:
+  static constexpr const std::size_t default_limit{4 * 1024 * 1024};
+
+  explicit SendQueue(Fd const& fd, std::size_t limit = default_limit);
+  ~SendQueue();
+
+  // Returns true if data was queued and the caller has to call flush()
+  // once the socket is writable. Throws if the socket failed.
+  bool send(const struct iovec *iov, std::size_t count);
+  // Writes as much queued data as the socket takes. Returns true if data
+  // is left and the caller needs to wait for the socket to be writable
+  // again.
+  bool flush();
+  // Blocks until all queued data is written.
+  void drain();
+  // Drops all queued data, e.g. when the socket is closed.
+  void discard();
+
+  // Bypass the queue once everything queued before is written.
+  ssize_t send_raw(char const* data, std::size_t length);
+  ssize_t send_raw(const struct iovec *iov, std::size_t count);
+
+  // Bytes currently queued and queued in total over the lifetime
+  std::size_t queued_bytes() const;
+  std::uint64_t total_queued_bytes() const;
+
+ private:
+  // Returns the number of bytes written, 0 if the socket is full.
+  std::size_t write(const struct iovec *iov, std::size_t count);
+  bool flush_locked();
+  void drain_locked(std::size_t limit);
+
+  const Fd fd_;
+  const std::size_t limit_;
+  mutable std::mutex lock_;
+  std::deque<std::vector<char>> buffers_;
+  // Offset into the first buffer which was written already
+  std::size_t offset_ = 0;
+  std::size_t queued_bytes_ = 0;
+  std::uint64_t total_queued_bytes_ = 0;
+  bool waiting_ = false;
+};
+}  // namespace network
+}  // namespace anbox
+
+#endif
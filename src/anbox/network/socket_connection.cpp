@@ -53,6 +53,16 @@ void SocketConnection::send(char const* data, size_t length) {
 }
 
 void SocketConnection::read_next_message() {
+  if (processor_->defer_read(std::bind(&SocketConnection::read_next_message, this)))
+    return;
+
+  std::size_t size = 0;
+  if (auto data = processor_->prepare_data(&size)) {
+    auto callback = std::bind(&SocketConnection::on_data_committed, this, std::placeholders::_1, std::placeholders::_2);
+    message_receiver_->async_receive_msg(callback, ba::buffer(data, size));
+    return;
+  }
+
   auto callback = std::bind(&SocketConnection::on_read_size, this, std::placeholders::_1, std::placeholders::_2);
   message_receiver_->async_receive_msg(callback, ba::buffer(buffer_));
 }
@@ -71,5 +81,17 @@ void SocketConnection::on_read_size(const boost::system::error_code& error, std:
   else
       connections_->remove(id());
 }
+
+void SocketConnection::on_data_committed(const boost::system::error_code& error, std::size_t bytes_read) {
+  if (error) {
+    connections_->remove(id());
+    return;
+  }
+
+  if (processor_->commit_data(bytes_read))
+    read_next_message();
+  else
+    connections_->remove(id());
+}
 }  // namespace anbox
 }  // namespace network
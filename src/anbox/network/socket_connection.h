@@ -50,6 +50,8 @@ class SocketConnection {
  private:
   void on_read_size(const boost::system::error_code& ec,
                     std::size_t bytes_read);
+  void on_data_committed(const boost::system::error_code& ec,
+                         std::size_t bytes_read);
 
   std::shared_ptr<MessageReceiver> const message_receiver_;
   std::shared_ptr<MessageSender> const message_sender_;
@@ -31,6 +31,13 @@ class SocketMessenger : public MessageSender, public MessageReceiver {
  public:
   virtual Credentials creds() const = 0;
   virtual unsigned short local_port() const = 0;
+  // The underlying socket for users moving data around it directly
+  virtual int native_handle() const = 0;
+  // Calls |handler| once everything sent before went out and the socket
+  // takes more data. Users writing to native_handle() or with send_raw()
+  // wait with this when the socket is full.
+  typedef std::function<void(boost::system::error_code const&)> AnboxWritableHandler;
+  virtual void async_wait_writable(AnboxWritableHandler const& handler) = 0;
   virtual void set_no_delay() = 0;
   virtual void close() = 0;
 };
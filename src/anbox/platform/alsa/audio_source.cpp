@@ -23,9 +23,24 @@
 #include <boost/throw_exception.hpp>
 #include <alsa/asoundlib.h>
 #include <sys/select.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include "anbox/logger.h"
 #include "anbox/audio/client_info.h"
 
+namespace {
+// Number of sent periods after which the capture statistics are logged
+const std::uint64_t stats_interval = 500;
+
+// Same clock as CLOCK_MONOTONIC which the guest compares against
+std::int64_t monotonic_time_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
 namespace anbox{
 namespace platform{
 namespace sdl{
@@ -37,6 +52,11 @@ AudioSource::AudioSource()
     is_opened = false;
 }
 
+AudioSource::~AudioSource()
+{
+    stop_streaming();
+}
+
 bool AudioSource::connect_audio()
 {
     clock_t start = clock();
@@ -108,6 +128,114 @@ void AudioSource::process_pcm_data()
     delete[] dataBuf;
 }
 
+void AudioSource::start_streaming()
+{
+    stop_streaming();
+
+    if (!is_opened) {
+        ERROR("pcm devices isn't opened");
+        // An empty period tells the guest that we can't capture anything
+        audio::CapturePeriodHeader header{0, 0, 0};
+        mConnection->send(reinterpret_cast<const char*>(&header), sizeof(header));
+        return;
+    }
+
+    capture_ring_.reset(new audio::CaptureRing(malsahelper.get_period_frames_bytes(),
+                                               streaming_period_count));
+    streaming_ = true;
+    capture_thread_ = std::thread(&AudioSource::capture_main, this);
+    send_thread_ = std::thread(&AudioSource::send_main, this);
+    DEBUG("audio source started streaming");
+}
+
+void AudioSource::stop_streaming()
+{
+    if (!capture_ring_) {
+        return;
+    }
+
+    streaming_ = false;
+    capture_ring_->close();
+    if (capture_thread_.joinable()) {
+        capture_thread_.join();
+    }
+    if (send_thread_.joinable()) {
+        send_thread_.join();
+    }
+    capture_ring_.reset();
+    DEBUG("audio source stopped streaming");
+}
+
+void AudioSource::capture_main()
+{
+    audio::hwparams params;
+    malsahelper.get_device_config(params);
+    const auto period_frames = malsahelper.get_period_frames();
+    const auto period_bytes = malsahelper.get_period_frames_bytes();
+    const std::int64_t period_ns = period_frames * 1000000000LL / std::max(params.rate, 1U);
+
+    // Read the device straight into the ring, it never waits for the
+    // sender so the device keeps being drained at its own pace.
+    while (streaming_) {
+        auto data = capture_ring_->prepare();
+        if (malsahelper.pcm_read(reinterpret_cast<char*>(data), period_frames) != period_frames) {
+            ERROR("read pcm data failed !!!");
+            break;
+        }
+        // The read returns once the last frame of the period arrived
+        capture_ring_->commit(period_bytes, monotonic_time_ns() - period_ns);
+    }
+
+    capture_ring_->close();
+}
+
+void AudioSource::send_main()
+{
+    std::vector<std::uint8_t> message(sizeof(audio::CapturePeriodHeader) + capture_ring_->period_size());
+    audio::CapturePeriodHeader header{0, 0, 0};
+    // The device keeps counting across sessions, the guest wants them per session
+    const auto xrun_base = malsahelper.get_xrun_count();
+
+    std::uint64_t periods = 0;
+    std::int64_t total_latency_us = 0;
+    std::int64_t max_latency_us = 0;
+
+    size_t size = 0;
+    std::int64_t capture_time_ns = 0;
+    while (capture_ring_->pop(message.data() + sizeof(header), &size, &capture_time_ns)) {
+        header.size = static_cast<std::uint32_t>(size);
+        header.overruns = static_cast<std::uint32_t>(capture_ring_->overruns() + malsahelper.get_xrun_count() - xrun_base);
+        header.capture_time_ns = capture_time_ns;
+        memcpy(message.data(), &header, sizeof(header));
+
+        try {
+            mConnection->send(reinterpret_cast<const char*>(message.data()), sizeof(header) + size);
+        } catch (const std::exception &err) {
+            ERROR("Failed to send captured pcm data: %s", err.what());
+            break;
+        }
+
+        const auto latency_us = (monotonic_time_ns() - capture_time_ns) / 1000;
+        total_latency_us += latency_us;
+        max_latency_us = std::max(max_latency_us, latency_us);
+        if (++periods % stats_interval == 0) {
+            DEBUG("audio capture: %d periods sent, %d overruns, latency avg %d us max %d us",
+                  periods, header.overruns, total_latency_us / static_cast<std::int64_t>(periods),
+                  max_latency_us);
+        }
+    }
+
+    // Capturing failed while the guest still waits for data
+    if (streaming_.exchange(false)) {
+        audio::CapturePeriodHeader end{0, header.overruns, 0};
+        try {
+            mConnection->send(reinterpret_cast<const char*>(&end), sizeof(end));
+        } catch (const std::exception &err) {
+            ERROR("Failed to send end of capture: %s", err.what());
+        }
+    }
+}
+
 /**
 *  response recording request from android audio hal
 */
@@ -122,7 +250,16 @@ void AudioSource::read_data(const std::vector<std::uint8_t> &data)
         case audio::RecordCommand::StartRecord:
             process_pcm_data();
             break;
+        case audio::RecordCommand::StartStreaming:
+            start_streaming();
+            break;
         case audio::RecordCommand::StopRecord:
+            if (capture_ring_) {
+                // Streaming clients don't wait for an answer
+                stop_streaming();
+                disconnect_audio();
+                break;
+            }
             res = disconnect_audio();
             str = std::to_string(res);
             mConnection->send(str.c_str(), str.length());
@@ -24,8 +24,11 @@
 #include <unistd.h>
 #include "anbox/audio/source.h"
 #include "anbox/audio/alsa_helper.h"
+#include "anbox/audio/capture_ring.h"
 #include "anbox/network/socket_connection.h"
-#include "anbox/graphics/buffer_queue.h"
+
+#include <atomic>
+#include <memory>
 
 namespace anbox {
 namespace platform {
@@ -33,7 +36,7 @@ namespace sdl {
 class AudioSource:public audio::Source {
 public:
     AudioSource();
-    ~AudioSource() {}
+    ~AudioSource();
     void read_data(const std::vector<std::uint8_t> &data) override;
     void set_socket_connection(std::shared_ptr<network::SocketConnection> const& connection) override;
     bool connect_audio() override;
@@ -47,8 +50,21 @@ private:
     anbox::audio::AlsaHelper malsahelper;
     std::shared_ptr<network::SocketConnection>  mConnection;
 
+    // Periods buffered between capturing and sending them in streaming mode
+    static const size_t streaming_period_count = 8;
+
     int disconnect_audio();
     void process_pcm_data();
+
+    void start_streaming();
+    void stop_streaming();
+    void capture_main();
+    void send_main();
+
+    std::unique_ptr<audio::CaptureRing> capture_ring_;
+    std::atomic<bool> streaming_{false};
+    std::thread capture_thread_;
+    std::thread send_thread_;
 };
 } // alsa
 } // platform
@@ -16,14 +16,49 @@
  */
 
 #include "anbox/platform/sdl/audio_sink.h"
+#include "anbox/stats/registry.h"
 #include "anbox/logger.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include <boost/throw_exception.hpp>
 
 namespace {
 const constexpr size_t max_queue_size{16};
+const constexpr int default_sample_rate{44100};
+const constexpr Uint16 default_device_samples{1024};
+// We always play back S16 stereo
+const constexpr size_t bytes_per_frame{4};
+// Guest periods buffered before playback starts in negotiated mode
+const constexpr size_t jitter_periods{2};
+const constexpr Uint16 min_device_samples{64};
+// Formats the guest may ask for. Periods are at most 100ms long at the
+// highest rate which keeps the device buffer within what SDL accepts.
+const constexpr std::uint32_t min_sample_rate{8000};
+const constexpr std::uint32_t max_sample_rate{192000};
+const constexpr std::uint32_t max_period_frames{max_sample_rate / 10};
+// Seconds between two statistics reports of an active device
+const constexpr int stats_interval{10};
+
+struct AudioMetrics {
+  anbox::stats::Counter &written_bytes;
+  anbox::stats::Counter &underruns;
+  anbox::stats::Counter &dropped;
+  anbox::stats::Gauge &queued_bytes;
+};
+
+AudioMetrics &metrics() {
+  auto &registry = anbox::stats::Registry::instance();
+  static AudioMetrics m{
+      registry.counter("anbox_audio_written_bytes_total", "Audio bytes received for playback"),
+      registry.counter("anbox_audio_underruns_total",
+                       "Times the device asked for data while the jitter buffer was empty"),
+      registry.counter("anbox_audio_dropped_buffers_total", "Buffers dropped as the queue was full"),
+      registry.gauge("anbox_audio_queued_bytes", "Bytes waiting to be handed to the device"),
+  };
+  return m;
+}
 }
 
 namespace anbox {
@@ -31,6 +66,8 @@ namespace platform {
 namespace sdl {
 AudioSink::AudioSink() :
   device_id_(0),
+  sample_rate_(default_sample_rate),
+  device_samples_(default_device_samples),
   queue_(max_queue_size),
   mThreadExit(false),
   t(NULL) {
@@ -42,7 +79,7 @@ AudioSink::~AudioSink() {
     free(t);
     t = NULL;
   }
-  queue_.close_locked();
+  queue_.close();
   disconnect_audio();
 }
 
@@ -51,9 +88,53 @@ void AudioSink::on_data_requested(void *user_data, std::uint8_t *buffer, int siz
   thiz->read_data(buffer, size);
 }
 
+void AudioSink::configure(audio::ClientInfo &client_info) {
+  std::unique_lock<std::mutex> l(lock_);
+  if (client_info.sample_rate == 0 || client_info.period_frames == 0) {
+    client_info.sample_rate = sample_rate_;
+    client_info.latency_frames = device_samples_;
+    return;
+  }
+
+  // Open the device with the rate the guest renders at so SDL doesn't
+  // need to resample and let it ask for less than a guest period at a
+  // time so that a period arriving late doesn't stall the device.
+  client_info.sample_rate = std::min(std::max(client_info.sample_rate, min_sample_rate), max_sample_rate);
+  client_info.period_frames = std::min(client_info.period_frames, max_period_frames);
+
+  sample_rate_ = static_cast<int>(client_info.sample_rate);
+  std::uint32_t device_samples = min_device_samples;
+  while (device_samples * 2 <= client_info.period_frames)
+    device_samples *= 2;
+  device_samples_ = static_cast<Uint16>(device_samples);
+
+  const auto jitter_frames = jitter_periods * client_info.period_frames;
+  jitter_target_ = jitter_frames * bytes_per_frame;
+  client_info.latency_frames = jitter_frames + device_samples_;
+
+  DEBUG("Audio playback negotiated: %d Hz, %d frames per period, %d device samples, latency %d frames",
+        sample_rate_, client_info.period_frames, device_samples_, client_info.latency_frames);
+}
+
+AudioSink::Stats AudioSink::stats() const {
+  return Stats{underruns_, dropped_, queued_bytes_};
+}
+
+void AudioSink::report_stats() {
+  const auto s = stats();
+  const auto latency_ms = (s.queued_bytes / bytes_per_frame + device_samples_) * 1000 / sample_rate_;
+  DEBUG("Audio playback: latency %d ms, %d underruns, %d dropped buffers",
+        latency_ms, s.underruns, s.dropped);
+  reported_underruns_ = s.underruns;
+}
+
 void AudioSink::monitor_loop()
 {
+    int iterations = 0;
     while (!mThreadExit) {
+      if (device_id_ > 0 && (underruns_ != reported_underruns_ || ++iterations % stats_interval == 0))
+        report_stats();
+
       if (device_id_ > 0 && SDL_GetAudioDeviceStatus(device_id_) == SDL_AUDIO_STOPPED) {
         // restart audio if stopped internal cause of alsa errors
         ERROR("closing sdl audio device cause of error device_id_ %d", device_id_);
@@ -73,10 +154,10 @@ bool AudioSink::connect_audio() {
   }
 
   SDL_memset(&spec_, 0, sizeof(spec_));
-  spec_.freq = 44100;
+  spec_.freq = sample_rate_;
   spec_.format = AUDIO_S16;
   spec_.channels = 2;
-  spec_.samples = 1024;
+  spec_.samples = device_samples_;
   spec_.callback = &AudioSink::on_data_requested;
   spec_.userdata = this;
 
@@ -103,8 +184,53 @@ void AudioSink::disconnect_audio() {
   device_id_ = 0;
 }
 
+size_t AudioSink::copy_queued_data(std::uint8_t *buffer, size_t size) {
+  size_t count = 0;
+  while (count < size) {
+    if (read_buffer_left_ == 0) {
+      if (queue_.try_pop(&read_buffer_) != 0)
+        break;
+      read_buffer_left_ = read_buffer_.size();
+      continue;
+    }
+
+    const auto avail = std::min(size - count, read_buffer_left_);
+    memcpy(buffer + count,
+           read_buffer_.data() + (read_buffer_.size() - read_buffer_left_),
+           avail);
+    count += avail;
+    read_buffer_left_ -= avail;
+  }
+  queued_bytes_ -= count;
+  return count;
+}
+
+void AudioSink::read_data_buffered(std::uint8_t *buffer, int size) {
+  const auto wanted = static_cast<size_t>(size);
+  size_t count = 0;
+  if (!prefilling_ || queued_bytes_ >= jitter_target_) {
+    prefilling_ = false;
+    count = copy_queued_data(buffer, wanted);
+  }
+
+  if (count < wanted) {
+    // Never stall the device, play silence and wait for the jitter
+    // buffer to fill up again instead.
+    memset(buffer + count, spec_.silence, wanted - count);
+    if (!prefilling_) {
+      underruns_++;
+      metrics().underruns.add();
+      prefilling_ = true;
+    }
+  }
+}
+
 void AudioSink::read_data(std::uint8_t *buffer, int size) {
-  std::unique_lock<std::mutex> l(lock_);
+  if (jitter_target_ > 0) {
+    read_data_buffered(buffer, size);
+    return;
+  }
+
   const auto wanted = size;
   int count = 0;
   auto dst = buffer;
@@ -117,15 +243,16 @@ void AudioSink::read_data(std::uint8_t *buffer, int size) {
              avail);
       count += avail;
       read_buffer_left_ -= avail;
+      queued_bytes_ -= avail;
       continue;
     }
 
     bool blocking = (count == 0);
     auto result = -EIO;
     if (blocking)
-      result = queue_.pop_locked(&read_buffer_, l);
+      result = queue_.pop(&read_buffer_);
     else
-      result = queue_.try_pop_locked(&read_buffer_);
+      result = queue_.try_pop(&read_buffer_);
 
     if (result == 0) {
       read_buffer_left_ = read_buffer_.size();
@@ -149,11 +276,18 @@ void AudioSink::write_data(const std::vector<std::uint8_t> &data) {
     return;
   }
   graphics::Buffer buffer{data.data(), data.data() + data.size()};
-  if(!queue_.can_push_locked()){
+  // Account before pushing as the device may consume it right away
+  queued_bytes_ += data.size();
+  if (queue_.try_push(std::move(buffer)) == -EAGAIN) {
     ERROR("AudioSink buffer queue full, skipping %d bytes", data.size());
-    return;
+    queued_bytes_ -= data.size();
+    dropped_++;
+    metrics().dropped.add();
   }
-  queue_.push_locked(std::move(buffer), l);
+
+  auto &m = metrics();
+  m.written_bytes.add(data.size());
+  m.queued_bytes.set(queued_bytes_);
 }
 } // namespace sdl
 } // namespace platform
@@ -22,6 +22,7 @@
 #include "anbox/graphics/buffer_queue.h"
 #include "anbox/platform/sdl/sdl_wrapper.h"
 
+#include <atomic>
 #include <thread>
 
 namespace anbox {
@@ -29,25 +30,51 @@ namespace platform {
 namespace sdl {
 class AudioSink : public audio::Sink {
  public:
+  struct Stats {
+    // Times the device asked for data while the jitter buffer was empty
+    std::uint64_t underruns;
+    // Buffers dropped as the queue was full
+    std::uint64_t dropped;
+    // Bytes waiting to be handed to the device
+    std::size_t queued_bytes;
+  };
+
   AudioSink();
   ~AudioSink();
 
+  void configure(audio::ClientInfo &client_info) override;
   void write_data(const std::vector<std::uint8_t> &data) override;
 
+  Stats stats() const;
+
  private:
   bool connect_audio();
   void disconnect_audio();
   void read_data(std::uint8_t *buffer, int size);
+  void read_data_buffered(std::uint8_t *buffer, int size);
+  size_t copy_queued_data(std::uint8_t *buffer, size_t size);
   void monitor_loop();
+  void report_stats();
 
   static void on_data_requested(void *user_data, std::uint8_t *buffer, int size);
 
   std::mutex lock_;
   SDL_AudioSpec spec_;
   SDL_AudioDeviceID device_id_;
-  graphics::BufferQueue queue_;
+  int sample_rate_;
+  Uint16 device_samples_;
+  // Bytes queued before playback (re)starts after an underrun. Zero
+  // keeps the legacy mode where the device callback blocks for data.
+  size_t jitter_target_ = 0;
+  bool prefilling_ = true;
+  // Filled by write_data() and drained by the SDL audio callback
+  graphics::LockFreeBufferQueue queue_;
   graphics::Buffer read_buffer_;
   size_t read_buffer_left_ = 0;
+  std::atomic<size_t> queued_bytes_{0};
+  std::atomic<std::uint64_t> underruns_{0};
+  std::atomic<std::uint64_t> dropped_{0};
+  std::uint64_t reported_underruns_ = 0;
   bool mThreadExit;
   std::thread *t;
 };
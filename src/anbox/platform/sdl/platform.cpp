@@ -35,6 +35,11 @@
 #include <sys/types.h>
 #pragma GCC diagnostic pop
 
+namespace {
+// Longest time motion events are held back to be coalesced
+constexpr const std::uint32_t input_flush_interval_ms{8};
+}
+
 namespace anbox {
 namespace platform {
 namespace sdl {
@@ -306,10 +311,23 @@ void Platform::process_events() {
           user_event_function(event);
           break;
       }
+
+      // Motion is queued and coalesced while SDL has more events for us
+      // but never held back for longer than a frame.
+      if (!SDL_HasEvents(SDL_FIRSTEVENT, SDL_LASTEVENT) ||
+          SDL_GetTicks() - last_input_flush_ >= input_flush_interval_ms)
+        flush_input_events();
     }
+    flush_input_events();
   }
 }
 
+void Platform::flush_input_events() {
+  last_input_flush_ = SDL_GetTicks();
+  pointer_->flush();
+  touch_->flush();
+}
+
 bool Platform::text_input_fliter(const char* text) {
   return text[0] > 0x7f || (input_flag == 0 &&
           ((text[0] <= 'Z' && text[0] >= 'A') || (text[0] <= 'z' && text[0] >= 'a')));
@@ -357,6 +375,9 @@ void Platform::input_key_event(const SDL_Scancode &scan_code, std::int32_t down_
   std::vector<input::Event> keyboard_events;
   std::uint16_t code = KeycodeConverter::convert(scan_code);
   keyboard_events.push_back({EV_KEY, code, down_or_up});
+  // Pointer and touch events which happened before have to reach the
+  // guest before the key does.
+  flush_input_events();
   keyboard_->send_events(keyboard_events);
 }
 
@@ -383,9 +404,12 @@ bool Platform::mbd_event_fliter(const SDL_Event &event) {
 }
 
 void Platform::process_input_event(const SDL_Event &event) {
-  std::vector<input::Event> mouse_events;
-  std::vector<input::Event> keyboard_events;
-  std::vector<input::Event> touch_events;
+  auto &mouse_events = mouse_events_;
+  auto &keyboard_events = keyboard_events_;
+  auto &touch_events = touch_events_;
+  mouse_events.clear();
+  keyboard_events.clear();
+  touch_events.clear();
 
   std::int32_t x = 0;
   std::int32_t y = 0;
@@ -502,14 +526,16 @@ void Platform::process_input_event(const SDL_Event &event) {
 
   if (mouse_events.size() > 0) {
     mouse_events.push_back({EV_SYN, SYN_REPORT, 0});
-    pointer_->send_events(mouse_events);
+    pointer_->queue_events(mouse_events);
   }
 
-  if (keyboard_events.size() > 0)
+  if (keyboard_events.size() > 0) {
+    flush_input_events();
     keyboard_->send_events(keyboard_events);
+  }
 
   if (touch_events.size() > 0)
-    touch_->send_events(touch_events);
+    touch_->queue_events(touch_events);
 }
 
 int Platform::find_touch_slot(int id) {
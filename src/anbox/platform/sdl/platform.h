@@ -84,6 +84,7 @@ class Platform : public std::enable_shared_from_this<Platform>,
  private:
   void process_events();
   void process_input_event(const SDL_Event &event);
+  void flush_input_events();
   bool mbd_event_fliter(const SDL_Event &event);
   SDL_Scancode removeKPPropertyIfNeeded(const SDL_Scancode &scan_code);
   void sync_mod_state();
@@ -138,6 +139,12 @@ class Platform : public std::enable_shared_from_this<Platform>,
 
   int user_window_event = 0;
   std::uint32_t key_mod_{ KMOD_NONE };
+
+  // Reused for every SDL event to avoid allocating on the input path
+  std::vector<input::Event> mouse_events_;
+  std::vector<input::Event> keyboard_events_;
+  std::vector<input::Event> touch_events_;
+  std::uint32_t last_input_flush_ = 0;
 };
 } // namespace sdl
 } // namespace platform
@@ -319,6 +319,12 @@ void Window::process_event(const SDL_Event &event) {
         observer_->window_moved(id_, event.window.data1, event.window.data2);
       }
       break;
+    // The host lost what we drew into the window last so it has to be
+    // redrawn even if the guest didn't change anything.
+    case SDL_WINDOWEVENT_EXPOSED:
+    case SDL_WINDOWEVENT_RESTORED:
+      invalidate();
+      break;
     case SDL_WINDOWEVENT_SHOWN:
       break;
     case SDL_WINDOWEVENT_HIDDEN:
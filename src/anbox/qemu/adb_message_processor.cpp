@@ -19,10 +19,17 @@
 #include "anbox/network/delegate_connection_creator.h"
 #include "anbox/network/delegate_message_processor.h"
 #include "anbox/network/tcp_socket_messenger.h"
+#include "anbox/logger.h"
 #include "anbox/utils.h"
 
+#include <algorithm>
+#include <array>
+#include <condition_variable>
 #include <fstream>
 #include <functional>
+#include <mutex>
+
+#include <fcntl.h>
 
 namespace {
 const unsigned short default_adb_client_port{5037};
@@ -39,38 +46,104 @@ const std::string start_command{"start"};
 // user until we connect to the adb host instance after it appeared and not
 // too short to not put unnecessary burden on the CPU.
 const boost::posix_time::seconds default_adb_wait_time{1};
+// Odd ports from the default one up to the end of the range
+constexpr const unsigned int max_adb_sessions{14};
+// Amount of data moved in one go from one side of the proxy to the other
+constexpr const std::size_t relay_buffer_size{64 * 1024};
+constexpr const std::size_t max_pooled_relay_buffers{8};
+
+// Hands out the session numbers which decide the listen port. The
+// container directly opens a second connection once the first one is
+// established but will not use it until it was accepted, so callers
+// wait here until one of the allowed sessions is free.
+class SessionSlots {
+ public:
+  int acquire(unsigned int max_sessions) {
+    std::unique_lock<std::mutex> l(lock_);
+    for (;;) {
+      for (unsigned int n = 0; n < std::min(max_sessions, max_adb_sessions); n++) {
+        if (!used_[n]) {
+          used_[n] = true;
+          return n;
+        }
+      }
+      released_.wait(l);
+    }
+  }
+
+  void release(int slot) {
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      used_[slot] = false;
+    }
+    released_.notify_all();
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable released_;
+  std::array<bool, max_adb_sessions> used_{};
+};
+
+SessionSlots session_slots;
+
+std::mutex relay_buffer_lock;
+std::vector<std::unique_ptr<std::uint8_t[]>> relay_buffer_pool;
+
+std::unique_ptr<std::uint8_t[]> acquire_relay_buffer() {
+  std::unique_lock<std::mutex> l(relay_buffer_lock);
+  if (relay_buffer_pool.empty())
+    return std::unique_ptr<std::uint8_t[]>(new std::uint8_t[relay_buffer_size]);
+  auto buffer = std::move(relay_buffer_pool.back());
+  relay_buffer_pool.pop_back();
+  return buffer;
+}
+
+void release_relay_buffer(std::unique_ptr<std::uint8_t[]> buffer) {
+  if (!buffer)
+    return;
+  std::unique_lock<std::mutex> l(relay_buffer_lock);
+  if (relay_buffer_pool.size() < max_pooled_relay_buffers)
+    relay_buffer_pool.push_back(std::move(buffer));
+}
 }
 
 using namespace std::placeholders;
 
 namespace anbox {
 namespace qemu {
-std::mutex AdbMessageProcessor::active_instance_{};
+const AdbMessageProcessor::Config AdbMessageProcessor::default_config{1, true, default_host_listen_port};
 
 AdbMessageProcessor::AdbMessageProcessor(
     const std::shared_ptr<Runtime> &rt,
-    const std::shared_ptr<network::SocketMessenger> &messenger)
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    const Config &config)
     : runtime_(rt),
+      config_(config),
       state_(waiting_for_guest_accept_command),
       expected_command_(accept_command),
-      messenger_(messenger),
-      lock_(active_instance_, std::defer_lock) {
+      messenger_(messenger) {
 }
 
 AdbMessageProcessor::~AdbMessageProcessor() {
   state_ = closed_by_host;
 
   host_connector_.reset();
+
+  release_relay_buffer(std::move(host_buffer_));
+  release_relay_buffer(std::move(guest_buffer_));
+
+  if (session_ >= 0)
+    session_slots.release(session_);
 }
 
 void AdbMessageProcessor::advance_state() {
   switch (state_) {
     case waiting_for_guest_accept_command:
-      // Try to get a lock here as if we already have another processor
-      // running we don't have to do anything here until that one is done.
-      // The container directly starts a second connection once the first
-      // one is established but will not use it until the active one is closed.
-      lock_.lock();
+      // If all allowed sessions are running we don't have to do anything
+      // here until one of them is done.
+      session_ = session_slots.acquire(config_.max_sessions);
+      listen_port_ = config_.listen_port + 2 * session_;
 
       if (state_ == closed_by_host) {
         host_connector_.reset();
@@ -87,7 +160,11 @@ void AdbMessageProcessor::advance_state() {
       break;
     case waiting_for_guest_start_command:
       state_ = proxying_data;
-      read_next_host_message();
+      if (config_.zero_copy && !setup_relay_pipe())
+        WARNING("Failed to create adb relay pipe, copying proxied data");
+      // Data from the host bypasses the send queue of the messenger so
+      // everything we queued before has to go out first.
+      messenger_->async_wait_writable(std::bind(&AdbMessageProcessor::on_guest_writable, this, _1));
       break;
     case proxying_data:
       break;
@@ -115,7 +192,7 @@ void AdbMessageProcessor::wait_for_host_connection() {
   if (!host_connector_) {
     host_connector_ = std::make_shared<network::TcpSocketConnector>(
         boost::asio::ip::address_v4::from_string(loopback_address),
-        default_host_listen_port, runtime_,
+        listen_port_, runtime_,
         std::make_shared<
             network::DelegateConnectionCreator<boost::asio::ip::tcp>>(
             std::bind(&AdbMessageProcessor::on_host_connection, this, _1)));
@@ -126,7 +203,7 @@ void AdbMessageProcessor::wait_for_host_connection() {
     // proxy is waiting for incoming connections.
     auto messenger = std::make_shared<network::TcpSocketMessenger>(
         boost::asio::ip::address_v4::from_string(loopback_address), default_adb_client_port, runtime_);
-    auto message = utils::string_format("host:emulator:%d", default_host_listen_port);
+    auto message = utils::string_format("host:emulator:%d", listen_port_);
     auto handshake = utils::string_format("%04x%s", message.size(), message.c_str());
     messenger->send(handshake.data(), handshake.size());
   } catch (...) {
@@ -135,6 +212,7 @@ void AdbMessageProcessor::wait_for_host_connection() {
 }
 
 void AdbMessageProcessor::on_host_connection(std::shared_ptr<boost::asio::basic_stream_socket<boost::asio::ip::tcp>> const &socket) {
+  host_socket_ = socket;
   host_messenger_ = std::make_shared<network::TcpSocketMessenger>(socket);
 
   // set_no_delay() reduces the latency of sending data, at the cost
@@ -152,9 +230,44 @@ void AdbMessageProcessor::on_host_connection(std::shared_ptr<boost::asio::basic_
   expected_command_ = start_command;
 }
 
+bool AdbMessageProcessor::setup_relay_pipe() {
+  int fds[2];
+  if (::pipe2(fds, O_CLOEXEC | O_NONBLOCK) < 0)
+    return false;
+
+  relay_pipe_read_ = Fd{fds[0]};
+  relay_pipe_write_ = Fd{fds[1]};
+  // Best effort, a smaller pipe only means more splice calls
+  ::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(relay_buffer_size));
+  return true;
+}
+
 void AdbMessageProcessor::read_next_host_message() {
+  if (relay_pipe_read_ != Fd::invalid) {
+    // Only wait for the socket to become readable, the data itself never
+    // reaches user space.
+    auto callback = std::bind(&AdbMessageProcessor::on_host_readable, this, _1);
+    host_socket_->async_read_some(boost::asio::null_buffers(), callback);
+    return;
+  }
+
+  if (!host_buffer_)
+    host_buffer_ = acquire_relay_buffer();
+
   auto callback = std::bind(&AdbMessageProcessor::on_host_read_size, this, _1, _2);
-  host_messenger_->async_receive_msg(callback, boost::asio::buffer(host_buffer_));
+  host_messenger_->async_receive_msg(callback, boost::asio::buffer(host_buffer_.get(), relay_buffer_size));
+}
+
+void AdbMessageProcessor::on_host_error(const boost::system::error_code &error) {
+  DEBUG("Lost connection to adb host: %s", error.message());
+
+  // We assume the connection with the host is dropped. We
+  // close the connection to the container's adbd, which will trigger the
+  // deletion of this AdbMessageProcessor instance and free resources (most
+  // importantly, the listen port and the session). The standing connection
+  // that adbd opened can then proceed and wait for the host to be up again.
+  state_ = closed_by_host;
+  messenger_->close();
 }
 
 void AdbMessageProcessor::on_host_read_size(const boost::system::error_code &error, std::size_t bytes_read) {
@@ -167,26 +280,161 @@ void AdbMessageProcessor::on_host_read_size(const boost::system::error_code &err
     if (error == boost::system::errc::operation_canceled)
       return;
 
-    // For other errors, we assume the connection with the host is dropped. We
-    // close the connection to the container's adbd, which will trigger the
-    // deletion of this AdbMessageProcessor instance and free resources (most
-    // importantly, default_host_listen_port and the lock). The standing
-    // connection that adbd opened can then proceed and wait for the host to be
-    // up again.
-    state_ = closed_by_host;
-    messenger_->close();
+    on_host_error(error);
+    return;
+  }
+
+  to_guest_offset_ = 0;
+  to_guest_size_ = bytes_read;
+  send_to_guest();
+}
+
+void AdbMessageProcessor::on_host_readable(const boost::system::error_code &error) {
+  if (error) {
+    // See on_host_read_size()
+    if (error == boost::system::errc::operation_canceled)
+      return;
+
+    on_host_error(error);
     return;
   }
 
-  messenger_->send(reinterpret_cast<const char *>(host_buffer_.data()), bytes_read);
+  const auto bytes = ::splice(host_socket_->native_handle(), nullptr, relay_pipe_write_, nullptr,
+                              relay_buffer_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (bytes < 0 && (errno == EAGAIN || errno == EINTR)) {
+    read_next_host_message();
+    return;
+  } else if (bytes < 0 && errno == EINVAL) {
+    WARNING("Sockets can't be spliced, copying proxied data");
+    relay_pipe_read_ = Fd{};
+    relay_pipe_write_ = Fd{};
+    read_next_host_message();
+    return;
+  } else if (bytes <= 0) {
+    on_host_error(bytes == 0 ? boost::asio::error::eof
+                             : boost::system::error_code(errno, boost::system::system_category()));
+    return;
+  }
+
+  to_guest_size_ = bytes;
+  send_to_guest();
+}
+
+void AdbMessageProcessor::send_to_guest() {
+  while (to_guest_size_ > 0) {
+    ssize_t n = 0;
+    if (relay_pipe_read_ != Fd::invalid)
+      n = ::splice(relay_pipe_read_, nullptr, messenger_->native_handle(), nullptr, to_guest_size_,
+                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    else
+      n = messenger_->send_raw(reinterpret_cast<const char*>(host_buffer_.get()) + to_guest_offset_,
+                               to_guest_size_);
+
+    if (n > 0) {
+      to_guest_offset_ += n;
+      to_guest_size_ -= n;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && errno == EAGAIN) {
+      // Reading more from the host has to wait until the guest caught up
+      messenger_->async_wait_writable(std::bind(&AdbMessageProcessor::on_guest_writable, this, _1));
+      return;
+    } else {
+      messenger_->close();
+      return;
+    }
+  }
+
   read_next_host_message();
 }
 
+void AdbMessageProcessor::on_guest_writable(const boost::system::error_code &error) {
+  if (error) {
+    // See on_host_read_size()
+    if (error != boost::system::errc::operation_canceled)
+      messenger_->close();
+    return;
+  }
+
+  send_to_guest();
+}
+
+bool AdbMessageProcessor::send_to_host() {
+  while (to_host_size_ > 0) {
+    const auto n = host_messenger_->send_raw(
+        reinterpret_cast<const char*>(guest_buffer_.get()) + to_host_offset_, to_host_size_);
+    if (n > 0) {
+      to_host_offset_ += n;
+      to_host_size_ -= n;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && errno == EAGAIN) {
+      // The rest goes out once the host socket is writable again, see
+      // defer_read()
+      return true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AdbMessageProcessor::on_host_writable(const boost::system::error_code &error) {
+  if (error == boost::system::errc::operation_canceled)
+    return;
+
+  if (error) {
+    on_host_error(error);
+  } else if (!send_to_host()) {
+    messenger_->close();
+  } else if (to_host_size_ > 0) {
+    host_messenger_->async_wait_writable(std::bind(&AdbMessageProcessor::on_host_writable, this, _1));
+    return;
+  }
+
+  // The connection to the guest continues reading, which also lets it
+  // notice when we closed it.
+  auto resume = std::move(resume_guest_reads_);
+  resume_guest_reads_ = nullptr;
+  resume();
+}
+
+bool AdbMessageProcessor::defer_read(const std::function<void()> &resume) {
+  if (to_host_size_ == 0)
+    return false;
+
+  resume_guest_reads_ = resume;
+  host_messenger_->async_wait_writable(std::bind(&AdbMessageProcessor::on_host_writable, this, _1));
+  return true;
+}
+
+std::uint8_t *AdbMessageProcessor::prepare_data(std::size_t *size) {
+  // Commands are parsed by process_data(), only the proxied stream is
+  // received straight into the relay buffer.
+  if (state_ != proxying_data)
+    return nullptr;
+
+  if (!guest_buffer_)
+    guest_buffer_ = acquire_relay_buffer();
+
+  *size = relay_buffer_size;
+  return guest_buffer_.get();
+}
+
+bool AdbMessageProcessor::commit_data(std::size_t size) {
+  to_host_offset_ = 0;
+  to_host_size_ = size;
+  return send_to_host();
+}
+
 bool AdbMessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
   if (state_ == proxying_data) {
-    host_messenger_->send(reinterpret_cast<const char *>(data.data()),
-                          data.size());
-    return true;
+    std::size_t size = 0;
+    auto dst = prepare_data(&size);
+    if (data.size() > size)
+      return false;
+    std::copy(data.begin(), data.end(), dst);
+    return commit_data(data.size());
   }
 
   for (const auto &byte : data) buffer_.push_back(byte);
@@ -18,6 +18,7 @@
 #ifndef ANBOX_QEMU_ADBD_MESSAGE_PROCESSOR_H_
 #define ANBOX_QEMU_ADBD_MESSAGE_PROCESSOR_H_
 
+#include "anbox/common/fd.h"
 #include "anbox/network/message_processor.h"
 #include "anbox/network/socket_connection.h"
 #include "anbox/network/socket_messenger.h"
@@ -27,18 +28,41 @@
 
 #include <boost/asio.hpp>
 
-#include <mutex>
+#include <atomic>
+#include <functional>
+#include <memory>
 
 namespace anbox {
 namespace qemu {
 class AdbMessageProcessor : public network::MessageProcessor {
  public:
+  struct Config {
+    // Number of adb host connections proxied at the same time. Each one
+    // listens on its own port so the adb server sees a device per session.
+    unsigned int max_sessions;
+    // Move data from the adb host to the container with splice() instead
+    // of copying it through user space.
+    bool zero_copy;
+    // Port the first session listens on, further ones take the next odd
+    // ports as the adb server expects.
+    unsigned short listen_port;
+  };
+
+  static const Config default_config;
+
   AdbMessageProcessor(
       const std::shared_ptr<Runtime> &rt,
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      const Config &config = default_config);
   ~AdbMessageProcessor();
 
   bool process_data(const std::vector<std::uint8_t> &data) override;
+  std::uint8_t *prepare_data(std::size_t *size) override;
+  bool commit_data(std::size_t size) override;
+  bool defer_read(const std::function<void()> &resume) override;
+
+  // Port the adb host has to connect to, zero until the session started
+  unsigned short listen_port() const { return listen_port_; }
 
  private:
   enum State {
@@ -58,18 +82,39 @@ class AdbMessageProcessor : public network::MessageProcessor {
   void read_next_host_message();
   void on_host_read_size(const boost::system::error_code &error,
                          std::size_t bytes_read);
+  void on_host_readable(const boost::system::error_code &error);
+  void on_host_error(const boost::system::error_code &error);
+  bool setup_relay_pipe();
+  void send_to_guest();
+  void on_guest_writable(const boost::system::error_code &error);
+  bool send_to_host();
+  void on_host_writable(const boost::system::error_code &error);
 
   std::shared_ptr<Runtime> runtime_;
+  Config config_;
   State state_ = waiting_for_guest_accept_command;
   std::string expected_command_;
   std::shared_ptr<network::SocketMessenger> const messenger_;
   std::vector<std::uint8_t> buffer_;
   std::shared_ptr<network::TcpSocketConnector> host_connector_;
+  std::shared_ptr<boost::asio::basic_stream_socket<boost::asio::ip::tcp>> host_socket_;
   std::shared_ptr<network::TcpSocketMessenger> host_messenger_;
-  std::array<std::uint8_t, 8192> host_buffer_;
-  std::unique_lock<std::mutex> lock_;
-
-  static std::mutex active_instance_;
+  // Relay buffers are taken from a pool shared by all sessions as adbd
+  // reconnects for every new adb host connection.
+  std::unique_ptr<std::uint8_t[]> host_buffer_;
+  std::unique_ptr<std::uint8_t[]> guest_buffer_;
+  Fd relay_pipe_read_;
+  Fd relay_pipe_write_;
+  // Data one side sent which the other one didn't take yet. Data for the
+  // guest waits in |host_buffer_| or the relay pipe, data for the host in
+  // |guest_buffer_|. Neither side is read from until it went out.
+  std::size_t to_guest_offset_ = 0;
+  std::size_t to_guest_size_ = 0;
+  std::size_t to_host_offset_ = 0;
+  std::size_t to_host_size_ = 0;
+  std::function<void()> resume_guest_reads_;
+  int session_ = -1;
+  std::atomic<unsigned short> listen_port_{0};
 };
 }  // namespace graphics
 }  // namespace anbox
@@ -15,6 +15,8 @@
  *
  */
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 
 #include "anbox/graphics/opengles_message_processor.h"
@@ -30,10 +32,21 @@
 #include "anbox/qemu/null_message_processor.h"
 #include "anbox/qemu/pipe_connection_creator.h"
 #include "anbox/qemu/sensors_message_processor.h"
+#include "anbox/stats/registry.h"
 
 namespace ba = boost::asio;
 
 namespace {
+constexpr const std::size_t max_identifier_size{256};
+
+anbox::stats::Histogram &setup_duration_metric() {
+  static auto &histogram = anbox::stats::Registry::instance().histogram(
+      "anbox_pipe_setup_duration_us",
+      "Time from accepting a pipe connection until its processor was ready",
+      anbox::stats::Histogram::exponential_bounds(10, 14));
+  return histogram;
+}
+
 std::string client_type_to_string(
     const anbox::qemu::PipeConnectionCreator::client_type &type) {
   switch (type) {
@@ -65,9 +78,11 @@ std::string client_type_to_string(
 }
 namespace anbox {
 namespace qemu {
-PipeConnectionCreator::PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt)
+PipeConnectionCreator::PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt,
+                                             const AdbMessageProcessor::Config &adb_config)
     : renderer_(renderer),
       runtime_(rt),
+      adb_config_(adb_config),
       next_connection_id_(0),
       connections_(
           std::make_shared<network::Connections<network::SocketConnection>>()) {
@@ -80,34 +95,127 @@ PipeConnectionCreator::~PipeConnectionCreator() noexcept {
 void PipeConnectionCreator::create_connection_for(
     std::shared_ptr<boost::asio::local::stream_protocol::socket> const
         &socket) {
-  auto const messenger = std::make_shared<network::LocalSocketMessenger>(socket);
-  const auto type = identify_client(messenger);
-  auto const processor = create_processor(type, messenger);
-  if (!processor)
-    BOOST_THROW_EXCEPTION(std::runtime_error("Unhandled client type"));
+  auto handshake = std::make_shared<Handshake>();
+  handshake->messenger = std::make_shared<network::LocalSocketMessenger>(socket);
+  handshake->started_at = std::chrono::steady_clock::now();
+  // Identifying the client must not block the thread accepting connections
+  // as the guest may be slow to send its identifier. We collect it
+  // asynchronously and only create the processor once it is complete.
+  read_handshake(handshake);
+}
 
-  auto const &connection = std::make_shared<network::SocketConnection>(
-      messenger, messenger, next_id(), connections_, processor);
-  connection->set_name(client_type_to_string(type));
-  connections_->add(connection);
-  connection->read_next_message();
+void PipeConnectionCreator::read_handshake(
+    const std::shared_ptr<Handshake> &handshake) {
+  handshake->messenger->async_receive_msg(
+      [this, handshake](const boost::system::error_code &error,
+                        std::size_t bytes_read) {
+        on_handshake_data(handshake, error, bytes_read);
+      },
+      ba::buffer(handshake->read_buffer));
 }
 
-PipeConnectionCreator::client_type PipeConnectionCreator::identify_client(
-    std::shared_ptr<network::SocketMessenger> const &messenger) {
+void PipeConnectionCreator::on_handshake_data(
+    const std::shared_ptr<Handshake> &handshake,
+    const boost::system::error_code &error, std::size_t bytes_read) {
+  if (error) {
+    if (error != ba::error::operation_aborted && error != ba::error::eof)
+      ERROR("Failed to read pipe identifier: %s", error.message());
+    return;
+  }
+
+  auto &data = handshake->data;
+  data.insert(data.end(), handshake->read_buffer.begin(),
+              handshake->read_buffer.begin() + bytes_read);
+
   // The client will identify itself as first thing by writing a string
   // in the format 'pipe:<name>[:<arguments>]\0' to the channel.
-  std::vector<char> buffer;
-  for (;;) {
-    unsigned char byte[1] = {0};
-    const auto err = messenger->receive_msg(ba::buffer(byte, 1));
-    if (err) return client_type::invalid;
-    buffer.push_back(byte[0]);
-    if (byte[0] == 0x0) break;
+  const auto end = std::find(data.begin(), data.end(), 0);
+  if (end == data.end()) {
+    if (data.size() >= max_identifier_size) {
+      ERROR("Pipe identifier exceeds %d bytes, dropping connection",
+            max_identifier_size);
+      handshake->messenger->close();
+      return;
+    }
+    read_handshake(handshake);
+    return;
   }
 
-  std::string identifier_and_args = buffer.data();
+  const auto identifier_size =
+      static_cast<std::size_t>(std::distance(data.begin(), end)) + 1;
+  handshake->type = identify_client(std::string(data.begin(), end));
+
+  // The OpenGL ES client sends its flags right after the identifier and
+  // we need them before we can process any command.
+  if (handshake->type == client_type::opengles &&
+      data.size() < identifier_size + sizeof(unsigned int)) {
+    read_handshake(handshake);
+    return;
+  }
 
+  finish_handshake(handshake);
+}
+
+void PipeConnectionCreator::finish_handshake(
+    const std::shared_ptr<Handshake> &handshake) {
+  auto &data = handshake->data;
+  auto offset = static_cast<std::size_t>(
+      std::distance(data.begin(), std::find(data.begin(), data.end(), 0)) + 1);
+
+  unsigned int client_flags = 0;
+  if (handshake->type == client_type::opengles) {
+    std::memcpy(&client_flags, data.data() + offset, sizeof(client_flags));
+    offset += sizeof(client_flags);
+  }
+
+  auto const &messenger = handshake->messenger;
+  auto const processor = create_processor(handshake->type, messenger, client_flags);
+  if (!processor) {
+    ERROR("Unhandled client type");
+    messenger->close();
+    return;
+  }
+
+  auto const &connection = std::make_shared<network::SocketConnection>(
+      messenger, messenger, next_id(), connections_, processor);
+  connection->set_name(client_type_to_string(handshake->type));
+  connections_->add(connection);
+
+  const auto setup_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - handshake->started_at).count();
+  {
+    std::lock_guard<std::mutex> l(stats_lock_);
+    setup_stats_.connections++;
+    setup_stats_.total_us += setup_time;
+    setup_stats_.max_us = std::max<std::uint64_t>(setup_stats_.max_us, setup_time);
+  }
+  auto &registry = stats::Registry::instance();
+  registry.counter("anbox_pipe_connections_total", "Pipe connections set up",
+                   {{"client", client_type_to_string(handshake->type)}}).add();
+  setup_duration_metric().observe(setup_time);
+  DEBUG("Set up %s pipe connection in %d us",
+        client_type_to_string(handshake->type), setup_time);
+
+  // Anything the client sent along with its identifier already belongs
+  // to the processor.
+  if (offset < data.size()) {
+    std::vector<std::uint8_t> remaining(data.begin() + offset, data.end());
+    if (!processor->process_data(remaining)) {
+      connections_->remove(connection->id());
+      return;
+    }
+  }
+
+  connection->read_next_message();
+}
+
+PipeConnectionCreator::SetupStats PipeConnectionCreator::setup_stats() const {
+  std::lock_guard<std::mutex> l(stats_lock_);
+  return setup_stats_;
+}
+
+PipeConnectionCreator::client_type PipeConnectionCreator::identify_client(
+    const std::string &identifier_and_args) {
   if (utils::string_starts_with(identifier_and_args, "pipe:opengles"))
     return client_type::opengles;
   // Even if 'boot-properties' is an argument to the service 'qemud' here we
@@ -139,9 +247,11 @@ PipeConnectionCreator::client_type PipeConnectionCreator::identify_client(
 std::shared_ptr<network::MessageProcessor>
 PipeConnectionCreator::create_processor(
     const client_type &type,
-    const std::shared_ptr<network::SocketMessenger> &messenger) {
+    const std::shared_ptr<network::SocketMessenger> &messenger,
+    unsigned int client_flags) {
   if (type == client_type::opengles)
-    return std::make_shared<graphics::OpenGlesMessageProcessor>(renderer_, messenger);
+    return std::make_shared<graphics::OpenGlesMessageProcessor>(renderer_, messenger,
+                                                                client_flags);
   else if (type == client_type::qemud_boot_properties)
     return std::make_shared<qemu::BootPropertiesMessageProcessor>(messenger);
   else if (type == client_type::qemud_hw_control)
@@ -155,7 +265,8 @@ PipeConnectionCreator::create_processor(
   else if (type == client_type::qemud_gsm)
     return std::make_shared<qemu::GsmMessageProcessor>(messenger);
   else if (type == client_type::qemud_adb)
-    return std::make_shared<qemu::AdbMessageProcessor>(runtime_, messenger);
+    return std::make_shared<qemu::AdbMessageProcessor>(
+        runtime_->executor(Runtime::Subsystem::Adb), messenger, adb_config_);
 
   return std::make_shared<qemu::NullMessageProcessor>();
 }
@@ -20,13 +20,20 @@
 
 #include <boost/asio.hpp>
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "anbox/do_not_copy_or_move.h"
 #include "anbox/network/connection_creator.h"
 #include "anbox/network/connections.h"
 #include "anbox/network/socket_connection.h"
 #include "anbox/network/socket_messenger.h"
+#include "anbox/qemu/adb_message_processor.h"
 #include "anbox/runtime.h"
 
 class Renderer;
@@ -36,13 +43,23 @@ namespace qemu {
 class PipeConnectionCreator
     : public network::ConnectionCreator<boost::asio::local::stream_protocol> {
  public:
-  PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt);
+  PipeConnectionCreator(const std::shared_ptr<Renderer> &renderer, const std::shared_ptr<Runtime> &rt,
+                        const AdbMessageProcessor::Config &adb_config = AdbMessageProcessor::default_config);
   ~PipeConnectionCreator() noexcept;
 
   void create_connection_for(
       std::shared_ptr<boost::asio::basic_stream_socket<
           boost::asio::local::stream_protocol>> const &socket) override;
 
+  // Time it took from accepting a pipe connection until its processor
+  // was ready to handle data.
+  struct SetupStats {
+    std::uint64_t connections;
+    std::uint64_t total_us;
+    std::uint64_t max_us;
+  };
+  SetupStats setup_stats() const;
+
   enum class client_type {
     invalid,
     opengles,
@@ -56,19 +73,37 @@ class PipeConnectionCreator
     bootanimation,
   };
 
+  // Maps the 'pipe:<name>[:<arguments>]' identifier a client sends first
+  static client_type identify_client(const std::string &identifier_and_args);
+
  private:
+  struct Handshake {
+    std::shared_ptr<network::SocketMessenger> messenger;
+    std::chrono::steady_clock::time_point started_at;
+    std::vector<std::uint8_t> data;
+    std::array<std::uint8_t, 256> read_buffer;
+    client_type type = client_type::invalid;
+  };
+
   int next_id();
 
-  client_type identify_client(
-      std::shared_ptr<network::SocketMessenger> const &messenger);
+  void read_handshake(const std::shared_ptr<Handshake> &handshake);
+  void on_handshake_data(const std::shared_ptr<Handshake> &handshake,
+                         const boost::system::error_code &error,
+                         std::size_t bytes_read);
+  void finish_handshake(const std::shared_ptr<Handshake> &handshake);
   std::shared_ptr<network::MessageProcessor> create_processor(
       const client_type &type,
-      const std::shared_ptr<network::SocketMessenger> &messenger);
+      const std::shared_ptr<network::SocketMessenger> &messenger,
+      unsigned int client_flags);
 
   std::shared_ptr<Renderer> renderer_;
   std::shared_ptr<Runtime> runtime_;
+  AdbMessageProcessor::Config adb_config_;
   std::atomic<int> next_connection_id_;
   std::shared_ptr<network::Connections<network::SocketConnection>> const connections_;
+  mutable std::mutex stats_lock_;
+  SetupStats setup_stats_{0, 0, 0};
 };
 }  // namespace qemu
 }  // namespace anbox
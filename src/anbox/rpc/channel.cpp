@@ -21,6 +21,7 @@
 #include "anbox/common/variable_length_array.h"
 #include "anbox/network/message_sender.h"
 #include "anbox/rpc/constants.h"
+#include "anbox/rpc/metrics.h"
 #include "anbox/rpc/pending_call_cache.h"
 
 #include "anbox_rpc.pb.h"
@@ -73,25 +74,31 @@ protobuf::rpc::Invocation Channel::invocation_for(
 void Channel::send_message(const std::uint8_t &type,
                            google::protobuf::MessageLite const &message) {
   const size_t size = message.ByteSize();
-  const unsigned char header_bytes[header_size] = {
+  unsigned char header_bytes[header_size] = {
       static_cast<unsigned char>((size >>16) & 0xff),
       static_cast<unsigned char>((size >> 8) & 0xff),
       static_cast<unsigned char>((size >> 0) & 0xff), type,
   };
 
-  std::vector<std::uint8_t> send_buffer(sizeof(header_bytes) + size);
-  std::copy(header_bytes, header_bytes + sizeof(header_bytes),
-            send_buffer.begin());
-  message.SerializeToArray(send_buffer.data() + sizeof(header_bytes), size);
+  VariableLengthArray<2048> send_buffer{size};
+  message.SerializeWithCachedSizesToArray(send_buffer.data());
+
+  struct iovec iov[] = {
+      {header_bytes, sizeof(header_bytes)},
+      {send_buffer.data(), send_buffer.size()},
+  };
 
   try {
     std::lock_guard<std::mutex> lock(write_mutex_);
-    sender_->send(reinterpret_cast<const char *>(send_buffer.data()),
-                  send_buffer.size());
+    sender_->send_gathered(iov, 2);
   } catch (std::runtime_error const &) {
     notify_disconnected();
     throw;
   }
+
+  auto &m = metrics();
+  m.sent_messages.add();
+  m.sent_bytes.add(sizeof(header_bytes) + size);
 }
 
 void Channel::notify_disconnected() { pending_calls_->force_completion(); }
@@ -19,10 +19,22 @@
 #include "anbox/common/variable_length_array.h"
 #include "anbox/rpc/constants.h"
 #include "anbox/rpc/make_protobuf_object.h"
+#include "anbox/rpc/metrics.h"
 #include "anbox/rpc/template_message_processor.h"
 
 #include "anbox_rpc.pb.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+constexpr const std::size_t initial_buffer_size{64 * 1024};
+constexpr const std::size_t max_idle_buffer_size{1024 * 1024};
+// Smallest space we hand out for the next socket read to land in
+constexpr const std::size_t min_read_size{4096};
+}  // namespace
+
 namespace anbox {
 namespace rpc {
 const ::std::string &Invocation::method_name() const {
@@ -38,52 +50,104 @@ google::protobuf::uint32 Invocation::id() const { return invocation_.id(); }
 MessageProcessor::MessageProcessor(
     const std::shared_ptr<network::MessageSender> &sender,
     const std::shared_ptr<PendingCallCache> &pending_calls)
-    : sender_(sender), pending_calls_(pending_calls) {}
+    : sender_(sender), pending_calls_(pending_calls), buffer_(initial_buffer_size) {}
 
 MessageProcessor::~MessageProcessor() {}
 
 bool MessageProcessor::process_data(const std::vector<std::uint8_t> &data) {
-  for (const auto &byte : data) buffer_.push_back(byte);
-
-  while (buffer_.size() > 0) {
-    const auto high = buffer_[0];
-    const auto medium = buffer_[1];
-    const auto low = buffer_[2];
-    size_t const message_size = (high << 16) + (medium << 8) + low;
-    const auto message_type = buffer_[3];
-
-    // If we don't have yet all bytes for a new message return and wait
-    // until we have all.
-    if (buffer_.size() < (message_size + header_size)) break;
-
-    if (message_type == MessageType::invocation) {
-      anbox::protobuf::rpc::Invocation raw_invocation;
-      raw_invocation.ParseFromArray(buffer_.data() + header_size, message_size);
-
-      dispatch(Invocation(raw_invocation));
-    } else if (message_type == MessageType::response) {
-      auto result = make_protobuf_object<protobuf::rpc::Result>();
-      result->ParseFromArray(buffer_.data() + header_size, message_size);
-
-      if (result->has_id()) {
-        pending_calls_->populate_message_for_result(*result,
-                                                    [&](google::protobuf::MessageLite *result_message) {
-                                                      result_message->ParseFromString(result->response());
-                                                    });
-        pending_calls_->complete_response(*result);
-      }
-
-      for (int n = 0; n < result->events_size(); n++)
-        process_event_sequence(result->events(n));
+  reserve(data.size());
+  std::memcpy(buffer_.data() + write_pos_, data.data(), data.size());
+  write_pos_ += data.size();
+  return process_buffered_messages();
+}
+
+std::uint8_t *MessageProcessor::prepare_data(std::size_t *size) {
+  reserve(min_read_size);
+  *size = buffer_.size() - write_pos_;
+  return buffer_.data() + write_pos_;
+}
+
+bool MessageProcessor::commit_data(std::size_t size) {
+  write_pos_ += size;
+  return process_buffered_messages();
+}
+
+void MessageProcessor::reserve(std::size_t size) {
+  if (buffer_.size() - write_pos_ >= size)
+    return;
+
+  // Complete messages are always processed right away so all which can be
+  // left here is the start of a single message we didn't fully receive yet.
+  const auto pending = write_pos_ - read_pos_;
+  if (read_pos_ > 0) {
+    std::memmove(buffer_.data(), buffer_.data() + read_pos_, pending);
+    read_pos_ = 0;
+    write_pos_ = pending;
+  }
+
+  if (buffer_.size() - write_pos_ < size)
+    buffer_.resize(std::max({buffer_.size() * 2, pending + size, initial_buffer_size}));
+}
+
+bool MessageProcessor::process_buffered_messages() {
+  const auto header_length = static_cast<std::size_t>(header_size);
+  while (write_pos_ - read_pos_ >= header_length) {
+    const auto header = buffer_.data() + read_pos_;
+    const std::size_t message_size = (header[0] << 16) + (header[1] << 8) + header[2];
+    const auto message_type = header[3];
+
+    // If we don't have yet all bytes for a new message make sure it will
+    // fit and wait until we have all.
+    const auto available = write_pos_ - read_pos_;
+    if (available < header_length + message_size) {
+      reserve(header_length + message_size - available);
+      break;
     }
 
-    buffer_.erase(buffer_.begin(),
-                  buffer_.begin() + header_size + message_size);
+    auto &m = metrics();
+    const auto start = std::chrono::steady_clock::now();
+    process_message(message_type, header + header_length, message_size);
+    m.process_us.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    m.received_messages.add();
+    m.received_bytes.add(header_length + message_size);
+
+    read_pos_ += header_length + message_size;
+  }
+
+  if (read_pos_ == write_pos_) {
+    read_pos_ = write_pos_ = 0;
+    // Don't hold on to the memory a burst of large messages needed
+    if (buffer_.size() > max_idle_buffer_size)
+      std::vector<std::uint8_t>(initial_buffer_size).swap(buffer_);
   }
 
   return true;
 }
 
+void MessageProcessor::process_message(std::uint8_t type, const std::uint8_t *data, std::size_t size) {
+  if (type == MessageType::invocation) {
+    anbox::protobuf::rpc::Invocation raw_invocation;
+    raw_invocation.ParseFromArray(data, static_cast<int>(size));
+
+    dispatch(Invocation(raw_invocation));
+  } else if (type == MessageType::response) {
+    auto result = make_protobuf_object<protobuf::rpc::Result>();
+    result->ParseFromArray(data, static_cast<int>(size));
+
+    if (result->has_id()) {
+      pending_calls_->populate_message_for_result(*result,
+                                                  [&](google::protobuf::MessageLite *result_message) {
+                                                    result_message->ParseFromString(result->response());
+                                                  });
+      pending_calls_->complete_response(*result);
+    }
+
+    for (int n = 0; n < result->events_size(); n++)
+      process_event_sequence(result->events(n));
+  }
+}
+
 void MessageProcessor::send_response(::google::protobuf::uint32 id,
                                      google::protobuf::MessageLite *response) {
   VariableLengthArray<serialization_buffer_size> send_response_buffer(
@@ -101,21 +165,23 @@ void MessageProcessor::send_response(::google::protobuf::uint32 id,
       send_response_buffer.data());
 
   const size_t size = send_response_buffer.size();
-  const unsigned char header_bytes[header_size] = {
+  unsigned char header_bytes[header_size] = {
       static_cast<unsigned char>((size >> 16) & 0xff),
       static_cast<unsigned char>((size >> 8) & 0xff),
       static_cast<unsigned char>((size >> 0) & 0xff), MessageType::response,
   };
 
-  std::vector<std::uint8_t> send_buffer(sizeof(header_bytes) + size);
-  std::copy(header_bytes, header_bytes + sizeof(header_bytes),
-            send_buffer.begin());
-  std::copy(send_response_buffer.data(),
-            send_response_buffer.data() + send_response_buffer.size(),
-            send_buffer.begin() + sizeof(header_bytes));
+  // The header goes out together with the response without copying both
+  // into another buffer first.
+  struct iovec iov[] = {
+      {header_bytes, sizeof(header_bytes)},
+      {send_response_buffer.data(), send_response_buffer.size()},
+  };
+  sender_->send_gathered(iov, 2);
 
-  sender_->send(reinterpret_cast<const char *>(send_buffer.data()),
-                send_buffer.size());
+  auto &m = metrics();
+  m.sent_messages.add();
+  m.sent_bytes.add(sizeof(header_bytes) + size);
 }
 }  // namespace anbox
 }  // namespace network
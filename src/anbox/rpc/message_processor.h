@@ -54,6 +54,8 @@ class MessageProcessor : public network::MessageProcessor {
   ~MessageProcessor();
 
   bool process_data(const std::vector<std::uint8_t>& data) override;
+  std::uint8_t* prepare_data(std::size_t* size) override;
+  bool commit_data(std::size_t size) override;
 
   void send_response(::google::protobuf::uint32 id,
                      google::protobuf::MessageLite* response);
@@ -62,9 +64,18 @@ class MessageProcessor : public network::MessageProcessor {
   virtual void process_event_sequence(const std::string&) {}
 
  private:
+  void reserve(std::size_t size);
+  bool process_buffered_messages();
+  void process_message(std::uint8_t type, const std::uint8_t* data, std::size_t size);
+
   std::shared_ptr<network::MessageSender> sender_;
-  std::vector<std::uint8_t> buffer_;
   std::shared_ptr<PendingCallCache> pending_calls_;
+  // Incoming data is appended at |write_pos_| and messages are parsed in
+  // place starting at |read_pos_|. Both go back to the start once all
+  // buffered data was processed.
+  std::vector<std::uint8_t> buffer_;
+  std::size_t read_pos_ = 0;
+  std::size_t write_pos_ = 0;
 };
 }  // namespace rpc
 }  // namespace anbox
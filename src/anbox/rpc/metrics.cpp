@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/rpc/metrics.h"
+
+namespace anbox {
+namespace rpc {
+Metrics &metrics() {
+  auto &registry = stats::Registry::instance();
+  static Metrics m{
+      registry.counter("anbox_rpc_messages_total", "Rpc messages", {{"direction", "sent"}}),
+      registry.counter("anbox_rpc_bytes_total", "Rpc bytes including headers", {{"direction", "sent"}}),
+      registry.counter("anbox_rpc_messages_total", "Rpc messages", {{"direction", "received"}}),
+      registry.counter("anbox_rpc_bytes_total", "Rpc bytes including headers", {{"direction", "received"}}),
+      registry.histogram("anbox_rpc_process_duration_us", "Time to process a received rpc message",
+                         stats::Histogram::exponential_bounds(10, 14)),
+  };
+  return m;
+}
+}  // namespace rpc
+}  // namespace anbox
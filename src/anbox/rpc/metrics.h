@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_RPC_METRICS_H_
+#define ANBOX_RPC_METRICS_H_
+
+#include "anbox/stats/registry.h"
+
+namespace anbox {
+namespace rpc {
+// Statistics shared by all rpc channels and message processors
+struct Metrics {
+  stats::Counter &sent_messages;
+  stats::Counter &sent_bytes;
+  stats::Counter &received_messages;
+  stats::Counter &received_bytes;
+  // Time taken to process a single received message
+  stats::Histogram &process_us;
+};
+
+Metrics &metrics();
+}  // namespace rpc
+}  // namespace anbox
+
+#endif
@@ -15,10 +15,20 @@
  *
  */
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+
+#include <boost/throw_exception.hpp>
+
+#include <pthread.h>
+#include <sched.h>
 
 #include "anbox/logger.h"
 #include "anbox/runtime.h"
+#include "anbox/stats/registry.h"
+#include "anbox/utils.h"
 
 namespace {
 // exception_safe_run runs service, catching all exceptions and
@@ -44,15 +54,109 @@ void exception_safe_run(boost::asio::io_service& service) {
     }
   }
 }
+
+// How often we measure how long a handler has to wait before it runs
+// when nothing else is posted through Runtime::post.
+constexpr const std::chrono::seconds probe_interval{1};
+
+const std::map<std::string, anbox::Runtime::Subsystem> subsystem_names{
+    {"input", anbox::Runtime::Subsystem::Input},
+    {"audio", anbox::Runtime::Subsystem::Audio},
+    {"qemu", anbox::Runtime::Subsystem::Qemu},
+    {"adb", anbox::Runtime::Subsystem::Adb},
+    {"bridge", anbox::Runtime::Subsystem::Bridge},
+    {"container", anbox::Runtime::Subsystem::Container},
+};
+
+std::string subsystem_to_string(anbox::Runtime::Subsystem subsystem) {
+  for (const auto &entry : subsystem_names)
+    if (entry.second == subsystem)
+      return entry.first;
+  return "unknown";
+}
+
+int parse_number(const std::string &value, const std::string &entry) {
+  try {
+    std::size_t end = 0;
+    const auto number = std::stoi(value, &end);
+    if (end == value.size() && number >= 0)
+      return number;
+  } catch (const std::exception &) {
+  }
+  BOOST_THROW_EXCEPTION(std::runtime_error("Invalid runtime executor configuration '" + entry + "'"));
+}
+
+// parse_cpu only accepts CPUs we can actually pin threads to. Inside a
+// container or under taskset that is our affinity mask rather than all
+// online CPUs, and anything beyond CPU_SETSIZE would overflow the
+// cpu_set_t in Runtime::start.
+int parse_cpu(const std::string &value, const std::string &entry) {
+  const auto cpu = parse_number(value, entry);
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (cpu >= CPU_SETSIZE ||
+      (::sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && !CPU_ISSET(cpu, &allowed)))
+    BOOST_THROW_EXCEPTION(std::runtime_error("Runtime executor '" + entry + "' uses unavailable CPU " + value));
+  return cpu;
+}
 }
 namespace anbox {
+Runtime::Config Runtime::parse_config(const std::string &spec) {
+  Config config{{worker_threads, {}}, {}};
+  if (spec.empty())
+    return config;
+
+  for (const auto &entry : utils::string_split(spec, ',')) {
+    const auto name_and_value = utils::string_split(entry, '=');
+    if (name_and_value.size() != 2)
+      BOOST_THROW_EXCEPTION(std::runtime_error("Invalid runtime executor configuration '" + entry + "'"));
+
+    const auto threads_and_cpus = utils::string_split(name_and_value[1], '@');
+    if (threads_and_cpus.empty() || threads_and_cpus.size() > 2)
+      BOOST_THROW_EXCEPTION(std::runtime_error("Invalid runtime executor configuration '" + entry + "'"));
+
+    ExecutorConfig executor{static_cast<std::uint32_t>(parse_number(threads_and_cpus[0], entry)), {}};
+    if (executor.threads == 0)
+      BOOST_THROW_EXCEPTION(std::runtime_error("Runtime executor '" + entry + "' needs at least one thread"));
+
+    if (threads_and_cpus.size() == 2) {
+      for (const auto &cpu : utils::string_split(threads_and_cpus[1], '+'))
+        executor.cpus.push_back(parse_cpu(cpu, entry));
+    }
+
+    if (name_and_value[0] == "default") {
+      config.default_executor = executor;
+      continue;
+    }
+
+    const auto subsystem = subsystem_names.find(name_and_value[0]);
+    if (subsystem == subsystem_names.end())
+      BOOST_THROW_EXCEPTION(std::runtime_error("Unknown runtime subsystem '" + name_and_value[0] + "'"));
+
+    config.executors[subsystem->second] = executor;
+  }
+
+  return config;
+}
 
 std::shared_ptr<Runtime> Runtime::create(std::uint32_t pool_size) {
-  return std::shared_ptr<Runtime>(new Runtime(pool_size));
+  return std::shared_ptr<Runtime>(new Runtime("default", {pool_size, {}}));
 }
 
-Runtime::Runtime(std::uint32_t pool_size)
-    : pool_size_{pool_size},
+std::shared_ptr<Runtime> Runtime::create(const Config &config) {
+  auto rt = std::shared_ptr<Runtime>(new Runtime("default", config.default_executor));
+  for (const auto &executor : config.executors) {
+    const auto name = subsystem_to_string(executor.first);
+    rt->executors_[executor.first] =
+        std::shared_ptr<Runtime>(new Runtime(name, executor.second));
+  }
+  return rt;
+}
+
+Runtime::Runtime(const std::string &name, const ExecutorConfig &config)
+    : name_{name},
+      pool_size_{config.threads},
+      cpus_{config.cpus},
       
       #if BOOST_VERSION >= 106600
       service_{static_cast<int>(pool_size_)},
@@ -61,7 +165,15 @@ Runtime::Runtime(std::uint32_t pool_size)
       #endif
       
       strand_{service_},
-      keep_alive_{service_} {}
+      keep_alive_{service_},
+      probe_timer_{service_},
+      stats_{name_, pool_size_, 0, 0, 0, 0, 0},
+      queued_metric_{stats::Registry::instance().gauge(
+          "anbox_executor_queued_handlers", "Handlers posted to an executor which didn't run yet",
+          {{"executor", name_}})},
+      latency_metric_{stats::Registry::instance().histogram(
+          "anbox_executor_latency_us", "Time handlers wait before they run",
+          stats::Histogram::exponential_bounds(10, 16), {{"executor", name_}})} {}
 
 Runtime::~Runtime() noexcept(true) {
   try {
@@ -72,11 +184,33 @@ Runtime::~Runtime() noexcept(true) {
 }
 
 void Runtime::start() {
-  for (unsigned int i = 0; i < pool_size_; i++)
+  for (auto &executor : executors_)
+    executor.second->start();
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for (const auto cpu : cpus_)
+    CPU_SET(cpu, &cpus);
+
+  const auto thread_name = utils::string_format("anbox-%s", name_).substr(0, 15);
+  for (unsigned int i = 0; i < pool_size_; i++) {
     workers_.push_back(std::thread{exception_safe_run, std::ref(service_)});
+    auto handle = workers_.back().native_handle();
+    ::pthread_setname_np(handle, thread_name.c_str());
+    if (cpus_.empty())
+      continue;
+    const auto err = ::pthread_setaffinity_np(handle, sizeof(cpus), &cpus);
+    if (err != 0)
+      WARNING("Failed to set CPU affinity of %s executor: %s", name_, std::strerror(err));
+  }
+
+  schedule_probe();
 }
 
 void Runtime::stop() {
+  for (auto &executor : executors_)
+    executor.second->stop();
+
   service_.stop();
 
   for (auto& worker : workers_)
@@ -88,9 +222,75 @@ std::function<void(std::function<void()>)> Runtime::to_dispatcher_functional() {
   // We have to make sure that we stay alive for as long as
   // calling code requires the dispatcher to work.
   auto sp = shared_from_this();
-  return [sp](std::function<void()> task) { sp->strand_.post(task); };
+  return [sp](std::function<void()> task) { sp->strand_.post(sp->track(task)); };
 }
 
 boost::asio::io_service& Runtime::service() { return service_; }
 
+std::shared_ptr<Runtime> Runtime::executor(Subsystem subsystem) {
+  auto it = executors_.find(subsystem);
+  if (it != executors_.end())
+    return it->second;
+  return shared_from_this();
+}
+
+void Runtime::post(std::function<void()> task) {
+  service_.post(track(task));
+}
+
+std::function<void()> Runtime::track(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> l(stats_lock_);
+    stats_.queued++;
+    stats_.max_queued = std::max(stats_.max_queued, stats_.queued);
+  }
+  queued_metric_.add();
+
+  // Handlers only run while our service does so we don't need to keep
+  // ourself alive here.
+  const auto queued_at = std::chrono::steady_clock::now();
+  return [this, task, queued_at]() {
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - queued_at).count();
+    {
+      std::lock_guard<std::mutex> l(stats_lock_);
+      stats_.queued--;
+      stats_.handlers++;
+      stats_.total_latency_us += latency;
+      stats_.max_latency_us = std::max<std::uint64_t>(stats_.max_latency_us, latency);
+    }
+    queued_metric_.sub();
+    latency_metric_.observe(latency);
+    task();
+  };
+}
+
+void Runtime::schedule_probe() {
+  // Handlers of sockets and timers are not visible to us so we regularly
+  // post an empty one to see how long work waits on this executor.
+  std::weak_ptr<Runtime> weak_self = shared_from_this();
+  probe_timer_.expires_from_now(probe_interval);
+  probe_timer_.async_wait([weak_self](const boost::system::error_code &err) {
+    if (err)
+      return;
+    auto self = weak_self.lock();
+    if (!self)
+      return;
+    self->post([]() {});
+    self->schedule_probe();
+  });
+}
+
+Runtime::Stats Runtime::own_stats() const {
+  std::lock_guard<std::mutex> l(stats_lock_);
+  return stats_;
+}
+
+std::vector<Runtime::Stats> Runtime::stats() const {
+  std::vector<Stats> stats{own_stats()};
+  for (const auto &executor : executors_)
+    stats.push_back(executor.second->own_stats());
+  return stats;
+}
+
 }  // namespace anbox
@@ -22,12 +22,21 @@
 #include <boost/version.hpp>
 
 #include <memory.h>
+#include <chrono>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "anbox/do_not_copy_or_move.h"
 
 namespace anbox {
+namespace stats {
+class Gauge;
+class Histogram;
+}  // namespace stats
 
 // We bundle our "global" runtime dependencies here, specifically
 // a dispatcher to decouple multiple in-process providers from one
@@ -38,11 +47,56 @@ class Runtime : public DoNotCopyOrMove,
   // Our default concurrency setup.
   static constexpr const std::uint32_t worker_threads = 8;
 
+  // Subsystems which can be given an executor of their own so that a
+  // burst of work in one of them doesn't delay the handlers of another.
+  enum class Subsystem {
+    Input,
+    Audio,
+    Qemu,
+    Adb,
+    Bridge,
+    Container,
+  };
+
+  struct ExecutorConfig {
+    std::uint32_t threads;
+    // CPUs the worker threads are pinned to, empty to not pin them.
+    std::vector<int> cpus;
+  };
+
+  struct Config {
+    ExecutorConfig default_executor;
+    // Subsystems not listed here run on the default executor.
+    std::map<Subsystem, ExecutorConfig> executors;
+  };
+
+  // parse_config reads a comma separated list of '<name>=<threads>[@<cpu>[+<cpu>...]]'
+  // entries where name is either 'default' or one of the subsystems, e.g.
+  // 'default=4,input=1@2,audio=1@3,adb=2'. Throws on malformed entries and
+  // on CPUs which aren't online.
+  static Config parse_config(const std::string &spec);
+
+  struct Stats {
+    std::string name;
+    std::uint32_t threads;
+    // Handlers submitted through post() which didn't run yet.
+    std::uint64_t queued;
+    std::uint64_t max_queued;
+    // Number of handlers run and the time they waited to be run.
+    std::uint64_t handlers;
+    std::uint64_t total_latency_us;
+    std::uint64_t max_latency_us;
+  };
+
   // create returns a Runtime instance with pool_size worker threads
   // executing the underlying service.
   static std::shared_ptr<Runtime> create(
       std::uint32_t pool_size = worker_threads);
 
+  // create returns a Runtime instance with a separate executor for
+  // each subsystem listed in config.
+  static std::shared_ptr<Runtime> create(const Config &config);
+
   // Tears down the runtime, stopping all worker threads.
   ~Runtime() noexcept(true);
 
@@ -61,16 +115,40 @@ class Runtime : public DoNotCopyOrMove,
   // by the Runtime.
   boost::asio::io_service& service();
 
+  // executor returns the runtime responsible for subsystem. That is this
+  // instance unless the subsystem was given an executor of its own.
+  std::shared_ptr<Runtime> executor(Subsystem subsystem);
+
+  // post queues task for execution and accounts for it in the statistics.
+  void post(std::function<void()> task);
+
+  // stats returns the statistics of this runtime followed by the ones of
+  // all executors created for individual subsystems.
+  std::vector<Stats> stats() const;
+
  private:
   // Runtime constructs a new instance, firing up pool_size
   // worker threads.
-  Runtime(std::uint32_t pool_size);
+  Runtime(const std::string &name, const ExecutorConfig &config);
+
+  std::function<void()> track(std::function<void()> task);
+  void schedule_probe();
+  Stats own_stats() const;
 
+  std::string name_;
   std::uint32_t pool_size_;
+  std::vector<int> cpus_;
   boost::asio::io_service service_;
   boost::asio::io_service::strand strand_;
   boost::asio::io_service::work keep_alive_;
+  boost::asio::steady_timer probe_timer_;
   std::vector<std::thread> workers_;
+  std::map<Subsystem, std::shared_ptr<Runtime>> executors_;
+
+  mutable std::mutex stats_lock_;
+  Stats stats_;
+  stats::Gauge &queued_metric_;
+  stats::Histogram &latency_metric_;
 };
 
 }  // namespace anbox
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/stats/connection_creator.h"
+#include "anbox/stats/registry.h"
+#include "anbox/logger.h"
+
+namespace anbox {
+namespace stats {
+ConnectionCreator::ConnectionCreator(Registry &registry) : registry_(registry) {}
+
+void ConnectionCreator::create_connection_for(
+    std::shared_ptr<boost::asio::basic_stream_socket<
+        boost::asio::local::stream_protocol>> const &socket) {
+  auto dump = std::make_shared<std::string>(registry_.to_prometheus());
+  boost::asio::async_write(
+      *socket, boost::asio::buffer(*dump),
+      [socket, dump](const boost::system::error_code &err, std::size_t) {
+        if (err)
+          DEBUG("Failed to send statistics: %s", err.message());
+        boost::system::error_code ignored;
+        socket->shutdown(boost::asio::socket_base::shutdown_both, ignored);
+        socket->close(ignored);
+      });
+}
+}  // namespace stats
+}  // namespace anbox
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_STATS_CONNECTION_CREATOR_H_
+#define ANBOX_STATS_CONNECTION_CREATOR_H_
+
+#include "anbox/network/connection_creator.h"
+
+#include <boost/asio.hpp>
+
+namespace anbox {
+namespace stats {
+class Registry;
+
+// Answers every new connection with a dump of all metrics in the
+// Prometheus text format and closes it afterwards, e.g.
+//   socat - UNIX-CONNECT:$XDG_RUNTIME_DIR/anbox/sockets/anbox_stats
+class ConnectionCreator
+    : public network::ConnectionCreator<boost::asio::local::stream_protocol> {
+ public:
+  explicit ConnectionCreator(Registry &registry);
+
+  void create_connection_for(
+      std::shared_ptr<boost::asio::basic_stream_socket<
+          boost::asio::local::stream_protocol>> const &socket) override;
+
+ private:
+  Registry &registry_;
+};
+}  // namespace stats
+}  // namespace anbox
+
+#endif
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/stats/registry.h"
+
+// Also built for the Android side so this doesn't depend on boost.
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+std::size_t this_thread_shard() {
+  static std::atomic<std::size_t> next_shard{0};
+  static thread_local const std::size_t shard = next_shard++ % anbox::stats::shard_count;
+  return shard;
+}
+
+std::string escape_label_value(const std::string &value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (const auto c : value) {
+    if (c == '\\' || c == '"')
+      escaped += '\\';
+    if (c == '\n') {
+      escaped += "\\n";
+      continue;
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+// Formats {a="1",b="2"} including the optional extra label used for the
+// histogram buckets. Returns an empty string without any labels.
+std::string format_labels(const anbox::stats::Labels &labels,
+                          const std::string &extra_name = "",
+                          const std::string &extra_value = "") {
+  auto all = labels;
+  if (!extra_name.empty())
+    all.emplace_back(extra_name, extra_value);
+  if (all.empty())
+    return "";
+
+  std::string result = "{";
+  for (const auto &label : all) {
+    if (result.size() > 1)
+      result += ',';
+    result += label.first + "=\"" + escape_label_value(label.second) + "\"";
+  }
+  result += '}';
+  return result;
+}
+}  // namespace
+
+namespace anbox {
+namespace stats {
+void Counter::add(std::uint64_t value) {
+  shards_[this_thread_shard()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+std::uint64_t Counter::value() const {
+  std::uint64_t value = 0;
+  for (const auto &shard : shards_)
+    value += shard.value.load(std::memory_order_relaxed);
+  return value;
+}
+
+void Gauge::set(std::int64_t value) {
+  value_.store(value, std::memory_order_relaxed);
+}
+
+void Gauge::add(std::int64_t value) {
+  value_.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Gauge::sub(std::int64_t value) {
+  value_.fetch_sub(value, std::memory_order_relaxed);
+}
+
+std::int64_t Gauge::value() const {
+  return value_.load(std::memory_order_relaxed);
+}
+
+Histogram::Histogram(const std::vector<std::uint64_t> &bounds) : bounds_(bounds) {
+  if (!std::is_sorted(bounds_.begin(), bounds_.end()))
+    throw std::invalid_argument("Histogram bounds need to be sorted");
+
+  for (auto &shard : shards_) {
+    shard.buckets.reset(new std::atomic<std::uint64_t>[bounds_.size() + 1]);
+    for (std::size_t n = 0; n <= bounds_.size(); n++)
+      shard.buckets[n] = 0;
+  }
+}
+
+std::vector<std::uint64_t> Histogram::exponential_bounds(std::uint64_t start, std::size_t count) {
+  std::vector<std::uint64_t> bounds;
+  bounds.reserve(count);
+  for (std::size_t n = 0; n < count; n++)
+    bounds.push_back(start << n);
+  return bounds;
+}
+
+void Histogram::observe(std::uint64_t value) {
+  const auto bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+  auto &shard = shards_[this_thread_shard()];
+  shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snapshot{bounds_, std::vector<std::uint64_t>(bounds_.size() + 1, 0), 0, 0};
+  for (const auto &shard : shards_) {
+    for (std::size_t n = 0; n <= bounds_.size(); n++)
+      snapshot.buckets[n] += shard.buckets[n].load(std::memory_order_relaxed);
+    snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    snapshot.count += shard.count.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+Registry &Registry::instance() {
+  static Registry registry;
+  return registry;
+}
+
+Registry::Registry() {}
+
+Registry::Family &Registry::family_locked(const std::string &name, const std::string &help, Type type) {
+  auto it = families_.find(name);
+  if (it == families_.end())
+    it = families_.insert({name, Family{type, help, {}, {}, {}}}).first;
+  else if (it->second.type != type)
+    throw std::logic_error("Metric " + name + " registered with a different type");
+  return it->second;
+}
+
+Counter &Registry::counter(const std::string &name, const std::string &help, const Labels &labels) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &metric = family_locked(name, help, Type::Counter).counters[labels];
+  if (!metric)
+    metric.reset(new Counter);
+  return *metric;
+}
+
+Gauge &Registry::gauge(const std::string &name, const std::string &help, const Labels &labels) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &metric = family_locked(name, help, Type::Gauge).gauges[labels];
+  if (!metric)
+    metric.reset(new Gauge);
+  return *metric;
+}
+
+Histogram &Registry::histogram(const std::string &name, const std::string &help,
+                               const std::vector<std::uint64_t> &bounds, const Labels &labels) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto &metric = family_locked(name, help, Type::Histogram).histograms[labels];
+  if (!metric)
+    metric.reset(new Histogram(bounds));
+  return *metric;
+}
+
+void Registry::remove(const std::string &name, const Labels &labels) {
+  std::lock_guard<std::mutex> l(lock_);
+  auto it = families_.find(name);
+  if (it == families_.end())
+    return;
+
+  auto &family = it->second;
+  family.counters.erase(labels);
+  family.gauges.erase(labels);
+  family.histograms.erase(labels);
+  if (family.counters.empty() && family.gauges.empty() && family.histograms.empty())
+    families_.erase(it);
+}
+
+std::string Registry::to_prometheus() const {
+  std::lock_guard<std::mutex> l(lock_);
+
+  std::ostringstream out;
+  for (const auto &entry : families_) {
+    const auto &name = entry.first;
+    const auto &family = entry.second;
+
+    out << "# HELP " << name << " " << family.help << "\n";
+    switch (family.type) {
+    case Type::Counter:
+      out << "# TYPE " << name << " counter\n";
+      for (const auto &metric : family.counters)
+        out << name << format_labels(metric.first) << " " << metric.second->value() << "\n";
+      break;
+    case Type::Gauge:
+      out << "# TYPE " << name << " gauge\n";
+      for (const auto &metric : family.gauges)
+        out << name << format_labels(metric.first) << " " << metric.second->value() << "\n";
+      break;
+    case Type::Histogram:
+      out << "# TYPE " << name << " histogram\n";
+      for (const auto &metric : family.histograms) {
+        const auto snapshot = metric.second->snapshot();
+        std::uint64_t cumulative = 0;
+        for (std::size_t n = 0; n < snapshot.buckets.size(); n++) {
+          cumulative += snapshot.buckets[n];
+          const auto le = n < snapshot.bounds.size() ? std::to_string(snapshot.bounds[n]) : "+Inf";
+          out << name << "_bucket" << format_labels(metric.first, "le", le) << " " << cumulative << "\n";
+        }
+        out << name << "_sum" << format_labels(metric.first) << " " << snapshot.sum << "\n";
+        // Use the buckets for the count as well so both always agree even
+        // when observations come in while the snapshot is taken.
+        out << name << "_count" << format_labels(metric.first) << " " << cumulative << "\n";
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return out.str();
+}
+}  // namespace stats
+}  // namespace anbox
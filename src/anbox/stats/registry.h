@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ANBOX_STATS_REGISTRY_H_
+#define ANBOX_STATS_REGISTRY_H_
+
+#include "anbox/common/cache_line_aligned.h"
+#include "anbox/do_not_copy_or_move.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anbox {
+namespace stats {
+// Every metric is split into shards and each thread only updates the
+// shard it was assigned to. This keeps threads bumping the same metric
+// from fighting over a single cache line. Shards are summed up when a
+// snapshot is taken.
+constexpr const std::size_t shard_count{16};
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter : public common::CacheLineAligned {
+ public:
+  void add(std::uint64_t value = 1);
+  std::uint64_t value() const;
+
+ private:
+  struct alignas(common::cache_line_size) Shard {
+    std::atomic<std::uint64_t> value{0};
+  };
+  std::array<Shard, shard_count> shards_;
+};
+
+// Gauges describe a current level like a queue depth and are updated far
+// less often than counters so they don't need to be sharded.
+class Gauge {
+ public:
+  void set(std::int64_t value);
+  void add(std::int64_t value = 1);
+  void sub(std::int64_t value = 1);
+  std::int64_t value() const;
+
+ private:
+  std::atomic<std::int64_t> value_{0};
+};
+
+class Histogram : public common::CacheLineAligned {
+ public:
+  // Upper bounds of the buckets, the last bucket takes everything above
+  // the highest bound.
+  explicit Histogram(const std::vector<std::uint64_t> &bounds);
+
+  // Returns count bounds starting at start and doubling with each bucket.
+  static std::vector<std::uint64_t> exponential_bounds(std::uint64_t start, std::size_t count);
+
+  void observe(std::uint64_t value);
+
+  struct Snapshot {
+    std::vector<std::uint64_t> bounds;
+    // Observations per bucket, one more than there are bounds
+    std::vector<std::uint64_t> buckets;
+    std::uint64_t count;
+    std::uint64_t sum;
+  };
+  Snapshot snapshot() const;
+
+ private:
+  struct alignas(common::cache_line_size) Shard {
+    std::unique_ptr<std::atomic<std::uint64_t>[]> buckets;
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum{0};
+  };
+
+  const std::vector<std::uint64_t> bounds_;
+  std::array<Shard, shard_count> shards_;
+};
+
+// Process wide registry all components register their metrics with.
+// Metrics are created on first use and live as long as the process so
+// components can keep references to them. Asking for the same name and
+// labels again returns the existing metric.
+class Registry : public DoNotCopyOrMove {
+ public:
+  static Registry &instance();
+
+  Registry();
+
+  Counter &counter(const std::string &name, const std::string &help,
+                   const Labels &labels = {});
+  Gauge &gauge(const std::string &name, const std::string &help,
+               const Labels &labels = {});
+  Histogram &histogram(const std::string &name, const std::string &help,
+                       const std::vector<std::uint64_t> &bounds,
+                       const Labels &labels = {});
+
+  // Drops the metric with the given name and labels, e.g. when the thread
+  // it describes is gone. References to it must not be used anymore.
+  void remove(const std::string &name, const Labels &labels = {});
+
+  // Renders all metrics in the Prometheus text exposition format.
+  std::string to_prometheus() const;
+
+ private:
+  enum class Type { Counter, Gauge, Histogram };
+
+  struct Family {
+    Type type;
+    std::string help;
+    std::map<Labels, std::unique_ptr<Counter>> counters;
+    std::map<Labels, std::unique_ptr<Gauge>> gauges;
+    std::map<Labels, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Family &family_locked(const std::string &name, const std::string &help, Type type);
+
+  mutable std::mutex lock_;
+  std::map<std::string, Family> families_;
+};
+}  // namespace stats
+}  // namespace anbox
+
+#endif
@@ -34,6 +34,7 @@ class Manager {
   virtual void setup() {}
 
   virtual void apply_window_state_update(const WindowState::List &updated, const WindowState::List &removed) = 0;
+  virtual void apply_window_state_delta(const WindowStateDelta &delta) = 0;
 
   virtual void resize_task(const Task::Id &task, const anbox::graphics::Rect &rect,
                            const std::int32_t &resize_mode) = 0;
@@ -33,6 +33,16 @@ MultiWindowManager::MultiWindowManager(const std::weak_ptr<platform::BasePlatfor
 
 MultiWindowManager::~MultiWindowManager() {}
 
+namespace {
+bool is_managed_window(const WindowState &window) {
+  // Ignore all windows which are not part of the freeform or fullscreen
+  // task stack and those which don't have a surface mapped at the moment
+  if (window.stack() != Stack::Id::Freeform && window.stack() != Stack::Id::Fullscreen)
+    return false;
+  return window.has_surface();
+}
+}  // namespace
+
 void MultiWindowManager::apply_window_state_update(const WindowState::List &updated,
                                         const WindowState::List &removed) {
   // Base on the update we get from the Android WindowManagerService we will
@@ -46,44 +56,19 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
   bool is_window_removed = false;
   WindowState last_ws;
   for (const auto &window : updated) {
-    // Ignore all windows which are not part of the freeform task stack
-    if (window.stack() != Stack::Id::Freeform && window.stack() != Stack::Id::Fullscreen) continue;
-
-    // And also those which don't have a surface mapped at the moment
-    if (!window.has_surface()) continue;
+    if (!is_managed_window(window)) continue;
 
     neet_setfocus = true;
     last_ws = window;
     // If we know that task already we first collect all window updates
     // for it so we can apply all of them together.
-    auto t = task_updates.find(window.task());
-    if (t == task_updates.end())
-      task_updates.insert({window.task(), {window}});
-    else
-      task_updates[window.task()].push_back(window);
+    task_updates[window.task()].push_back(window);
     if (find_window_for_task(window.task()) != nullptr) {
       continue;
     }
 
-    if (window.frame().width() == 0 || window.frame().height() == 0) {
-      continue;
-    }
-
-    auto title = window.package_name();
-    auto app = app_db_->find_by_package(window.package_name());
-    if (app.valid()) {
-      title = app.name;
-    }
-    if (auto p = platform_.lock()) {
-      SDL_Event event;
-      SDL_memset(&event, 0, sizeof(event));
-      event.type = p->get_user_window_event();
-      event.user.code = platform::USER_CREATE_WINDOW;
-      event.user.data1 = new(std::nothrow) platform::manager_window_param(window.task(), window.frame(), title);
-      event.user.data2 = 0;
-      SDL_PushEvent(&event);
+    if (request_window_creation(window))
       neet_setfocus = false;
-    }
   }
 
   {
@@ -98,35 +83,126 @@ void MultiWindowManager::apply_window_state_update(const WindowState::List &upda
         it->second->update_state(w->second);
         continue;
       }
-      auto platform_window = it->second;
-      platform_window->release();
-
-      if (auto p = platform_.lock()) {
-        SDL_Event event;
-        SDL_memset(&event, 0, sizeof(event));
-        event.type = p->get_user_window_event();
-        event.user.code = platform::USER_DESTROY_WINDOW;
-        event.user.data1 = new(std::nothrow) platform::manager_window_param(it->first, graphics::Rect(0, 0, 0, 0), "");
-        event.user.data2 = 0;
-        SDL_PushEvent(&event);
+      it->second->release();
+
+      if (request_window_destruction(it->first))
         is_window_removed = true;
+    }
+  }
+  if (neet_setfocus)
+    update_focus(last_ws, is_window_removed);
+}
+
+void MultiWindowManager::apply_window_state_delta(const WindowStateDelta &delta) {
+  // Unlike a full update a delta only touches the tasks which changed so
+  // all other windows are left alone and don't need to be visited.
+  std::map<Task::Id, WindowState::List> task_updates;
+  std::vector<Task::Id> removed_tasks = delta.removed;
+
+  bool neet_setfocus = false;
+  bool is_window_removed = false;
+  WindowState last_ws;
+  for (const auto *windows : {&delta.added, &delta.changed}) {
+    for (const auto &window : *windows) {
+      if (!is_managed_window(window)) {
+        // A task without any window we manage is gone for us.
+        if (task_updates.find(window.task()) == task_updates.end())
+          removed_tasks.push_back(window.task());
+        continue;
       }
+
+      neet_setfocus = true;
+      last_ws = window;
+
+      auto t = task_updates.find(window.task());
+      if (t != task_updates.end()) {
+        t->second.push_back(window);
+        continue;
+      }
+      task_updates.insert({window.task(), {window}});
+
+      if (find_window_for_task(window.task()) != nullptr)
+        continue;
+
+      if (request_window_creation(window))
+        neet_setfocus = false;
     }
   }
-  if (neet_setfocus) {
-    auto w = find_window_for_task(last_ws.task());
-    if (w) {
-      w->set_focus_from_android(is_window_removed);
+
+  {
+    std::lock_guard<std::mutex> l(mutex_);
+    for (const auto &task : removed_tasks) {
+      // Removals may have been superseded by windows later in the delta
+      if (task_updates.find(task) != task_updates.end()) continue;
+
+      auto it = windows_.find(task);
+      if (it == windows_.end()) continue;
+      it->second->release();
+
+      if (request_window_destruction(task))
+        is_window_removed = true;
+    }
+
+    for (const auto &update : task_updates) {
+      auto it = windows_.find(update.first);
+      if (it != windows_.end())
+        it->second->update_state(update.second);
     }
   }
+
+  if (neet_setfocus)
+    update_focus(last_ws, is_window_removed);
+}
+
+bool MultiWindowManager::request_window_creation(const WindowState &window) {
+  if (window.frame().width() == 0 || window.frame().height() == 0)
+    return false;
+
+  auto p = platform_.lock();
+  if (!p) return false;
+
+  auto title = window.package_name();
+  auto app = app_db_->find_by_package(window.package_name());
+  if (app.valid()) {
+    title = app.name;
+  }
+
+  SDL_Event event;
+  SDL_memset(&event, 0, sizeof(event));
+  event.type = p->get_user_window_event();
+  event.user.code = platform::USER_CREATE_WINDOW;
+  event.user.data1 = new(std::nothrow) platform::manager_window_param(window.task(), window.frame(), title);
+  event.user.data2 = 0;
+  SDL_PushEvent(&event);
+  return true;
+}
+
+bool MultiWindowManager::request_window_destruction(const Task::Id &task) {
+  auto p = platform_.lock();
+  if (!p) return false;
+
+  SDL_Event event;
+  SDL_memset(&event, 0, sizeof(event));
+  event.type = p->get_user_window_event();
+  event.user.code = platform::USER_DESTROY_WINDOW;
+  event.user.data1 = new(std::nothrow) platform::manager_window_param(task, graphics::Rect(0, 0, 0, 0), "");
+  event.user.data2 = 0;
+  SDL_PushEvent(&event);
+  return true;
+}
+
+void MultiWindowManager::update_focus(const WindowState &window, bool is_window_removed) {
+  auto w = find_window_for_task(window.task());
+  if (w) {
+    w->set_focus_from_android(is_window_removed);
+  }
 }
 
 std::shared_ptr<Window> MultiWindowManager::find_window_for_task(const Task::Id &task) {
   std::lock_guard<std::mutex> l(mutex_);
-  for (const auto &w : windows_) {
-    if (w.second->task() == task) return w.second;
-  }
-  return nullptr;
+  auto it = windows_.find(task);
+  if (it == windows_.end()) return nullptr;
+  return it->second;
 }
 
 void MultiWindowManager::resize_task(const Task::Id &task, const anbox::graphics::Rect &rect,
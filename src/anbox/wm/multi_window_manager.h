@@ -24,6 +24,7 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <unordered_map>
 
 namespace anbox {
 namespace application {
@@ -44,6 +45,7 @@ class MultiWindowManager : public Manager {
   ~MultiWindowManager();
 
   void apply_window_state_update(const WindowState::List &updated, const WindowState::List &removed) override;
+  void apply_window_state_delta(const WindowStateDelta &delta) override;
 
   std::shared_ptr<Window> find_window_for_task(const Task::Id &task) override;
 
@@ -59,11 +61,15 @@ class MultiWindowManager : public Manager {
 
   std::string get_title(const std::string &package_name) override;
  private:
+  bool request_window_creation(const WindowState &window);
+  bool request_window_destruction(const Task::Id &task);
+  void update_focus(const WindowState &window, bool is_window_removed);
+
   std::mutex mutex_;
   std::weak_ptr<platform::BasePlatform> platform_;
   std::shared_ptr<bridge::AndroidApiStub> android_api_stub_;
   std::shared_ptr<application::Database> app_db_;
-  std::map<Task::Id, std::shared_ptr<Window>> windows_;
+  std::unordered_map<Task::Id, std::shared_ptr<Window>> windows_;
   std::vector<std::shared_ptr<Window>> toast_windows_;
 };
 }  // namespace wm
@@ -48,6 +48,10 @@ void SingleWindowManager::apply_window_state_update(const WindowState::List &upd
   (void)removed;
 }
 
+void SingleWindowManager::apply_window_state_delta(const WindowStateDelta &delta) {
+  (void)delta;
+}
+
 std::shared_ptr<Window> SingleWindowManager::find_window_for_task(const Task::Id &task) {
   (void)task;
   return window_;
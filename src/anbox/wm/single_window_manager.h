@@ -43,6 +43,7 @@ class SingleWindowManager : public Manager {
   void setup() override;
 
   void apply_window_state_update(const WindowState::List &updated, const WindowState::List &removed) override;
+  void apply_window_state_delta(const WindowStateDelta &delta) override;
 
   std::shared_ptr<Window> find_window_for_task(const Task::Id &task) override;
 
@@ -25,6 +25,7 @@
 
 #include <EGL/egl.h>
 
+#include <atomic>
 #include <memory>
 
 class Renderer;
@@ -67,6 +68,12 @@ class Window {
   virtual bool checkResizeable() { return resizing_; }
   virtual void setResizing(bool resizing) { resizing_ = resizing; }
   virtual void destroy_window() {}
+
+  // Makes the next composition redraw the whole window, e.g. after the
+  // host exposed or restored it and its content got lost.
+  void invalidate() { invalidated_ = true; }
+  // Returns whether the window was invalidated since the last call.
+  bool take_invalidation() { return invalidated_.exchange(false); }
  protected:
   graphics::Rect last_frame_;
   bool resizing_{false};
@@ -77,6 +84,7 @@ class Window {
   graphics::Rect frame_;
   std::string title_;
   bool attached_ = false;
+  std::atomic<bool> invalidated_{false};
 };
 }  // namespace wm
 }  // namespace anbox
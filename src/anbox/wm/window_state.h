@@ -58,6 +58,14 @@ class WindowState {
   bool videofullscreen_;
   int32_t flags_;
 };
+
+// Incremental update of the window state. Every added or changed task
+// comes with the complete list of its windows.
+struct WindowStateDelta {
+  WindowState::List added;
+  WindowState::List changed;
+  std::vector<Task::Id> removed;
+};
 }  // namespace wm
 }  // namespace anbox
 
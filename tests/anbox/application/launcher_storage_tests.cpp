@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/application/database.h"
+#include "anbox/application/launcher_storage.h"
+#include "anbox/common/content_hash.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace {
+class LauncherStorageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = fs::temp_directory_path() / fs::unique_path("anbox-launcher-%%%%-%%%%");
+    storage_ = std::make_shared<anbox::application::LauncherStorage>(path_);
+  }
+
+  void TearDown() override { fs::remove_all(path_); }
+
+  anbox::application::Database::Item item(const std::string &package,
+                                          const std::string &icon) {
+    anbox::application::Database::Item item;
+    item.name = package;
+    item.package = package;
+    item.launch_intent.package = package;
+    item.icon_hash = anbox::common::content_hash(icon);
+    return item;
+  }
+
+  std::size_t count_files(const fs::path &path) {
+    return std::distance(fs::directory_iterator(path), fs::directory_iterator());
+  }
+
+  fs::path path_;
+  std::shared_ptr<anbox::application::LauncherStorage> storage_;
+};
+}  // namespace
+
+namespace anbox {
+namespace application {
+TEST_F(LauncherStorageTest, OnlyWritesChangedFiles) {
+  storage_->add_or_update(item("org.example.a", "icon-a"), "icon-a");
+  ASSERT_EQ(2u, storage_->files_written());
+  ASSERT_TRUE(fs::exists(path_ / "anbox-org-example-a.desktop"));
+
+  // A new session storing the same item doesn't touch the disk
+  LauncherStorage storage(path_);
+  storage.add_or_update(item("org.example.a", "icon-a"), "icon-a");
+  ASSERT_EQ(0u, storage.files_written());
+
+  auto renamed = item("org.example.a", "icon-a");
+  renamed.name = "Renamed";
+  storage.add_or_update(renamed, "");
+  ASSERT_EQ(1u, storage.files_written());
+}
+
+TEST_F(LauncherStorageTest, SharesIconsWithSameContent) {
+  storage_->add_or_update(item("org.example.a", "icon"), "icon");
+  storage_->add_or_update(item("org.example.b", "icon"), "icon");
+  ASSERT_EQ(3u, storage_->files_written());
+  ASSERT_EQ(1u, count_files(path_ / "anbox-icons"));
+}
+
+TEST_F(LauncherStorageTest, RetainDropsOtherItemsAndUnusedIcons) {
+  storage_->add_or_update(item("org.example.a", "icon-a"), "icon-a");
+  storage_->add_or_update(item("org.example.b", "icon-b"), "icon-b");
+
+  storage_->retain({"org.example.a"});
+
+  ASSERT_TRUE(fs::exists(path_ / "anbox-org-example-a.desktop"));
+  ASSERT_FALSE(fs::exists(path_ / "anbox-org-example-b.desktop"));
+  ASSERT_EQ(1u, count_files(path_ / "anbox-icons"));
+
+  storage_->retain({});
+  ASSERT_FALSE(fs::exists(path_ / "anbox-org-example-a.desktop"));
+  ASSERT_EQ(0u, count_files(path_ / "anbox-icons"));
+}
+
+TEST_F(LauncherStorageTest, DatabaseSkipsUnchangedItems) {
+  Database db(storage_);
+  db.store_or_update(item("org.example.a", "icon-a"), "icon-a");
+  ASSERT_EQ(2u, storage_->files_written());
+
+  db.store_or_update(item("org.example.a", "icon-a"), "icon-a");
+  ASSERT_EQ(2u, storage_->files_written());
+  ASSERT_TRUE(db.find_by_package("org.example.a").valid());
+
+  db.retain({});
+  ASSERT_FALSE(db.find_by_package("org.example.a").valid());
+}
+}  // namespace application
+}  // namespace anbox
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/capture_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace audio {
+namespace {
+void capture(CaptureRing &ring, std::uint8_t value, std::int64_t capture_time_ns) {
+  auto data = ring.prepare();
+  std::memset(data, value, ring.period_size());
+  ring.commit(ring.period_size(), capture_time_ns);
+}
+}
+
+TEST(CaptureRing, PeriodsArePoppedInOrder) {
+  CaptureRing ring(16, 4);
+  capture(ring, 1, 100);
+  capture(ring, 2, 200);
+
+  std::vector<std::uint8_t> data(ring.period_size());
+  std::size_t size = 0;
+  std::int64_t capture_time_ns = 0;
+
+  ASSERT_TRUE(ring.pop(data.data(), &size, &capture_time_ns));
+  ASSERT_EQ(16u, size);
+  ASSERT_EQ(100, capture_time_ns);
+  ASSERT_EQ(1, data[0]);
+
+  ASSERT_TRUE(ring.pop(data.data(), &size, &capture_time_ns));
+  ASSERT_EQ(200, capture_time_ns);
+  ASSERT_EQ(2, data[15]);
+
+  ASSERT_EQ(0u, ring.overruns());
+}
+
+TEST(CaptureRing, OverrunDropsOldestPeriod) {
+  CaptureRing ring(16, 2);
+  capture(ring, 1, 100);
+  capture(ring, 2, 200);
+  capture(ring, 3, 300);
+
+  ASSERT_EQ(1u, ring.overruns());
+
+  std::vector<std::uint8_t> data(ring.period_size());
+  std::size_t size = 0;
+  std::int64_t capture_time_ns = 0;
+
+  ASSERT_TRUE(ring.pop(data.data(), &size, &capture_time_ns));
+  ASSERT_EQ(200, capture_time_ns);
+  ASSERT_EQ(2, data[0]);
+
+  ASSERT_TRUE(ring.pop(data.data(), &size, &capture_time_ns));
+  ASSERT_EQ(300, capture_time_ns);
+  ASSERT_EQ(3, data[0]);
+}
+
+TEST(CaptureRing, CloseWakesUpReader) {
+  CaptureRing ring(16, 2);
+
+  std::thread closer([&]() { ring.close(); });
+
+  std::vector<std::uint8_t> data(ring.period_size());
+  std::size_t size = 0;
+  std::int64_t capture_time_ns = 0;
+  ASSERT_FALSE(ring.pop(data.data(), &size, &capture_time_ns));
+  closer.join();
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/audio/handshake.h"
+#include "anbox/network/local_socket_messenger.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+
+#include <unistd.h>
+
+namespace anbox {
+namespace audio {
+namespace {
+// The host end is wrapped in the messenger the server uses, the guest end
+// is written and read the way the Android audio HAL does.
+struct Connection {
+  Connection() : host{std::make_shared<boost::asio::local::stream_protocol::socket>(io_service)},
+                 guest{io_service} {
+    boost::asio::local::connect_pair(*host, guest);
+    messenger = std::make_shared<network::LocalSocketMessenger>(host);
+  }
+
+  void guest_write(const void *data, size_t size) {
+    ASSERT_EQ(static_cast<ssize_t>(size), ::write(guest.native_handle(), data, size));
+  }
+
+  void guest_read(void *data, size_t size) {
+    ASSERT_EQ(static_cast<ssize_t>(size), ::read(guest.native_handle(), data, size));
+  }
+
+  boost::asio::io_service io_service;
+  std::shared_ptr<boost::asio::local::stream_protocol::socket> host;
+  boost::asio::local::stream_protocol::socket guest;
+  std::shared_ptr<network::LocalSocketMessenger> messenger;
+};
+}  // namespace
+
+TEST(AudioHandshake, ReadsExtendedClientInfo) {
+  Connection connection;
+
+  ClientInfo sent{ClientInfo::Type::Playback, 48000, 960, 0};
+  sent.type = static_cast<ClientInfo::Type>(static_cast<std::uint8_t>(sent.type) |
+                                            ClientInfo::extended_info);
+  connection.guest_write(&sent, sizeof(sent));
+
+  ClientInfo received;
+  bool extended = false;
+  ASSERT_TRUE(receive_client_info(*connection.messenger, &received, &extended));
+  ASSERT_TRUE(extended);
+  ASSERT_EQ(ClientInfo::Type::Playback, received.type);
+  ASSERT_EQ(48000u, received.sample_rate);
+  ASSERT_EQ(960u, received.period_frames);
+  ASSERT_EQ(0u, received.latency_frames);
+
+  received.latency_frames = 1920;
+  send_client_info(*connection.messenger, received, extended);
+
+  ClientInfo reply;
+  connection.guest_read(&reply, sizeof(reply));
+  ASSERT_EQ(sent.type, reply.type);
+  ASSERT_EQ(48000u, reply.sample_rate);
+  ASSERT_EQ(960u, reply.period_frames);
+  ASSERT_EQ(1920u, reply.latency_frames);
+}
+
+TEST(AudioHandshake, OlderClientsOnlySendTheirType) {
+  Connection connection;
+
+  const auto type = ClientInfo::Type::Recording;
+  connection.guest_write(&type, sizeof(type));
+
+  ClientInfo received;
+  bool extended = true;
+  ASSERT_TRUE(receive_client_info(*connection.messenger, &received, &extended));
+  ASSERT_FALSE(extended);
+  ASSERT_EQ(ClientInfo::Type::Recording, received.type);
+  ASSERT_EQ(0u, received.sample_rate);
+
+  send_client_info(*connection.messenger, received, extended);
+
+  ClientInfo::Type reply = ClientInfo::Type::Max;
+  connection.guest_read(&reply, sizeof(reply));
+  ASSERT_EQ(ClientInfo::Type::Recording, reply);
+}
+
+TEST(AudioHandshake, FailsWhenClientHangsUp) {
+  Connection connection;
+  connection.guest.close();
+
+  ClientInfo received;
+  bool extended = false;
+  ASSERT_FALSE(receive_client_info(*connection.messenger, &received, &extended));
+}
+}  // namespace audio
+}  // namespace anbox
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/common/shared_memory.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace anbox {
+namespace common {
+TEST(SharedMemory, ContainsChecksBounds) {
+  SharedMemory memory("test", 4096);
+  ASSERT_NE(nullptr, memory.data());
+  ASSERT_EQ(4096u, memory.size());
+
+  EXPECT_TRUE(memory.contains(0, 4096));
+  EXPECT_TRUE(memory.contains(4000, 96));
+  EXPECT_TRUE(memory.contains(4096, 0));
+  EXPECT_FALSE(memory.contains(4000, 97));
+  EXPECT_FALSE(memory.contains(4097, 0));
+  EXPECT_FALSE(memory.contains(1, static_cast<std::size_t>(-1)));
+}
+
+TEST(SharedMemory, WritesAreVisibleThroughFd) {
+  SharedMemory memory("test", 4096);
+  std::memcpy(memory.data() + 100, "anbox", 5);
+
+  auto addr = ::mmap(nullptr, memory.size(), PROT_READ, MAP_SHARED, memory.fd(), 0);
+  ASSERT_NE(MAP_FAILED, addr);
+  EXPECT_EQ(0, std::memcmp(static_cast<std::uint8_t*>(addr) + 100, "anbox", 5));
+  ::munmap(addr, memory.size());
+}
+}  // namespace common
+}  // namespace anbox
@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstring>
 #include <thread>
 
 namespace anbox {
@@ -294,5 +296,103 @@ TEST(BufferQueue, PopLockedWithClosedQueue) {
 
     thread.stop();
 }
+
+TEST(LockFreeBufferQueue, TryPush) {
+    LockFreeBufferQueue queue(2);
+
+    EXPECT_EQ(0, queue.try_push(Buffer("Hello")));
+    EXPECT_EQ(0, queue.try_push(Buffer("World")));
+
+    Buffer buff0("You Shall Not Move");
+    EXPECT_EQ(-EAGAIN, queue.try_push(std::move(buff0)));
+    EXPECT_FALSE(buff0.empty()) << "Buffer should not be moved on failure!";
+}
+
+TEST(LockFreeBufferQueue, TryPushOnClosedQueue) {
+    LockFreeBufferQueue queue(2);
+
+    EXPECT_EQ(0, queue.try_push(Buffer("Hello")));
+    queue.close();
+    EXPECT_EQ(-EIO, queue.try_push(Buffer("World")));
+}
+
+TEST(LockFreeBufferQueue, TryPopOnClosedQueue) {
+    LockFreeBufferQueue queue(2);
+
+    Buffer buffer;
+    EXPECT_EQ(-EAGAIN, queue.try_pop(&buffer));
+    EXPECT_TRUE(queue.empty());
+
+    EXPECT_EQ(0, queue.try_push(Buffer("Hello")));
+    EXPECT_EQ(0, queue.try_push(Buffer("World")));
+    EXPECT_FALSE(queue.empty());
+
+    EXPECT_EQ(0, queue.try_pop(&buffer));
+    EXPECT_STREQ("Hello", reinterpret_cast<const char*>(buffer.data()));
+
+    // Closing the queue doesn't prevent popping existing items, but
+    // will generate -EIO once it is empty.
+    queue.close();
+
+    EXPECT_EQ(0, queue.try_pop(&buffer));
+    EXPECT_STREQ("World", reinterpret_cast<const char*>(buffer.data()));
+
+    EXPECT_EQ(-EIO, queue.try_pop(&buffer));
+}
+
+TEST(LockFreeBufferQueue, PopBatch) {
+    LockFreeBufferQueue queue(4);
+
+    EXPECT_EQ(0, queue.try_push(Buffer("A")));
+    EXPECT_EQ(0, queue.try_push(Buffer("B")));
+    EXPECT_EQ(0, queue.try_push(Buffer("C")));
+
+    Buffer buffers[2];
+    EXPECT_EQ(2, queue.try_pop_batch(buffers, 2));
+    EXPECT_STREQ("A", reinterpret_cast<const char*>(buffers[0].data()));
+    EXPECT_STREQ("B", reinterpret_cast<const char*>(buffers[1].data()));
+
+    EXPECT_EQ(1, queue.pop_batch(buffers, 2));
+    EXPECT_STREQ("C", reinterpret_cast<const char*>(buffers[0].data()));
+
+    EXPECT_EQ(-EAGAIN, queue.try_pop_batch(buffers, 2));
+}
+
+TEST(LockFreeBufferQueue, PushAndPopWaitForEachOther) {
+    LockFreeBufferQueue queue(2);
+    const int count = 10000;
+
+    std::thread consumer([&]() {
+      Buffer buffer;
+      for (int n = 0; n < count; n++) {
+        ASSERT_EQ(0, queue.pop(&buffer));
+        int value = 0;
+        std::memcpy(&value, buffer.data(), sizeof(value));
+        ASSERT_EQ(n, value);
+      }
+      EXPECT_EQ(-EIO, queue.pop(&buffer));
+    });
+
+    for (int n = 0; n < count; n++) {
+      auto data = reinterpret_cast<const std::uint8_t*>(&n);
+      EXPECT_EQ(0, queue.push(Buffer{data, data + sizeof(n)}));
+    }
+    queue.close();
+
+    consumer.join();
+}
+
+TEST(LockFreeBufferQueue, CloseWakesUpConsumer) {
+    LockFreeBufferQueue queue(2);
+
+    std::thread closer([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      queue.close();
+    });
+
+    Buffer buffer;
+    EXPECT_EQ(-EIO, queue.pop(&buffer));
+    closer.join();
+}
 } // namespace graphics
 } // namespace anbox
@@ -17,7 +17,9 @@
 
 #include "anbox/graphics/buffered_io_stream.h"
 
+#include <algorithm>
 #include <chrono>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -31,6 +33,8 @@ class MockSocketMessenger :
   // anbox::network::SocketMessenger
   MOCK_CONST_METHOD0(creds, anbox::network::Credentials());
   MOCK_CONST_METHOD0(local_port, unsigned short());
+  MOCK_CONST_METHOD0(native_handle, int());
+  MOCK_METHOD1(async_wait_writable, void(AnboxWritableHandler const&));
   MOCK_METHOD0(set_no_delay, void());
   MOCK_METHOD0(close, void());
 
@@ -43,6 +47,26 @@ class MockSocketMessenger :
   MOCK_METHOD1(receive_msg, boost::system::error_code(boost::asio::mutable_buffers_1 const&));
   MOCK_METHOD0(available_bytes, size_t());
 };
+
+// Takes at most a few bytes per gathering write so that writes end in the
+// middle of the committed buffers.
+class TrickleSocketMessenger : public MockSocketMessenger {
+ public:
+  static constexpr const size_t max_write_size{3};
+
+  ssize_t send_raw_gathered(struct iovec const* iov, size_t count) override {
+    size_t written = 0;
+    for (size_t n = 0; n < count && written < max_write_size; n++) {
+      const auto size = std::min(iov[n].iov_len, max_write_size - written);
+      auto data = static_cast<char const*>(iov[n].iov_base);
+      received.insert(received.end(), data, data + size);
+      written += size;
+    }
+    return written;
+  }
+
+  std::vector<char> received;
+};
 }
 
 namespace anbox {
@@ -93,6 +117,25 @@ TEST(BufferedIOStream, WriterContinuesWhenSocketIsBusy) {
   ASSERT_EQ(stream.commitBuffer(buffer_size), buffer_size);
 }
 
+TEST(BufferedIOStream, WriterResumesPartialGatheredWrites) {
+  auto messenger = std::make_shared<TrickleSocketMessenger>();
+  std::vector<char> sent;
+  {
+    BufferedIOStream stream(messenger);
+    for (int n = 0; n < 8; n++) {
+      auto ptr = static_cast<char*>(stream.allocBuffer(5));
+      ASSERT_NE(ptr, nullptr);
+      for (int i = 0; i < 5; i++)
+        ptr[i] = static_cast<char>(n * 5 + i);
+      sent.insert(sent.end(), ptr, ptr + 5);
+      ASSERT_EQ(5u, stream.commitBuffer(5));
+    }
+  }
+
+  // The destructor waits for the writer so everything went out by now
+  EXPECT_EQ(sent, messenger->received);
+}
+
 TEST(BufferedIOStream, ReadWhenEnoughDataAvailable) {
   auto messenger = std::make_shared<MockSocketMessenger>();
   BufferedIOStream stream(messenger);
@@ -141,5 +184,78 @@ TEST(BufferedIOStream, ReadWithNoDataAvailable) {
   stopped = true;
   producer.join();
 }
+
+TEST(BufferedIOStream, StreamingModeReadsFromRing) {
+  auto messenger = std::make_shared<MockSocketMessenger>();
+  BufferedIOStream stream(messenger, BufferedIOStream::default_buffer_size,
+                          BufferedIOStream::IngestMode::Streaming);
+  ASSERT_NE(nullptr, stream.ring());
+  EXPECT_TRUE(stream.needs_data());
+
+  size_t size = 0;
+  auto dst = stream.prepare_data(&size);
+  ASSERT_NE(nullptr, dst);
+  ASSERT_GE(size, 2u);
+  dst[0] = 0x12;
+  dst[1] = 0x34;
+  ASSERT_TRUE(stream.commit_data(2));
+  EXPECT_FALSE(stream.needs_data());
+
+  std::uint8_t read_data[10] = {0x0};
+  size_t read = sizeof(read_data);
+  EXPECT_NE(nullptr, stream.read(read_data, &read));
+  EXPECT_EQ(2u, read);
+  EXPECT_EQ(0x12, read_data[0]);
+  EXPECT_EQ(0x34, read_data[1]);
+  EXPECT_TRUE(stream.needs_data());
+}
+
+TEST(BufferedIOStream, StreamingModeReadsPostedData) {
+  auto messenger = std::make_shared<MockSocketMessenger>();
+  BufferedIOStream stream(messenger, BufferedIOStream::default_buffer_size,
+                          BufferedIOStream::IngestMode::Streaming);
+
+  // Data which arrived together with the pipe handshake is posted as a
+  // whole before the connection starts to stream into the ring.
+  Buffer buffer;
+  buffer.push_back(0x12);
+  buffer.push_back(0x34);
+  stream.post_data(std::move(buffer));
+  EXPECT_FALSE(stream.needs_data());
+
+  size_t size = 0;
+  auto dst = stream.prepare_data(&size);
+  ASSERT_NE(nullptr, dst);
+  ASSERT_GE(size, 1u);
+  dst[0] = 0x56;
+  ASSERT_TRUE(stream.commit_data(1));
+
+  std::uint8_t read_data[10] = {0x0};
+  size_t read = sizeof(read_data);
+  EXPECT_NE(nullptr, stream.read(read_data, &read));
+  EXPECT_EQ(3u, read);
+  EXPECT_EQ(0x12, read_data[0]);
+  EXPECT_EQ(0x34, read_data[1]);
+  EXPECT_EQ(0x56, read_data[2]);
+}
+
+TEST(BufferedIOStream, PostingToStoppedStreamFails) {
+  auto messenger = std::make_shared<MockSocketMessenger>();
+  BufferedIOStream stream(messenger, BufferedIOStream::default_buffer_size,
+                          BufferedIOStream::IngestMode::Streaming);
+  stream.forceStop();
+
+  Buffer buffer;
+  buffer.push_back(0x12);
+  EXPECT_FALSE(stream.post_data(std::move(buffer)));
+
+  // Queued mode drops the data the same way
+  BufferedIOStream queued_stream(messenger);
+  queued_stream.forceStop();
+
+  buffer.clear();
+  buffer.push_back(0x12);
+  EXPECT_FALSE(queued_stream.post_data(std::move(buffer)));
+}
 } // namespace graphics
 } // namespace anbox
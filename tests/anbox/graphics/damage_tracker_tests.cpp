@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/graphics/damage_tracker.h"
+#include "anbox/wm/window.h"
+
+namespace anbox {
+namespace graphics {
+namespace {
+std::shared_ptr<wm::Window> make_window(const wm::Task::Id &task) {
+  return std::make_shared<wm::Window>(nullptr, task, Rect{0, 0, 1024, 768}, "test");
+}
+}  // namespace
+
+TEST(DamageTracker, NewWindowIsFullyDamaged) {
+  DamageTracker tracker;
+  auto window = make_window(1);
+
+  auto damage = tracker.update({{window, {{"layer", 1, 1.0f, {0, 0, 1024, 768}}}}});
+  ASSERT_EQ(1u, damage.size());
+  ASSERT_EQ((Rect{0, 0, 1024, 768}), damage[window]);
+}
+
+TEST(DamageTracker, UnchangedWindowHasNoDamage) {
+  DamageTracker tracker;
+  auto window = make_window(1);
+  const RenderableList renderables{{"layer", 1, 1.0f, {0, 0, 1024, 768}}};
+
+  tracker.update({{window, renderables}});
+  auto damage = tracker.update({{window, renderables}});
+  ASSERT_EQ(0, damage[window].width());
+  ASSERT_EQ(0, damage[window].height());
+}
+
+TEST(DamageTracker, OnlyChangedLayersAreDamaged) {
+  DamageTracker tracker;
+  auto first_window = make_window(1);
+  auto second_window = make_window(2);
+  const RenderableList background{{"background", 1, 1.0f, {0, 0, 1024, 768}}};
+
+  tracker.update({
+      {first_window, {background[0], {"popup", 2, 1.0f, {100, 100, 200, 200}}}},
+      {second_window, background},
+  });
+
+  // The popup moved and shows a new buffer
+  auto damage = tracker.update({
+      {first_window, {background[0], {"popup", 3, 1.0f, {150, 100, 250, 220}}}},
+      {second_window, background},
+  });
+
+  ASSERT_EQ((Rect{100, 100, 250, 220}), damage[first_window]);
+  ASSERT_EQ(0, damage[second_window].width());
+}
+
+TEST(DamageTracker, ChangedLayerCountDamagesWholeWindow) {
+  DamageTracker tracker;
+  auto window = make_window(1);
+  const Renderable background{"background", 1, 1.0f, {0, 0, 1024, 768}};
+
+  tracker.update({{window, {background}}});
+  auto damage = tracker.update({{window, {background, {"popup", 2, 1.0f, {10, 10, 20, 20}}}}});
+  ASSERT_EQ((Rect{0, 0, 1024, 768}), damage[window]);
+}
+
+TEST(DamageTracker, ReappearingWindowIsFullyDamaged) {
+  DamageTracker tracker;
+  auto first_window = make_window(1);
+  auto second_window = make_window(2);
+  const RenderableList renderables{{"layer", 1, 1.0f, {0, 0, 1024, 768}}};
+
+  tracker.update({{first_window, renderables}, {second_window, renderables}});
+  tracker.update({{second_window, renderables}});
+  auto damage = tracker.update({{first_window, renderables}, {second_window, renderables}});
+  ASSERT_EQ((Rect{0, 0, 1024, 768}), damage[first_window]);
+  ASSERT_EQ(0, damage[second_window].width());
+}
+
+TEST(DamageTracker, InvalidatedWindowIsFullyDamagedOnce) {
+  DamageTracker tracker;
+  auto window = make_window(1);
+  const RenderableList renderables{{"layer", 1, 1.0f, {0, 0, 1024, 768}}};
+
+  tracker.update({{window, renderables}});
+  window->invalidate();
+  auto damage = tracker.update({{window, renderables}});
+  ASSERT_EQ((Rect{0, 0, 1024, 768}), damage[window]);
+
+  damage = tracker.update({{window, renderables}});
+  ASSERT_EQ(0, damage[window].width());
+}
+
+TEST(DamageTracker, ResizingWindowIsFullyDamaged) {
+  DamageTracker tracker;
+  auto window = make_window(1);
+  const RenderableList renderables{{"layer", 1, 1.0f, {0, 0, 1024, 768}}};
+
+  tracker.update({{window, renderables}});
+  window->setResizing(true);
+  auto damage = tracker.update({{window, renderables}});
+  ASSERT_EQ((Rect{0, 0, 1024, 768}), damage[window]);
+
+  // Once more when the resize is over to switch to the final content
+  window->setResizing(false);
+  damage = tracker.update({{window, renderables}});
+  ASSERT_EQ((Rect{0, 0, 1024, 768}), damage[window]);
+
+  damage = tracker.update({{window, renderables}});
+  ASSERT_EQ(0, damage[window].width());
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "external/android-emugl/shared/OpenglCodecCommon/DecoderProfile.h"
+
+#include <gtest/gtest.h>
+
+using emugl::DecoderProfile;
+
+namespace {
+const char *opcode_name(uint32_t opcode) {
+  switch (opcode) {
+  case 100: return "first";
+  case 101: return "second";
+  case 102: return "third";
+  default: return nullptr;
+  }
+}
+}  // namespace
+
+TEST(DecoderProfile, IgnoresOpcodesOfOtherDecoders) {
+  DecoderProfile profile(100, 3, &opcode_name);
+  EXPECT_FALSE(profile.begin(99, 8));
+  EXPECT_FALSE(profile.begin(103, 8));
+  EXPECT_TRUE(profile.top(10).empty());
+}
+
+TEST(DecoderProfile, TimesEverySampleIntervalCall) {
+  DecoderProfile profile(100, 3, &opcode_name);
+  std::size_t timed = 0;
+  for (std::uint64_t n = 0; n < 2 * DecoderProfile::kSampleInterval; n++) {
+    if (profile.begin(101, 16)) {
+      profile.end(101, std::chrono::microseconds(1));
+      timed++;
+    }
+  }
+  EXPECT_EQ(2, timed);
+
+  const auto top = profile.top(10);
+  ASSERT_EQ(1, top.size());
+  EXPECT_EQ(101, top[0].opcode);
+  EXPECT_STREQ("second", top[0].name);
+  EXPECT_EQ(2 * DecoderProfile::kSampleInterval, top[0].calls);
+  EXPECT_EQ(2 * DecoderProfile::kSampleInterval * 16, top[0].bytes);
+  // The timed calls stand in for all the others
+  EXPECT_EQ(2 * DecoderProfile::kSampleInterval * 1000, top[0].estimatedNs);
+}
+
+TEST(DecoderProfile, SortsByEstimatedTime) {
+  DecoderProfile profile(100, 3, &opcode_name);
+  if (profile.begin(100, 4096))
+    profile.end(100, std::chrono::microseconds(10));
+  if (profile.begin(102, 8))
+    profile.end(102, std::chrono::microseconds(100));
+  if (profile.begin(101, 8))
+    profile.end(101, std::chrono::microseconds(50));
+
+  auto top = profile.top(2);
+  ASSERT_EQ(2, top.size());
+  EXPECT_STREQ("third", top[0].name);
+  EXPECT_STREQ("second", top[1].name);
+
+  profile.reset();
+  EXPECT_TRUE(profile.top(2).empty());
+}
+
+TEST(DecoderProfile, CanBeSwitchedOnAndOff) {
+  EXPECT_FALSE(DecoderProfile::enabled());
+  DecoderProfile::setEnabled(true);
+  EXPECT_TRUE(DecoderProfile::enabled());
+  DecoderProfile::setEnabled(false);
+  EXPECT_FALSE(DecoderProfile::enabled());
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "external/android-emugl/shared/OpenglCodecCommon/GLStateShadow.h"
+
+#include <gtest/gtest.h>
+
+TEST(GLStateShadow, AnswersInvariantsOnceStored) {
+  GLStateShadow shadow;
+  GLint value = 0;
+  EXPECT_FALSE(shadow.getIntegerv(GL_MAX_TEXTURE_SIZE, &value));
+
+  const GLint max_texture_size = 4096;
+  shadow.storeIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size, true);
+  EXPECT_TRUE(shadow.getIntegerv(GL_MAX_TEXTURE_SIZE, &value));
+  EXPECT_EQ(max_texture_size, value);
+
+  // Invariants are kept per type as the driver converts them on its own
+  GLfloat float_value = 0.0f;
+  EXPECT_FALSE(shadow.getFloatv(GL_MAX_TEXTURE_SIZE, &float_value));
+
+  // and survive the host working with the context
+  shadow.invalidate();
+  EXPECT_TRUE(shadow.getIntegerv(GL_MAX_TEXTURE_SIZE, &value));
+}
+
+TEST(GLStateShadow, DoesNotStoreUntrackedState) {
+  GLStateShadow shadow;
+  shadow.clearErrorsPossible();
+
+  const GLint texture = 1;
+  shadow.storeIntegerv(GL_TEXTURE_BINDING_2D, &texture, false);
+
+  GLint value = 0;
+  EXPECT_FALSE(shadow.getIntegerv(GL_TEXTURE_BINDING_2D, &value));
+  EXPECT_TRUE(shadow.errorsPossible());
+}
+
+TEST(GLStateShadow, FollowsCapabilities) {
+  GLStateShadow shadow;
+  GLboolean enabled = GL_TRUE;
+  EXPECT_FALSE(shadow.isEnabled(GL_BLEND, &enabled));
+
+  shadow.setEnabled(GL_BLEND, true);
+  EXPECT_TRUE(shadow.isEnabled(GL_BLEND, &enabled));
+  EXPECT_EQ(GL_TRUE, enabled);
+
+  GLint value = 0;
+  EXPECT_TRUE(shadow.getIntegerv(GL_BLEND, &value));
+  EXPECT_EQ(1, value);
+
+  shadow.setEnabled(GL_BLEND, false);
+  EXPECT_TRUE(shadow.isEnabled(GL_BLEND, &enabled));
+  EXPECT_EQ(GL_FALSE, enabled);
+
+  // Unknown capabilities are left to the driver which reports the error
+  shadow.setEnabled(GL_TEXTURE_2D, true);
+  EXPECT_FALSE(shadow.isEnabled(GL_TEXTURE_2D, &enabled));
+}
+
+TEST(GLStateShadow, ClampsViewportLikeTheDriver) {
+  GLStateShadow shadow;
+  const GLint max_viewport_dims[] = {2048, 1024};
+  shadow.setViewport(10, 20, 4096, 512, max_viewport_dims);
+
+  GLint viewport[4] = {0};
+  ASSERT_TRUE(shadow.getIntegerv(GL_VIEWPORT, viewport));
+  EXPECT_EQ(10, viewport[0]);
+  EXPECT_EQ(20, viewport[1]);
+  EXPECT_EQ(2048, viewport[2]);
+  EXPECT_EQ(512, viewport[3]);
+
+  GLfloat float_viewport[4] = {0.0f};
+  ASSERT_TRUE(shadow.getFloatv(GL_VIEWPORT, float_viewport));
+  EXPECT_EQ(2048.0f, float_viewport[2]);
+}
+
+TEST(GLStateShadow, IgnoresCallsTheDriverRejects) {
+  GLStateShadow shadow;
+  const GLint max_viewport_dims[] = {2048, 2048};
+  shadow.setViewport(0, 0, 64, 64, max_viewport_dims);
+  shadow.setViewport(0, 0, -1, 64, max_viewport_dims);
+  shadow.setScissor(0, 0, 32, -1);
+  shadow.setPixelStore(GL_UNPACK_ALIGNMENT, 3);
+  shadow.setActiveTexture(GL_TEXTURE0 + 8, 8);
+
+  GLint viewport[4] = {0};
+  ASSERT_TRUE(shadow.getIntegerv(GL_VIEWPORT, viewport));
+  EXPECT_EQ(64, viewport[2]);
+
+  GLint value = 0;
+  EXPECT_FALSE(shadow.getIntegerv(GL_SCISSOR_BOX, viewport));
+  EXPECT_FALSE(shadow.getIntegerv(GL_UNPACK_ALIGNMENT, &value));
+  EXPECT_FALSE(shadow.getIntegerv(GL_ACTIVE_TEXTURE, &value));
+
+  shadow.setPixelStore(GL_UNPACK_ALIGNMENT, 1);
+  shadow.setActiveTexture(GL_TEXTURE0 + 7, 8);
+  ASSERT_TRUE(shadow.getIntegerv(GL_UNPACK_ALIGNMENT, &value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(shadow.getIntegerv(GL_ACTIVE_TEXTURE, &value));
+  EXPECT_EQ(static_cast<GLint>(GL_TEXTURE0 + 7), value);
+}
+
+TEST(GLStateShadow, TracksWhetherErrorsArePossible) {
+  GLStateShadow shadow;
+  // Nothing is known about a fresh context
+  EXPECT_TRUE(shadow.errorsPossible());
+
+  shadow.clearErrorsPossible();
+  EXPECT_FALSE(shadow.errorsPossible());
+
+  const GLint max_texture_size = 4096;
+  shadow.storeIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size, true);
+  shadow.storeString(GL_VENDOR, "vendor");
+  EXPECT_FALSE(shadow.errorsPossible());
+
+  shadow.markErrorsPossible();
+  EXPECT_TRUE(shadow.errorsPossible());
+}
+
+TEST(GLStateShadow, StoresKnownStringsOnly) {
+  GLStateShadow shadow;
+  shadow.clearErrorsPossible();
+
+  std::string value;
+  EXPECT_FALSE(shadow.getString(GL_VENDOR, &value));
+  shadow.storeString(GL_VENDOR, "vendor");
+  EXPECT_TRUE(shadow.getString(GL_VENDOR, &value));
+  EXPECT_EQ("vendor", value);
+
+  shadow.storeString(GL_TEXTURE_2D, "invalid");
+  EXPECT_FALSE(shadow.getString(GL_TEXTURE_2D, &value));
+  EXPECT_TRUE(shadow.errorsPossible());
+}
+
+TEST(GLStateShadow, InvalidateForgetsTrackedState) {
+  GLStateShadow shadow;
+  shadow.setEnabled(GL_DEPTH_TEST, true);
+  shadow.setScissor(1, 2, 3, 4);
+  shadow.clearErrorsPossible();
+
+  shadow.invalidate();
+
+  GLboolean enabled = GL_FALSE;
+  GLint scissor[4] = {0};
+  EXPECT_FALSE(shadow.isEnabled(GL_DEPTH_TEST, &enabled));
+  EXPECT_FALSE(shadow.getIntegerv(GL_SCISSOR_BOX, scissor));
+  EXPECT_TRUE(shadow.errorsPossible());
+}
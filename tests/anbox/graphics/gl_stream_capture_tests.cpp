@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/gl_stream_capture.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+
+namespace anbox {
+namespace graphics {
+TEST(GLStreamCapture, RecordedStreamCanBeReadBack) {
+  const auto directory = fs::temp_directory_path() / fs::unique_path();
+  fs::create_directories(directory);
+  const auto path = GLStreamCapture::make_path(directory.string());
+
+  const std::vector<std::uint8_t> first{0x10, 0x27, 0x00, 0x00};
+  const std::vector<std::uint8_t> second{0x08, 0x00, 0x00, 0x00};
+  {
+    GLStreamCapture capture(path, 0x1);
+    capture.record(first.data(), first.size());
+    capture.record(second.data(), second.size());
+    EXPECT_EQ(8u, capture.bytes_recorded());
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  GLStreamCapture::Header header;
+  ASSERT_TRUE(GLStreamCapture::read_header(in, &header));
+  EXPECT_EQ(0x1u, header.client_flags);
+
+  std::vector<std::uint8_t> data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  std::vector<std::uint8_t> expected{first};
+  expected.insert(expected.end(), second.begin(), second.end());
+  EXPECT_EQ(expected, data);
+
+  fs::remove_all(directory);
+}
+
+TEST(GLStreamCapture, RejectsUnknownFiles) {
+  std::stringstream in("this is not a capture");
+  GLStreamCapture::Header header;
+  EXPECT_FALSE(GLStreamCapture::read_header(in, &header));
+}
+}  // namespace graphics
+}  // namespace anbox
@@ -28,6 +28,10 @@
 #include "anbox/graphics/layer_composer.h"
 #include "anbox/graphics/multi_window_composer_strategy.h"
 
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
 using namespace ::testing;
 
 namespace {
@@ -36,6 +40,18 @@ class MockRenderer : public anbox::graphics::Renderer {
   MOCK_METHOD3(draw, bool(EGLNativeWindowType, const anbox::graphics::Rect&,
                           const RenderableList&));
 };
+
+class SingleWindowStrategy : public anbox::graphics::LayerComposer::Strategy {
+ public:
+  SingleWindowStrategy(const std::shared_ptr<anbox::wm::Window> &window) : window_(window) {}
+
+  WindowRenderableList process_layers(const RenderableList &renderables) override {
+    return {{window_, renderables}};
+  }
+
+ private:
+  std::shared_ptr<anbox::wm::Window> window_;
+};
 }
 
 namespace anbox {
@@ -339,5 +355,147 @@ TEST(LayerComposer, ResizeOverShouldUseNewRender) {
   composer.submit_layers(renderables_second);
   EXPECT_TRUE(window->checkResizeable() == false);
 }
+
+TEST(LayerComposer, AsynchronousModeComposesNewestFrameOnly) {
+  auto renderer = std::make_shared<MockRenderer>();
+  auto window = std::make_shared<wm::Window>(nullptr, wm::Task::Id{1}, Rect{0, 0, 1024, 768}, "org.anbox.test.1");
+
+  RenderableList first_frame = {
+    {"org.anbox.surface.1", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList second_frame = {
+    {"org.anbox.surface.2", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList third_frame = {
+    {"org.anbox.surface.3", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  // Keep the compositor thread busy with the first frame until we've
+  // submitted the others so that the second one gets replaced.
+  std::mutex lock;
+  std::condition_variable cv;
+  bool first_frame_drawing = false;
+  bool release_first_frame = false;
+  std::promise<void> last_frame_drawn;
+
+  InSequence s;
+  EXPECT_CALL(*renderer, draw(_, Rect{0, 0, 1024, 768}, first_frame))
+      .Times(1)
+      .WillOnce(Invoke([&](EGLNativeWindowType, const Rect&, const RenderableList&) {
+        std::unique_lock<std::mutex> l(lock);
+        first_frame_drawing = true;
+        cv.notify_all();
+        cv.wait(l, [&]() { return release_first_frame; });
+        return true;
+      }));
+  EXPECT_CALL(*renderer, draw(_, Rect{0, 0, 1024, 768}, third_frame))
+      .Times(1)
+      .WillOnce(Invoke([&](EGLNativeWindowType, const Rect&, const RenderableList&) {
+        last_frame_drawn.set_value();
+        return true;
+      }));
+
+  LayerComposer composer(renderer, std::make_shared<SingleWindowStrategy>(window),
+                         LayerComposer::Mode::Asynchronous);
+
+  composer.submit_layers(first_frame);
+  {
+    std::unique_lock<std::mutex> l(lock);
+    cv.wait(l, [&]() { return first_frame_drawing; });
+  }
+
+  composer.submit_layers(second_frame);
+  composer.submit_layers(third_frame);
+  EXPECT_EQ(1u, composer.queue_depth());
+  EXPECT_EQ(1u, composer.dropped_frames());
+
+  {
+    std::unique_lock<std::mutex> l(lock);
+    release_first_frame = true;
+  }
+  cv.notify_all();
+
+  ASSERT_EQ(std::future_status::ready,
+            last_frame_drawn.get_future().wait_for(std::chrono::seconds(5)));
+  EXPECT_EQ(0u, composer.queue_depth());
+}
+
+TEST(LayerComposer, SynchronousModeHasNoQueue) {
+  auto renderer = std::make_shared<MockRenderer>();
+  auto window = std::make_shared<wm::Window>(nullptr, wm::Task::Id{1}, Rect{0, 0, 1024, 768}, "org.anbox.test.1");
+
+  RenderableList first_frame = {
+    {"org.anbox.surface.1", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList second_frame = {
+    {"org.anbox.surface.1", 1, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  InSequence s;
+  EXPECT_CALL(*renderer, draw(_, Rect{0, 0, 1024, 768}, first_frame))
+      .Times(1)
+      .WillOnce(Return(true));
+  EXPECT_CALL(*renderer, draw(_, Rect{0, 0, 1024, 768}, second_frame))
+      .Times(1)
+      .WillOnce(Return(true));
+
+  LayerComposer composer(renderer, std::make_shared<SingleWindowStrategy>(window));
+  composer.submit_layers(first_frame);
+  composer.submit_layers(second_frame);
+
+  EXPECT_EQ(0u, composer.queue_depth());
+  EXPECT_EQ(0u, composer.dropped_frames());
+  EXPECT_EQ(2u, composer.composed_frames());
+}
+
+TEST(LayerComposer, SkipsWindowsWithoutChanges) {
+  auto renderer = std::make_shared<MockRenderer>();
+  auto window = std::make_shared<wm::Window>(nullptr, wm::Task::Id{1}, Rect{0, 0, 1024, 768}, "org.anbox.test.1");
+
+  RenderableList frame = {
+    {"org.anbox.surface.1", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+  RenderableList changed_frame = {
+    {"org.anbox.surface.1", 1, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  InSequence s;
+  EXPECT_CALL(*renderer, draw(_, Rect{0, 0, 1024, 768}, frame))
+      .Times(1)
+      .WillOnce(Return(true));
+  EXPECT_CALL(*renderer, draw(_, Rect{0, 0, 1024, 768}, changed_frame))
+      .Times(1)
+      .WillOnce(Return(true));
+
+  LayerComposer composer(renderer, std::make_shared<SingleWindowStrategy>(window));
+  composer.submit_layers(frame);
+  composer.submit_layers(frame);
+  composer.submit_layers(changed_frame);
+
+  EXPECT_EQ(3u, composer.composed_frames());
+  EXPECT_EQ(1u, composer.skipped_windows());
+}
+
+TEST(LayerComposer, RedrawsInvalidatedWindows) {
+  auto renderer = std::make_shared<MockRenderer>();
+  auto window = std::make_shared<wm::Window>(nullptr, wm::Task::Id{1}, Rect{0, 0, 1024, 768}, "org.anbox.test.1");
+
+  RenderableList frame = {
+    {"org.anbox.surface.1", 0, 1.0f, {0, 0, 1024, 768}, {0, 0, 1024, 768}},
+  };
+
+  EXPECT_CALL(*renderer, draw(_, Rect{0, 0, 1024, 768}, frame))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  LayerComposer composer(renderer, std::make_shared<SingleWindowStrategy>(window));
+  composer.submit_layers(frame);
+  // Like when the host exposes the window again
+  window->invalidate();
+  composer.submit_layers(frame);
+  composer.submit_layers(frame);
+
+  EXPECT_EQ(1u, composer.skipped_windows());
+}
 }  // namespace graphics
 }  // namespace anbox
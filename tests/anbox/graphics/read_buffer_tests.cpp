@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/ReadBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+namespace {
+// Hands out the queued data in pieces of at most the requested size
+class FakeStream : public IOStream {
+ public:
+  FakeStream() : IOStream(0) {}
+
+  void *allocBuffer(size_t) override { return nullptr; }
+  size_t commitBuffer(size_t size) override { return size; }
+  void forceStop() override {}
+
+  const unsigned char *read(void *buf, size_t *inout_len) override {
+    if (data_.empty())
+      return nullptr;
+    const auto len = std::min(*inout_len, data_.size());
+    std::copy(data_.begin(), data_.begin() + len, static_cast<unsigned char*>(buf));
+    data_.erase(data_.begin(), data_.begin() + len);
+    *inout_len = len;
+    return static_cast<const unsigned char*>(buf);
+  }
+
+  // Queues a command with the usual opcode and size header
+  void push_command(uint32_t opcode, uint32_t size) {
+    std::vector<unsigned char> command(size, 0xab);
+    std::memcpy(command.data(), &opcode, sizeof(opcode));
+    std::memcpy(command.data() + sizeof(opcode), &size, sizeof(size));
+    data_.insert(data_.end(), command.begin(), command.end());
+  }
+
+ private:
+  std::deque<unsigned char> data_;
+};
+
+uint32_t command_size(const ReadBuffer &buffer) {
+  uint32_t size = 0;
+  std::memcpy(&size, buffer.buf() + sizeof(uint32_t), sizeof(size));
+  return size;
+}
+}  // namespace
+
+TEST(ReadBuffer, StartsSmall) {
+  ReadBuffer buffer;
+  ASSERT_EQ(ReadBuffer::kInitialSize, buffer.size());
+}
+
+TEST(ReadBuffer, GrowsToFitOversizedCommand) {
+  FakeStream stream;
+  const uint32_t size = 3 * 1024 * 1024 + 100;
+  stream.push_command(1, size);
+
+  ReadBuffer buffer;
+  while (buffer.validData() < size)
+    ASSERT_GT(buffer.getData(&stream), 0);
+
+  ASSERT_EQ(size, command_size(buffer));
+  // Grown to what the command needs rather than doubled
+  ASSERT_LT(buffer.size(), size + 4096);
+  ASSERT_EQ(buffer.size(), buffer.highWaterMark());
+
+  buffer.consume(size);
+
+  // A client sending large commands in a row doesn't make the buffer
+  // grow again for each of them
+  const auto grown_size = buffer.size();
+  stream.push_command(2, 64);
+  ASSERT_EQ(64, buffer.getData(&stream));
+  ASSERT_EQ(grown_size, buffer.size());
+}
+
+TEST(ReadBuffer, ShrinksWhenIdle) {
+  FakeStream stream;
+  const uint32_t size = 3 * 1024 * 1024;
+  stream.push_command(1, size);
+
+  ReadBuffer buffer;
+  while (buffer.validData() < size)
+    ASSERT_GT(buffer.getData(&stream), 0);
+  buffer.consume(size);
+
+  std::this_thread::sleep_for(ReadBuffer::kShrinkDelay + std::chrono::milliseconds(10));
+
+  stream.push_command(2, 64);
+  ASSERT_EQ(64, buffer.getData(&stream));
+  ASSERT_EQ(ReadBuffer::kInitialSize, buffer.size());
+  ASSERT_GT(buffer.highWaterMark(), buffer.size());
+}
+
+TEST(ReadBuffer, KeepsPartialCommandWhenGrowing) {
+  FakeStream stream;
+  stream.push_command(1, 100);
+  stream.push_command(2, 2 * ReadBuffer::kInitialSize);
+
+  ReadBuffer buffer;
+  ASSERT_GT(buffer.getData(&stream), 0);
+  buffer.consume(100);
+
+  while (buffer.validData() < 2 * ReadBuffer::kInitialSize)
+    ASSERT_GT(buffer.getData(&stream), 0);
+
+  uint32_t opcode = 0;
+  std::memcpy(&opcode, buffer.buf(), sizeof(opcode));
+  ASSERT_EQ(2u, opcode);
+  ASSERT_EQ(2 * ReadBuffer::kInitialSize, command_size(buffer));
+}
+
+TEST(ReadBuffer, ShrinksRightAwayWhenOverThreshold) {
+  FakeStream stream;
+  const uint32_t size = 512 * 1024;
+  stream.push_command(1, size);
+
+  ReadBuffer buffer;
+  while (buffer.validData() < size)
+    ASSERT_GT(buffer.getData(&stream), 0);
+  buffer.consume(size);
+
+  // Recently used buffers are kept while below the threshold
+  stream.push_command(2, 64);
+  ASSERT_EQ(64, buffer.getData(&stream));
+  ASSERT_GT(buffer.size(), ReadBuffer::kInitialSize);
+  buffer.consume(64);
+
+  ReadBuffer::setShrinkThreshold(ReadBuffer::kInitialSize);
+  stream.push_command(3, 64);
+  ASSERT_EQ(64, buffer.getData(&stream));
+  ASSERT_EQ(ReadBuffer::kInitialSize, buffer.size());
+  ReadBuffer::setShrinkThreshold(ReadBuffer::kDefaultShrinkThreshold);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/graphics/emugl/RenderContext.h"
+#include "anbox/graphics/emugl/DispatchTables.h"
+
+#include "external/android-emugl/host/include/OpenGLESDispatch/EGLDispatch.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+// Stands in for the host EGL and GLESv2 libraries and tracks which
+// context is current when buffers get deleted.
+struct FakeGL {
+  int context_storage = 0;
+  EGLContext context = &context_storage;
+  int other_context_storage = 0;
+  EGLContext other_context = &other_context_storage;
+
+  EGLContext current = EGL_NO_CONTEXT;
+  std::vector<GLuint> deleted;
+  EGLContext deleted_while = EGL_NO_CONTEXT;
+  bool destroyed = false;
+  bool deleted_after_destroy = false;
+};
+
+FakeGL *fake = nullptr;
+
+class RenderContextTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    saved_egl_ = s_egl;
+    saved_gles2_ = s_gles2;
+    fake = &fake_;
+
+    s_egl.eglCreateContext = [](EGLDisplay, EGLConfig, EGLContext, const EGLint*) -> EGLContext {
+      return fake->context;
+    };
+    s_egl.eglDestroyContext = [](EGLDisplay, EGLContext) -> EGLBoolean {
+      fake->destroyed = true;
+      return EGL_TRUE;
+    };
+    s_egl.eglMakeCurrent = [](EGLDisplay, EGLSurface, EGLSurface, EGLContext context) -> EGLBoolean {
+      fake->current = context;
+      return EGL_TRUE;
+    };
+    s_egl.eglGetCurrentContext = []() -> EGLContext { return fake->current; };
+    s_egl.eglGetCurrentSurface = [](EGLint) -> EGLSurface { return EGL_NO_SURFACE; };
+    s_egl.eglGetError = []() -> EGLint { return EGL_SUCCESS; };
+    s_gles2.glDeleteBuffers = [](GLsizei n, const GLuint *buffers) {
+      fake->deleted.insert(fake->deleted.end(), buffers, buffers + n);
+      fake->deleted_while = fake->current;
+      fake->deleted_after_destroy = fake->destroyed;
+    };
+  }
+
+  void TearDown() override {
+    s_egl = saved_egl_;
+    s_gles2 = saved_gles2_;
+    fake = nullptr;
+  }
+
+  RenderContext *create_with_cached_buffers() {
+    auto context = RenderContext::create(EGL_NO_DISPLAY, nullptr, EGL_NO_CONTEXT, true);
+    auto &cache = context->decoderContextData().vertexDataCache();
+    std::vector<GLuint> evicted;
+    cache.reserve(256, &evicted);
+    cache.insert(VertexDataCache::Digest{1, 1}, 256, 10);
+    cache.reserve(256, &evicted);
+    cache.insert(VertexDataCache::Digest{2, 2}, 256, 11);
+    return context;
+  }
+
+  FakeGL fake_;
+  EGLDispatch saved_egl_;
+  GLESv2Dispatch saved_gles2_;
+};
+}  // namespace
+
+TEST_F(RenderContextTest, DeletesCachedBuffersWhileCurrent) {
+  fake_.current = fake_.other_context;
+  delete create_with_cached_buffers();
+
+  EXPECT_EQ((std::vector<GLuint>{11, 10}), fake_.deleted);
+  EXPECT_EQ(fake_.context, fake_.deleted_while);
+  EXPECT_FALSE(fake_.deleted_after_destroy);
+  EXPECT_TRUE(fake_.destroyed);
+  // Whatever was bound before is bound again
+  EXPECT_EQ(fake_.other_context, fake_.current);
+}
+
+TEST_F(RenderContextTest, KeepsBindingWithoutCachedBuffers) {
+  fake_.current = fake_.other_context;
+  delete RenderContext::create(EGL_NO_DISPLAY, nullptr, EGL_NO_CONTEXT, true);
+
+  EXPECT_TRUE(fake_.deleted.empty());
+  EXPECT_TRUE(fake_.destroyed);
+  EXPECT_EQ(fake_.other_context, fake_.current);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/RendererWindowStats.h"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono;
+
+TEST(RendererWindowStats, StartsEmpty) {
+  anbox::stats::Registry registry;
+  RendererWindowStats stats{registry};
+
+  ASSERT_EQ(0u, stats.frames());
+  ASSERT_EQ(0, stats.last_present_us());
+  ASSERT_EQ(0, stats.max_present_us());
+  ASSERT_EQ(0, stats.average_present_us());
+}
+
+TEST(RendererWindowStats, TracksPresentLatency) {
+  anbox::stats::Registry registry;
+  RendererWindowStats stats{registry};
+
+  const auto start = steady_clock::now();
+  stats.record(300, start);
+  stats.record(900, start + milliseconds(16));
+  stats.record(600, start + milliseconds(32));
+
+  ASSERT_EQ(3u, stats.frames());
+  ASSERT_EQ(600, stats.last_present_us());
+  ASSERT_EQ(900, stats.max_present_us());
+  ASSERT_EQ(600, stats.average_present_us());
+}
+
+TEST(RendererWindowStats, PublishesFramesToRegistry) {
+  anbox::stats::Registry registry;
+  RendererWindowStats first{registry};
+  RendererWindowStats second{registry};
+
+  const auto start = steady_clock::now();
+  first.record(300, start);
+  first.record(500, start + milliseconds(16));
+  second.record(700, start);
+
+  // Frames of all windows add up
+  ASSERT_EQ(3u, registry.counter("anbox_renderer_frames_total", "").value());
+
+  const auto present = registry.histogram("anbox_renderer_present_duration_us", "",
+                                          anbox::stats::Histogram::exponential_bounds(250, 9))
+                           .snapshot();
+  ASSERT_EQ(3u, present.count);
+  ASSERT_EQ(1500u, present.sum);
+
+  // Only windows which presented before have an interval to report
+  const auto interval = registry.histogram("anbox_renderer_frame_interval_us", "",
+                                           anbox::stats::Histogram::exponential_bounds(1000, 10))
+                            .snapshot();
+  ASSERT_EQ(1u, interval.count);
+  ASSERT_EQ(16000u, interval.sum);
+}
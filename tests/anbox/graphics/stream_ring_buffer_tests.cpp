@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/stream_ring_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace anbox {
+namespace graphics {
+TEST(StreamRingBuffer, CommittedDataIsReadable) {
+  StreamRingBuffer ring(4096);
+
+  size_t size = 0;
+  auto dst = ring.prepare(&size);
+  ASSERT_NE(nullptr, dst);
+  ASSERT_EQ(ring.capacity(), size);
+
+  std::memcpy(dst, "abcd", 4);
+  ring.commit(4);
+
+  size_t avail = 0;
+  auto src = ring.wait_for_data(0, &avail);
+  ASSERT_NE(nullptr, src);
+  ASSERT_EQ(4u, avail);
+  ASSERT_EQ(0, std::memcmp(src, "abcd", 4));
+
+  ring.consume(4);
+  ASSERT_EQ(0u, ring.readable());
+}
+
+TEST(StreamRingBuffer, DataWrappingAroundIsContiguous) {
+  StreamRingBuffer ring(4096);
+  const auto capacity = ring.capacity();
+
+  // Move the read and write position close to the end of the ring.
+  size_t size = 0;
+  ring.prepare(&size);
+  ring.commit(capacity - 8);
+  size_t avail = 0;
+  ring.wait_for_data(0, &avail);
+  ring.consume(capacity - 8);
+
+  std::vector<std::uint8_t> data(32);
+  std::iota(data.begin(), data.end(), 0);
+
+  auto dst = ring.prepare(&size);
+  ASSERT_EQ(capacity, size);
+  std::memcpy(dst, data.data(), data.size());
+  ring.commit(data.size());
+
+  auto src = ring.wait_for_data(0, &avail);
+  ASSERT_EQ(data.size(), avail);
+  ASSERT_EQ(0, std::memcmp(src, data.data(), data.size()));
+}
+
+TEST(StreamRingBuffer, GrowsWhenConsumerNeedsMoreThanCapacity) {
+  StreamRingBuffer ring(4096);
+  const auto capacity = ring.capacity();
+
+  std::vector<std::uint8_t> data(capacity + 100);
+  std::iota(data.begin(), data.end(), 0);
+
+  std::thread producer([&]() {
+    size_t written = 0;
+    while (written < data.size()) {
+      size_t size = 0;
+      auto dst = ring.prepare(&size);
+      ASSERT_NE(nullptr, dst);
+      size = std::min(size, data.size() - written);
+      std::memcpy(dst, data.data() + written, size);
+      ring.commit(size);
+      written += size;
+    }
+  });
+
+  // Like a decoder waiting for the rest of a command which doesn't fit
+  // into the ring we never consume anything.
+  size_t have = 0;
+  const std::uint8_t *src = nullptr;
+  while (have < data.size()) {
+    src = ring.wait_for_data(have, &have);
+    ASSERT_NE(nullptr, src);
+  }
+
+  producer.join();
+
+  ASSERT_GT(ring.capacity(), capacity);
+  ASSERT_EQ(data.size(), have);
+  ASSERT_EQ(0, std::memcmp(src, data.data(), data.size()));
+}
+
+TEST(StreamRingBuffer, CloseWakesUpConsumer) {
+  StreamRingBuffer ring(4096);
+
+  std::thread closer([&]() { ring.close(); });
+
+  size_t avail = 0;
+  ASSERT_EQ(nullptr, ring.wait_for_data(0, &avail));
+  closer.join();
+
+  size_t size = 0;
+  ASSERT_EQ(nullptr, ring.prepare(&size));
+}
+}  // namespace graphics
+}  // namespace anbox
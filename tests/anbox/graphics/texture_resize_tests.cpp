@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/graphics/emugl/TextureResize.h"
+
+#include <gtest/gtest.h>
+
+TEST(TextureResize, NoScalingForSmallerBuffers) {
+  ASSERT_EQ(1u, TextureResize::computeFactor(1024, 768, {0, 0, 1024, 768}));
+  ASSERT_EQ(1u, TextureResize::computeFactor(1024, 768, {0, 0, 600, 400}));
+  ASSERT_EQ(1u, TextureResize::computeFactor(256, 256, {0, 0, 1920, 1080}));
+}
+
+TEST(TextureResize, ScalesToJustLargerThanViewport) {
+  ASSERT_EQ(2u, TextureResize::computeFactor(2048, 1536, {0, 0, 1024, 768}));
+  ASSERT_EQ(4u, TextureResize::computeFactor(4096, 4096, {0, 0, 800, 800}));
+}
+
+TEST(TextureResize, LimitsFactor) {
+  ASSERT_EQ(16u, TextureResize::computeFactor(8192, 8192, {0, 0, 16, 16}));
+}
+
+TEST(TextureResize, HandlesRotatedViewport) {
+  ASSERT_EQ(2u, TextureResize::computeFactor(2048, 1024, {0, 0, 512, 1024}));
+}
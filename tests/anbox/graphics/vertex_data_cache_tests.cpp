@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "external/android-emugl/shared/OpenglCodecCommon/VertexDataCache.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+VertexDataCache::Digest digest(std::uint64_t hash, std::uint64_t check = 0) {
+  return VertexDataCache::Digest{hash, check};
+}
+
+class VertexDataCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override { VertexDataCache::setCapacity(1024); }
+  void TearDown() override { VertexDataCache::setCapacity(VertexDataCache::kDefaultCapacity); }
+
+  void add(VertexDataCache &cache, std::uint64_t hash, std::size_t size, GLuint buffer) {
+    std::vector<GLuint> evicted;
+    ASSERT_TRUE(cache.reserve(size, &evicted));
+    ASSERT_TRUE(evicted.empty());
+    cache.insert(digest(hash), size, buffer);
+  }
+};
+}  // namespace
+
+TEST_F(VertexDataCacheTest, DigestSeesDifferencesInAllBits) {
+  const float a[] = {1.0f, 1.0f, 1.0f, 1.0f};
+  const float b[] = {1.0f, -1.0f, 1.0f, 1.0f};
+  const float c[] = {1.0f, 1.0f, 1.0f, -1.0f};
+  const auto da = VertexDataCache::digest(a, sizeof(a));
+  const auto db = VertexDataCache::digest(b, sizeof(b));
+  const auto dc = VertexDataCache::digest(c, sizeof(c));
+  EXPECT_TRUE(da == VertexDataCache::digest(a, sizeof(a)));
+  EXPECT_NE(da.hash, db.hash);
+  EXPECT_NE(da.check, db.check);
+  EXPECT_NE(da.hash, dc.hash);
+  EXPECT_NE(da.check, dc.check);
+  EXPECT_NE(db.hash, dc.hash);
+  EXPECT_NE(db.check, dc.check);
+  EXPECT_FALSE(da == VertexDataCache::digest(a, sizeof(a) - 1));
+}
+
+TEST_F(VertexDataCacheTest, CheckSeesSwappedWords) {
+  const std::uint64_t a[] = {1, 2, 3, 4};
+  const std::uint64_t b[] = {2, 1, 3, 4};
+  EXPECT_NE(VertexDataCache::digest(a, sizeof(a)).check,
+            VertexDataCache::digest(b, sizeof(b)).check);
+}
+
+TEST_F(VertexDataCacheTest, FindsBuffersByDigestAndSize) {
+  VertexDataCache cache;
+  EXPECT_EQ(0u, cache.lookup(digest(1), 256));
+
+  add(cache, 1, 256, 10);
+  EXPECT_EQ(10u, cache.lookup(digest(1), 256));
+  EXPECT_EQ(0u, cache.lookup(digest(1), 128));
+  EXPECT_EQ(0u, cache.lookup(digest(2), 256));
+  // Data colliding in the hash only is still a miss
+  EXPECT_EQ(0u, cache.lookup(digest(1, 1), 256));
+  EXPECT_EQ(256u, cache.size());
+}
+
+TEST_F(VertexDataCacheTest, EvictsLeastRecentlyUsedFirst) {
+  VertexDataCache cache;
+  add(cache, 1, 512, 10);
+  add(cache, 2, 256, 11);
+  add(cache, 3, 256, 12);
+  // Using the oldest buffer keeps it around
+  EXPECT_EQ(10u, cache.lookup(digest(1), 512));
+
+  std::vector<GLuint> evicted;
+  ASSERT_TRUE(cache.reserve(512, &evicted));
+  EXPECT_EQ((std::vector<GLuint>{11, 12}), evicted);
+  EXPECT_EQ(0u, cache.lookup(digest(2), 256));
+  EXPECT_EQ(0u, cache.lookup(digest(3), 256));
+  EXPECT_EQ(512u, cache.size());
+}
+
+TEST_F(VertexDataCacheTest, KeepsBuffersAttributesPointTo) {
+  VertexDataCache cache;
+  add(cache, 1, 512, 10);
+  add(cache, 2, 512, 11);
+  cache.attachAttrib(0, digest(1), 512);
+  cache.attachAttrib(1, digest(2), 512);
+
+  std::vector<GLuint> evicted;
+  EXPECT_FALSE(cache.reserve(256, &evicted));
+  EXPECT_TRUE(evicted.empty());
+
+  // Pointing the attribute elsewhere allows to evict the buffer again
+  cache.detachAttrib(0);
+  EXPECT_TRUE(cache.reserve(256, &evicted));
+  EXPECT_EQ((std::vector<GLuint>{10}), evicted);
+
+  // Attaching another buffer to an attribute releases the previous one
+  evicted.clear();
+  cache.insert(digest(3), 256, 12);
+  cache.attachAttrib(1, digest(3), 256);
+  EXPECT_TRUE(cache.reserve(512, &evicted));
+  EXPECT_EQ((std::vector<GLuint>{11}), evicted);
+}
+
+TEST_F(VertexDataCacheTest, RejectsDataLargerThanTheCapacity) {
+  VertexDataCache cache;
+  std::vector<GLuint> evicted;
+  EXPECT_FALSE(cache.reserve(2048, &evicted));
+
+  VertexDataCache::setCapacity(0);
+  EXPECT_FALSE(cache.reserve(VertexDataCache::kMinDataSize, &evicted));
+  EXPECT_TRUE(evicted.empty());
+}
+
+TEST_F(VertexDataCacheTest, OnlyRecentlySeenDataIsWorthABuffer) {
+  VertexDataCache cache;
+  EXPECT_FALSE(cache.seenRecently(digest(1), 256));
+  EXPECT_TRUE(cache.seenRecently(digest(1), 256));
+  // Same hash but different data
+  EXPECT_FALSE(cache.seenRecently(digest(1, 1), 256));
+  EXPECT_FALSE(cache.seenRecently(digest(1), 512));
+
+  // Data seen too long ago counts as new again
+  for (std::uint64_t n = 0; n < VertexDataCache::kRecentDigests; n++)
+    EXPECT_FALSE(cache.seenRecently(digest(100 + n), 256));
+  EXPECT_FALSE(cache.seenRecently(digest(1), 256));
+  EXPECT_TRUE(cache.seenRecently(digest(1), 256));
+}
+
+TEST_F(VertexDataCacheTest, ClearHandsOutAllBuffers) {
+  VertexDataCache cache;
+  add(cache, 1, 256, 10);
+  add(cache, 2, 256, 11);
+  cache.attachAttrib(0, digest(1), 256);
+
+  std::vector<GLuint> buffers;
+  cache.clear(&buffers);
+  EXPECT_EQ((std::vector<GLuint>{11, 10}), buffers);
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(0u, cache.lookup(digest(1), 256));
+
+  // Nothing is held back for the attribute anymore
+  std::vector<GLuint> evicted;
+  EXPECT_TRUE(cache.reserve(1024, &evicted));
+  EXPECT_TRUE(evicted.empty());
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/input/device.h"
+#include "anbox/input/event_coalescer.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+struct timespec at(long usec) {
+  struct timespec spec;
+  spec.tv_sec = 0;
+  spec.tv_nsec = usec * 1000;
+  return spec;
+}
+
+std::vector<anbox::input::Event> touch_motion(std::int32_t x, std::int32_t y) {
+  return {{EV_ABS, ABS_MT_POSITION_X, x},
+          {EV_ABS, ABS_MT_POSITION_Y, y},
+          {EV_SYN, SYN_REPORT, 0}};
+}
+}  // namespace
+
+namespace anbox {
+namespace input {
+TEST(EventCoalescer, MergesConsecutiveMotion) {
+  EventCoalescer coalescer(64);
+  ASSERT_TRUE(coalescer.push({{EV_ABS, ABS_MT_SLOT, 0},
+                              {EV_ABS, ABS_MT_POSITION_X, 10},
+                              {EV_ABS, ABS_MT_POSITION_Y, 20},
+                              {EV_SYN, SYN_REPORT, 0}}, at(1)));
+  ASSERT_TRUE(coalescer.push(touch_motion(11, 21), at(2)));
+  ASSERT_TRUE(coalescer.push(touch_motion(12, 22), at(3)));
+
+  ASSERT_EQ(4u, coalescer.size());
+  ASSERT_EQ(6u, coalescer.coalesced());
+
+  const auto events = coalescer.data();
+  ASSERT_EQ(ABS_MT_SLOT, events[0].code);
+  ASSERT_EQ(12u, events[1].value);
+  ASSERT_EQ(22u, events[2].value);
+  ASSERT_EQ(SYN_REPORT, events[3].code);
+  ASSERT_EQ(3u, events[3].usec);
+}
+
+TEST(EventCoalescer, AddsUpRelativeMotion) {
+  EventCoalescer coalescer(64);
+  for (int n = 0; n < 3; n++) {
+    ASSERT_TRUE(coalescer.push({{EV_ABS, ABS_X, 100 + n},
+                                {EV_ABS, ABS_Y, 200 + n},
+                                {EV_REL, REL_X, 2},
+                                {EV_REL, REL_Y, -1},
+                                {EV_SYN, SYN_REPORT, 0}}, at(n)));
+  }
+
+  ASSERT_EQ(5u, coalescer.size());
+  const auto events = coalescer.data();
+  ASSERT_EQ(102u, events[0].value);
+  ASSERT_EQ(202u, events[1].value);
+  ASSERT_EQ(6, static_cast<std::int32_t>(events[2].value));
+  ASSERT_EQ(-3, static_cast<std::int32_t>(events[3].value));
+}
+
+TEST(EventCoalescer, KeepsStateChanges) {
+  EventCoalescer coalescer(64);
+  ASSERT_TRUE(coalescer.push({{EV_ABS, ABS_MT_SLOT, 0},
+                              {EV_ABS, ABS_MT_TRACKING_ID, 1},
+                              {EV_ABS, ABS_MT_POSITION_X, 10},
+                              {EV_ABS, ABS_MT_POSITION_Y, 20},
+                              {EV_SYN, SYN_REPORT, 0}}, at(1)));
+  // Motion after a finger down is not merged into it
+  ASSERT_TRUE(coalescer.push(touch_motion(11, 21), at(2)));
+  ASSERT_TRUE(coalescer.push({{EV_ABS, ABS_MT_TRACKING_ID, -1},
+                              {EV_SYN, SYN_REPORT, 0}}, at(3)));
+  // Nor is motion merged across a finger up
+  ASSERT_TRUE(coalescer.push(touch_motion(12, 22), at(4)));
+
+  ASSERT_EQ(13u, coalescer.size());
+  ASSERT_EQ(0u, coalescer.coalesced());
+}
+
+TEST(EventCoalescer, DoesNotMergeMotionOfDifferentSlots) {
+  EventCoalescer coalescer(64);
+  ASSERT_TRUE(coalescer.push(touch_motion(10, 20), at(1)));
+  ASSERT_TRUE(coalescer.push({{EV_ABS, ABS_MT_SLOT, 1},
+                              {EV_ABS, ABS_MT_POSITION_X, 30},
+                              {EV_ABS, ABS_MT_POSITION_Y, 40},
+                              {EV_SYN, SYN_REPORT, 0}}, at(2)));
+  ASSERT_TRUE(coalescer.push(touch_motion(31, 41), at(3)));
+
+  ASSERT_EQ(7u, coalescer.size());
+  ASSERT_EQ(3u, coalescer.coalesced());
+  ASSERT_EQ(31u, coalescer.data()[4].value);
+}
+
+TEST(EventCoalescer, NothingIsMergedIntoSentEvents) {
+  EventCoalescer coalescer(64);
+  ASSERT_TRUE(coalescer.push(touch_motion(10, 20), at(1)));
+  coalescer.clear();
+  ASSERT_TRUE(coalescer.empty());
+  ASSERT_TRUE(coalescer.push(touch_motion(11, 21), at(2)));
+  ASSERT_EQ(3u, coalescer.size());
+}
+
+TEST(EventCoalescer, RefusesEventsBeyondCapacity) {
+  EventCoalescer coalescer(4);
+  ASSERT_TRUE(coalescer.push({{EV_KEY, BTN_LEFT, 1}, {EV_SYN, SYN_REPORT, 0}}, at(1)));
+  ASSERT_FALSE(coalescer.push({{EV_KEY, BTN_LEFT, 0}, {EV_ABS, ABS_X, 1}, {EV_SYN, SYN_REPORT, 0}}, at(2)));
+  ASSERT_EQ(2u, coalescer.size());
+}
+}  // namespace input
+}  // namespace anbox
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/async_log_writer.h"
+#include "anbox/logger.h"
+
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace {
+struct RecordingLogger : public anbox::Logger {
+  void Init(const Severity &severity) override { SetSeverity(severity); }
+
+  void Log(Severity severity, const std::string &message,
+           const boost::optional<Location> &) override {
+    messages.push_back({severity, message});
+  }
+
+  std::vector<std::pair<Severity, std::string>> messages;
+};
+
+int count_evaluation(int *evaluated) {
+  (*evaluated)++;
+  return *evaluated;
+}
+
+anbox::AsyncLogWriter::Record make_record(const std::string &message) {
+  return {anbox::Logger::Severity::kInfo, boost::posix_time::ptime{}, message, boost::none};
+}
+}  // namespace
+
+namespace anbox {
+TEST(Logger, FilteredMessagesAreNotFormatted) {
+  auto logger = std::make_shared<RecordingLogger>();
+  logger->Init(Logger::Severity::kWarning);
+  SetLogger(logger);
+
+  int evaluated = 0;
+  DEBUG("value %d", count_evaluation(&evaluated));
+  INFO("value %d", count_evaluation(&evaluated));
+  ASSERT_EQ(0, evaluated);
+  ASSERT_TRUE(logger->messages.empty());
+
+  WARNING("value %d", count_evaluation(&evaluated));
+  ASSERT_EQ(1, evaluated);
+  ASSERT_EQ(1u, logger->messages.size());
+  ASSERT_EQ(Logger::Severity::kWarning, logger->messages[0].first);
+  ASSERT_EQ("value 1", logger->messages[0].second);
+
+  logger->SetSeverity(Logger::Severity::kDebug);
+  DEBUG("value %d", count_evaluation(&evaluated));
+  ASSERT_EQ(2, evaluated);
+  ASSERT_EQ(2u, logger->messages.size());
+}
+
+TEST(Logger, SeverityFromString) {
+  auto logger = std::make_shared<RecordingLogger>();
+  ASSERT_TRUE(logger->SetSeverityFromString("error"));
+  ASSERT_EQ(Logger::Severity::kError, logger->GetSeverity());
+  ASSERT_FALSE(logger->IsEnabled(Logger::Severity::kWarning));
+  ASSERT_TRUE(logger->IsEnabled(Logger::Severity::kFatal));
+  ASSERT_FALSE(logger->SetSeverityFromString("verbose"));
+  ASSERT_EQ(Logger::Severity::kError, logger->GetSeverity());
+}
+
+TEST(AsyncLogWriter, WritesRecordsInOrder) {
+  std::vector<std::string> written;
+  {
+    AsyncLogWriter writer(128, [&](const AsyncLogWriter::Record &record) {
+      written.push_back(record.message);
+    });
+    for (int n = 0; n < 100; n++)
+      ASSERT_TRUE(writer.post(make_record(std::to_string(n))));
+    writer.stop();
+  }
+
+  ASSERT_EQ(100u, written.size());
+  for (int n = 0; n < 100; n++)
+    ASSERT_EQ(std::to_string(n), written[n]);
+}
+
+TEST(AsyncLogWriter, ReportsDroppedRecords) {
+  std::mutex lock;
+  std::condition_variable cond;
+  bool writing = false;
+  bool blocked = true;
+  std::vector<AsyncLogWriter::Record> written;
+
+  AsyncLogWriter writer(4, [&](const AsyncLogWriter::Record &record) {
+    std::unique_lock<std::mutex> l(lock);
+    written.push_back(record);
+    writing = true;
+    cond.notify_all();
+    cond.wait(l, [&]() { return !blocked; });
+  });
+
+  // Keep the writer busy with the first record so the queue fills up
+  ASSERT_TRUE(writer.post(make_record("first")));
+  {
+    std::unique_lock<std::mutex> l(lock);
+    cond.wait(l, [&]() { return writing; });
+  }
+
+  // Four fit into the queue, the other three are dropped
+  for (int n = 0; n < 7; n++)
+    ASSERT_TRUE(writer.post(make_record(std::to_string(n))));
+
+  {
+    std::lock_guard<std::mutex> l(lock);
+    blocked = false;
+  }
+  cond.notify_all();
+  writer.stop();
+
+  ASSERT_EQ(6u, written.size());
+  ASSERT_EQ("first", written[0].message);
+  for (int n = 0; n < 4; n++)
+    ASSERT_EQ(std::to_string(n), written[n + 1].message);
+  ASSERT_EQ(Logger::Severity::kWarning, written[5].severity);
+  ASSERT_EQ("Dropped 3 log messages as the log queue was full", written[5].message);
+}
+
+TEST(AsyncLogWriter, RejectsRecordsOnceStopped) {
+  std::vector<std::string> written;
+  AsyncLogWriter writer(4, [&](const AsyncLogWriter::Record &record) {
+    written.push_back(record.message);
+  });
+
+  ASSERT_TRUE(writer.post(make_record("before")));
+  writer.stop();
+
+  // The caller has to write the record itself now
+  ASSERT_FALSE(writer.post(make_record("after")));
+  ASSERT_EQ(std::vector<std::string>{"before"}, written);
+}
+}  // namespace anbox
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/network/send_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+struct SocketPair {
+  SocketPair() {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+      throw std::runtime_error("Failed to create socket pair");
+
+    const int size = 4096;
+    ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    sender = anbox::Fd{fds[0]};
+    receiver = anbox::Fd{fds[1]};
+  }
+
+  std::vector<char> read(std::size_t size) {
+    std::vector<char> data(size);
+    std::size_t offset = 0;
+    while (offset < size) {
+      const auto n = ::read(receiver, data.data() + offset, size - offset);
+      if (n <= 0)
+        break;
+      offset += n;
+    }
+    data.resize(offset);
+    return data;
+  }
+
+  anbox::Fd sender;
+  anbox::Fd receiver;
+};
+
+std::vector<char> make_data(std::size_t size, char start = 0) {
+  std::vector<char> data(size);
+  std::iota(data.begin(), data.end(), start);
+  return data;
+}
+}  // namespace
+
+namespace anbox {
+namespace network {
+TEST(SendQueue, GatheredDataArrivesInOrder) {
+  SocketPair sockets;
+  SendQueue queue(sockets.sender);
+
+  const std::string header{"head"};
+  const std::string payload{"payload"};
+  struct iovec iov[2] = {
+      {const_cast<char*>(header.data()), header.size()},
+      {const_cast<char*>(payload.data()), payload.size()}};
+
+  ASSERT_FALSE(queue.send(iov, 2));
+  ASSERT_EQ(0u, queue.queued_bytes());
+
+  const auto data = sockets.read(header.size() + payload.size());
+  ASSERT_EQ("headpayload", std::string(data.begin(), data.end()));
+}
+
+TEST(SendQueue, QueuesWhatTheSocketDoesNotTake) {
+  SocketPair sockets;
+  SendQueue queue(sockets.sender);
+
+  const auto first = make_data(256 * 1024);
+  const auto second = make_data(1024, 42);
+  struct iovec iov = {const_cast<char*>(first.data()), first.size()};
+  ASSERT_TRUE(queue.send(&iov, 1));
+  ASSERT_GT(queue.queued_bytes(), 0u);
+
+  // Already waiting for the socket to be writable
+  iov = {const_cast<char*>(second.data()), second.size()};
+  ASSERT_FALSE(queue.send(&iov, 1));
+  ASSERT_EQ(queue.total_queued_bytes(), queue.queued_bytes());
+
+  std::vector<char> received;
+  std::thread reader([&]() { received = sockets.read(first.size() + second.size()); });
+  while (queue.flush())
+    std::this_thread::yield();
+  reader.join();
+
+  ASSERT_EQ(0u, queue.queued_bytes());
+  ASSERT_GT(queue.total_queued_bytes(), 0u);
+
+  auto expected = first;
+  expected.insert(expected.end(), second.begin(), second.end());
+  ASSERT_EQ(expected, received);
+}
+
+TEST(SendQueue, BlocksSenderAboveLimit) {
+  SocketPair sockets;
+  const std::size_t limit = 16 * 1024;
+  SendQueue queue(sockets.sender, limit);
+
+  const auto data = make_data(64 * 1024);
+  std::vector<char> received;
+  std::thread reader([&]() { received = sockets.read(4 * data.size()); });
+
+  for (int n = 0; n < 4; n++) {
+    struct iovec iov = {const_cast<char*>(data.data()), data.size()};
+    queue.send(&iov, 1);
+    ASSERT_LE(queue.queued_bytes(), limit);
+  }
+  queue.drain();
+  reader.join();
+
+  ASSERT_EQ(0u, queue.queued_bytes());
+  ASSERT_EQ(4 * data.size(), received.size());
+}
+
+TEST(SendQueue, RawGatheredDataFollowsQueuedData) {
+  SocketPair sockets;
+  SendQueue queue(sockets.sender);
+
+  const auto queued = make_data(256 * 1024);
+  struct iovec iov = {const_cast<char*>(queued.data()), queued.size()};
+  ASSERT_TRUE(queue.send(&iov, 1));
+
+  std::vector<char> received;
+  const std::string header{"head"};
+  const std::string payload{"payload"};
+  std::thread reader([&]() {
+    received = sockets.read(queued.size() + header.size() + payload.size());
+  });
+
+  struct iovec raw[2] = {
+      {const_cast<char*>(header.data()), header.size()},
+      {const_cast<char*>(payload.data()), payload.size()}};
+  ASSERT_EQ(static_cast<ssize_t>(header.size() + payload.size()), queue.send_raw(raw, 2));
+  ASSERT_EQ(0u, queue.queued_bytes());
+  reader.join();
+
+  auto expected = queued;
+  expected.insert(expected.end(), header.begin(), header.end());
+  expected.insert(expected.end(), payload.begin(), payload.end());
+  ASSERT_EQ(expected, received);
+}
+
+TEST(SendQueue, DiscardDropsQueuedData) {
+  SocketPair sockets;
+  SendQueue queue(sockets.sender);
+
+  const auto data = make_data(256 * 1024);
+  struct iovec iov = {const_cast<char*>(data.data()), data.size()};
+  ASSERT_TRUE(queue.send(&iov, 1));
+
+  queue.discard();
+  ASSERT_EQ(0u, queue.queued_bytes());
+  ASSERT_FALSE(queue.flush());
+}
+}  // namespace network
+}  // namespace anbox
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "anbox/qemu/adb_message_processor.h"
+#include "anbox/network/local_socket_messenger.h"
+#include "anbox/network/socket_connection.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace ba = boost::asio;
+
+namespace {
+using Socket = ba::local::stream_protocol::socket;
+
+// Far away from the ports a real adb server or emulator would use
+constexpr unsigned short test_listen_port{25585};
+
+std::vector<char> make_payload(std::size_t size, char seed) {
+  std::vector<char> payload(size);
+  for (std::size_t n = 0; n < size; n++)
+    payload[n] = static_cast<char>(seed + n % 251);
+  return payload;
+}
+
+bool connect_host(ba::ip::tcp::socket &host) {
+  const ba::ip::tcp::endpoint endpoint(ba::ip::address_v4::loopback(), test_listen_port);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    boost::system::error_code err;
+    host.connect(endpoint, err);
+    if (!err)
+      return true;
+    host.close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return false;
+}
+
+// Sends more than any socket buffer takes in each direction so the
+// processor has to wait for both sides to become writable again.
+void proxy_data(bool zero_copy) {
+  auto rt = anbox::Runtime::create(1);
+  rt->start();
+
+  auto server = std::make_shared<Socket>(rt->service());
+  Socket guest(rt->service());
+  ba::local::connect_pair(guest, *server);
+
+  auto messenger = std::make_shared<anbox::network::LocalSocketMessenger>(server);
+  auto connections = std::make_shared<anbox::network::Connections<anbox::network::SocketConnection>>();
+  auto processor = std::make_shared<anbox::qemu::AdbMessageProcessor>(
+      rt, messenger, anbox::qemu::AdbMessageProcessor::Config{1, zero_copy, test_listen_port});
+  auto connection = std::make_shared<anbox::network::SocketConnection>(
+      messenger, messenger, 0, connections, processor);
+  connections->add(connection);
+  connection->read_next_message();
+
+  ba::write(guest, ba::buffer(std::string("accept")));
+
+  ba::ip::tcp::socket host(rt->service());
+  ASSERT_TRUE(connect_host(host));
+
+  std::string reply(2, 0);
+  ba::read(guest, ba::buffer(&reply[0], reply.size()));
+  ASSERT_EQ("ok", reply);
+
+  ba::write(guest, ba::buffer(std::string("start")));
+
+  const auto to_guest = make_payload(4 * 1024 * 1024, 'a');
+  const auto to_host = make_payload(4 * 1024 * 1024, 'A');
+
+  std::thread host_writer([&]() { ba::write(host, ba::buffer(to_guest)); });
+  std::vector<char> received_by_guest(to_guest.size());
+  ba::read(guest, ba::buffer(received_by_guest));
+  host_writer.join();
+  ASSERT_EQ(to_guest, received_by_guest);
+
+  std::thread guest_writer([&]() { ba::write(guest, ba::buffer(to_host)); });
+  std::vector<char> received_by_host(to_host.size());
+  ba::read(host, ba::buffer(received_by_host));
+  guest_writer.join();
+  ASSERT_EQ(to_host, received_by_host);
+
+  host.close();
+  guest.close();
+  rt->stop();
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(AdbMessageProcessor, ProxiesDataWithCopies) {
+  proxy_data(false);
+}
+
+TEST(AdbMessageProcessor, ProxiesDataWithSplice) {
+  proxy_data(true);
+}
+}  // namespace qemu
+}  // namespace anbox
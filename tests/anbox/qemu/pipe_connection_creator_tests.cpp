@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/qemu/pipe_connection_creator.h"
+#include "anbox/stats/registry.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace ba = boost::asio;
+
+namespace {
+using Socket = ba::local::stream_protocol::socket;
+
+bool wait_for_connections(const anbox::qemu::PipeConnectionCreator &creator,
+                          std::uint64_t connections) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (creator.setup_stats().connections >= connections)
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return false;
+}
+}  // namespace
+
+namespace anbox {
+namespace qemu {
+TEST(PipeConnectionCreator, IdentifiesClients) {
+  using client_type = PipeConnectionCreator::client_type;
+  ASSERT_EQ(client_type::opengles, PipeConnectionCreator::identify_client("pipe:opengles"));
+  ASSERT_EQ(client_type::qemud_boot_properties,
+            PipeConnectionCreator::identify_client("pipe:qemud:boot-properties"));
+  ASSERT_EQ(client_type::qemud_adb, PipeConnectionCreator::identify_client("pipe:qemud:adb:5555"));
+  ASSERT_EQ(client_type::bootanimation,
+            PipeConnectionCreator::identify_client("pipe:anbox:bootanimation"));
+  ASSERT_EQ(client_type::invalid, PipeConnectionCreator::identify_client("pipe:unknown"));
+  ASSERT_EQ(client_type::invalid, PipeConnectionCreator::identify_client(""));
+}
+
+TEST(PipeConnectionCreator, AcceptsIdentifierSentInPieces) {
+  auto rt = Runtime::create(1);
+  rt->start();
+
+  auto server = std::make_shared<Socket>(rt->service());
+  Socket client(rt->service());
+  ba::local::connect_pair(client, *server);
+
+  PipeConnectionCreator creator(nullptr, rt);
+  creator.create_connection_for(server);
+
+  // Nothing is set up until the identifier is complete and the caller
+  // doesn't block waiting for it.
+  ba::write(client, ba::buffer(std::string("pipe:qemud:unk")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_EQ(0u, creator.setup_stats().connections);
+
+  const std::string rest("nown\0trailing", 13);
+  ba::write(client, ba::buffer(rest));
+  ASSERT_TRUE(wait_for_connections(creator, 1));
+
+  // The setup is exported along with all other metrics
+  const auto metrics = stats::Registry::instance().to_prometheus();
+  ASSERT_NE(std::string::npos, metrics.find("anbox_pipe_connections_total{client=\"unknown\"} 1\n"));
+  ASSERT_NE(std::string::npos, metrics.find("anbox_pipe_setup_duration_us_count 1\n"));
+
+  client.close();
+  rt->stop();
+}
+
+TEST(PipeConnectionCreator, DropsClientsWithOversizedIdentifier) {
+  auto rt = Runtime::create(1);
+  rt->start();
+
+  auto server = std::make_shared<Socket>(rt->service());
+  Socket client(rt->service());
+  ba::local::connect_pair(client, *server);
+
+  PipeConnectionCreator creator(nullptr, rt);
+  creator.create_connection_for(server);
+
+  ba::write(client, ba::buffer(std::string(1024, 'a')));
+
+  // The connection is closed without reading the rest of what we sent
+  // so depending on timing we see either a reset or the end of the stream.
+  char byte = 0;
+  boost::system::error_code err;
+  ba::read(client, ba::buffer(&byte, 1), err);
+  ASSERT_TRUE(err == ba::error::eof || err == ba::error::connection_reset);
+  ASSERT_EQ(0u, creator.setup_stats().connections);
+
+  rt->stop();
+}
+}  // namespace qemu
+}  // namespace anbox
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include "anbox/rpc/constants.h"
+#include "anbox/rpc/message_processor.h"
+
+#include "anbox_rpc.pb.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+class RecordingMessageProcessor : public anbox::rpc::MessageProcessor {
+ public:
+  RecordingMessageProcessor()
+      : anbox::rpc::MessageProcessor(nullptr, std::make_shared<anbox::rpc::PendingCallCache>()) {}
+
+  void dispatch(anbox::rpc::Invocation const &invocation) override {
+    methods.push_back(invocation.method_name());
+    parameter_sizes.push_back(invocation.parameters().size());
+  }
+
+  std::vector<std::string> methods;
+  std::vector<std::size_t> parameter_sizes;
+};
+
+std::vector<std::uint8_t> make_invocation(const std::string &method, std::size_t parameter_size = 0) {
+  anbox::protobuf::rpc::Invocation invocation;
+  invocation.set_id(1);
+  invocation.set_method_name(method);
+  invocation.set_parameters(std::string(parameter_size, 'x'));
+  invocation.set_protocol_version(1);
+
+  const auto payload = invocation.SerializeAsString();
+  std::vector<std::uint8_t> message(anbox::rpc::header_size + payload.size());
+  message[0] = static_cast<std::uint8_t>((payload.size() >> 16) & 0xff);
+  message[1] = static_cast<std::uint8_t>((payload.size() >> 8) & 0xff);
+  message[2] = static_cast<std::uint8_t>(payload.size() & 0xff);
+  message[3] = anbox::rpc::MessageType::invocation;
+  std::memcpy(message.data() + anbox::rpc::header_size, payload.data(), payload.size());
+  return message;
+}
+}  // namespace
+
+namespace anbox {
+namespace rpc {
+TEST(MessageProcessor, ProcessesAllMessagesOfASingleRead) {
+  RecordingMessageProcessor processor;
+
+  std::vector<std::uint8_t> data;
+  for (const auto &method : {"first", "second", "third"}) {
+    const auto message = make_invocation(method);
+    data.insert(data.end(), message.begin(), message.end());
+  }
+
+  ASSERT_TRUE(processor.process_data(data));
+  ASSERT_EQ((std::vector<std::string>{"first", "second", "third"}), processor.methods);
+}
+
+TEST(MessageProcessor, WaitsForCompleteHeaderAndMessage) {
+  RecordingMessageProcessor processor;
+  const auto message = make_invocation("split");
+
+  // Feed the message byte by byte so we see every partial header
+  for (std::size_t n = 0; n < message.size() - 1; n++) {
+    ASSERT_TRUE(processor.process_data({message[n]}));
+    ASSERT_TRUE(processor.methods.empty());
+  }
+
+  ASSERT_TRUE(processor.process_data({message.back()}));
+  ASSERT_EQ(std::vector<std::string>{"split"}, processor.methods);
+}
+
+TEST(MessageProcessor, ReceivesLargeMessagesInPlace) {
+  RecordingMessageProcessor processor;
+
+  auto data = make_invocation("small");
+  const auto large = make_invocation("large", 4 * 1024 * 1024);
+  data.insert(data.end(), large.begin(), large.end());
+  const auto tail = make_invocation("tail");
+  data.insert(data.end(), tail.begin(), tail.end());
+
+  std::size_t written = 0;
+  while (written < data.size()) {
+    std::size_t size = 0;
+    auto dst = processor.prepare_data(&size);
+    ASSERT_NE(nullptr, dst);
+    ASSERT_GT(size, 0u);
+    size = std::min(size, data.size() - written);
+    std::memcpy(dst, data.data() + written, size);
+    ASSERT_TRUE(processor.commit_data(size));
+    written += size;
+  }
+
+  ASSERT_EQ((std::vector<std::string>{"small", "large", "tail"}), processor.methods);
+  ASSERT_EQ(4u * 1024 * 1024, processor.parameter_sizes[1]);
+}
+}  // namespace rpc
+}  // namespace anbox
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/runtime.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+
+namespace {
+// CPUs this process may run on, which can be fewer than the online ones
+std::vector<int> allowed_cpus() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  EXPECT_EQ(0, ::sched_getaffinity(0, sizeof(allowed), &allowed));
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed))
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+}  // namespace
+
+namespace anbox {
+TEST(Runtime, ParsesExecutorConfig) {
+  const auto cpus = allowed_cpus();
+  ASSERT_FALSE(cpus.empty());
+  const auto first_cpu = cpus.front();
+  const auto last_cpu = cpus.back();
+  const auto config = Runtime::parse_config(
+      "default=2,input=1@" + std::to_string(last_cpu) + ",audio=1@" + std::to_string(first_cpu) + "+" +
+      std::to_string(last_cpu) + ",adb=4");
+  ASSERT_EQ(2u, config.default_executor.threads);
+  ASSERT_TRUE(config.default_executor.cpus.empty());
+  ASSERT_EQ(3u, config.executors.size());
+
+  const auto &input = config.executors.at(Runtime::Subsystem::Input);
+  ASSERT_EQ(1u, input.threads);
+  ASSERT_EQ(std::vector<int>{last_cpu}, input.cpus);
+
+  const auto &audio = config.executors.at(Runtime::Subsystem::Audio);
+  ASSERT_EQ((std::vector<int>{first_cpu, last_cpu}), audio.cpus);
+
+  ASSERT_EQ(4u, config.executors.at(Runtime::Subsystem::Adb).threads);
+}
+
+TEST(Runtime, EmptyExecutorConfigUsesDefaults) {
+  const auto config = Runtime::parse_config("");
+  ASSERT_EQ(std::uint32_t{Runtime::worker_threads}, config.default_executor.threads);
+  ASSERT_TRUE(config.executors.empty());
+}
+
+TEST(Runtime, RejectsMalformedExecutorConfig) {
+  ASSERT_THROW(Runtime::parse_config("input"), std::runtime_error);
+  ASSERT_THROW(Runtime::parse_config("input=0"), std::runtime_error);
+  ASSERT_THROW(Runtime::parse_config("input=one"), std::runtime_error);
+  ASSERT_THROW(Runtime::parse_config("input=1@x"), std::runtime_error);
+  ASSERT_THROW(Runtime::parse_config("display=1"), std::runtime_error);
+}
+
+TEST(Runtime, RejectsUnavailableCpus) {
+  // The first CPU we aren't allowed to run on, online or not
+  const auto cpus = allowed_cpus();
+  int unavailable = 0;
+  while (std::find(cpus.begin(), cpus.end(), unavailable) != cpus.end())
+    unavailable++;
+  ASSERT_THROW(Runtime::parse_config("input=1@" + std::to_string(unavailable)), std::runtime_error);
+  ASSERT_THROW(Runtime::parse_config("input=1@" + std::to_string(cpus.front()) + "+" + std::to_string(CPU_SETSIZE)),
+               std::runtime_error);
+}
+
+TEST(Runtime, SubsystemsWithoutExecutorShareDefault) {
+  auto rt = Runtime::create(Runtime::parse_config("input=1"));
+  ASSERT_EQ(rt, rt->executor(Runtime::Subsystem::Adb));
+  ASSERT_NE(rt, rt->executor(Runtime::Subsystem::Input));
+  ASSERT_NE(&rt->service(), &rt->executor(Runtime::Subsystem::Input)->service());
+  ASSERT_EQ(2u, rt->stats().size());
+}
+
+TEST(Runtime, BusyExecutorDoesNotDelayOthers) {
+  auto rt = Runtime::create(Runtime::parse_config("default=1,input=1"));
+  rt->start();
+
+  std::mutex lock;
+  std::condition_variable cv;
+  bool release = false;
+
+  // Keep the only thread of the default executor busy.
+  rt->post([&]() {
+    std::unique_lock<std::mutex> l(lock);
+    cv.wait(l, [&]() { return release; });
+  });
+
+  std::promise<void> input_ran;
+  rt->executor(Runtime::Subsystem::Input)->post([&]() { input_ran.set_value(); });
+  ASSERT_EQ(std::future_status::ready,
+            input_ran.get_future().wait_for(std::chrono::seconds(5)));
+
+  {
+    std::lock_guard<std::mutex> l(lock);
+    release = true;
+  }
+  cv.notify_all();
+
+  std::promise<void> default_ran;
+  rt->post([&]() { default_ran.set_value(); });
+  ASSERT_EQ(std::future_status::ready,
+            default_ran.get_future().wait_for(std::chrono::seconds(5)));
+
+  const auto stats = rt->stats();
+  ASSERT_EQ("default", stats[0].name);
+  ASSERT_GE(stats[0].handlers, 2u);
+  ASSERT_GE(stats[0].max_queued, 1u);
+  ASSERT_EQ("input", stats[1].name);
+  ASSERT_GE(stats[1].handlers, 1u);
+
+  rt->stop();
+}
+}  // namespace anbox
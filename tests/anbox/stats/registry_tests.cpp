@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 Simon Fels <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "anbox/stats/registry.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace anbox {
+namespace stats {
+TEST(Registry, CountsFromAllThreads) {
+  Registry registry;
+  auto &counter = registry.counter("test_total", "Test counter");
+
+  std::vector<std::thread> threads;
+  for (int n = 0; n < 8; n++)
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 1000; i++)
+        counter.add();
+    });
+  for (auto &thread : threads)
+    thread.join();
+
+  ASSERT_EQ(8000u, counter.value());
+}
+
+TEST(Registry, ReturnsExistingMetric) {
+  Registry registry;
+  auto &a = registry.counter("test_total", "Test counter", {{"kind", "a"}});
+  auto &b = registry.counter("test_total", "Test counter", {{"kind", "b"}});
+  ASSERT_NE(&a, &b);
+  ASSERT_EQ(&a, &registry.counter("test_total", "Test counter", {{"kind", "a"}}));
+  ASSERT_THROW(registry.gauge("test_total", "Test gauge"), std::logic_error);
+}
+
+TEST(Registry, RemovesMetric) {
+  Registry registry;
+  registry.gauge("test_thread_bytes", "Per thread", {{"thread", "1"}}).set(1);
+  registry.gauge("test_thread_bytes", "Per thread", {{"thread", "2"}}).set(2);
+
+  registry.remove("test_thread_bytes", {{"thread", "1"}});
+  ASSERT_EQ("# HELP test_thread_bytes Per thread\n"
+            "# TYPE test_thread_bytes gauge\n"
+            "test_thread_bytes{thread=\"2\"} 2\n",
+            registry.to_prometheus());
+
+  registry.remove("test_thread_bytes", {{"thread", "2"}});
+  ASSERT_EQ("", registry.to_prometheus());
+}
+
+TEST(Registry, HistogramSortsIntoBuckets) {
+  Histogram histogram(Histogram::exponential_bounds(10, 3));
+  histogram.observe(5);
+  histogram.observe(10);
+  histogram.observe(15);
+  histogram.observe(1000);
+
+  const auto snapshot = histogram.snapshot();
+  ASSERT_EQ((std::vector<std::uint64_t>{10, 20, 40}), snapshot.bounds);
+  ASSERT_EQ((std::vector<std::uint64_t>{2, 1, 0, 1}), snapshot.buckets);
+  ASSERT_EQ(4u, snapshot.count);
+  ASSERT_EQ(1030u, snapshot.sum);
+}
+
+TEST(Registry, RendersPrometheusText) {
+  Registry registry;
+  registry.counter("test_bytes_total", "Bytes", {{"direction", "sent"}}).add(42);
+  registry.gauge("test_queued", "Queued").set(-3);
+  auto &histogram = registry.histogram("test_duration_us", "Duration", {10, 100});
+  histogram.observe(7);
+  histogram.observe(50);
+
+  const std::string expected =
+      "# HELP test_bytes_total Bytes\n"
+      "# TYPE test_bytes_total counter\n"
+      "test_bytes_total{direction=\"sent\"} 42\n"
+      "# HELP test_duration_us Duration\n"
+      "# TYPE test_duration_us histogram\n"
+      "test_duration_us_bucket{le=\"10\"} 1\n"
+      "test_duration_us_bucket{le=\"100\"} 2\n"
+      "test_duration_us_bucket{le=\"+Inf\"} 2\n"
+      "test_duration_us_sum 57\n"
+      "test_duration_us_count 2\n"
+      "# HELP test_queued Queued\n"
+      "# TYPE test_queued gauge\n"
+      "test_queued -3\n";
+  ASSERT_EQ(expected, registry.to_prometheus());
+}
+}  // namespace stats
+}  // namespace anbox
@@ -245,5 +245,87 @@ TEST(MultiWindowManager, TestUpdateWindow) {
   vector<SDL_Event> emptyEventList;
   TestUpdateWindow(emptyEventList);
 }
+
+TEST(MultiWindowManager, TestDeltaOnlyUpdatesChangedTasks) {
+  user_window_event = SDL_RegisterEvents(1);
+
+  auto first_window = WindowState{
+    Display::Id{1},
+    true,
+    graphics::Rect{0, 0, 1024, 768},
+    "org.anbox.foo",
+    Task::Id{1},
+    Stack::Id::Freeform,
+  };
+
+  auto second_window = WindowState{
+    Display::Id{1},
+    true,
+    graphics::Rect{100, 100, 500, 500},
+    "org.anbox.bar",
+    Task::Id{2},
+    Stack::Id::Freeform,
+  };
+
+  std::shared_ptr<platform::BasePlatform> platform = std::make_shared<MockPlatform>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform, nullptr, app_db);
+  auto window1 = std::make_shared<MockWindow>(first_window.task(), first_window.frame(), first_window.package_name());
+  auto window2 = std::make_shared<MockWindow>(second_window.task(), second_window.frame(), second_window.package_name());
+  wm->insert_task(first_window.task(), window1);
+  wm->insert_task(second_window.task(), window2);
+  EXPECT_CALL(*window1, update_state(_)).Times(1);
+  EXPECT_CALL(*window2, update_state(_)).Times(0);
+
+  WindowStateDelta delta;
+  delta.changed.push_back(first_window);
+  wm->apply_window_state_delta(delta);
+
+  vector<SDL_Event> emptyEventList;
+  TestUpdateWindow(emptyEventList);
+}
+
+TEST(MultiWindowManager, TestDeltaCreatesAndDestroysWindows) {
+  user_window_event = SDL_RegisterEvents(1);
+
+  auto first_window = WindowState{
+    Display::Id{1},
+    true,
+    graphics::Rect{0, 0, 1024, 768},
+    "org.anbox.foo",
+    Task::Id{1},
+    Stack::Id::Freeform,
+  };
+
+  auto second_window = WindowState{
+    Display::Id{1},
+    true,
+    graphics::Rect{100, 100, 500, 500},
+    "org.anbox.bar",
+    Task::Id{2},
+    Stack::Id::Freeform,
+  };
+
+  std::shared_ptr<platform::BasePlatform> platform = std::make_shared<MockPlatform>();
+  auto app_db = std::make_shared<application::Database>();
+  auto wm = std::make_shared<wm::MultiWindowManager>(platform, nullptr, app_db);
+  auto window = platform->create_window(first_window.task(), first_window.frame(), first_window.package_name());
+  wm->insert_task(first_window.task(), window);
+
+  vector<SDL_Event> eventList;
+  SDL_Event event;
+  makeEvent(event, platform::USER_CREATE_WINDOW, Task::Id{2}, graphics::Rect{100, 100, 500, 500}, "org.anbox.bar");
+  eventList.push_back(event);
+  makeEvent(event, platform::USER_DESTROY_WINDOW, Task::Id{1}, graphics::Rect{0, 0, 0, 0}, "");
+  eventList.push_back(event);
+
+  WindowStateDelta delta;
+  delta.added.push_back(second_window);
+  delta.removed.push_back(first_window.task());
+  // Removals of tasks we don't know about are ignored
+  delta.removed.push_back(Task::Id{3});
+  wm->apply_window_state_delta(delta);
+  TestUpdateWindow(eventList);
+}
 }
 }